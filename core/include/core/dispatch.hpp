@@ -209,10 +209,16 @@ dispatchRequest(helix::BorrowedLane conversation, helix_ng::RecvInlineResult rec
 	co_return {};
 }
 
+//! Tails up to this size are received inline (i.e., directly into the IPC queue)
+//! instead of into a separately allocated buffer. This leaves room for the results
+//! of additional items that are received alongside the tail.
+inline constexpr size_t inlineTailLimit = helix_ng::maxRecvInlineSize / 2;
+
 //! Receive the tail of a message and decode it into an existing message.
 //!
 //! Optionally receives additional message items alongside the tail in a single
 //! exchangeMsgs call. The results of the additional items are returned on success.
+//! Small tails are received inline, larger tails are received into a buffer.
 //!
 //! @param[in] conversation
 //! Lane on which to receive the tail.
@@ -227,24 +233,40 @@ async::result<std::expected<decltype(helix_ng::createResultsTuple(std::declval<I
 dispatchTail(Message &msg, helix::BorrowedDescriptor conversation, bragi::preamble preamble, Items &&...items) {
 	using ExtraResults = decltype(helix_ng::createResultsTuple(std::declval<Items>()...));
 
+	auto decode = [&] (auto &results, const void *data, size_t size)
+			-> std::expected<ExtraResults, DispatchError> {
+		bool anyError = [&]<std::size_t ...Is>(std::index_sequence<Is...>) {
+			return ((results.template get<Is>().error() != kHelErrNone) || ...);
+		}(std::make_index_sequence<1 + sizeof...(Items)>{});
+		if (anyError)
+			return std::unexpected(DispatchError::ipcError);
+
+		bragi::limited_reader reader{data, size};
+		if (!msg.decode_tail(reader))
+			return std::unexpected(DispatchError::malformedMessage);
+
+		return [&]<std::size_t ...Is>(std::index_sequence<Is...>) -> ExtraResults {
+			return ExtraResults{std::move(results.template get<Is + 1>())...};
+		}(std::make_index_sequence<std::tuple_size_v<ExtraResults>>{});
+	};
+
+	if (preamble.tail_size() <= inlineTailLimit) {
+		auto results = co_await helix_ng::exchangeMsgs(
+			conversation,
+			helix_ng::recvInline(preamble.tail_size()),
+			std::forward<Items>(items)...
+		);
+		auto &recvTail = results.template get<0>();
+		if (recvTail.error() != kHelErrNone)
+			co_return std::unexpected(DispatchError::ipcError);
+		co_return decode(results, recvTail.data(), recvTail.length());
+	}
+
 	std::vector<char> tail(preamble.tail_size());
 	auto results = co_await helix_ng::exchangeMsgs(
 		conversation,
 		helix_ng::recvBuffer(tail.data(), tail.size()),
 		std::forward<Items>(items)...
 	);
-
-	bool anyError = [&]<std::size_t ...Is>(std::index_sequence<Is...>) {
-		return ((results.template get<Is>().error() != kHelErrNone) || ...);
-	}(std::make_index_sequence<1 + sizeof...(Items)>{});
-	if (anyError)
-		co_return std::unexpected(DispatchError::ipcError);
-
-	bragi::limited_reader reader{tail.data(), tail.size()};
-	if (!msg.decode_tail(reader))
-		co_return std::unexpected(DispatchError::malformedMessage);
-
-	co_return [&]<std::size_t ...Is>(std::index_sequence<Is...>) -> ExtraResults {
-		return ExtraResults{std::move(results.template get<Is + 1>())...};
-	}(std::make_index_sequence<std::tuple_size_v<ExtraResults>>{});
+	co_return decode(results, tail.data(), tail.size());
 }
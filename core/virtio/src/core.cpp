@@ -314,7 +314,7 @@ struct StandardPciTransport : Transport {
 	friend struct StandardPciQueue;
 
 	StandardPciTransport(protocols::hw::Device hw_device,
-			bool useMsi,
+			unsigned int numMsis,
 			Mapping common_mapping, Mapping notify_mapping,
 			Mapping isr_mapping, Mapping device_mapping,
 			unsigned int notify_multiplier, helix::UniqueDescriptor irq,
@@ -348,10 +348,13 @@ private:
 	arch::mem_space _deviceSpace() { return arch::mem_space{_deviceMapping.get()}; }
 
 	async::detached _processIrqs();
+	// Handles the MSI that is shared by all queues without a dedicated MSI.
 	async::detached _processQueueMsi();
+	async::detached _processQueueMsi(StandardPciQueue *queue);
 
 	protocols::hw::Device _hwDevice;
 	bool _useMsi;
+	unsigned int _numMsis;
 	Mapping _commonMapping;
 	Mapping _notifyMapping;
 	Mapping _isrMapping;
@@ -365,6 +368,8 @@ private:
 };
 
 struct StandardPciQueue final : Queue {
+	friend struct StandardPciTransport;
+
 	StandardPciQueue(
 	    StandardPciTransport *transport,
 	    unsigned int queue_index,
@@ -386,11 +391,13 @@ protected:
 private:
 	StandardPciTransport *_transport;
 	arch::scalar_register<uint16_t> _notifyRegister;
+	// Dedicated MSI of this queue (if any).
+	helix::UniqueDescriptor _msi;
 };
 
 StandardPciTransport::StandardPciTransport(
     protocols::hw::Device hw_device,
-    bool useMsi,
+    unsigned int numMsis,
     Mapping common_mapping,
     Mapping notify_mapping,
     Mapping isr_mapping,
@@ -403,7 +410,8 @@ StandardPciTransport::StandardPciTransport(
 )
 : Transport(std::move(dmaSpace), iommuActive),
   _hwDevice{std::move(hw_device)},
-  _useMsi{useMsi},
+  _useMsi{numMsis > 0},
+  _numMsis{numMsis},
   _commonMapping{std::move(common_mapping)},
   _notifyMapping{std::move(notify_mapping)},
   _isrMapping{std::move(isr_mapping)},
@@ -510,11 +518,25 @@ async::result<Queue *> StandardPciTransport::setupQueue(unsigned int queue_index
 	_commonSpace().store(PCI_QUEUE_USED[0], used_physical);
 	_commonSpace().store(PCI_QUEUE_USED[1], used_physical >> 32);
 
-	// Setup MSI-X.
+	// Setup MSI-X. If the device has enough vectors, each queue gets a dedicated vector
+	// (and the vectors are spread across CPUs). Otherwise, queues share vector 0.
 	if(_useMsi) {
-		_commonSpace().store(PCI_QUEUE_MSIX_VECTOR, 0);
-		if(_commonSpace().load(PCI_QUEUE_MSIX_VECTOR) != 0)
-			throw std::runtime_error("Device failed to allocate MSI-X interrupt");
+		uint16_t vector = 0;
+		if(queue_index + 1 < _numMsis) {
+			_commonSpace().store(PCI_QUEUE_MSIX_VECTOR, queue_index + 1);
+			if(_commonSpace().load(PCI_QUEUE_MSIX_VECTOR) == queue_index + 1) {
+				vector = queue_index + 1;
+				auto msi = co_await _hwDevice.installMsi(vector);
+				protocols::hw::spreadIrq(msi, vector);
+				_queues[queue_index]->_msi = std::move(msi);
+			}
+		}
+
+		if(!vector) {
+			_commonSpace().store(PCI_QUEUE_MSIX_VECTOR, 0);
+			if(_commonSpace().load(PCI_QUEUE_MSIX_VECTOR) != 0)
+				throw std::runtime_error("Device failed to allocate MSI-X interrupt");
+		}
 	}
 
 	_commonSpace().store(PCI_QUEUE_ENABLE, 1);
@@ -526,8 +548,13 @@ void StandardPciTransport::runDevice() {
 	// Finally set the DRIVER_OK bit to finish the configuration.
 	_commonSpace().store(PCI_DEVICE_STATUS, _commonSpace().load(PCI_DEVICE_STATUS) | DRIVER_OK);
 
-	if(_useMsi)
+	if(_useMsi) {
 		_processQueueMsi();
+		for(auto &queue : _queues) {
+			if(queue->_msi)
+				_processQueueMsi(queue.get());
+		}
+	}
 	_processIrqs();
 }
 
@@ -646,8 +673,23 @@ async::detached StandardPciTransport::_processQueueMsi() {
 
 		HEL_CHECK(helAcknowledgeIrq(_queueMsi.getHandle(), kHelAckAcknowledge, sequence));
 
-		for(auto &queue : _queues)
-			queue->processInterrupt();
+		for(auto &queue : _queues) {
+			if(!queue->_msi)
+				queue->processInterrupt();
+		}
+	}
+}
+
+async::detached StandardPciTransport::_processQueueMsi(StandardPciQueue *queue) {
+	uint64_t sequence = 0;
+	while(true) {
+		auto await = co_await helix_ng::awaitEvent(queue->_msi, sequence);
+		HEL_CHECK(await.error());
+		sequence = await.sequence();
+
+		HEL_CHECK(helAcknowledgeIrq(queue->_msi.getHandle(), kHelAckAcknowledge, sequence));
+
+		queue->processInterrupt();
 	}
 }
 
@@ -159,6 +159,8 @@ async::result<void> PciExpressController::disable() {
 async::result<void> PciExpressController::setupIOQueueInterrupts(size_t queueId, size_t vector) {
 	if(irqMode_ == InterruptMode::Msi || irqMode_ == InterruptMode::MsiX) {
 		auto irq = co_await hwDevice_.installMsi(vector);
+		// Each queue's completions are handled on a different CPU.
+		protocols::hw::spreadIrq(irq, queueId);
 		handleMsis(std::move(irq), queueId, irqMode_ == InterruptMode::MsiX);
 	}
 }
@@ -107,6 +107,9 @@ struct FileSystem final : BaseFileSystem {
 	async::result<std::shared_ptr<BaseInode>>
 	createRegular(int uid, int gid, uint32_t parentIno) override;
 	protocols::fs::FsStats getFsStats() override;
+	async::result<frg::expected<protocols::fs::Error, size_t>>
+	copyFileRange(uint32_t sourceIno, uint64_t sourceOffset,
+			uint32_t targetIno, uint64_t targetOffset, size_t length) override;
 
 	async::detached initiateInode(std::shared_ptr<Inode> inode);
 	async::detached manageFileData(std::shared_ptr<Inode> inode);
@@ -51,6 +51,27 @@ readEntries(void *object) {
 	};
 }
 
+async::result<std::expected<void, managarm::fs::Errors>>
+readEntriesBatch(void *object, protocols::fs::DirentBuffer &buffer) {
+	auto self = static_cast<btrfs::OpenFile *>(object);
+
+	while (true) {
+		auto offset = self->offset;
+		auto entry = co_await readEntries(object);
+		if (!entry) {
+			if (entry.error() == managarm::fs::Errors::END_OF_FILE)
+				co_return {};
+			co_return std::unexpected(entry.error());
+		}
+
+		// Rewind such that the entry is returned again by the next call.
+		if (!buffer.append(*entry)) {
+			self->offset = offset;
+			co_return {};
+		}
+	}
+}
+
 async::result<int> getFileFlags(void *) {
 	std::println("libblockfs: getFileFlags is stubbed");
 	co_return 0;
@@ -235,9 +256,12 @@ constinit protocols::fs::FileOperations fileOperations{
     .seekEof = &doSeekEof<FileSystem>,
     .read = &doRead<FileSystem>,
     .pread = &doPread<FileSystem>,
+    .readMemory = &doReadMemory<FileSystem>,
+    .preadMemory = &doPreadMemory<FileSystem>,
     .write = &doWrite<FileSystem>,
     .pwrite = &doPwrite<FileSystem>,
     .readEntries = &readEntries,
+    .readEntriesBatch = &readEntriesBatch,
     .accessMemory = &doAccessMemory<FileSystem>,
     .truncate = &doTruncate<FileSystem>,
     .flock = &doFlock<FileSystem>,
@@ -261,4 +285,10 @@ constinit protocols::fs::NodeOperations nodeOperations{
     .getLinkOrCreate = &getLinkOrCreate
 };
 
+async::result<frg::expected<protocols::fs::Error, size_t>>
+FileSystem::copyFileRange(uint32_t, uint64_t, uint32_t, uint64_t, size_t) {
+	// TODO: Share the source extents (i.e., reflink) once we support writing to btrfs.
+	co_return protocols::fs::Error::notSupported;
+}
+
 } // namespace blockfs::btrfs
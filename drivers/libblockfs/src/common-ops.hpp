@@ -1,6 +1,8 @@
 #pragma once
 
 #include <mutex>
+#include <optional>
+#include <vector>
 
 #include <async/algorithm.hpp>
 #include <core/clock.hpp>
@@ -106,8 +108,7 @@ async::result<protocols::fs::ReadResult> doReadImpl(T *inode, void *buffer, size
 	auto chunkOffset = offset;
 	offset += chunkSize;
 
-	// TODO: Add a sendFromMemory action to exchangeMsgs to avoid
-	// having to copy this data twice.
+	// Note that protocols::fs prefers doReadMemoryImpl() which avoids copying the data here.
 	auto readMemory = co_await helix_ng::readMemory(
 		inode->accessMemory(),
 		chunkOffset, chunkSize, buffer);
@@ -116,6 +117,47 @@ async::result<protocols::fs::ReadResult> doReadImpl(T *inode, void *buffer, size
 	co_return chunkSize;
 }
 
+// Like doReadImpl() but returns the range of the page cache that contains the data.
+// The inode stays locked (in shared mode) until the returned guard is released.
+template <Inode T>
+async::result<protocols::fs::ReadMemoryResult>
+doReadMemoryImpl(std::shared_ptr<T> inode, size_t length, auto &offset) {
+	protocols::ostrace::Timer timer;
+	frg::scope_exit evtOnExit{[&] {
+		ostContext.emit(
+			ostEvtRead,
+			ostAttrNumBytes(length),
+			ostAttrTime(timer.elapsed())
+		);
+	}};
+
+	if (!length)
+		co_return protocols::fs::ReadMemoryRange{inode->accessMemory(), 0, 0, nullptr};
+
+	co_await inode->readyEvent.wait();
+
+	co_await inode->inodeMutex.async_lock_shared();
+	std::shared_ptr<void> inodeGuard{inode.get(), [inode] (void *) {
+		inode->inodeMutex.unlock_shared();
+	}};
+
+	if (inode->fileType == FileType::kTypeDirectory)
+		co_return std::unexpected{protocols::fs::Error::isDirectory};
+	if (offset >= inode->fileSize())
+		co_return std::unexpected{protocols::fs::Error::endOfFile};
+
+	auto remaining = inode->fileSize() - offset;
+	auto chunkSize = std::min(length, remaining);
+	if (!chunkSize)
+		co_return std::unexpected{protocols::fs::Error::endOfFile};
+
+	auto chunkOffset = offset;
+	offset += chunkSize;
+
+	co_return protocols::fs::ReadMemoryRange{inode->accessMemory(),
+			chunkOffset, chunkSize, std::move(inodeGuard)};
+}
+
 template <Inode T>
 async::result<frg::expected<protocols::fs::Error, size_t>>
 doWriteImpl(T *inode, const void *buffer, size_t length, bool append, auto &offset) {
@@ -197,6 +239,42 @@ async::result<protocols::fs::ReadResult> doPread(void *object, int64_t offset, h
 }
 
 
+template <FileSystem T>
+async::result<protocols::fs::ReadMemoryResult> doReadMemory(void *object, helix_ng::CredentialsView,
+		size_t length) {
+	using File = typename T::File;
+	using Inode = typename T::Inode;
+
+	auto self = static_cast<File *>(object);
+	auto inode = std::static_pointer_cast<Inode>(self->inode);
+
+	co_await self->mutex.async_lock();
+	frg::unique_lock lock{frg::adopt_lock, self->mutex};
+
+	co_return co_await detail::doReadMemoryImpl(std::move(inode), length, self->offset);
+}
+
+
+template <FileSystem T>
+async::result<protocols::fs::ReadMemoryResult> doPreadMemory(void *object, int64_t offset,
+		helix_ng::CredentialsView, size_t length) {
+	using File = typename T::File;
+	using Inode = typename T::Inode;
+
+	if (offset < 0)
+		co_return std::unexpected{protocols::fs::Error::illegalArguments};
+	size_t unsignedOffset = offset;
+
+	auto self = static_cast<File *>(object);
+	auto inode = std::static_pointer_cast<Inode>(self->inode);
+
+	co_await self->mutex.async_lock_shared();
+	frg::shared_lock lock{frg::adopt_lock, self->mutex};
+
+	co_return co_await detail::doReadMemoryImpl(std::move(inode), length, unsignedOffset);
+}
+
+
 template <FileSystem T>
 async::result<frg::expected<protocols::fs::Error, size_t>> doWrite(void *object, helix_ng::CredentialsView,
 		const void *buffer, size_t length) {
@@ -259,6 +337,67 @@ async::result<frg::expected<protocols::fs::Error>> doTruncate(void *object, size
 	co_return frg::success;
 }
 
+template <FileSystem T>
+async::result<frg::expected<protocols::fs::Error, size_t>>
+doCopyFileRange(T *fs, uint32_t sourceIno, uint64_t sourceOffset,
+		uint32_t targetIno, uint64_t targetOffset, size_t length) {
+	using Inode = typename T::Inode;
+
+	auto source = std::static_pointer_cast<Inode>(fs->accessInode(sourceIno));
+	auto target = std::static_pointer_cast<Inode>(fs->accessInode(targetIno));
+	co_await source->readyEvent.wait();
+	co_await target->readyEvent.wait();
+
+	if (source->fileType == FileType::kTypeDirectory || target->fileType == FileType::kTypeDirectory)
+		co_return protocols::fs::Error::isDirectory;
+	if (source->fileType != FileType::kTypeRegular || target->fileType != FileType::kTypeRegular)
+		co_return protocols::fs::Error::illegalArguments;
+
+	// Lock the inodes in inodeMutex order (lower inode number first).
+	std::optional<frg::shared_lock<async::shared_mutex>> sourceLock;
+	std::optional<frg::unique_lock<async::shared_mutex>> targetLock;
+	if (source.get() == target.get()) {
+		co_await target->inodeMutex.async_lock();
+		targetLock.emplace(frg::adopt_lock, target->inodeMutex);
+	} else if (source->number < target->number) {
+		co_await source->inodeMutex.async_lock_shared();
+		sourceLock.emplace(frg::adopt_lock, source->inodeMutex);
+		co_await target->inodeMutex.async_lock();
+		targetLock.emplace(frg::adopt_lock, target->inodeMutex);
+	} else {
+		co_await target->inodeMutex.async_lock();
+		targetLock.emplace(frg::adopt_lock, target->inodeMutex);
+		co_await source->inodeMutex.async_lock_shared();
+		sourceLock.emplace(frg::adopt_lock, source->inodeMutex);
+	}
+
+	if (sourceOffset >= source->fileSize())
+		co_return size_t{0};
+	length = std::min(length, source->fileSize() - sourceOffset);
+	if (!length)
+		co_return size_t{0};
+
+	if (targetOffset + length > target->fileSize())
+		FRG_CO_TRY(co_await target->resizeFile(targetOffset + length));
+
+	// Both files live in page caches of this server, hence the data never leaves this process.
+	constexpr size_t chunkSize = 0x10000;
+	std::vector<uint8_t> buffer(std::min(length, chunkSize));
+	size_t progress = 0;
+	while (progress < length) {
+		auto chunk = std::min(length - progress, chunkSize);
+		auto readMemory = co_await helix_ng::readMemory(source->accessMemory(),
+				sourceOffset + progress, chunk, buffer.data());
+		HEL_CHECK(readMemory.error());
+		auto writeMemory = co_await helix_ng::writeMemory(target->accessMemory(),
+				targetOffset + progress, chunk, buffer.data());
+		HEL_CHECK(writeMemory.error());
+		progress += chunk;
+	}
+
+	co_return length;
+}
+
 template <FileSystem T>
 async::result<helix::BorrowedDescriptor>
 doAccessMemory(void *object) {
@@ -32,6 +32,21 @@ namespace {
 
 	constexpr int pageShift = 12;
 
+	// Translates the file type of a directory entry to the fs protocol's FileType.
+	// Returns zero (i.e., DT_UNKNOWN) if the type is not recorded in the entry.
+	int64_t entryFileType(uint8_t fileType) {
+		switch(fileType) {
+		case EXT2_FT_REG_FILE: return managarm::fs::FileType::REGULAR;
+		case EXT2_FT_DIR: return managarm::fs::FileType::DIRECTORY;
+		case EXT2_FT_CHRDEV: return managarm::fs::FileType::CHAR_DEVICE;
+		case EXT2_FT_BLKDEV: return managarm::fs::FileType::BLOCK_DEVICE;
+		case EXT2_FT_FIFO: return managarm::fs::FileType::FIFO;
+		case EXT2_FT_SOCK: return managarm::fs::FileType::SOCKET;
+		case EXT2_FT_SYMLINK: return managarm::fs::FileType::SYMLINK;
+		default: return 0;
+		}
+	}
+
 	void updateInodeChecksum(FileSystem &fs, DiskInode *inode, uint32_t number) {
 		if(fs.metadataChecksum) {
 			inode->osd2.checksumLow = 0;
@@ -104,6 +119,96 @@ namespace {
 		}
 	}
 
+	// Returns the offset of the live entry with the given name in [begin, end) of the directory.
+	std::optional<size_t> scanDirEntries(const char *base, size_t begin, size_t end,
+			std::string_view name) {
+		size_t offset = begin;
+		while(offset < end) {
+			assert(!(offset & 3));
+			assert(offset + sizeof(DiskDirEntry) <= end);
+			auto disk_entry = reinterpret_cast<const DiskDirEntry *>(base + offset);
+			assert(disk_entry->recordLength);
+
+			if(disk_entry->inode
+					&& name.length() == disk_entry->nameLength
+					&& !memcmp(disk_entry->name, name.data(), name.length()))
+				return offset;
+
+			offset += disk_entry->recordLength;
+		}
+		return std::nullopt;
+	}
+
+	// Size of a directory entry without any slack space.
+	size_t dirEntrySize(size_t nameLength) {
+		return (sizeof(DiskDirEntry) + nameLength + 3) & ~size_t(3);
+	}
+
+	// Number of bytes at the end of directory blocks that are reserved for the DirentTail.
+	size_t direntTailSize(FileSystem &fs) {
+		return fs.metadataChecksum ? sizeof(DirentTail) : 0;
+	}
+
+	// Writes an empty DirentTail to the end of the directory block (on metadata_csum file systems).
+	void initDirentTail(FileSystem &fs, char *block) {
+		if(!fs.metadataChecksum)
+			return;
+		auto tail = reinterpret_cast<DirentTail *>(block + fs.blockSize - sizeof(DirentTail));
+		memset(tail, 0, sizeof(DirentTail));
+		tail->recordLength = sizeof(DirentTail);
+		tail->reservedFileType = direntTailFileType;
+	}
+
+	// Updates the checksum of a directory block that ends in a DirentTail.
+	// Blocks without a DirentTail (e.g., written by older versions of this driver) are left alone.
+	void updateDirentTailChecksum(FileSystem &fs, Inode *inode, char *block) {
+		if(!fs.metadataChecksum)
+			return;
+		auto tail = reinterpret_cast<DirentTail *>(block + fs.blockSize - sizeof(DirentTail));
+		if(tail->reservedZero1 || tail->recordLength != sizeof(DirentTail)
+				|| tail->reservedZero2 || tail->reservedFileType != direntTailFileType)
+			return;
+
+		uint32_t number = inode->number;
+		checksums::Crc32c crc32{fs.metadataChecksumSeed};
+		crc32.addData(&number, sizeof(number));
+		crc32.addData(&inode->diskInode()->generation, sizeof(inode->diskInode()->generation));
+		crc32.addData(block, fs.blockSize - sizeof(DirentTail));
+		tail->checksum = crc32.finalize();
+	}
+
+	// Number of DxEntry structs that fit into an index block if the array starts at entriesOffset.
+	// On metadata_csum file systems, the last slot holds the DxTail instead.
+	uint16_t dxLimit(FileSystem &fs, size_t entriesOffset) {
+		auto limit = (fs.blockSize - entriesOffset) / sizeof(DxEntry);
+		if(fs.metadataChecksum)
+			limit -= sizeof(DxTail) / sizeof(DxEntry);
+		return limit;
+	}
+
+	// Updates the checksum in the DxTail of an index block (the root or another node).
+	// entriesOffset is the offset of the DxEntry array within the block.
+	void updateDxChecksum(FileSystem &fs, Inode *inode, char *block, size_t entriesOffset) {
+		if(!fs.metadataChecksum)
+			return;
+		auto countLimit = reinterpret_cast<DxCountLimit *>(block + entriesOffset);
+		auto tailOffset = entriesOffset + countLimit->limit * sizeof(DxEntry);
+		if(tailOffset + sizeof(DxTail) > fs.blockSize)
+			return;
+		auto tail = reinterpret_cast<DxTail *>(block + tailOffset);
+
+		// The checksum covers the used entries and the DxTail (with a zero checksum).
+		uint32_t number = inode->number;
+		uint32_t zeroChecksum = 0;
+		checksums::Crc32c crc32{fs.metadataChecksumSeed};
+		crc32.addData(&number, sizeof(number));
+		crc32.addData(&inode->diskInode()->generation, sizeof(inode->diskInode()->generation));
+		crc32.addData(block, entriesOffset + countLimit->count * sizeof(DxEntry));
+		crc32.addData(&tail->reserved, sizeof(tail->reserved));
+		crc32.addData(&zeroChecksum, sizeof(zeroChecksum));
+		tail->checksum = crc32.finalize();
+	}
+
 	void updateInodeBitmapChecksum(FileSystem &fs, DiskGroupDesc *desc, const void *bitmap, size_t bitmapSize) {
 		if(fs.metadataChecksum) {
 			checksums::Crc32c crc32{fs.metadataChecksumSeed};
@@ -152,40 +257,487 @@ Inode::findEntry(std::string name) {
 	co_await submit.async_wait();
 	HEL_CHECK(lock_memory.error());
 
-	// Read the directory structure.
-	uintptr_t offset = 0;
-	while(offset < fileSize()) {
-		assert(!(offset & 3));
-		assert(offset + sizeof(DiskDirEntry) <= fileSize());
+	auto offset = locateEntry(name);
+	if(!offset)
+		co_return std::nullopt;
+
+	auto disk_entry = reinterpret_cast<DiskDirEntry *>(
+			reinterpret_cast<char *>(fileMapping.get()) + *offset);
+
+	DirEntry entry;
+	entry.inode = disk_entry->inode;
+
+	switch(disk_entry->fileType) {
+	case EXT2_FT_REG_FILE:
+		entry.fileType = kTypeRegular; break;
+	case EXT2_FT_DIR:
+		entry.fileType = kTypeDirectory; break;
+	case EXT2_FT_SYMLINK:
+		entry.fileType = kTypeSymlink; break;
+	default:
+		entry.fileType = kTypeNone;
+	}
+
+	co_return entry;
+}
+
+std::optional<size_t> Inode::locateEntry(const std::string &name) {
+	auto base = reinterpret_cast<const char *>(fileMapping.get());
+
+	// "." and ".." are always stored in the first block (and are not part of the htree index).
+	if(name == "." || name == "..")
+		return scanDirEntries(base, 0, std::min(size_t{fs.blockSize}, fileSize()), name);
+
+	if(auto path = dxProbe(name); path) {
+		auto &bottom = path->frames[path->numFrames - 1];
+		auto entries = reinterpret_cast<const DxEntry *>(base + bottom.entriesOffset);
+		auto count = reinterpret_cast<const DxCountLimit *>(entries)->count;
+
+		auto at = bottom.at;
+		while(true) {
+			size_t leafOffset = size_t{entries[at].block & dxBlockMask} << fs.blockShift;
+			if(leafOffset + fs.blockSize > fileSize())
+				break;
+			if(auto offset = scanDirEntries(base, leafOffset, leafOffset + fs.blockSize, name); offset)
+				return offset;
+
+			// Entries with the same hash can continue in the next leaf.
+			// This is marked by the lowest bit of the next leaf's hash.
+			if(at + 1 < count) {
+				if((entries[at + 1].hash & ~uint32_t{1}) != path->hash)
+					return std::nullopt;
+				at++;
+				continue;
+			}
+			if(path->numFrames == 1)
+				return std::nullopt;
+			// The next leaf belongs to another index node. This is rare, hence we
+			// simply fall back to a linear scan instead of walking up the index.
+			break;
+		}
+
+		return scanDirEntries(base, 0, fileSize(), name);
+	}
+
+	// Small directories are not worth indexing.
+	if(fileSize() <= fs.blockSize)
+		return scanDirEntries(base, 0, fileSize(), name);
+
+	std::lock_guard lock{dirIndexMutex};
+	if(!dirIndex) {
+		dirIndex.emplace();
+
+		uintptr_t offset = 0;
+		while(offset < fileSize()) {
+			assert(!(offset & 3));
+			assert(offset + sizeof(DiskDirEntry) <= fileSize());
+			auto disk_entry = reinterpret_cast<const DiskDirEntry *>(base + offset);
+			assert(disk_entry->recordLength);
+
+			if(disk_entry->inode)
+				dirIndex->emplace(std::string(disk_entry->name, disk_entry->nameLength), offset);
+
+			offset += disk_entry->recordLength;
+		}
+		assert(offset == fileSize());
+	}
+
+	auto it = dirIndex->find(name);
+	if(it == dirIndex->end())
+		return std::nullopt;
+	return it->second;
+}
+
+std::optional<DxPath> Inode::dxProbe(std::string_view name) {
+	if(!fs.dirIndex || !(diskInode()->flags & EXT4_INDEX_FL))
+		return std::nullopt;
+	if(fileSize() < fs.blockSize)
+		return std::nullopt;
+
+	auto base = reinterpret_cast<const char *>(fileMapping.get());
+	auto info = reinterpret_cast<const DxRootInfo *>(base + dxRootInfoOffset);
+	if(info->reservedZero || info->infoLength != sizeof(DxRootInfo) || (info->unusedFlags & 1))
+		return std::nullopt;
+
+	int maxLevels = fs.largeDir ? 3 : 2;
+	if(info->indirectLevels >= maxLevels)
+		return std::nullopt;
+
+	DxPath path;
+	path.hashVersion = info->hashVersion;
+	if(path.hashVersion <= DX_HASH_TEA && fs.unsignedHash)
+		path.hashVersion += DX_HASH_LEGACY_UNSIGNED;
+	auto hash = dxHashName(name, path.hashVersion, fs.hashSeed);
+	if(!hash)
+		return std::nullopt;
+	path.hash = *hash;
+
+	size_t entriesOffset = dxRootInfoOffset + info->infoLength;
+	path.numFrames = info->indirectLevels + 1;
+	for(int level = 0; level < path.numFrames; level++) {
+		auto blockEnd = (entriesOffset & ~size_t(fs.blockSize - 1)) + fs.blockSize;
+		auto entries = reinterpret_cast<const DxEntry *>(base + entriesOffset);
+		auto countLimit = reinterpret_cast<const DxCountLimit *>(entries);
+		if(!countLimit->count || countLimit->count > countLimit->limit
+				|| entriesOffset + countLimit->limit * sizeof(DxEntry) > blockEnd)
+			return std::nullopt;
+
+		// Find the last entry whose hash is not greater than the name's hash.
+		// The first entry has an implicit hash of zero.
+		unsigned int low = 1;
+		unsigned int high = countLimit->count;
+		while(low < high) {
+			auto mid = low + (high - low) / 2;
+			if(entries[mid].hash > path.hash) {
+				high = mid;
+			}else{
+				low = mid + 1;
+			}
+		}
+		path.frames[level] = {entriesOffset, low - 1};
+
+		size_t block = entries[low - 1].block & dxBlockMask;
+		if(((block + 1) << fs.blockShift) > fileSize())
+			return std::nullopt;
+		if(level + 1 < path.numFrames) {
+			entriesOffset = (block << fs.blockShift) + dxNodeEntriesOffset;
+		}else{
+			path.leafBlock = block;
+		}
+	}
+
+	return path;
+}
+
+async::result<bool> Inode::dxSplitLeaf(const DxPath &path) {
+	// Make room for another leaf in the index first.
+	// The caller probes again afterwards as the path may have changed.
+	auto &bottom = path.frames[path.numFrames - 1];
+	{
+		auto countLimit = reinterpret_cast<DxCountLimit *>(
+				reinterpret_cast<char *>(fileMapping.get()) + bottom.entriesOffset);
+		if(countLimit->count >= countLimit->limit)
+			co_return co_await dxGrowIndex(path);
+	}
+
+	struct Record {
+		uint32_t hash;
+		uint32_t inode;
+		uint8_t fileType;
+		std::string name;
+	};
+
+	// Collect the leaf's entries before the directory is remapped below.
+	std::vector<Record> records;
+	auto leafOffset = size_t{path.leafBlock} << fs.blockShift;
+	for(size_t offset = leafOffset; offset < leafOffset + fs.blockSize; ) {
 		auto disk_entry = reinterpret_cast<DiskDirEntry *>(
 				reinterpret_cast<char *>(fileMapping.get()) + offset);
 		assert(disk_entry->recordLength);
 
-		if(disk_entry->inode
-				&& name.length() == disk_entry->nameLength
-				&& !memcmp(disk_entry->name, name.data(), name.length())) {
-			DirEntry entry;
-			entry.inode = disk_entry->inode;
-
-			switch(disk_entry->fileType) {
-			case EXT2_FT_REG_FILE:
-				entry.fileType = kTypeRegular; break;
-			case EXT2_FT_DIR:
-				entry.fileType = kTypeDirectory; break;
-			case EXT2_FT_SYMLINK:
-				entry.fileType = kTypeSymlink; break;
-			default:
-				entry.fileType = kTypeNone;
-			}
-
-			co_return entry;
+		if(disk_entry->inode) {
+			std::string name(disk_entry->name, disk_entry->nameLength);
+			auto hash = dxHashName(name, path.hashVersion, fs.hashSeed);
+			assert(hash);
+			records.push_back({*hash, disk_entry->inode, disk_entry->fileType, std::move(name)});
 		}
 
 		offset += disk_entry->recordLength;
 	}
-	assert(offset == fileSize());
+	if(records.size() < 2)
+		co_return false;
+
+	std::ranges::stable_sort(records, {}, &Record::hash);
+
+	// Move the upper half (in terms of size) to the new leaf.
+	size_t totalSize = 0;
+	for(auto &record : records)
+		totalSize += dirEntrySize(record.name.size());
+	size_t split = records.size();
+	size_t movedSize = 0;
+	while(split > 1 && movedSize < totalSize / 2) {
+		split--;
+		movedSize += dirEntrySize(records[split].name.size());
+	}
+	auto splitHash = records[split].hash;
+	// Set the collision bit if entries with the same hash end up in both leaves.
+	bool continued = records[split - 1].hash == splitHash;
+
+	auto newOffset = co_await appendDirectoryBlock();
+	uint32_t newBlock = newOffset >> fs.blockShift;
+
+	helix::LockMemoryView lock_memory;
+	auto &&submit = helix::submitLockMemoryView(helix::BorrowedDescriptor(frontalMemory),
+			&lock_memory,
+			0, fileMapping.size(), helix::Dispatcher::global());
+	co_await submit.async_wait();
+	HEL_CHECK(lock_memory.error());
+
+	auto base = reinterpret_cast<char *>(fileMapping.get());
+	auto writeLeaf = [&] (size_t blockOffset, size_t first, size_t last) {
+		memset(base + blockOffset, 0, fs.blockSize);
+		auto blockEnd = blockOffset + fs.blockSize - direntTailSize(fs);
+		size_t offset = blockOffset;
+		for(size_t i = first; i < last; i++) {
+			auto &record = records[i];
+			auto disk_entry = reinterpret_cast<DiskDirEntry *>(base + offset);
+			disk_entry->inode = record.inode;
+			disk_entry->nameLength = record.name.size();
+			disk_entry->fileType = record.fileType;
+			memcpy(disk_entry->name, record.name.data(), record.name.size());
+			// The last entry covers the remainder of the block.
+			auto size = (i + 1 == last) ? blockEnd - offset
+					: dirEntrySize(record.name.size());
+			disk_entry->recordLength = size;
+			offset += size;
+		}
+		initDirentTail(fs, base + blockOffset);
+		updateDirentTailChecksum(fs, this, base + blockOffset);
+	};
+	writeLeaf(leafOffset, 0, split);
+	writeLeaf(newOffset, split, records.size());
+
+	// Entries have moved within the directory.
+	{
+		std::lock_guard lock{dirIndexMutex};
+		dirIndex.reset();
+	}
+
+	// Insert the new leaf into the index, right after the old one.
+	dxInsertEntry(bottom, splitHash | (continued ? 1 : 0), newBlock);
+
+	auto syncDir = co_await helix_ng::synchronizeSpace(
+			helix::BorrowedDescriptor{kHelNullHandle}, fileMapping.get(), fileSize());
+	HEL_CHECK(syncDir.error());
+
+	co_return true;
+}
+
+void Inode::dxInsertEntry(const DxPath::Frame &frame, uint32_t hash, uint32_t block) {
+	auto base = reinterpret_cast<char *>(fileMapping.get());
+	auto entries = reinterpret_cast<DxEntry *>(base + frame.entriesOffset);
+	auto countLimit = reinterpret_cast<DxCountLimit *>(entries);
+	assert(countLimit->count < countLimit->limit);
+	memmove(&entries[frame.at + 2], &entries[frame.at + 1],
+			(countLimit->count - frame.at - 1) * sizeof(DxEntry));
+	entries[frame.at + 1].hash = hash;
+	entries[frame.at + 1].block = block;
+	countLimit->count++;
+
+	auto blockOffset = frame.entriesOffset & ~size_t(fs.blockSize - 1);
+	updateDxChecksum(fs, this, base + blockOffset, frame.entriesOffset - blockOffset);
+}
+
+async::result<bool> Inode::dxGrowIndex(const DxPath &path) {
+	auto nodeIsFull = [&] (int level) {
+		auto countLimit = reinterpret_cast<DxCountLimit *>(
+				reinterpret_cast<char *>(fileMapping.get()) + path.frames[level].entriesOffset);
+		return countLimit->count >= countLimit->limit;
+	};
+
+	// Find the lowest index node on the path that has room for another entry.
+	int level = path.numFrames - 1;
+	while(level >= 0 && nodeIsFull(level))
+		level--;
+
+	if(level < 0) {
+		// All nodes on the path are full, including the root. Add another level of index nodes
+		// by moving the root's entries to a new node (as Linux does).
+		auto info = reinterpret_cast<DxRootInfo *>(
+				reinterpret_cast<char *>(fileMapping.get()) + dxRootInfoOffset);
+		int maxLevels = fs.largeDir ? 3 : 2;
+		if(info->indirectLevels + 1 >= maxLevels)
+			co_return false;
+	}
+
+	auto newOffset = co_await appendDirectoryBlock();
+	uint32_t newBlock = newOffset >> fs.blockShift;
+
+	helix::LockMemoryView lock_memory;
+	auto &&submit = helix::submitLockMemoryView(helix::BorrowedDescriptor(frontalMemory),
+			&lock_memory,
+			0, fileMapping.size(), helix::Dispatcher::global());
+	co_await submit.async_wait();
+	HEL_CHECK(lock_memory.error());
+
+	auto base = reinterpret_cast<char *>(fileMapping.get());
+
+	// Index nodes start with an empty directory entry that spans the whole block.
+	auto newNode = base + newOffset;
+	memset(newNode, 0, fs.blockSize);
+	reinterpret_cast<DiskDirEntry *>(newNode)->recordLength = fs.blockSize;
+	auto newEntries = reinterpret_cast<DxEntry *>(newNode + dxNodeEntriesOffset);
+
+	// Moves entries [first, count) of the node at the given level to the new node.
+	auto moveEntries = [&] (int level, unsigned int first) {
+		auto entries = reinterpret_cast<DxEntry *>(base + path.frames[level].entriesOffset);
+		auto countLimit = reinterpret_cast<DxCountLimit *>(entries);
+		auto count = countLimit->count;
+		memcpy(newEntries, &entries[first], (count - first) * sizeof(DxEntry));
+		// The DxCountLimit overlays the (implicit) hash of the first entry.
+		auto newCountLimit = reinterpret_cast<DxCountLimit *>(newEntries);
+		newCountLimit->limit = dxLimit(fs, dxNodeEntriesOffset);
+		newCountLimit->count = count - first;
+		countLimit->count = first;
+		updateDxChecksum(fs, this, newNode, dxNodeEntriesOffset);
+	};
+
+	if(level < 0) {
+		auto &root = path.frames[0];
+		moveEntries(0, 0);
+
+		// The root now only points to the new node.
+		auto entries = reinterpret_cast<DxEntry *>(base + root.entriesOffset);
+		reinterpret_cast<DxCountLimit *>(entries)->count = 1;
+		entries[0].block = newBlock;
+
+		auto info = reinterpret_cast<DxRootInfo *>(base + dxRootInfoOffset);
+		info->indirectLevels++;
+		updateDxChecksum(fs, this, base, root.entriesOffset);
+	}else{
+		// Split the full child of the node at level and insert the upper half into the node.
+		auto &child = path.frames[level + 1];
+		auto childEntries = reinterpret_cast<DxEntry *>(base + child.entriesOffset);
+		auto split = reinterpret_cast<DxCountLimit *>(childEntries)->count / 2u;
+		auto splitHash = childEntries[split].hash;
+		moveEntries(level + 1, split);
+
+		auto childBlockOffset = child.entriesOffset & ~size_t(fs.blockSize - 1);
+		updateDxChecksum(fs, this, base + childBlockOffset, child.entriesOffset - childBlockOffset);
+
+		dxInsertEntry(path.frames[level], splitHash, newBlock);
+	}
+
+	auto syncDir = co_await helix_ng::synchronizeSpace(
+			helix::BorrowedDescriptor{kHelNullHandle}, fileMapping.get(), fileSize());
+	HEL_CHECK(syncDir.error());
+
+	co_return true;
+}
+
+async::result<bool> Inode::dxMakeIndexed() {
+	if(!fs.dirIndex || fileSize() != fs.blockSize || fs.defHashVersion > DX_HASH_TEA)
+		co_return false;
+
+	// The root needs the "." and ".." entries at the start of the block.
+	auto dotEntry = reinterpret_cast<DiskDirEntry *>(fileMapping.get());
+	if(dotEntry->recordLength != dirEntrySize(1) || dotEntry->nameLength != 1
+			|| memcmp(dotEntry->name, ".", 1))
+		co_return false;
+	size_t dotDotOffset = dotEntry->recordLength;
+	auto dotDotEntry = reinterpret_cast<DiskDirEntry *>(
+			reinterpret_cast<char *>(fileMapping.get()) + dotDotOffset);
+	if(dotDotEntry->recordLength < dirEntrySize(2) || dotDotEntry->nameLength != 2
+			|| memcmp(dotDotEntry->name, "..", 2))
+		co_return false;
+	assert(dotDotOffset + dirEntrySize(2) == dxRootInfoOffset);
+
+	size_t entriesStart = dotDotOffset + dotDotEntry->recordLength;
+	size_t entriesEnd = fs.blockSize - direntTailSize(fs);
+	if(entriesStart >= entriesEnd)
+		co_return false;
+
+	auto newOffset = co_await appendDirectoryBlock();
+	uint32_t newBlock = newOffset >> fs.blockShift;
+
+	helix::LockMemoryView lock_memory;
+	auto &&submit = helix::submitLockMemoryView(helix::BorrowedDescriptor(frontalMemory),
+			&lock_memory,
+			0, fileMapping.size(), helix::Dispatcher::global());
+	co_await submit.async_wait();
+	HEL_CHECK(lock_memory.error());
+
+	auto base = reinterpret_cast<char *>(fileMapping.get());
+	dotDotEntry = reinterpret_cast<DiskDirEntry *>(base + dotDotOffset);
+
+	// Move all entries after ".." to the new leaf. Their offsets shift down by entriesStart,
+	// so the last entry has to grow by entriesStart to cover the remainder of the leaf.
+	auto leaf = base + newOffset;
+	memset(leaf, 0, fs.blockSize);
+	memcpy(leaf, base + entriesStart, entriesEnd - entriesStart);
+	size_t offset = 0;
+	while(true) {
+		auto diskEntry = reinterpret_cast<DiskDirEntry *>(leaf + offset);
+		assert(diskEntry->recordLength);
+		if(offset + diskEntry->recordLength == entriesEnd - entriesStart) {
+			diskEntry->recordLength += entriesStart;
+			break;
+		}
+		offset += diskEntry->recordLength;
+	}
+	initDirentTail(fs, leaf);
+	updateDirentTailChecksum(fs, this, leaf);
+
+	// Turn the first block into the root of the index. ".." now covers the index;
+	// index blocks do not have a DirentTail.
+	memset(base + dxRootInfoOffset, 0, fs.blockSize - dxRootInfoOffset);
+	dotDotEntry->recordLength = fs.blockSize - dotDotOffset;
+
+	auto info = reinterpret_cast<DxRootInfo *>(base + dxRootInfoOffset);
+	info->hashVersion = fs.defHashVersion;
+	info->infoLength = sizeof(DxRootInfo);
+
+	size_t entriesOffset = dxRootInfoOffset + sizeof(DxRootInfo);
+	auto entries = reinterpret_cast<DxEntry *>(base + entriesOffset);
+	auto countLimit = reinterpret_cast<DxCountLimit *>(entries);
+	countLimit->limit = dxLimit(fs, entriesOffset);
+	countLimit->count = 1;
+	entries[0].block = newBlock;
+	updateDxChecksum(fs, this, base, entriesOffset);
+
+	{
+		std::lock_guard lock{dirIndexMutex};
+		dirIndex.reset();
+	}
+
+	auto syncDir = co_await helix_ng::synchronizeSpace(
+			helix::BorrowedDescriptor{kHelNullHandle}, fileMapping.get(), fileSize());
+	HEL_CHECK(syncDir.error());
+
+	diskInode()->flags |= EXT4_INDEX_FL;
+
+	updateInodeChecksum(fs, diskInode(), number);
+
+	auto syncInode = co_await helix_ng::synchronizeSpace(
+			helix::BorrowedDescriptor{kHelNullHandle},
+			diskInode(), fs.inodeSize);
+	HEL_CHECK(syncInode.error());
+
+	co_return true;
+}
+
+async::result<void> Inode::clearIndexFlag() {
+	diskInode()->flags &= ~EXT4_INDEX_FL;
+
+	updateInodeChecksum(fs, diskInode(), number);
+
+	auto syncInode = co_await helix_ng::synchronizeSpace(
+			helix::BorrowedDescriptor{kHelNullHandle},
+			diskInode(), fs.inodeSize);
+	HEL_CHECK(syncInode.error());
+}
+
+async::result<size_t> Inode::appendDirectoryBlock() {
+	auto offset = fileSize();
+	auto blockOffset = (offset & ~(fs.blockSize - 1)) >> fs.blockShift;
+	auto newSize = offset + fs.blockSize;
+	auto newMappingSize = (newSize + 0xFFF) & ~size_t(0xFFF);
+	setFileSize(newSize);
+
+	{
+		co_await blockMapMutex.async_lock();
+		frg::unique_lock blockMapLock{frg::adopt_lock, blockMapMutex};
+		co_await fs.assignDataBlocks(this, blockOffset, 1);
+	}
+
+	auto resizeResult = co_await helix_ng::resizeMemory(
+			helix::BorrowedDescriptor{backingMemory}, newMappingSize);
+	HEL_CHECK(resizeResult.error());
+	fileMapping = helix::Mapping{helix::BorrowedDescriptor{frontalMemory},
+			0, newMappingSize,
+			kHelMapProtRead | kHelMapProtWrite | kHelMapDontRequireBacking};
 
-	co_return std::nullopt;
+	co_return offset;
 }
 
 async::result<frg::expected<protocols::fs::Error, DirEntry>>
@@ -222,6 +774,15 @@ Inode::insertEntry(std::string name, int64_t ino, blockfs::FileType type) {
 		}
 		memcpy(diskEntry->name, name.data(), name.length() + 1);
 
+		auto blockOffset = offset & ~size_t(fs.blockSize - 1);
+		updateDirentTailChecksum(fs, this, reinterpret_cast<char *>(fileMapping.get()) + blockOffset);
+
+		{
+			std::lock_guard lock{dirIndexMutex};
+			if(dirIndex)
+				dirIndex->emplace(name, offset);
+		}
+
 		// Flush the data to disk.
 		// TODO: It would be enough to flush only one or two pages here.
 		auto syncDir = co_await helix_ng::synchronizeSpace(
@@ -274,61 +835,87 @@ Inode::insertEntry(std::string name, int64_t ino, blockfs::FileType type) {
 	// We use name.size() + 1 for the entry name length to account for the null terminator
 	auto required = (sizeof(DiskDirEntry) + name.size() + 1 + 3) & ~size_t(3);
 
-	// Walk the directory structure.
-	uintptr_t offset = 0;
-	while(offset < fileSize()) {
-		assert(!(offset & 3));
-		assert(offset + sizeof(DiskDirEntry) <= fileSize());
-		auto previous_entry = reinterpret_cast<DiskDirEntry *>(
-				reinterpret_cast<char *>(fileMapping.get()) + offset);
-		assert(previous_entry->recordLength);
-
-		// Calculate available space after we contract previous_entry.
-		auto contracted = (sizeof(DiskDirEntry) + previous_entry->nameLength + 3) & ~size_t(3);
-		assert(previous_entry->recordLength >= contracted);
-		auto available = previous_entry->recordLength - contracted;
-
-		// Check whether we can shrink previous_entry and insert a new entry after it.
-		if(available >= required) {
-			// Update the existing dentry.
-			previous_entry->recordLength = contracted;
+	// Looks for an entry in [begin, end) that can be shrunk to make room for the new entry.
+	// On success, shrinks that entry and returns the offset and length of the free space.
+	auto claimSpace = [&] (size_t begin, size_t end) -> std::optional<std::pair<size_t, size_t>> {
+		uintptr_t offset = begin;
+		while(offset < end) {
+			assert(!(offset & 3));
+			assert(offset + sizeof(DiskDirEntry) <= end);
+			auto previous_entry = reinterpret_cast<DiskDirEntry *>(
+					reinterpret_cast<char *>(fileMapping.get()) + offset);
+			assert(previous_entry->recordLength);
+
+			// Calculate available space after we contract previous_entry.
+			auto contracted = dirEntrySize(previous_entry->nameLength);
+			assert(previous_entry->recordLength >= contracted);
+			auto available = previous_entry->recordLength - contracted;
+
+			// Check whether we can shrink previous_entry and insert a new entry after it.
+			if(available >= required) {
+				// Update the existing dentry.
+				previous_entry->recordLength = contracted;
+				return std::pair{offset + contracted, available};
+			}
 
-			co_return co_await appendDirEntry(offset + contracted, available);
+			offset += previous_entry->recordLength;
 		}
+		assert(offset == end);
+		return std::nullopt;
+	};
 
-		offset += previous_entry->recordLength;
+	// Once the first block of a directory is full, index the directory (as Linux does).
+	if(!(diskInode()->flags & EXT4_INDEX_FL) && fileSize() == fs.blockSize) {
+		if(auto space = claimSpace(0, fileSize()); space)
+			co_return co_await appendDirEntry(space->first, space->second);
+		co_await dxMakeIndexed();
 	}
-	assert(offset == fileSize());
 
-	// If we made it this far, we ran out of space in the directory. Resize it.
-	auto blockOffset = (offset & ~(fs.blockSize - 1)) >> fs.blockShift;
-	auto newSize = offset + fs.blockSize;
-	auto newMappingSize = (newSize + 0xFFF) & ~size_t(0xFFF);
-	setFileSize(newSize);
+	// In hashed directories, the entry must be stored in the leaf that covers its hash.
+	if(diskInode()->flags & EXT4_INDEX_FL) {
+		while(true) {
+			auto path = dxProbe(name);
+			if(!path)
+				break;
 
-	{
-		co_await blockMapMutex.async_lock();
-		frg::unique_lock blockMapLock{frg::adopt_lock, blockMapMutex};
-		co_await fs.assignDataBlocks(this, blockOffset, 1);
+			// Lock the directory again as dxSplitLeaf() may have grown it.
+			helix::LockMemoryView lock_leaf;
+			auto &&submit = helix::submitLockMemoryView(helix::BorrowedDescriptor(frontalMemory),
+					&lock_leaf,
+					0, fileMapping.size(), helix::Dispatcher::global());
+			co_await submit.async_wait();
+			HEL_CHECK(lock_leaf.error());
+
+			auto leafOffset = size_t{path->leafBlock} << fs.blockShift;
+			if(auto space = claimSpace(leafOffset, leafOffset + fs.blockSize); space)
+				co_return co_await appendDirEntry(space->first, space->second);
+
+			if(!(co_await dxSplitLeaf(*path)))
+				break;
+		}
+
+		// We cannot maintain the index. Degrade to a linear directory (which stays valid).
+		co_await clearIndexFlag();
 	}
 
-	auto resizeResult = co_await helix_ng::resizeMemory(
-			helix::BorrowedDescriptor{backingMemory}, newMappingSize);
-	HEL_CHECK(resizeResult.error());
-	fileMapping = helix::Mapping{helix::BorrowedDescriptor{frontalMemory},
-			0, newMappingSize,
-			kHelMapProtRead | kHelMapProtWrite | kHelMapDontRequireBacking};
+	// Walk the directory structure.
+	if(auto space = claimSpace(0, fileSize()); space)
+		co_return co_await appendDirEntry(space->first, space->second);
+
+	// If we made it this far, we ran out of space in the directory. Resize it.
+	auto offset = co_await appendDirectoryBlock();
 
 	// Now append the entry that we couldn't add before.
 	{
 		helix::LockMemoryView lock_memory;
 		auto &&submit = helix::submitLockMemoryView(helix::BorrowedDescriptor(frontalMemory),
 				&lock_memory,
-				0, newMappingSize, helix::Dispatcher::global());
+				0, fileMapping.size(), helix::Dispatcher::global());
 		co_await submit.async_wait();
 		HEL_CHECK(lock_memory.error());
 
-		co_return co_await appendDirEntry(offset, fileSize() - offset);
+		initDirentTail(fs, reinterpret_cast<char *>(fileMapping.get()) + offset);
+		co_return co_await appendDirEntry(offset, fileSize() - offset - direntTailSize(fs));
 	}
 }
 
@@ -349,72 +936,73 @@ async::result<frg::expected<protocols::fs::Error>> Inode::removeEntry(std::strin
 	co_await submit.async_wait();
 	HEL_CHECK(lock_memory.error());
 
-	// Read the directory structure.
-	DiskDirEntry *previous_entry = nullptr;
-	uintptr_t offset = 0;
-	while(offset < fileSize()) {
-		assert(!(offset & 3));
-		assert(offset + sizeof(DiskDirEntry) <= fileSize());
-		auto disk_entry = reinterpret_cast<DiskDirEntry *>(
-				reinterpret_cast<char *>(fileMapping.get()) + offset);
-		assert(disk_entry->recordLength);
+	auto offset = locateEntry(name);
+	if(!offset)
+		co_return protocols::fs::Error::fileNotFound;
 
-		if(disk_entry->inode
-				&& name.length() == disk_entry->nameLength
-				&& !memcmp(disk_entry->name, name.data(), name.length())) {
+	auto base = reinterpret_cast<char *>(fileMapping.get());
+	auto disk_entry = reinterpret_cast<DiskDirEntry *>(base + *offset);
 
-			auto target = std::static_pointer_cast<Inode>(fs.accessInode(disk_entry->inode));
-			co_await target->readyEvent.wait();
+	// Find the preceding entry in the same block.
+	DiskDirEntry *previous_entry = nullptr;
+	for(size_t prev = *offset & ~size_t(fs.blockSize - 1); prev < *offset; ) {
+		previous_entry = reinterpret_cast<DiskDirEntry *>(base + prev);
+		assert(previous_entry->recordLength);
+		prev += previous_entry->recordLength;
+	}
 
-			auto targetIno = disk_entry->inode;
-			if(offset & (fs.blockSize - 1)) {
-				previous_entry->recordLength += disk_entry->recordLength;
-			} else {
-				// The directory entry is at the start of a block. We mark it as unused instead of merging it.
-				disk_entry->inode = 0;
-			}
+	auto target = std::static_pointer_cast<Inode>(fs.accessInode(disk_entry->inode));
+	co_await target->readyEvent.wait();
 
-			// Flush the data to disk.
-			// TODO: It would be enough to flush only one or two pages here.
-			auto syncDir = co_await helix_ng::synchronizeSpace(
-					helix::BorrowedDescriptor{kHelNullHandle}, fileMapping.get(), fileSize());
-			HEL_CHECK(syncDir.error());
+	auto targetIno = disk_entry->inode;
+	if(*offset & (fs.blockSize - 1)) {
+		previous_entry->recordLength += disk_entry->recordLength;
+	} else {
+		// The directory entry is at the start of a block. We mark it as unused instead of merging it.
+		disk_entry->inode = 0;
+	}
 
-			// Decrement the inode's link count
-			// This is sound since the caller holds the target's inodeMutex exclusively.
-			if(--target->diskInode()->linksCount == 0) {
-				// TODO: free the data blocks and set size to 0
-				target->diskInode()->dtime = clk::getRealtime().tv_sec;
-			}
+	updateDirentTailChecksum(fs, this, base + (*offset & ~size_t(fs.blockSize - 1)));
 
-			updateInodeChecksum(fs, target->diskInode(), targetIno);
+	{
+		std::lock_guard lock{dirIndexMutex};
+		if(dirIndex)
+			dirIndex->erase(name);
+	}
 
-			auto syncInode = co_await helix_ng::synchronizeSpace(
-					helix::BorrowedDescriptor{kHelNullHandle},
-					target->diskInode(), fs.inodeSize);
-			HEL_CHECK(syncInode.error());
+	// Flush the data to disk.
+	// TODO: It would be enough to flush only one or two pages here.
+	auto syncDir = co_await helix_ng::synchronizeSpace(
+			helix::BorrowedDescriptor{kHelNullHandle}, fileMapping.get(), fileSize());
+	HEL_CHECK(syncDir.error());
+
+	// Decrement the inode's link count
+	// This is sound since the caller holds the target's inodeMutex exclusively.
+	if(--target->diskInode()->linksCount == 0) {
+		// TODO: free the data blocks and set size to 0
+		target->diskInode()->dtime = clk::getRealtime().tv_sec;
+	}
 
-			// A removed subdirectory drops its ".." backlink to this directory.
-			if(target->fileType == kTypeDirectory) {
-				diskInode()->linksCount--;
+	updateInodeChecksum(fs, target->diskInode(), targetIno);
 
-				updateInodeChecksum(fs, diskInode(), number);
+	auto syncInode = co_await helix_ng::synchronizeSpace(
+			helix::BorrowedDescriptor{kHelNullHandle},
+			target->diskInode(), fs.inodeSize);
+	HEL_CHECK(syncInode.error());
 
-				auto syncParent = co_await helix_ng::synchronizeSpace(
-						helix::BorrowedDescriptor{kHelNullHandle},
-						diskInode(), fs.inodeSize);
-				HEL_CHECK(syncParent.error());
-			}
+	// A removed subdirectory drops its ".." backlink to this directory.
+	if(target->fileType == kTypeDirectory) {
+		diskInode()->linksCount--;
 
-			co_return {};
-		}
+		updateInodeChecksum(fs, diskInode(), number);
 
-		offset += disk_entry->recordLength;
-		previous_entry = disk_entry;
+		auto syncParent = co_await helix_ng::synchronizeSpace(
+				helix::BorrowedDescriptor{kHelNullHandle},
+				diskInode(), fs.inodeSize);
+		HEL_CHECK(syncParent.error());
 	}
-	assert(offset == fileSize());
 
-	co_return protocols::fs::Error::fileNotFound;
+	co_return {};
 }
 
 async::result<std::expected<bool, protocols::fs::Error>> Inode::isDirectoryEmpty() {
@@ -609,11 +1197,15 @@ async::result<std::expected<DirEntry, protocols::fs::Error>> Inode::mkdir(std::s
 			reinterpret_cast<char *>(dirNode->fileMapping.get()) + offset);
 
 	dotDotEntry->inode = number;
-	dotDotEntry->recordLength = dirNode->fileSize() - offset;
+	dotDotEntry->recordLength = dirNode->fileSize() - offset - direntTailSize(fs);
 	dotDotEntry->nameLength = 2;
 	dotDotEntry->fileType = EXT2_FT_DIR;
 	memcpy(dotDotEntry->name, "..", 3);
 
+	auto dirBlock = reinterpret_cast<char *>(dirNode->fileMapping.get());
+	initDirentTail(fs, dirBlock);
+	updateDirentTailChecksum(fs, dirNode.get(), dirBlock);
+
 	updateInodeChecksum(fs, dirNode->diskInode(), dirNode->number);
 
 	// Synchronize the new directory's inode to update its linksCount
@@ -881,6 +1473,11 @@ async::result<void> FileSystem::init() {
 	is64Bit = sb.featureIncompat & EXT4_INCOMPAT_64BIT;
 	usesExtents = sb.featureIncompat & EXT4_INCOMPAT_EXTENTS;
 	metadataChecksum = sb.featureRoCompat & EXT4_RO_COMPAT_METADATA_CSUM;
+	dirIndex = sb.featureCompat & EXT4_COMPAT_DIR_INDEX;
+	largeDir = sb.featureIncompat & EXT4_INCOMPAT_LARGEDIR;
+	unsignedHash = sb.flags & EXT2_FLAGS_UNSIGNED_HASH;
+	memcpy(hashSeed, sb.hashSeed, sizeof(hashSeed));
+	defHashVersion = sb.defHashVersion;
 	uint16_t blockGroupDescriptorSize = is64Bit ? sb.groupDescSize : 32;
 
 	if(logSuperblock) {
@@ -2220,6 +2817,7 @@ OpenFile::readEntries() {
 				.name = std::string(disk_entry->name, disk_entry->nameLength),
 				.inode = disk_entry->inode,
 				.offset = static_cast<long>(offset),
+				.fileType = entryFileType(disk_entry->fileType),
 			};
 		}
 	}
@@ -2228,5 +2826,59 @@ OpenFile::readEntries() {
 	co_return std::unexpected(managarm::fs::Errors::END_OF_FILE);
 }
 
+async::result<std::expected<void, managarm::fs::Errors>>
+OpenFile::readEntriesBatch(protocols::fs::DirentBuffer &buffer) {
+	auto inode = std::static_pointer_cast<Inode>(this->inode);
+
+	co_await inode->readyEvent.wait();
+
+	if (inode->fileType != kTypeDirectory) {
+		std::cout << "\e[33m" "ext2fs: readEntriesBatch called on something that's not a directory\e[39m" << std::endl;
+		co_return std::unexpected(managarm::fs::Errors::NOT_DIRECTORY);
+	}
+
+	if (offset >= inode->fileSize())
+		co_return {};
+
+	auto map_size = (inode->fileSize() + 0xFFF) & ~size_t(0xFFF);
+
+	helix::LockMemoryView lock_memory;
+	auto &&submit = helix::submitLockMemoryView(helix::BorrowedDescriptor(inode->frontalMemory),
+			&lock_memory, 0, map_size, helix::Dispatcher::global());
+	co_await submit.async_wait();
+	HEL_CHECK(lock_memory.error());
+
+	// Unlike readEntries(), the directory is only mapped once for all entries.
+	helix::Mapping file_map{helix::BorrowedDescriptor{inode->frontalMemory},
+			0, map_size,
+			kHelMapProtRead | kHelMapDontRequireBacking};
+
+	while(offset < inode->fileSize()) {
+		assert(!(offset & 3));
+		assert(offset + sizeof(DiskDirEntry) <= inode->fileSize());
+		auto disk_entry = reinterpret_cast<DiskDirEntry *>(
+				reinterpret_cast<char *>(file_map.get()) + offset);
+		assert(offset + disk_entry->recordLength <= inode->fileSize());
+
+		auto next = offset + disk_entry->recordLength;
+
+		// Only advance the offset once the entry has been consumed.
+		if(disk_entry->inode) {
+			protocols::fs::ReadEntriesResult entry{
+				.name = std::string(disk_entry->name, disk_entry->nameLength),
+				.inode = disk_entry->inode,
+				.offset = static_cast<long>(next),
+				.fileType = entryFileType(disk_entry->fileType),
+			};
+			if(!buffer.append(entry))
+				break;
+		}
+
+		offset = next;
+	}
+
+	co_return {};
+}
+
 } } // namespace blockfs::ext2fs
 
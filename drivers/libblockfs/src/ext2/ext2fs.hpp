@@ -23,6 +23,7 @@
 #include "fs.bragi.hpp"
 #include "../fs.hpp"
 #include "../metadata-cache.hpp"
+#include "htree.hpp"
 
 namespace blockfs {
 namespace ext2fs {
@@ -202,7 +203,14 @@ struct DiskSuperblock {
 static_assert(sizeof(DiskSuperblock) == 1024, "Bad DiskSuperblock struct size");
 
 enum {
-	EXT4_COMPAT_HAS_JOURNAL = 0x4
+	EXT4_COMPAT_HAS_JOURNAL = 0x4,
+	EXT4_COMPAT_DIR_INDEX = 0x20
+};
+
+// Values of DiskSuperblock::flags.
+enum {
+	EXT2_FLAGS_SIGNED_HASH = 0x1,
+	EXT2_FLAGS_UNSIGNED_HASH = 0x2
 };
 
 enum {
@@ -312,9 +320,26 @@ struct DiskDirEntry {
 	char name[];
 };
 
+// Occupies the last 12 bytes of directory blocks on file systems with metadata_csum.
+// It looks like an unused directory entry to readers that do not know about checksums.
+struct DirentTail {
+	uint32_t reservedZero1;
+	uint16_t recordLength;
+	uint8_t reservedZero2;
+	uint8_t reservedFileType;
+	uint32_t checksum;
+};
+static_assert(sizeof(DirentTail) == 12, "Bad DirentTail struct size");
+
+inline constexpr uint8_t direntTailFileType = 0xDE;
+
 enum {
 	EXT2_FT_REG_FILE = 1,
 	EXT2_FT_DIR = 2,
+	EXT2_FT_CHRDEV = 3,
+	EXT2_FT_BLKDEV = 4,
+	EXT2_FT_FIFO = 5,
+	EXT2_FT_SOCK = 6,
 	EXT2_FT_SYMLINK = 7
 };
 
@@ -344,6 +369,22 @@ struct ExtentBlockRange {
 
 struct FileSystem;
 
+// Position of a name in the index of a hashed directory.
+struct DxPath {
+	struct Frame {
+		// Offset (within the directory) of the index node's DxEntry array.
+		size_t entriesOffset;
+		// Index of the DxEntry that covers the hash.
+		unsigned int at;
+	};
+
+	uint32_t hash;
+	int hashVersion;
+	Frame frames[3];
+	int numFrames;
+	uint32_t leafBlock;
+};
+
 struct Inode final : BaseInode, std::enable_shared_from_this<Inode> {
 	Inode(FileSystem &fs, uint32_t number);
 
@@ -374,6 +415,44 @@ struct Inode final : BaseInode, std::enable_shared_from_this<Inode> {
 	// Callers must hold inodeMutex (shared).
 	async::result<std::expected<bool, protocols::fs::Error>> isDirectoryEmpty();
 
+	// Returns the offset of the entry with the given name within the directory.
+	// Uses the htree index of hashed directories and the in-memory index otherwise.
+	// Callers must hold inodeMutex (shared) and must have locked the directory's memory.
+	std::optional<size_t> locateEntry(const std::string &name);
+
+	// Walks the htree index of a hashed directory. Returns std::nullopt if the directory
+	// is not hashed or if its index cannot be used (in which case it is scanned linearly).
+	// Callers must hold inodeMutex (shared) and must have locked the directory's memory.
+	std::optional<DxPath> dxProbe(std::string_view name);
+
+	// Splits the leaf of a hashed directory that DxPath points to. If the bottom index node
+	// is full, it grows the index instead (see dxGrowIndex()) and callers have to probe again.
+	// Returns false if the index cannot grow any further (callers then fall back to
+	// a linear directory).
+	// Callers must hold inodeMutex (exclusive) and must have locked the directory's memory.
+	async::result<bool> dxSplitLeaf(const DxPath &path);
+
+	// Makes room in the bottom index node of DxPath: splits the lowest full node below a node
+	// that has room or, if all nodes on the path are full, adds another level below the root.
+	// Returns false if the directory already has the maximal number of levels.
+	// Callers must hold inodeMutex (exclusive) and must have locked the directory's memory.
+	async::result<bool> dxGrowIndex(const DxPath &path);
+
+	// Inserts a DxEntry right after the entry that the frame points to and updates
+	// the checksum of the index block. The index node must not be full.
+	void dxInsertEntry(const DxPath::Frame &frame, uint32_t hash, uint32_t block);
+
+	// Turns a full single-block directory into a hashed one (as Linux does): the entries
+	// are moved into a new leaf block and the first block becomes the root of the index.
+	// Returns false if the directory cannot be indexed (callers then append a linear block).
+	// Callers must hold inodeMutex (exclusive) and must have locked the directory's memory.
+	async::result<bool> dxMakeIndexed();
+
+	// Turns a hashed directory into a linear one; the index blocks are then
+	// treated as empty directory entries (as required by the htree format).
+	// Callers must hold inodeMutex (exclusive).
+	async::result<void> clearIndexFlag();
+
 	// Repoints the ".." entry of this directory at a new parent inode.
 	// Callers must hold topologyMutex (exclusive).
 	// Callers must hold inodeMutex (exclusive).
@@ -437,7 +516,18 @@ struct Inode final : BaseInode, std::enable_shared_from_this<Inode> {
 	async::result<frg::expected<protocols::fs::Error>>
 	resizeFile(size_t newSize);
 
+	// Appends a block to the directory and remaps it. Returns the offset of the new block.
+	// Callers must hold inodeMutex (exclusive).
+	async::result<size_t> appendDirectoryBlock();
+
 	bool usesExtents;
+
+	// In-memory index of non-hashed directories that maps names to offsets of entries.
+	// Built lazily by locateEntry() for directories that span multiple blocks and
+	// updated by insertEntry() and removeEntry().
+	// Protected by dirIndexMutex (since lookups only hold inodeMutex in shared mode).
+	std::optional<std::unordered_map<std::string, size_t>> dirIndex;
+	std::mutex dirIndexMutex;
 };
 
 // --------------------------------------------------------
@@ -487,6 +577,9 @@ struct FileSystem final : BaseFileSystem {
 	std::shared_ptr<BaseInode> accessInode(uint32_t number) override;
 	async::result<std::shared_ptr<BaseInode>> createRegular(int uid, int gid, uint32_t parentIno) override;
 	protocols::fs::FsStats getFsStats() override;
+	async::result<frg::expected<protocols::fs::Error, size_t>>
+	copyFileRange(uint32_t sourceIno, uint64_t sourceOffset,
+			uint32_t targetIno, uint64_t targetOffset, size_t length) override;
 
 	async::result<std::shared_ptr<Inode>> createDirectory();
 	async::result<std::shared_ptr<Inode>> createSymlink();
@@ -564,6 +657,14 @@ struct FileSystem final : BaseFileSystem {
 	bool metadataChecksum;
 	bool bgdtChecksum;
 
+	// Support for hashed directories.
+	bool dirIndex;
+	bool largeDir;
+	bool unsignedHash;
+	uint32_t hashSeed[4];
+	// Hash version of new hashed directories.
+	uint8_t defHashVersion;
+
 	// Mount-wide cache of metadata blocks, indexed by disk block number.
 	std::optional<MetadataCache> metadataCache;
 
@@ -592,6 +693,10 @@ struct OpenFile final : BaseFile {
 	// Callers must hold BaseFile::mutex.
 	// Callers must hold the inode's inodeMutex (shared).
 	async::result<std::expected<protocols::fs::ReadEntriesResult, managarm::fs::Errors>> readEntries();
+
+	// Same locking requirements as readEntries().
+	async::result<std::expected<void, managarm::fs::Errors>>
+	readEntriesBatch(protocols::fs::DirentBuffer &buffer);
 };
 
 static_assert(blockfs::Inode<Inode>);
@@ -0,0 +1,268 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstddef>
+#include <optional>
+#include <string_view>
+
+// Support for hashed directories (htree, also known as dx_dir).
+// The hash functions are ported from Linux' fs/ext4/hash.c.
+
+namespace blockfs::ext2fs {
+
+// --------------------------------------------------------
+// On-disk structures
+// --------------------------------------------------------
+
+// Follows the "." and ".." entries in the first block of a hashed directory.
+struct DxRootInfo {
+	uint32_t reservedZero;
+	uint8_t hashVersion;
+	uint8_t infoLength;
+	uint8_t indirectLevels;
+	uint8_t unusedFlags;
+};
+static_assert(sizeof(DxRootInfo) == 8, "Bad DxRootInfo struct size");
+
+// Overlays the hash of the first DxEntry of each index node (the first hash is implicitly zero).
+struct DxCountLimit {
+	uint16_t limit;
+	uint16_t count;
+};
+static_assert(sizeof(DxCountLimit) == 4, "Bad DxCountLimit struct size");
+
+struct DxEntry {
+	uint32_t hash;
+	uint32_t block;
+};
+static_assert(sizeof(DxEntry) == 8, "Bad DxEntry struct size");
+
+// Follows the DxEntry array (i.e., limit entries) of index blocks on file systems with metadata_csum.
+struct DxTail {
+	uint32_t reserved;
+	uint32_t checksum;
+};
+static_assert(sizeof(DxTail) == 8, "Bad DxTail struct size");
+
+enum {
+	DX_HASH_LEGACY = 0,
+	DX_HASH_HALF_MD4 = 1,
+	DX_HASH_TEA = 2,
+	DX_HASH_LEGACY_UNSIGNED = 3,
+	DX_HASH_HALF_MD4_UNSIGNED = 4,
+	DX_HASH_TEA_UNSIGNED = 5
+};
+
+// Offset of the DxRootInfo within the first block ("." and ".." take 12 bytes each).
+inline constexpr size_t dxRootInfoOffset = 24;
+// Offset of the DxCountLimit within other index blocks (after an empty directory entry).
+inline constexpr size_t dxNodeEntriesOffset = 8;
+// The upper bits of DxEntry::block are reserved.
+inline constexpr uint32_t dxBlockMask = 0x0FFFFFFF;
+
+// --------------------------------------------------------
+// Hash functions
+// --------------------------------------------------------
+
+namespace dx_hash {
+
+inline constexpr uint32_t legacyHash(std::string_view name, bool isUnsigned) {
+	uint32_t hash;
+	uint32_t hash0 = 0x12A3FE2D;
+	uint32_t hash1 = 0x37ABE8F9;
+	for(char c : name) {
+		int value = isUnsigned ? static_cast<int>(static_cast<unsigned char>(c))
+				: static_cast<int>(static_cast<signed char>(c));
+		hash = hash1 + (hash0 ^ static_cast<uint32_t>(value * 7152373));
+		if(hash & 0x80000000)
+			hash -= 0x7FFFFFFF;
+		hash1 = hash0;
+		hash0 = hash;
+	}
+	return hash0 << 1;
+}
+
+// Packs (up to) num * 4 bytes of the name into buf, padding with the length.
+inline constexpr void stringToHashBuffer(std::string_view name, uint32_t *buf, int num, bool isUnsigned) {
+	uint32_t pad = static_cast<uint32_t>(name.size()) | (static_cast<uint32_t>(name.size()) << 8);
+	pad |= pad << 16;
+
+	uint32_t value = pad;
+	size_t length = std::min(name.size(), static_cast<size_t>(num) * 4);
+	for(size_t i = 0; i < length; i++) {
+		int c = isUnsigned ? static_cast<int>(static_cast<unsigned char>(name[i]))
+				: static_cast<int>(static_cast<signed char>(name[i]));
+		value = static_cast<uint32_t>(c) + (value << 8);
+		if((i % 4) == 3) {
+			*buf++ = value;
+			value = pad;
+			num--;
+		}
+	}
+	if(--num >= 0)
+		*buf++ = value;
+	while(--num >= 0)
+		*buf++ = pad;
+}
+
+inline constexpr void teaTransform(uint32_t buf[4], const uint32_t in[4]) {
+	uint32_t sum = 0;
+	uint32_t b0 = buf[0];
+	uint32_t b1 = buf[1];
+	uint32_t a = in[0], b = in[1], c = in[2], d = in[3];
+	for(int n = 0; n < 16; n++) {
+		sum += 0x9E3779B9;
+		b0 += ((b1 << 4) + a) ^ (b1 + sum) ^ ((b1 >> 5) + b);
+		b1 += ((b0 << 4) + c) ^ (b0 + sum) ^ ((b0 >> 5) + d);
+	}
+	buf[0] += b0;
+	buf[1] += b1;
+}
+
+inline constexpr void halfMd4Transform(uint32_t buf[4], const uint32_t in[8]) {
+	auto f = [] (uint32_t x, uint32_t y, uint32_t z) { return z ^ (x & (y ^ z)); };
+	auto g = [] (uint32_t x, uint32_t y, uint32_t z) { return (x & y) + ((x ^ y) & z); };
+	auto h = [] (uint32_t x, uint32_t y, uint32_t z) { return x ^ y ^ z; };
+	auto round = [] (auto fn, uint32_t &a, uint32_t b, uint32_t c, uint32_t d,
+			uint32_t x, int s) {
+		a = std::rotl(a + fn(b, c, d) + x, s);
+	};
+	constexpr uint32_t k1 = 0;
+	constexpr uint32_t k2 = 013240474631;
+	constexpr uint32_t k3 = 015666365641;
+
+	uint32_t a = buf[0], b = buf[1], c = buf[2], d = buf[3];
+
+	round(f, a, b, c, d, in[0] + k1, 3);
+	round(f, d, a, b, c, in[1] + k1, 7);
+	round(f, c, d, a, b, in[2] + k1, 11);
+	round(f, b, c, d, a, in[3] + k1, 19);
+	round(f, a, b, c, d, in[4] + k1, 3);
+	round(f, d, a, b, c, in[5] + k1, 7);
+	round(f, c, d, a, b, in[6] + k1, 11);
+	round(f, b, c, d, a, in[7] + k1, 19);
+
+	round(g, a, b, c, d, in[1] + k2, 3);
+	round(g, d, a, b, c, in[3] + k2, 5);
+	round(g, c, d, a, b, in[5] + k2, 9);
+	round(g, b, c, d, a, in[7] + k2, 13);
+	round(g, a, b, c, d, in[0] + k2, 3);
+	round(g, d, a, b, c, in[2] + k2, 5);
+	round(g, c, d, a, b, in[4] + k2, 9);
+	round(g, b, c, d, a, in[6] + k2, 13);
+
+	round(h, a, b, c, d, in[3] + k3, 3);
+	round(h, d, a, b, c, in[7] + k3, 9);
+	round(h, c, d, a, b, in[2] + k3, 11);
+	round(h, b, c, d, a, in[6] + k3, 15);
+	round(h, a, b, c, d, in[1] + k3, 3);
+	round(h, d, a, b, c, in[5] + k3, 9);
+	round(h, c, d, a, b, in[0] + k3, 11);
+	round(h, b, c, d, a, in[4] + k3, 15);
+
+	buf[0] += a;
+	buf[1] += b;
+	buf[2] += c;
+	buf[3] += d;
+}
+
+} // namespace dx_hash
+
+// Computes the hash of a directory entry name, with the lowest bit cleared
+// (the lowest bit of DxEntry::hash marks hash collisions across leaf blocks).
+// Returns std::nullopt for unsupported hash versions.
+inline constexpr std::optional<uint32_t> dxHashName(std::string_view name, int version, const uint32_t seed[4]) {
+	uint32_t buf[4] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476};
+	if(seed[0] || seed[1] || seed[2] || seed[3]) {
+		for(int i = 0; i < 4; i++)
+			buf[i] = seed[i];
+	}
+
+	uint32_t hash;
+	switch(version) {
+	case DX_HASH_LEGACY:
+	case DX_HASH_LEGACY_UNSIGNED:
+		hash = dx_hash::legacyHash(name, version == DX_HASH_LEGACY_UNSIGNED);
+		break;
+	case DX_HASH_HALF_MD4:
+	case DX_HASH_HALF_MD4_UNSIGNED: {
+		uint32_t in[8];
+		auto rest = name;
+		do {
+			dx_hash::stringToHashBuffer(rest, in, 8, version == DX_HASH_HALF_MD4_UNSIGNED);
+			dx_hash::halfMd4Transform(buf, in);
+			rest.remove_prefix(std::min(rest.size(), size_t{32}));
+		} while(!rest.empty());
+		hash = buf[1];
+		break;
+	}
+	case DX_HASH_TEA:
+	case DX_HASH_TEA_UNSIGNED: {
+		uint32_t in[4];
+		auto rest = name;
+		do {
+			dx_hash::stringToHashBuffer(rest, in, 4, version == DX_HASH_TEA_UNSIGNED);
+			dx_hash::teaTransform(buf, in);
+			rest.remove_prefix(std::min(rest.size(), size_t{16}));
+		} while(!rest.empty());
+		hash = buf[0];
+		break;
+	}
+	default:
+		return std::nullopt;
+	}
+
+	hash &= ~uint32_t{1};
+	// 0x7FFFFFFF << 1 is reserved as an end-of-directory marker.
+	if(hash == (uint32_t{0x7FFFFFFF} << 1))
+		hash = uint32_t{0x7FFFFFFE} << 1;
+	return hash;
+}
+
+// Known-answer tests; reference values were computed with ext2fs_dirhash() from e2fsprogs.
+namespace dx_hash {
+
+inline constexpr uint32_t katNoSeed[4] = {0, 0, 0, 0};
+inline constexpr uint32_t katSeed[4] = {0x01234567, 0x89ABCDEF, 0xFEDCBA98, 0x76543210};
+// Contains bytes >= 0x80, which distinguishes the signed from the unsigned variants.
+inline constexpr std::string_view katHighName{"n\xE4me\xFF"};
+// Longer than one half_md4 (32 bytes) or TEA (16 bytes) input block.
+inline constexpr std::string_view katLongName{"a-very-long-file-name-that-exceeds-thirty-two-bytes.txt"};
+
+static_assert(dxHashName("lost+found", DX_HASH_LEGACY, katNoSeed) == 0x5E2ABA24);
+static_assert(dxHashName("lost+found", DX_HASH_HALF_MD4, katNoSeed) == 0x591DE422);
+static_assert(dxHashName("lost+found", DX_HASH_TEA, katNoSeed) == 0x2DBF9E80);
+static_assert(dxHashName("lost+found", DX_HASH_HALF_MD4, katSeed) == 0xF489B8EC);
+static_assert(dxHashName("lost+found", DX_HASH_TEA, katSeed) == 0xBB0625D4);
+// The legacy hash ignores the seed.
+static_assert(dxHashName("lost+found", DX_HASH_LEGACY, katSeed) == 0x5E2ABA24);
+
+static_assert(dxHashName(katHighName, DX_HASH_LEGACY, katNoSeed) == 0x158EC288);
+static_assert(dxHashName(katHighName, DX_HASH_HALF_MD4, katNoSeed) == 0xECEAF082);
+static_assert(dxHashName(katHighName, DX_HASH_TEA, katNoSeed) == 0x46CD84BA);
+static_assert(dxHashName(katHighName, DX_HASH_LEGACY_UNSIGNED, katNoSeed) == 0x2992C29C);
+static_assert(dxHashName(katHighName, DX_HASH_HALF_MD4_UNSIGNED, katNoSeed) == 0x3C413422);
+static_assert(dxHashName(katHighName, DX_HASH_TEA_UNSIGNED, katNoSeed) == 0x160C1C18);
+static_assert(dxHashName(katHighName, DX_HASH_HALF_MD4, katSeed) == 0x6664DA0E);
+static_assert(dxHashName(katHighName, DX_HASH_TEA, katSeed) == 0xDBCB3444);
+static_assert(dxHashName(katHighName, DX_HASH_HALF_MD4_UNSIGNED, katSeed) == 0xEB1DE090);
+static_assert(dxHashName(katHighName, DX_HASH_TEA_UNSIGNED, katSeed) == 0x7A0C8964);
+
+static_assert(dxHashName(katLongName, DX_HASH_LEGACY, katNoSeed) == 0x18E33D9A);
+static_assert(dxHashName(katLongName, DX_HASH_HALF_MD4, katNoSeed) == 0x3579649C);
+static_assert(dxHashName(katLongName, DX_HASH_TEA, katNoSeed) == 0xD39D722E);
+static_assert(dxHashName(katLongName, DX_HASH_HALF_MD4, katSeed) == 0xC9E2C156);
+static_assert(dxHashName(katLongName, DX_HASH_TEA, katSeed) == 0x82DB05DA);
+
+// The unsigned variants only differ for bytes >= 0x80.
+static_assert(dxHashName("entry-xxxx123", DX_HASH_LEGACY_UNSIGNED, katNoSeed) == 0x6A329BB4);
+static_assert(dxHashName("entry-xxxx123", DX_HASH_HALF_MD4_UNSIGNED, katNoSeed) == 0xAE890996);
+static_assert(dxHashName("entry-xxxx123", DX_HASH_TEA_UNSIGNED, katNoSeed) == 0xA50EB47A);
+
+static_assert(!dxHashName("lost+found", 6, katNoSeed));
+
+} // namespace dx_hash
+
+} // namespace blockfs::ext2fs
@@ -30,6 +30,23 @@ readEntries(void *object) {
 	co_return co_await self->readEntries();
 }
 
+async::result<std::expected<void, managarm::fs::Errors>>
+readEntriesBatch(void *object, protocols::fs::DirentBuffer &buffer) {
+	auto self = static_cast<ext2fs::OpenFile *>(object);
+
+	ostContext.emit(
+		ostEvtReadDir
+	);
+
+	co_await self->mutex.async_lock();
+	frg::unique_lock fileLock{frg::adopt_lock, self->mutex};
+
+	co_await self->inode->inodeMutex.async_lock_shared();
+	frg::shared_lock inodeLock{frg::adopt_lock, self->inode->inodeMutex};
+
+	co_return co_await self->readEntriesBatch(buffer);
+}
+
 async::result<int> getFileFlags(void *object) {
 	auto self = static_cast<ext2fs::OpenFile *>(object);
 	int flags = 0;
@@ -367,9 +384,12 @@ constinit protocols::fs::FileOperations fileOperations {
 	.seekEof      = &doSeekEof<FileSystem>,
 	.read         = &doRead<FileSystem>,
 	.pread        = &doPread<FileSystem>,
+	.readMemory   = &doReadMemory<FileSystem>,
+	.preadMemory  = &doPreadMemory<FileSystem>,
 	.write        = &doWrite<FileSystem>,
 	.pwrite       = &doPwrite<FileSystem>,
 	.readEntries  = &readEntries,
+	.readEntriesBatch = &readEntriesBatch,
 	.accessMemory = &doAccessMemory<FileSystem>,
 	.truncate     = &doTruncate<FileSystem>,
 	.flock        = &doFlock<FileSystem>,
@@ -395,4 +415,10 @@ constinit protocols::fs::NodeOperations nodeOperations{
 	.getLinkOrCreate = &getLinkOrCreate
 };
 
+async::result<frg::expected<protocols::fs::Error, size_t>>
+FileSystem::copyFileRange(uint32_t sourceIno, uint64_t sourceOffset,
+		uint32_t targetIno, uint64_t targetOffset, size_t length) {
+	return doCopyFileRange(this, sourceIno, sourceOffset, targetIno, targetOffset, length);
+}
+
 } // namespace blockfs::ext2fs
@@ -82,6 +82,11 @@ struct BaseFileSystem {
 	virtual std::shared_ptr<BaseInode> accessInode(uint32_t inode) = 0;
 	virtual async::result<std::shared_ptr<BaseInode>> createRegular(int uid, int gid, uint32_t parentIno) = 0;
 	virtual protocols::fs::FsStats getFsStats() = 0;
+	// Copies data between two regular files of this file system without going through clients.
+	// Returns the number of bytes copied (which is short at the end of the source file).
+	virtual async::result<frg::expected<protocols::fs::Error, size_t>>
+	copyFileRange(uint32_t sourceIno, uint64_t sourceOffset,
+			uint32_t targetIno, uint64_t targetOffset, size_t length) = 0;
 
 	BaseFileSystem() = default;
 
@@ -474,6 +474,35 @@ struct HandlePartition {
 		co_return {};
 	}
 
+	async::result<std::expected<void, DispatchError>>
+	operator()(managarm::fs::CopyFileRangeRequest &&req, helix::BorrowedDescriptor conversation, bragi::preamble,
+			gpt::Partition *, raw::RawFs *, std::unique_ptr<BaseFileSystem> *fsPtr) {
+		auto &fs = *fsPtr;
+		managarm::fs::CopyFileRangeResponse resp;
+		if(!fs) {
+			resp.set_error(managarm::fs::Errors::ILLEGAL_OPERATION_TARGET);
+		} else if(req.offset_source() < 0 || req.offset_target() < 0) {
+			resp.set_error(managarm::fs::Errors::ILLEGAL_ARGUMENT);
+		} else {
+			auto result = co_await fs->copyFileRange(req.inode_source(), req.offset_source(),
+					req.inode_target(), req.offset_target(), req.size());
+			if(!result) {
+				resp.set_error(result.error() | protocols::fs::toFsError);
+			} else {
+				resp.set_error(managarm::fs::Errors::SUCCESS);
+				resp.set_size(result.value());
+			}
+		}
+
+		auto ser = resp.SerializeAsString();
+		auto [send_resp] = co_await helix_ng::exchangeMsgs(
+			conversation,
+			helix_ng::sendBuffer(ser.data(), ser.size())
+		);
+		HEL_CHECK(send_resp.error());
+		co_return {};
+	}
+
 	async::result<std::expected<void, DispatchError>>
 	operator()(managarm::fs::GenericIoctlRequest &&req, helix::BorrowedDescriptor conversation, bragi::preamble,
 			gpt::Partition *partition, raw::RawFs *, std::unique_ptr<BaseFileSystem> *) {
@@ -512,6 +541,7 @@ async::detached servePartition(helix::UniqueLane lane, gpt::Partition *partition
 			managarm::fs::MountRequest,
 			managarm::fs::RenameRequest,
 			managarm::fs::GetFsStatsRequest,
+			managarm::fs::CopyFileRangeRequest,
 			managarm::fs::GenericIoctlRequest
 		>(lane, HandlePartition{}, partition, rawFs.get(), &fs);
 		if(!res) {
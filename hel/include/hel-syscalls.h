@@ -275,6 +275,26 @@ extern inline __attribute__ (( always_inline )) HelError helQueryThreadStats(Hel
 	return helSyscall2(kHelCallQueryThreadStats, (HelWord)handle, (HelWord)stats);
 };
 
+extern inline __attribute__ (( always_inline )) HelError helQueryUniverseStats(HelHandle handle,
+		struct HelThreadStats *stats) {
+	return helSyscall2(kHelCallQueryUniverseStats, (HelWord)handle, (HelWord)stats);
+};
+
+extern inline __attribute__ (( always_inline )) HelError helSetSchedulingParameters(
+		HelHandle handle, const struct HelSchedulingParameters *params) {
+	return helSyscall2(kHelCallSetSchedulingParameters, (HelWord)handle, (HelWord)params);
+};
+
+extern inline __attribute__ (( always_inline )) HelError helGetSchedulingParameters(
+		HelHandle handle, struct HelSchedulingParameters *params) {
+	return helSyscall2(kHelCallGetSchedulingParameters, (HelWord)handle, (HelWord)params);
+};
+
+extern inline __attribute__ (( always_inline )) HelError helSetTimerSlack(HelHandle handle,
+		uint64_t slack) {
+	return helSyscall2(kHelCallSetTimerSlack, (HelWord)handle, (HelWord)slack);
+};
+
 extern inline __attribute__ (( always_inline )) HelError helYield() {
 	return helSyscall0(kHelCallYield);
 };
@@ -415,6 +435,19 @@ extern inline __attribute__ (( always_inline )) HelError helAutomateIrq(HelHandl
 			(HelWord)kernlet);
 };
 
+extern inline __attribute__ (( always_inline )) HelError helSetIrqAffinity(HelHandle handle,
+		uint32_t cpu) {
+	return helSyscall2(kHelCallSetIrqAffinity, (HelWord)handle, (HelWord)cpu);
+};
+
+extern inline __attribute__ (( always_inline )) HelError helGetIrqAffinity(HelHandle handle,
+		uint32_t *cpu) {
+	HelWord cpu_word;
+	HelError error = helSyscall1_1(kHelCallGetIrqAffinity, (HelWord)handle, &cpu_word);
+	*cpu = (uint32_t)cpu_word;
+	return error;
+};
+
 extern inline __attribute__ (( always_inline )) HelError helAccessIo(
 	HelHandle accessHandle, const uintptr_t *portArray, size_t numPorts, HelHandle *handle
 ) {
@@ -18,7 +18,7 @@
 
 enum {
 	// largest system call number plus 1
-	kHelNumCalls = 113,
+	kHelNumCalls = 119,
 
 	kHelCallLog = 1,
 	kHelCallPanic = 10,
@@ -67,7 +67,11 @@ enum {
 
 	kHelCallCreateThread = 67,
 	kHelCallQueryThreadStats = 95,
+	kHelCallQueryUniverseStats = 118,
 	kHelCallSetPriority = 85,
+	kHelCallSetSchedulingParameters = 115,
+	kHelCallGetSchedulingParameters = 116,
+	kHelCallSetTimerSlack = 117,
 	kHelCallYield = 34,
 	kHelCallSubmitObserve = 74,
 	kHelCallKillThread = 87,
@@ -103,6 +107,8 @@ enum {
 	kHelCallAcknowledgeIrq = 81,
 	kHelCallSubmitAwaitEvent = 82,
 	kHelCallAutomateIrq = 94,
+	kHelCallSetIrqAffinity = 113,
+	kHelCallGetIrqAffinity = 114,
 
 	kHelCallAccessIo = 11,
 	kHelCallEnableIo = 12,
@@ -401,6 +407,7 @@ enum {
 	kHelActionExtractCredentials = 9,
 	kHelActionSendFromBuffer = 1,
 	kHelActionSendFromBufferSg = 10,
+	kHelActionSendFromMemory = 12,
 	kHelActionRecvInline = 7,
 	kHelActionRecvToBuffer = 3,
 	kHelActionPushDescriptor = 2,
@@ -413,6 +420,10 @@ enum {
 	kHelItemWantLane = (1 << 16),
 };
 
+//! Maximum size of kHelActionRecvInline if no explicit size is given.
+//! Larger sizes can be requested as long as the result fits into a single queue chunk.
+static const size_t kHelRecvInlineDefaultLength = 128;
+
 static const uint32_t kHelTransferDescriptorOut = UINT32_C(1) << 0;
 static const uint32_t kHelTransferDescriptorIn = UINT32_C(1) << 1;
 
@@ -430,16 +441,21 @@ struct HelAction {
 	union {
 		uintptr_t word0;
 		void *buffer;
+		// For kHelActionSendFromMemory: offset into the memory object.
+		uintptr_t offset;
 	};
 	union {
 		uintptr_t word1;
+		// For kHelActionRecvInline: maximum size of the received data
+		// (zero selects kHelRecvInlineDefaultLength).
 		size_t length;
 		// For kHelPushDescriptor, kHelPullDescriptor.
 		uint32_t rights;
 	};
 	union {
 		uintptr_t word2;
-		// For kHelActionImbueCredentials, kHelPushDescriptor, kHelPullDescriptor.
+		// For kHelActionImbueCredentials, kHelActionSendFromMemory,
+		// kHelPushDescriptor, kHelPullDescriptor.
 		HelHandle handle;
 	};
 };
@@ -463,7 +479,11 @@ enum HelManagedFlags {
 
 enum HelManageRequests {
 	kHelManageInitialize = 1,
-	kHelManageWriteback = 2
+	kHelManageWriteback = 2,
+	// Only sent for swap spaces: the swapped-out copy of the range is no longer needed.
+	// The driver acknowledges the request via helUpdateMemory(); the swap offsets
+	// are only reused afterwards.
+	kHelManageDiscard = 3
 };
 
 enum HelMapFlags {
@@ -745,6 +765,16 @@ static const uint32_t kHelSubmitWritebackFence = 14;
 static const uint32_t kHelSubmitInvalidateMemory = 15;
 //! SQ opcode: populate a space.
 static const uint32_t kHelSubmitPopulateSpace = 16;
+//! SQ opcode: map memory into a space.
+static const uint32_t kHelSubmitMapMemory = 17;
+//! SQ opcode: unmap memory from a space.
+static const uint32_t kHelSubmitUnmapMemory = 18;
+//! SQ opcode: close a descriptor.
+static const uint32_t kHelSubmitCloseDescriptor = 19;
+//! SQ opcode: wait on a futex.
+static const uint32_t kHelSubmitFutexWait = 20;
+//! SQ opcode: wake waiters of a futex.
+static const uint32_t kHelSubmitFutexWake = 21;
 
 //! In-memory kernel/user-space queue.
 struct HelQueue {
@@ -815,12 +845,19 @@ struct HelSqExchangeMsgs {
 	uint32_t flags;
 };
 
+//! Value of HelSqAwaitClock::slack that selects the timer slack of the submitting thread.
+static const uint64_t kHelTimerSlackDefault = UINT64_MAX;
+
 //! SQ data for kHelSubmitAwaitClock.
 struct HelSqAwaitClock {
 	//! Deadline in nanoseconds since boot.
 	uint64_t counter;
 	//! Tag to cancel this operation.
 	uint64_t cancellationTag;
+	//! Maximal amount of time (in nanoseconds) by which the operation may complete
+	//! after the deadline, or ::kHelTimerSlackDefault.
+	//! Optional: if the SQ element ends before this field, ::kHelTimerSlackDefault is used.
+	uint64_t slack;
 };
 
 //! SQ data for kHelSubmitAwaitEvent.
@@ -945,6 +982,61 @@ struct HelSqPopulateSpace {
 	size_t length;
 };
 
+//! SQ data for kHelSubmitMapMemory.
+//! The arguments have the same meaning as for helMapMemory().
+struct HelSqMapMemory {
+	//! Handle to the memory object.
+	HelHandle memoryHandle;
+	//! Handle to the address space (or kHelNullHandle).
+	HelHandle spaceHandle;
+	//! Requested address within the space.
+	void *pointer;
+	//! Offset within the memory object.
+	uintptr_t offset;
+	//! Length of the mapping.
+	size_t length;
+	//! Flags of the mapping (kHelMap*).
+	uint32_t flags;
+};
+
+//! SQ data for kHelSubmitUnmapMemory.
+struct HelSqUnmapMemory {
+	//! Handle to the address space (or kHelNullHandle).
+	HelHandle spaceHandle;
+	//! Start of the range.
+	void *pointer;
+	//! Length of the range.
+	size_t length;
+};
+
+//! SQ data for kHelSubmitCloseDescriptor.
+struct HelSqCloseDescriptor {
+	//! Handle to the universe (or kHelThisUniverse).
+	HelHandle universeHandle;
+	//! Handle of the descriptor to close.
+	HelHandle handle;
+};
+
+//! SQ data for kHelSubmitFutexWait.
+struct HelSqFutexWait {
+	//! Address of the futex word.
+	int *pointer;
+	//! Value that the futex word is expected to have.
+	int expected;
+	//! Deadline in nanoseconds since boot (or -1 to wait indefinitely).
+	int64_t deadline;
+	//! Tag to cancel this operation.
+	uint64_t cancellationTag;
+};
+
+//! SQ data for kHelSubmitFutexWake.
+struct HelSqFutexWake {
+	//! Address of the futex word.
+	int *pointer;
+	//! Maximal number of waiters to wake.
+	unsigned int count;
+};
+
 struct HelSimpleResult {
 	HelError error;
 	int reserved;
@@ -993,6 +1085,12 @@ struct HelHandleResult {
 	HelHandle handle;
 };
 
+struct HelMapResult {
+	HelError error;
+	int reserved;
+	void *pointer;
+};
+
 struct HelEventResult {
 	HelError error;
 	uint32_t bitset;
@@ -1011,7 +1109,43 @@ union HelKernletData {
 };
 
 struct HelThreadStats {
+	//! Time that the thread spent running (in nanoseconds).
 	uint64_t userTime;
+	//! Time that the thread spent waiting in a run queue while it was runnable.
+	uint64_t waitTime;
+	//! Number of time slices that the thread received.
+	uint64_t timeslices;
+	//! Number of times that the thread blocked.
+	uint64_t voluntarySwitches;
+	//! Number of times that the thread was preempted.
+	uint64_t involuntarySwitches;
+	//! Number of times that the thread moved to a different CPU.
+	uint64_t migrations;
+	//! Time that the thread spent waiting for IPC completions (via helDriveQueue).
+	uint64_t ipcWaitTime;
+	//! Time that the thread spent resolving page faults.
+	uint64_t faultTime;
+};
+
+enum HelSchedulingPolicy {
+	kHelSchedulingFair = 0,
+	kHelSchedulingFifo = 1,
+	kHelSchedulingRoundRobin = 2,
+	kHelSchedulingDeadline = 3,
+};
+
+struct HelSchedulingParameters {
+	//! One of the ::HelSchedulingPolicy values.
+	int policy;
+	//! Priority of the thread. For real-time policies, the priority must be in [1, 99].
+	//! Ignored for ::kHelSchedulingDeadline and ::kHelSchedulingFair;
+	//! fair threads keep the priority that was set by helSetPriority().
+	int priority;
+	//! For ::kHelSchedulingDeadline: runtime per period, relative deadline and period
+	//! (in nanoseconds). A period of zero is equivalent to a period equal to the deadline.
+	uint64_t runtime;
+	uint64_t deadline;
+	uint64_t period;
 };
 
 enum {
@@ -1229,6 +1363,8 @@ HEL_C_LINKAGE HelError helCreateManagedMemory(size_t size, uint32_t flags,
 //! these offsets from disk") and writeback ("write them out") requests
 //! through helSubmitManageMemory()/helUpdateMemory(). The kernel only issues
 //! writeback once a swap budget is set through helSetSwapBudget().
+//! When swapped-out pages are freed, the kernel issues discard requests; the
+//! daemon drops its copies and acknowledges them through helUpdateMemory().
 //! @param[out] backingHandle
 //!    	Handle to the swap space's memory object (for the swap daemon).
 //! @param[out] swapHandle
@@ -1405,6 +1541,15 @@ HEL_C_LINKAGE HelError helCreateThread(HelHandle universe, HelHandle spaceHandle
 //!     Statistics related to the thread.
 HEL_C_LINKAGE HelError helQueryThreadStats(HelHandle handle, struct HelThreadStats *stats);
 
+//! Query run-time statistics of all threads of a universe.
+//!
+//! The statistics include threads that already terminated.
+//! @param[in] handle
+//!     Handle to the universe (or kHelThisUniverse).
+//! @param[out] stats
+//!     Statistics summed over all threads of the universe.
+HEL_C_LINKAGE HelError helQueryUniverseStats(HelHandle handle, struct HelThreadStats *stats);
+
 //! Set the priority of a thread.
 //!
 //! Managarm always runs the runnable thread with highest priority.
@@ -1415,6 +1560,49 @@ HEL_C_LINKAGE HelError helQueryThreadStats(HelHandle handle, struct HelThreadSta
 //!     New priority value of the thread.
 HEL_C_LINKAGE HelError helSetPriority(HelHandle handle, int priority);
 
+//! Set the scheduling policy and parameters of a thread.
+//!
+//! Threads with a real-time policy (::kHelSchedulingFifo, ::kHelSchedulingRoundRobin)
+//! always take precedence over threads with ::kHelSchedulingFair.
+//! Threads with ::kHelSchedulingDeadline take precedence over all other threads
+//! and are scheduled in order of their deadlines; each such thread may consume
+//! @p runtime nanoseconds per period before it is throttled until its next period.
+//! The bandwidth of ::kHelSchedulingDeadline threads is reserved on the CPU that the thread
+//! is currently assigned to; such threads do not migrate to other CPUs.
+//! @param[in] handle
+//!     Handle to the thread.
+//! @param[in] params
+//!     New scheduling parameters of the thread.
+//!     Returns ::kHelErrIllegalArgs if the parameters are invalid and ::kHelErrIllegalState
+//!     if the bandwidth that is available to ::kHelSchedulingDeadline threads on the CPU
+//!     is exhausted.
+HEL_C_LINKAGE HelError helSetSchedulingParameters(HelHandle handle,
+		const struct HelSchedulingParameters *params);
+
+//! Get the scheduling policy and parameters of a thread.
+//! @param[in] handle
+//!     Handle to the thread.
+//! @param[out] params
+//!     Current scheduling parameters of the thread.
+HEL_C_LINKAGE HelError helGetSchedulingParameters(HelHandle handle,
+		struct HelSchedulingParameters *params);
+
+//! Default timer slack of threads in nanoseconds.
+//! Same as Linux' default timer_slack_ns.
+static const uint64_t kHelDefaultTimerSlack = 50000;
+
+//! Set the timer slack of a thread.
+//!
+//! Timeouts of the thread (i.e., of futex waits and of kHelSubmitAwaitClock
+//! operations that do not specify a slack) may expire up to @p slack nanoseconds late.
+//! This allows the kernel to coalesce the expiration of multiple timers
+//! into a single interrupt.
+//! @param[in] handle
+//!     Handle to the thread.
+//! @param[in] slack
+//!     New timer slack in nanoseconds.
+HEL_C_LINKAGE HelError helSetTimerSlack(HelHandle handle, uint64_t slack);
+
 //! Yields the current thread.
 HEL_C_LINKAGE HelError helYield();
 
@@ -1507,6 +1695,7 @@ HEL_C_LINKAGE HelError helGetAffinity(HelHandle handle, uint8_t *mask, size_t si
 //!     Pointer to a bit mask of CPUs to schedule on.
 //! @param[in] size
 //!     Size of bit mask.
+//!     Returns ::kHelErrIllegalState if the thread uses ::kHelSchedulingDeadline.
 HEL_C_LINKAGE HelError helSetAffinity(HelHandle handle, uint8_t *mask, size_t size);
 
 //! @}
@@ -1614,6 +1803,21 @@ HEL_C_LINKAGE HelError helAcknowledgeIrq(HelHandle handle, uint32_t flags, uint6
 
 HEL_C_LINKAGE HelError helAutomateIrq(HelHandle handle, uint32_t flags, HelHandle kernlet);
 
+//! Route an IRQ to a CPU.
+//! @param[in] handle
+//!     Handle to the IRQ object.
+//! @param[in] cpu
+//!     Index of the CPU that the IRQ is delivered to.
+//!     Returns ::kHelErrNoHardwareSupport if the IRQ cannot be re-routed.
+HEL_C_LINKAGE HelError helSetIrqAffinity(HelHandle handle, uint32_t cpu);
+
+//! Query the CPU that an IRQ is routed to.
+//! @param[in] handle
+//!     Handle to the IRQ object.
+//! @param[out] cpu
+//!     Index of the CPU that the IRQ is delivered to.
+HEL_C_LINKAGE HelError helGetIrqAffinity(HelHandle handle, uint32_t *cpu);
+
 //! @}
 //! @name Input/Output
 //! @{
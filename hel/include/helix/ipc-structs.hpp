@@ -121,6 +121,15 @@ namespace helix_ng {
 
 using namespace helix;
 
+// Size of the queue chunks that helix::Dispatcher allocates.
+inline constexpr size_t dispatcherChunkSize = 4096;
+
+// Largest amount of data that a single recvInline() can receive on a helix::Dispatcher
+// queue. All results of an exchangeMsgs() call share a chunk, i.e., if other items are
+// received alongside the inline data, the effective limit is smaller.
+inline constexpr size_t maxRecvInlineSize = dispatcherChunkSize
+		- sizeof(HelElement) - sizeof(HelInlineResultNoFlex);
+
 struct DismissResult {
 	DismissResult() :_valid{false} {}
 
@@ -321,6 +330,26 @@ private:
 	HelError _error;
 };
 
+struct SendMemoryResult {
+	SendMemoryResult() :_valid{false} {}
+
+	HelError error() {
+		FRG_ASSERT(_valid);
+		return _error;
+	}
+
+	void parse(void *&ptr, ElementHandle) {
+		auto result = reinterpret_cast<HelSimpleResult *>(ptr);
+		_error = result->error;
+		ptr = (char *)ptr + sizeof(HelSimpleResult);
+		_valid = true;
+	}
+
+private:
+	bool _valid;
+	HelError _error;
+};
+
 struct RecvBufferResult {
 	RecvBufferResult() :_valid{false} {}
 
@@ -486,12 +515,21 @@ struct SendBufferSg {
 	size_t size;
 };
 
+struct SendMemory {
+	HelHandle handle;
+	uintptr_t offset;
+	size_t size;
+};
+
 struct RecvBuffer {
 	void *buf;
 	size_t size;
 };
 
-struct RecvInline { };
+struct RecvInline {
+	// Maximum size of the received data; zero selects kHelRecvInlineDefaultLength.
+	size_t maxLength = 0;
+};
 
 struct PushDescriptor {
 	HelHandle handle;
@@ -581,6 +619,12 @@ inline auto sendBufferSg(const HelSgItem *data, size_t length) {
 	return SendBufferSg{data, length};
 }
 
+// Sends a range of a memory object. The kernel copies the data directly from the
+// memory object to the receiver, i.e., the data is not copied to the sender first.
+inline auto sendFromMemory(BorrowedDescriptor memory, uintptr_t offset, size_t length) {
+	return SendMemory{memory.getHandle(), offset, length};
+}
+
 inline auto recvBuffer(void *data, size_t length) {
 	return RecvBuffer{data, length};
 }
@@ -589,6 +633,12 @@ inline auto recvInline() {
 	return RecvInline{};
 }
 
+// Receives up to maxLength bytes inline (i.e., into the IPC queue).
+// The result must fit into a single queue chunk, see maxRecvInlineSize.
+inline auto recvInline(size_t maxLength) {
+	return RecvInline{maxLength};
+}
+
 inline auto pushDescriptor(BorrowedDescriptor desc, uint32_t exposedRights) {
 	return PushDescriptor{
 		.handle = desc.getHandle(),
@@ -719,6 +769,17 @@ inline auto createActionsArrayFor(bool chain, const SendBufferSg &item) {
 	return frg::array<HelAction, 1>{action};
 }
 
+inline auto createActionsArrayFor(bool chain, const SendMemory &item) {
+	HelAction action{};
+	action.type = kHelActionSendFromMemory;
+	action.flags = chain ? kHelItemChain : 0;
+	action.offset = item.offset;
+	action.length = item.size;
+	action.handle = item.handle;
+
+	return frg::array<HelAction, 1>{action};
+}
+
 inline auto createActionsArrayFor(bool chain, const RecvBuffer &item) {
 	HelAction action{};
 	action.type = kHelActionRecvToBuffer;
@@ -729,10 +790,11 @@ inline auto createActionsArrayFor(bool chain, const RecvBuffer &item) {
 	return frg::array<HelAction, 1>{action};
 }
 
-inline auto createActionsArrayFor(bool chain, const RecvInline &) {
+inline auto createActionsArrayFor(bool chain, const RecvInline &item) {
 	HelAction action{};
 	action.type = kHelActionRecvInline;
 	action.flags = chain ? kHelItemChain : 0;
+	action.length = item.maxLength;
 
 	return frg::array<HelAction, 1>{action};
 }
@@ -822,6 +884,10 @@ inline auto resultTypeTuple(const SendBufferSg &) {
 	return frg::tuple<SendBufferSgResult>{};
 }
 
+inline auto resultTypeTuple(const SendMemory &) {
+	return frg::tuple<SendMemoryResult>{};
+}
+
 inline auto resultTypeTuple(const RecvBuffer &) {
 	return frg::tuple<RecvBufferResult>{};
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <assert.h>
+#include <limits.h>
 #include <tuple>
 #include <array>
 #include <vector>
@@ -187,7 +188,7 @@ public:
 
 	Dispatcher()
 	: _handle{kHelNullHandle}, _queue{nullptr},
-			_numCqChunks{8}, _numSqChunks{8}, _chunkSize{4096},
+			_numCqChunks{8}, _numSqChunks{8}, _chunkSize{helix_ng::dispatcherChunkSize},
 			_retrieveChunk{0}, _tailChunk{0}, _lastProgress{0},
 			_sqCurrentChunk{0}, _sqProgress{0}, _runQueue{this} {
 		HelQueueParameters params {
@@ -612,13 +613,14 @@ private:
 
 struct Submission : private Context {
 	Submission(AwaitClock *operation,
-			uint64_t counter, Dispatcher &dispatcher)
+			uint64_t counter, uint64_t slack, Dispatcher &dispatcher)
 	: _result(operation) {
 		auto asyncId = dispatcher.makeAsyncId();
 
 		HelSqAwaitClock sqData;
 		sqData.counter = counter;
 		sqData.cancellationTag = asyncId;
+		sqData.slack = slack;
 		std::array segments{std::as_bytes(std::span{&sqData, 1})};
 		dispatcher.pushSq(kHelSubmitAwaitClock,
 				reinterpret_cast<uintptr_t>(context()), segments);
@@ -712,8 +714,8 @@ private:
 };
 
 inline Submission submitAwaitClock(AwaitClock *operation, uint64_t counter,
-		Dispatcher &dispatcher) {
-	return {operation, counter, dispatcher};
+		Dispatcher &dispatcher, uint64_t slack = kHelTimerSlackDefault) {
+	return {operation, counter, slack, dispatcher};
 }
 
 inline Submission submitProtectMemory(BorrowedDescriptor memory, ProtectMemory *operation,
@@ -1606,4 +1608,467 @@ inline auto populateSpace(BorrowedDescriptor space, uintptr_t address, size_t le
 	return PopulateSpaceSender{std::move(space), address, length};
 }
 
+// --------------------------------------------------------------------
+// MapMemory
+// --------------------------------------------------------------------
+
+struct MapMemoryResult {
+	HelError error() {
+		assert(valid_);
+		return error_;
+	}
+
+	void *pointer() {
+		assert(valid_);
+		return pointer_;
+	}
+
+	void parse(void *&ptr, const ElementHandle &) {
+		auto result = reinterpret_cast<HelMapResult *>(ptr);
+		error_ = result->error;
+		pointer_ = result->pointer;
+		ptr = (char *)ptr + sizeof(HelMapResult);
+		valid_ = true;
+	}
+
+private:
+	bool valid_ = false;
+	HelError error_;
+	void *pointer_;
+};
+
+template <typename Receiver>
+struct MapMemoryOperation : private Context {
+	MapMemoryOperation(BorrowedDescriptor memory, BorrowedDescriptor space,
+			void *pointer, uintptr_t offset, size_t length, uint32_t flags, Receiver r)
+	: memory_{std::move(memory)}, space_{std::move(space)}, pointer_{pointer},
+			offset_{offset}, length_{length}, flags_{flags}, r_{std::move(r)} {}
+
+	void start() {
+		HelSqMapMemory header;
+		header.memoryHandle = memory_.getHandle();
+		header.spaceHandle = space_.getHandle();
+		header.pointer = pointer_;
+		header.offset = offset_;
+		header.length = length_;
+		header.flags = flags_;
+
+		std::array segments{
+			std::as_bytes(std::span{&header, 1})
+		};
+
+		auto context = static_cast<Context *>(this);
+		Dispatcher::global().pushSq(kHelSubmitMapMemory,
+				reinterpret_cast<uintptr_t>(context), segments);
+	}
+
+	MapMemoryOperation(const MapMemoryOperation &) = delete;
+	MapMemoryOperation &operator= (const MapMemoryOperation &) = delete;
+
+private:
+	void complete(ElementHandle element) override {
+		MapMemoryResult result;
+		void *ptr = element.data();
+		result.parse(ptr, element);
+		async::execution::set_value(r_, std::move(result));
+	}
+
+	BorrowedDescriptor memory_;
+	BorrowedDescriptor space_;
+	void *pointer_;
+	uintptr_t offset_;
+	size_t length_;
+	uint32_t flags_;
+	Receiver r_;
+};
+
+struct [[nodiscard]] MapMemorySender {
+	using value_type = MapMemoryResult;
+
+	MapMemorySender(BorrowedDescriptor memory, BorrowedDescriptor space,
+			void *pointer, uintptr_t offset, size_t length, uint32_t flags)
+	: memory_{std::move(memory)}, space_{std::move(space)}, pointer_{pointer},
+			offset_{offset}, length_{length}, flags_{flags} { }
+
+	template<typename Receiver>
+	MapMemoryOperation<Receiver> connect(Receiver receiver) {
+		return {std::move(memory_), std::move(space_), pointer_,
+				offset_, length_, flags_, std::move(receiver)};
+	}
+
+private:
+	BorrowedDescriptor memory_;
+	BorrowedDescriptor space_;
+	void *pointer_;
+	uintptr_t offset_;
+	size_t length_;
+	uint32_t flags_;
+};
+
+inline async::sender_awaiter<MapMemorySender, MapMemoryResult>
+operator co_await (MapMemorySender sender) {
+	return {std::move(sender)};
+}
+
+inline auto mapMemory(BorrowedDescriptor memory, BorrowedDescriptor space,
+		void *pointer, uintptr_t offset, size_t length, uint32_t flags) {
+	return MapMemorySender{std::move(memory), std::move(space), pointer, offset, length, flags};
+}
+
+// --------------------------------------------------------------------
+// UnmapMemory
+// --------------------------------------------------------------------
+
+struct UnmapMemoryResult {
+	HelError error() {
+		assert(valid_);
+		return error_;
+	}
+
+	void parse(void *&ptr, const ElementHandle &) {
+		auto result = reinterpret_cast<HelSimpleResult *>(ptr);
+		error_ = result->error;
+		ptr = (char *)ptr + sizeof(HelSimpleResult);
+		valid_ = true;
+	}
+
+private:
+	bool valid_ = false;
+	HelError error_;
+};
+
+template <typename Receiver>
+struct UnmapMemoryOperation : private Context {
+	UnmapMemoryOperation(BorrowedDescriptor space, void *pointer, size_t length, Receiver r)
+	: space_{std::move(space)}, pointer_{pointer}, length_{length}, r_{std::move(r)} {}
+
+	void start() {
+		HelSqUnmapMemory header;
+		header.spaceHandle = space_.getHandle();
+		header.pointer = pointer_;
+		header.length = length_;
+
+		std::array segments{
+			std::as_bytes(std::span{&header, 1})
+		};
+
+		auto context = static_cast<Context *>(this);
+		Dispatcher::global().pushSq(kHelSubmitUnmapMemory,
+				reinterpret_cast<uintptr_t>(context), segments);
+	}
+
+	UnmapMemoryOperation(const UnmapMemoryOperation &) = delete;
+	UnmapMemoryOperation &operator= (const UnmapMemoryOperation &) = delete;
+
+private:
+	void complete(ElementHandle element) override {
+		UnmapMemoryResult result;
+		void *ptr = element.data();
+		result.parse(ptr, element);
+		async::execution::set_value(r_, std::move(result));
+	}
+
+	BorrowedDescriptor space_;
+	void *pointer_;
+	size_t length_;
+	Receiver r_;
+};
+
+struct [[nodiscard]] UnmapMemorySender {
+	using value_type = UnmapMemoryResult;
+
+	UnmapMemorySender(BorrowedDescriptor space, void *pointer, size_t length)
+	: space_{std::move(space)}, pointer_{pointer}, length_{length} { }
+
+	template<typename Receiver>
+	UnmapMemoryOperation<Receiver> connect(Receiver receiver) {
+		return {std::move(space_), pointer_, length_, std::move(receiver)};
+	}
+
+private:
+	BorrowedDescriptor space_;
+	void *pointer_;
+	size_t length_;
+};
+
+inline async::sender_awaiter<UnmapMemorySender, UnmapMemoryResult>
+operator co_await (UnmapMemorySender sender) {
+	return {std::move(sender)};
+}
+
+inline auto unmapMemory(BorrowedDescriptor space, void *pointer, size_t length) {
+	return UnmapMemorySender{std::move(space), pointer, length};
+}
+
+// --------------------------------------------------------------------
+// CloseDescriptor
+// --------------------------------------------------------------------
+
+struct CloseDescriptorResult {
+	HelError error() {
+		assert(valid_);
+		return error_;
+	}
+
+	void parse(void *&ptr, const ElementHandle &) {
+		auto result = reinterpret_cast<HelSimpleResult *>(ptr);
+		error_ = result->error;
+		ptr = (char *)ptr + sizeof(HelSimpleResult);
+		valid_ = true;
+	}
+
+private:
+	bool valid_ = false;
+	HelError error_;
+};
+
+template <typename Receiver>
+struct CloseDescriptorOperation : private Context {
+	CloseDescriptorOperation(BorrowedDescriptor universe, HelHandle handle, Receiver r)
+	: universe_{std::move(universe)}, handle_{handle}, r_{std::move(r)} {}
+
+	void start() {
+		HelSqCloseDescriptor header;
+		header.universeHandle = universe_.getHandle();
+		header.handle = handle_;
+
+		std::array segments{
+			std::as_bytes(std::span{&header, 1})
+		};
+
+		auto context = static_cast<Context *>(this);
+		Dispatcher::global().pushSq(kHelSubmitCloseDescriptor,
+				reinterpret_cast<uintptr_t>(context), segments);
+	}
+
+	CloseDescriptorOperation(const CloseDescriptorOperation &) = delete;
+	CloseDescriptorOperation &operator= (const CloseDescriptorOperation &) = delete;
+
+private:
+	void complete(ElementHandle element) override {
+		CloseDescriptorResult result;
+		void *ptr = element.data();
+		result.parse(ptr, element);
+		async::execution::set_value(r_, std::move(result));
+	}
+
+	BorrowedDescriptor universe_;
+	HelHandle handle_;
+	Receiver r_;
+};
+
+struct [[nodiscard]] CloseDescriptorSender {
+	using value_type = CloseDescriptorResult;
+
+	CloseDescriptorSender(BorrowedDescriptor universe, HelHandle handle)
+	: universe_{std::move(universe)}, handle_{handle} { }
+
+	template<typename Receiver>
+	CloseDescriptorOperation<Receiver> connect(Receiver receiver) {
+		return {std::move(universe_), handle_, std::move(receiver)};
+	}
+
+private:
+	BorrowedDescriptor universe_;
+	HelHandle handle_;
+};
+
+inline async::sender_awaiter<CloseDescriptorSender, CloseDescriptorResult>
+operator co_await (CloseDescriptorSender sender) {
+	return {std::move(sender)};
+}
+
+// Takes ownership of the descriptor; the handle is released once the kernel processes the SQ.
+inline auto closeDescriptor(UniqueDescriptor descriptor,
+		BorrowedDescriptor universe = BorrowedDescriptor{kHelThisUniverse}) {
+	auto handle = descriptor.getHandle();
+	descriptor.release();
+	return CloseDescriptorSender{std::move(universe), handle};
+}
+
+// --------------------------------------------------------------------
+// FutexWait
+// --------------------------------------------------------------------
+
+struct FutexWaitResult {
+	HelError error() {
+		assert(valid_);
+		return error_;
+	}
+
+	void parse(void *&ptr, const ElementHandle &) {
+		auto result = reinterpret_cast<HelSimpleResult *>(ptr);
+		error_ = result->error;
+		ptr = (char *)ptr + sizeof(HelSimpleResult);
+		valid_ = true;
+	}
+
+private:
+	bool valid_ = false;
+	HelError error_;
+};
+
+template <typename Receiver>
+struct FutexWaitOperation : private Context {
+	FutexWaitOperation(int *pointer, int expected, int64_t deadline,
+			async::cancellation_token ct, Receiver receiver)
+	: pointer_{pointer}, expected_{expected}, deadline_{deadline},
+			ct_{ct}, receiver_{std::move(receiver)} { }
+
+	void start() {
+		asyncId_ = Dispatcher::global().makeAsyncId();
+
+		HelSqFutexWait header;
+		header.pointer = pointer_;
+		header.expected = expected_;
+		header.deadline = deadline_;
+		header.cancellationTag = asyncId_;
+
+		std::array segments{
+			std::as_bytes(std::span{&header, 1})
+		};
+
+		auto context = static_cast<Context *>(this);
+		Dispatcher::global().pushSq(kHelSubmitFutexWait,
+				reinterpret_cast<uintptr_t>(context), segments);
+
+		cb_.emplace(ct_, this);
+	}
+
+	FutexWaitOperation(const FutexWaitOperation &) = delete;
+	FutexWaitOperation &operator= (const FutexWaitOperation &) = delete;
+
+private:
+	void complete(ElementHandle element) override {
+		cb_ = std::nullopt;
+
+		FutexWaitResult result;
+		void *ptr = element.data();
+		result.parse(ptr, element);
+		async::execution::set_value(receiver_, std::move(result));
+	}
+
+	void cancel() {
+		Dispatcher::global().cancel(asyncId_);
+	}
+
+	int *pointer_;
+	int expected_;
+	int64_t deadline_;
+	async::cancellation_token ct_;
+	std::optional<async::cancellation_callback<frg::bound_mem_fn<&FutexWaitOperation::cancel>>> cb_ = std::nullopt;
+	uint64_t asyncId_;
+	Receiver receiver_;
+};
+
+struct [[nodiscard]] FutexWaitSender {
+	using value_type = FutexWaitResult;
+
+	FutexWaitSender(int *pointer, int expected, int64_t deadline, async::cancellation_token ct)
+	: pointer_{pointer}, expected_{expected}, deadline_{deadline}, ct_{ct} { }
+
+	template<typename Receiver>
+	FutexWaitOperation<Receiver> connect(Receiver receiver) {
+		return {pointer_, expected_, deadline_, ct_, std::move(receiver)};
+	}
+
+private:
+	int *pointer_;
+	int expected_;
+	int64_t deadline_;
+	async::cancellation_token ct_;
+};
+
+inline async::sender_awaiter<FutexWaitSender, FutexWaitResult>
+operator co_await (FutexWaitSender sender) {
+	return {std::move(sender)};
+}
+
+inline auto futexWait(int *pointer, int expected, int64_t deadline = -1,
+		async::cancellation_token ct = {}) {
+	return FutexWaitSender{pointer, expected, deadline, ct};
+}
+
+// --------------------------------------------------------------------
+// FutexWake
+// --------------------------------------------------------------------
+
+struct FutexWakeResult {
+	HelError error() {
+		assert(valid_);
+		return error_;
+	}
+
+	void parse(void *&ptr, const ElementHandle &) {
+		auto result = reinterpret_cast<HelSimpleResult *>(ptr);
+		error_ = result->error;
+		ptr = (char *)ptr + sizeof(HelSimpleResult);
+		valid_ = true;
+	}
+
+private:
+	bool valid_ = false;
+	HelError error_;
+};
+
+template <typename Receiver>
+struct FutexWakeOperation : private Context {
+	FutexWakeOperation(int *pointer, unsigned int count, Receiver r)
+	: pointer_{pointer}, count_{count}, r_{std::move(r)} {}
+
+	void start() {
+		HelSqFutexWake header;
+		header.pointer = pointer_;
+		header.count = count_;
+
+		std::array segments{
+			std::as_bytes(std::span{&header, 1})
+		};
+
+		auto context = static_cast<Context *>(this);
+		Dispatcher::global().pushSq(kHelSubmitFutexWake,
+				reinterpret_cast<uintptr_t>(context), segments);
+	}
+
+	FutexWakeOperation(const FutexWakeOperation &) = delete;
+	FutexWakeOperation &operator= (const FutexWakeOperation &) = delete;
+
+private:
+	void complete(ElementHandle element) override {
+		FutexWakeResult result;
+		void *ptr = element.data();
+		result.parse(ptr, element);
+		async::execution::set_value(r_, std::move(result));
+	}
+
+	int *pointer_;
+	unsigned int count_;
+	Receiver r_;
+};
+
+struct [[nodiscard]] FutexWakeSender {
+	using value_type = FutexWakeResult;
+
+	FutexWakeSender(int *pointer, unsigned int count)
+	: pointer_{pointer}, count_{count} { }
+
+	template<typename Receiver>
+	FutexWakeOperation<Receiver> connect(Receiver receiver) {
+		return {pointer_, count_, std::move(receiver)};
+	}
+
+private:
+	int *pointer_;
+	unsigned int count_;
+};
+
+inline async::sender_awaiter<FutexWakeSender, FutexWakeResult>
+operator co_await (FutexWakeSender sender) {
+	return {std::move(sender)};
+}
+
+inline auto futexWake(int *pointer, unsigned int count = UINT_MAX) {
+	return FutexWakeSender{pointer, count};
+}
+
 } // namespace helix_ng
@@ -11,9 +11,9 @@ namespace helix {
 
 template<typename F>
 struct TimeoutCallback {
-	TimeoutCallback(uint64_t duration, F function)
+	TimeoutCallback(uint64_t duration, F function, uint64_t slack = kHelTimerSlackDefault)
 	: _function{std::move(function)} {
-		_runTimer(duration);
+		_runTimer(duration, slack);
 	}
 
 	TimeoutCallback(const TimeoutCallback &other) = delete;
@@ -26,13 +26,13 @@ struct TimeoutCallback {
 	}
 
 private:
-	async::detached _runTimer(uint64_t duration) {
+	async::detached _runTimer(uint64_t duration, uint64_t slack) {
 		uint64_t tick;
 		HEL_CHECK(helGetClock(&tick));
 
 		helix::AwaitClock await;
 		auto &&submit = helix::submitAwaitClock(&await, tick + duration,
-				helix::Dispatcher::global());
+				helix::Dispatcher::global(), slack);
 		auto async_id = await.asyncId();
 
 		{
@@ -56,8 +56,9 @@ private:
 };
 
 struct TimeoutCancellation {
-	TimeoutCancellation(uint64_t duration, async::cancellation_event &ev)
-	:_tb{duration, Functor{&ev}} {
+	TimeoutCancellation(uint64_t duration, async::cancellation_event &ev,
+			uint64_t slack = kHelTimerSlackDefault)
+	:_tb{duration, Functor{&ev}, slack} {
 	}
 
 	auto retire() {
@@ -76,13 +77,15 @@ private:
 	TimeoutCallback<Functor> _tb;
 };
 
-inline async::result<bool> sleepFor(uint64_t duration, async::cancellation_token cancel = {}) {
+// If slack is kHelTimerSlackDefault, the timer slack of the calling thread is used.
+inline async::result<bool> sleepFor(uint64_t duration, async::cancellation_token cancel = {},
+		uint64_t slack = kHelTimerSlackDefault) {
 	uint64_t tick;
 	HEL_CHECK(helGetClock(&tick));
 
 	helix::AwaitClock await;
 	auto &&submit = helix::submitAwaitClock(&await, tick + duration,
-			helix::Dispatcher::global());
+			helix::Dispatcher::global(), slack);
 	auto async_id = await.asyncId();
 
 	{
@@ -98,10 +101,11 @@ inline async::result<bool> sleepFor(uint64_t duration, async::cancellation_token
 	co_return true;
 }
 
-inline async::result<bool> sleepUntil(uint64_t tick, async::cancellation_token cancelToken) {
+inline async::result<bool> sleepUntil(uint64_t tick, async::cancellation_token cancelToken,
+		uint64_t slack = kHelTimerSlackDefault) {
 	helix::AwaitClock await;
 	auto &&submit = helix::submitAwaitClock(&await, tick,
-			helix::Dispatcher::global());
+			helix::Dispatcher::global(), slack);
 	auto asyncId = await.asyncId();
 	{
 		async::cancellation_callback cb{cancelToken, [&] {
@@ -41,6 +41,7 @@ enum {
 	kMsrLocalApicBase = 0x0000001B,
 	kMsrPAT = 0x00000277,
 	kMsrIa32TscDeadline = 0x000006E0,
+	kMsrXss = 0x00000DA0,
 	kMsrEfer = 0xC0000080,
 	kMsrStar = 0xC0000081,
 	kMsrLstar = 0xC0000082,
@@ -76,6 +77,34 @@ inline void xrstor(uint8_t *area, uint64_t rfbm) {
 	asm volatile("xrstor %0" : : "m"(*area), "a"(low), "d"(high) : "memory");
 }
 
+// Like xsave() but skips components that are in their initial configuration
+// or that were not modified since the last xrstor() from the same area.
+inline void xsaveopt(uint8_t *area, uint64_t rfbm) {
+	assert(!((uintptr_t)area & 0x3F));
+
+	uintptr_t low = rfbm & 0xFFFFFFFF;
+	uintptr_t high = (rfbm >> 32) & 0xFFFFFFFF;
+	asm volatile("xsaveopt %0" : : "m"(*area), "a"(low), "d"(high) : "memory");
+}
+
+// Like xsaveopt() but uses the compacted format.
+inline void xsaves(uint8_t *area, uint64_t rfbm) {
+	assert(!((uintptr_t)area & 0x3F));
+
+	uintptr_t low = rfbm & 0xFFFFFFFF;
+	uintptr_t high = (rfbm >> 32) & 0xFFFFFFFF;
+	asm volatile("xsaves %0" : : "m"(*area), "a"(low), "d"(high) : "memory");
+}
+
+// Counterpart of xsaves(). The area must have a valid compacted XSAVE header.
+inline void xrstors(uint8_t *area, uint64_t rfbm) {
+	assert(!((uintptr_t)area & 0x3F));
+
+	uintptr_t low = rfbm & 0xFFFFFFFF;
+	uintptr_t high = (rfbm >> 32) & 0xFFFFFFFF;
+	asm volatile("xrstors %0" : : "m"(*area), "a"(low), "d"(high) : "memory");
+}
+
 inline void wrmsr(uint32_t index, uint64_t value) {
 	uint32_t low = value;
 	uint32_t high = value >> 32;
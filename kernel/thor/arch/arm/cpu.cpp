@@ -6,6 +6,7 @@
 #include <thor-internal/main.hpp>
 #include <thor-internal/kasan.hpp>
 #include <thor-internal/fiber.hpp>
+#include <thor-internal/topology.hpp>
 
 namespace thor {
 
@@ -198,9 +199,11 @@ void setupCpuContext(AssemblyCpuData *context) {
 void prepareCpuDataFor(CpuData *context, int cpu) {
 	cpuData.initialize(context);
 	heapSlabPool.initialize(context);
+	heapMagazines.initialize(context);
 
 	context->selfPointer = context;
 	context->cpuIndex = cpu;
+	setFlatCpuTopology(context);
 }
 
 void setupBootCpuContext() {
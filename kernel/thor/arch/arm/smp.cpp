@@ -19,6 +19,7 @@
 #include <thor-internal/fiber.hpp>
 #include <thor-internal/load-balancing.hpp>
 #include <thor-internal/rcu.hpp>
+#include <thor-internal/topology.hpp>
 #include <uacpi/acpi.h>
 #include <uacpi/tables.h>
 
@@ -545,16 +546,20 @@ static initgraph::Task initAPs{&globalInitEngine, "arm.init-aps",
 		size_t apCpuIndex = 1;
 		auto bootApFromDt = [&](DeviceTreeNode *node) {
 			auto affinity = node->reg()[0].addr;
-			if (affinity == bspAffinity)
+			if (affinity == bspAffinity) {
+				parseCpuTopologyFromDt(node, getCpuData(0));
 				return;
+			}
 
 			if (static_cast<uint64_t>(apCpuIndex) >= cpuConfigNote->totalCpus) {
 				panicLogger() << "thor: CPU index " << apCpuIndex
 						<< " exceeds expected number of CPUs " << cpuConfigNote->totalCpus
 						<< frg::endlog;
 			}
-			if (apCpuIndex < cpuConfigNote->effectiveCpus)
+			if (apCpuIndex < cpuConfigNote->effectiveCpus) {
+				parseCpuTopologyFromDt(node, getCpuData(apCpuIndex));
 				bootSecondaryFromDt(node, apCpuIndex);
+			}
 			++apCpuIndex;
 		};
 		if (auto it = root->children().find("cpus"); it != root->children().end()) {
@@ -569,6 +574,7 @@ static initgraph::Task initAPs{&globalInitEngine, "arm.init-aps",
 	    if (apCpuIndex != cpuConfigNote->totalCpus)
 		    panicLogger() << "thor: Found " << apCpuIndex << " CPUs but Eir detected "
 		                  << cpuConfigNote->totalCpus << frg::endlog;
+	    dumpCpuTopology();
 	}
 };
 }
@@ -12,6 +12,7 @@
 #include <thor-internal/ipl.hpp>
 #include <thor-internal/kasan.hpp>
 #include <thor-internal/main.hpp>
+#include <thor-internal/topology.hpp>
 
 namespace thor {
 
@@ -226,9 +227,11 @@ void initializeThisProcessor() {
 void prepareCpuDataFor(CpuData *context, int cpu) {
 	cpuData.initialize(context);
 	heapSlabPool.initialize(context);
+	heapMagazines.initialize(context);
 
 	context->selfPointer = context;
 	context->cpuIndex = cpu;
+	setFlatCpuTopology(context);
 }
 
 void setupBootCpuContext() {
@@ -10,6 +10,7 @@
 #include <thor-internal/main.hpp>
 #include <thor-internal/physical.hpp>
 #include <thor-internal/rcu.hpp>
+#include <thor-internal/topology.hpp>
 #include <uacpi/acpi.h>
 #include <uacpi/tables.h>
 
@@ -203,8 +204,10 @@ initgraph::Task initAPs{
 		    if (reg.size() != 1)
 			    panicLogger() << "thor: Expect exactly one 'reg' entry for RISC-V CPUs"
 			                  << frg::endlog;
-		    if (reg.front().addr == bspHartId)
+		    if (reg.front().addr == bspHartId) {
+			    parseCpuTopologyFromDt(node, getCpuData(0));
 			    return;
+		    }
 
 		    if (static_cast<uint64_t>(apCpuIndex) >= cpuConfigNote->totalCpus) {
 			    panicLogger() << "thor: CPU index " << apCpuIndex
@@ -212,8 +215,10 @@ initgraph::Task initAPs{
 			                  << frg::endlog;
 		    }
 
-		    if (apCpuIndex < cpuConfigNote->effectiveCpus)
+		    if (apCpuIndex < cpuConfigNote->effectiveCpus) {
+			    parseCpuTopologyFromDt(node, getCpuData(apCpuIndex));
 			    bootAp(reg.front().addr, apCpuIndex);
+		    }
 		    ++apCpuIndex;
 	    };
 
@@ -227,6 +232,7 @@ initgraph::Task initAPs{
 	    if (apCpuIndex != cpuConfigNote->totalCpus)
 		    panicLogger() << "thor: Found " << apCpuIndex << " CPUs but Eir detected "
 		                  << cpuConfigNote->totalCpus << frg::endlog;
+	    dumpCpuTopology();
     }
 };
 
@@ -8,6 +8,7 @@
 #include <thor-internal/main.hpp>
 #include <thor-internal/physical.hpp>
 #include <thor-internal/rcu.hpp>
+#include <thor-internal/topology.hpp>
 #include <thor-internal/cpu-data.hpp>
 #include <thor-internal/ipl.hpp>
 #include <thor-internal/arch/pic.hpp>
@@ -54,6 +55,30 @@ static constexpr uint16_t fcwInitializer =
 static constexpr uint32_t mxcsrInitializer = 0b1111110000000;
 
 
+namespace {
+
+// Offset of the XSAVE header within the SIMD save area.
+constexpr size_t xsaveHeaderOffset = 512;
+// Offset of the first extended component (i.e., after the legacy area and the XSAVE header).
+constexpr size_t xsaveExtendedOffset = 576;
+
+constexpr uint64_t xcompBvCompacted = uint64_t(1) << 63;
+
+// Layout of the extended XSAVE components that we enable in XCR0.
+struct XsaveComponent {
+	size_t size;
+	size_t standardOffset;
+	size_t compactedOffset;
+};
+
+constinit XsaveComponent xsaveComponents[64]{};
+
+uint64_t *xsaveHeader(void *area) {
+	return reinterpret_cast<uint64_t *>(reinterpret_cast<char *>(area) + xsaveHeaderOffset);
+}
+
+} // anonymous namespace
+
 size_t Executor::determineSimdSize() {
 	assert(cpuFeaturesKnown);
 	if(getGlobalCpuFeatures()->haveXsave){
@@ -63,17 +88,29 @@ size_t Executor::determineSimdSize() {
 	}
 }
 
-size_t Executor::determineSize() {
+size_t Executor::determineSize(bool withSimd) {
+	if(!withSimd)
+		return sizeof(General);
+
+	// Executors use the compacted format if it is available, as it is smaller.
+	size_t simdSize;
+	if(getGlobalCpuFeatures()->haveXsaves){
+		simdSize = getGlobalCpuFeatures()->xsaveCompactedSize;
+	}else{
+		simdSize = determineSimdSize();
+	}
+
 	// fxState is offset from General by 0x10 bytes to make it 64byte aligned for xsave
-	return sizeof(General) + 0x10 + determineSimdSize();
+	return sizeof(General) + 0x10 + simdSize;
 }
 
 Executor::Executor()
-: _pointer{nullptr}, _syscallStack{nullptr}, _tss{nullptr} { }
+: _pointer{nullptr}, _syscallStack{nullptr}, _tss{nullptr}, _hasSimdState{false} { }
 
-Executor::Executor(UserContext *context) {
-	_pointer = (char *)kernelAlloc->allocate(determineSize());
-	memset(_pointer, 0, determineSize());
+Executor::Executor(UserContext *context)
+: _hasSimdState{true} {
+	_pointer = (char *)kernelAlloc->allocate(determineSize(true));
+	memset(_pointer, 0, determineSize(true));
 
 	// Assert assumptions about xsave.
 	assert(!((uintptr_t)_pointer & 0x3F));
@@ -82,6 +119,11 @@ Executor::Executor(UserContext *context) {
 	_fxState()->mxcsr |= mxcsrInitializer;
 	_fxState()->fcw |= fcwInitializer;
 
+	// xrstors requires the area to be in the compacted format.
+	// All components are in their initial configuration (XSTATE_BV = 0).
+	if(getGlobalCpuFeatures()->haveXsaves)
+		xsaveHeader(_fxState())[1] = xcompBvCompacted | getGlobalCpuFeatures()->xcr0Mask;
+
 	_tss = &context->tss;
 	_syscallStack = context->kernelStack.basePtr();
 }
@@ -105,16 +147,9 @@ Executor::Executor(UserContext *context, AbiParameters abi)
 }
 
 Executor::Executor(FiberContext *context, AbiParameters abi)
-: _syscallStack{nullptr}, _tss{nullptr} {
-	_pointer = (char *)kernelAlloc->allocate(determineSize());
-	memset(_pointer, 0, determineSize());
-
-	// Assert assumptions about xsave
-	assert(!((uintptr_t)_pointer & 0x3F));
-	assert(!((uintptr_t)this->_fxState() & 0x3F));
-
-	_fxState()->mxcsr |= mxcsrInitializer;
-	_fxState()->fcw |= fcwInitializer;
+: _syscallStack{nullptr}, _tss{nullptr}, _hasSimdState{false} {
+	_pointer = (char *)kernelAlloc->allocate(determineSize(false));
+	memset(_pointer, 0, determineSize(false));
 
 	general()->rip = abi.ip;
 	general()->rflags = 0x202;
@@ -128,6 +163,56 @@ Executor::~Executor() {
 	kernelAlloc->free(_pointer);
 }
 
+void Executor::readSimdState(void *buffer) {
+	assert(_hasSimdState);
+	auto features = getGlobalCpuFeatures();
+	if(!features->haveXsaves) {
+		memcpy(buffer, _fxState(), determineSimdSize());
+		return;
+	}
+
+	auto area = reinterpret_cast<char *>(_fxState());
+	auto out = reinterpret_cast<char *>(buffer);
+	memset(out, 0, determineSimdSize());
+	memcpy(out, area, xsaveHeaderOffset);
+
+	// Components that are not present in XSTATE_BV are in their initial configuration;
+	// for all components that we enable, this configuration is all zeros.
+	auto xstateBv = xsaveHeader(area)[0];
+	xsaveHeader(out)[0] = xstateBv;
+	for(int i = 2; i < 64; ++i) {
+		if(!(xstateBv & features->xcr0Mask & (uint64_t(1) << i)))
+			continue;
+		auto &component = xsaveComponents[i];
+		memcpy(out + component.standardOffset, area + component.compactedOffset, component.size);
+	}
+}
+
+void Executor::writeSimdState(const void *buffer) {
+	assert(_hasSimdState);
+	auto features = getGlobalCpuFeatures();
+	if(!features->haveXsaves) {
+		memcpy(_fxState(), buffer, determineSimdSize());
+		return;
+	}
+
+	auto area = reinterpret_cast<char *>(_fxState());
+	auto in = reinterpret_cast<const char *>(buffer);
+	memcpy(area, in, xsaveHeaderOffset);
+
+	uint64_t xstateBv;
+	memcpy(&xstateBv, in + xsaveHeaderOffset, sizeof(uint64_t));
+	memset(area + xsaveHeaderOffset, 0, xsaveExtendedOffset - xsaveHeaderOffset);
+	xsaveHeader(area)[0] = xstateBv & features->xcr0Mask;
+	xsaveHeader(area)[1] = xcompBvCompacted | features->xcr0Mask;
+	for(int i = 2; i < 64; ++i) {
+		if(!(features->xcr0Mask & (uint64_t(1) << i)))
+			continue;
+		auto &component = xsaveComponents[i];
+		memcpy(area + component.compactedOffset, in + component.standardOffset, component.size);
+	}
+}
+
 void saveExecutor(Executor *executor, FaultImageAccessor accessor) {
 	executor->general()->rax = accessor._frame()->rax;
 	executor->general()->rbx = accessor._frame()->rbx;
@@ -155,11 +240,7 @@ void saveExecutor(Executor *executor, FaultImageAccessor accessor) {
 	executor->general()->clientGs = common::x86::rdmsr(common::x86::kMsrIndexKernelGsBase);
 	executor->general()->iplState = accessor._frame()->iplState;
 
-	if(getGlobalCpuFeatures()->haveXsave){
-		common::x86::xsave((uint8_t*)executor->_fxState(), ~0);
-	} else {
-		asm volatile ("fxsaveq %0" : : "m" (*executor->_fxState()));
-	}
+	saveCurrentSimdState(executor);
 }
 
 void saveExecutor(Executor *executor, IrqImageAccessor accessor) {
@@ -189,11 +270,7 @@ void saveExecutor(Executor *executor, IrqImageAccessor accessor) {
 	executor->general()->clientGs = common::x86::rdmsr(common::x86::kMsrIndexKernelGsBase);
 	executor->general()->iplState = accessor._frame()->iplState;
 
-	if(getGlobalCpuFeatures()->haveXsave){
-		common::x86::xsave((uint8_t*)executor->_fxState(), ~0);
-	}else{
-		asm volatile ("fxsaveq %0" : : "m" (*executor->_fxState()));
-	}
+	saveCurrentSimdState(executor);
 }
 
 void saveExecutor(Executor *executor, SyscallImageAccessor accessor) {
@@ -223,11 +300,7 @@ void saveExecutor(Executor *executor, SyscallImageAccessor accessor) {
 	executor->general()->clientGs = common::x86::rdmsr(common::x86::kMsrIndexKernelGsBase);
 	executor->general()->iplState = accessor._frame()->iplState;
 
-	if(getGlobalCpuFeatures()->haveXsave){
-		common::x86::xsave((uint8_t*)executor->_fxState(), ~0);
-	}else{
-		asm volatile ("fxsaveq %0" : : "m" (*executor->_fxState()));
-	}
+	saveCurrentSimdState(executor);
 }
 
 extern "C" void forkExecutorRegisters(Executor *executor, void (*functor)(void *), void *context);
@@ -259,10 +332,17 @@ extern "C" bool thorFredEnabled;
 	common::x86::wrmsr(common::x86::kMsrIndexFsBase, executor->general()->clientFs);
 	common::x86::wrmsr(common::x86::kMsrIndexKernelGsBase, executor->general()->clientGs);
 
-	if(getGlobalCpuFeatures()->haveXsave){
-		common::x86::xrstor((uint8_t*)executor->_fxState(), ~0);
-	}else{
-		asm volatile ("fxrstorq %0" : : "m" (*executor->_fxState()));
+	// Kernel fibers do not touch SIMD registers; thus, the registers still contain the state
+	// of the last thread. Skipping the restore also keeps XSAVEOPT's modified optimization
+	// intact for that thread.
+	if(executor->hasSimdState()) {
+		if(getGlobalCpuFeatures()->haveXsaves){
+			common::x86::xrstors((uint8_t*)executor->_fxState(), ~0);
+		}else if(getGlobalCpuFeatures()->haveXsave){
+			common::x86::xrstor((uint8_t*)executor->_fxState(), ~0);
+		}else{
+			asm volatile ("fxrstorq %0" : : "m" (*executor->_fxState()));
+		}
 	}
 
 	iplLeaveContext(executor->general()->iplState);
@@ -375,23 +455,36 @@ initgraph::Stage *getCpuFeaturesKnownStage() {
 
 namespace {
 
-// Determine the XSAVE region size from the enabled components:
+// Determine the layout of the XSAVE region from the enabled components:
 // while cpuid can report the size of *all* components, that may be much larger than what we actually enable.
-size_t xsaveRegionSizeFor(uint64_t xcr0Mask) {
+// Fills in xsaveComponents and the region sizes in globalCpuFeatures.
+void determineXsaveLayout(uint64_t xcr0Mask) {
 	// Legacy FXSAVE area plus the XSAVE header. Components 0 (x87) and 1 (SSE) live in there.
-	size_t size = 576;
+	size_t standardSize = xsaveExtendedOffset;
+	size_t compactedSize = xsaveExtendedOffset;
 
 	for(int i = 2; i < 64; ++i) {
 		if(!(xcr0Mask & (uint64_t(1) << i)))
 			continue;
-		// EBX is the offset of the component, EAX its size. Take the maximum over all components.
+		// EBX is the offset of the component, EAX its size.
+		// ECX bit 1 is set if the component is 64-byte aligned in the compacted format.
 		auto leaf = common::x86::cpuid(0xD, i);
-		auto end = size_t{leaf[1]} + size_t{leaf[0]};
-		if(end > size)
-			size = end;
+		auto &component = xsaveComponents[i];
+		component.size = leaf[0];
+		component.standardOffset = leaf[1];
+		if(leaf[2] & 2)
+			compactedSize = (compactedSize + 63) & ~size_t{63};
+		component.compactedOffset = compactedSize;
+
+		// Take the maximum over all components.
+		auto end = component.standardOffset + component.size;
+		if(end > standardSize)
+			standardSize = end;
+		compactedSize += component.size;
 	}
 
-	return size;
+	globalCpuFeatures.xsaveRegionSize = standardSize;
+	globalCpuFeatures.xsaveCompactedSize = compactedSize;
 }
 
 } // namespace
@@ -440,9 +533,20 @@ static initgraph::Task enumerateCpuFeaturesTask{&globalInitEngine, "x86.enumerat
 						| (uint64_t(1) << 7); // ZMM{16 -> 31}.
 
 			globalCpuFeatures.xcr0Mask = xcr0Mask;
-			globalCpuFeatures.xsaveRegionSize = xsaveRegionSizeFor(xcr0Mask);
+			determineXsaveLayout(xcr0Mask);
 			debugLogger() << "thor: XSAVE region size is "
 					<< globalCpuFeatures.xsaveRegionSize << " bytes" << frg::endlog;
+
+			auto xsaveLeaf = common::x86::cpuid(0xD, 1);
+			if(xsaveLeaf[0] & 1) {
+				debugLogger() << "thor: CPUs support XSAVEOPT" << frg::endlog;
+				globalCpuFeatures.haveXsaveopt = true;
+			}
+			if(xsaveLeaf[0] & (1 << 3)) {
+				debugLogger() << "thor: CPUs support XSAVES, compacted XSAVE region size is "
+						<< globalCpuFeatures.xsaveCompactedSize << " bytes" << frg::endlog;
+				globalCpuFeatures.haveXsaves = true;
+			}
 		}
 
 		if(common::x86::cpuid(0x80000007)[3] & (1 << 8)) {
@@ -564,9 +668,11 @@ void setupCpuContext(AssemblyCpuData *context) {
 void prepareCpuDataFor(CpuData *context, int cpu) {
 	cpuData.initialize(context);
 	heapSlabPool.initialize(context);
+	heapMagazines.initialize(context);
 
 	context->selfPointer = context;
 	context->cpuIndex = cpu;
+	setFlatCpuTopology(context);
 }
 
 void setupBootCpuContext() {
@@ -595,9 +701,101 @@ static initgraph::Task initBootProcessorTask{&globalInitEngine, "x86.init-boot-p
 	}
 };
 
+namespace {
+
+unsigned int ceilLog2(uint32_t n) {
+	unsigned int shift = 0;
+	while((uint32_t{1} << shift) < n)
+		shift++;
+	return shift;
+}
+
+// Returns the APIC ID shift that corresponds to the CPUs sharing the last level cache.
+frg::optional<unsigned int> determineLlcShift() {
+	// Intel enumerates caches in leaf 4, AMD enumerates them in leaf 0x8000001D (if TOPOEXT).
+	uint32_t cacheLeaf;
+	if(common::x86::cpuid(0)[0] >= 4 && common::x86::cpuid(4, 0)[0] & 0x1F) {
+		cacheLeaf = 4;
+	}else if(common::x86::cpuid(0x8000'0000)[0] >= 0x8000'001D
+			&& (common::x86::cpuid(0x8000'0001)[2] & (uint32_t{1} << 22))) {
+		cacheLeaf = 0x8000'001D;
+	}else{
+		return frg::null_opt;
+	}
+
+	unsigned int maxLevel = 0;
+	uint32_t sharing = 1;
+	for(uint32_t i = 0; ; i++) {
+		auto leaf = common::x86::cpuid(cacheLeaf, i);
+		auto type = leaf[0] & 0x1F;
+		if(!type)
+			break;
+		auto level = (leaf[0] >> 5) & 7;
+		if(level >= maxLevel) {
+			maxLevel = level;
+			sharing = ((leaf[0] >> 14) & 0xFFF) + 1;
+		}
+	}
+	if(!maxLevel)
+		return frg::null_opt;
+	return ceilLog2(sharing);
+}
+
+// Derives the topology from the APIC ID (as described in the Intel SDM, "Programming Considerations
+// for Hierarchical Topology", and AMD's APM vol. 3, "CPUID Fn0000_000B").
+void detectCpuTopology(CpuData *cpuData) {
+	uint32_t apicId = cpuData->localApicId;
+	unsigned int smtShift = 0;
+	unsigned int coreShift = 0;
+
+	if(common::x86::cpuid(0)[0] >= 0xB && (common::x86::cpuid(0xB, 0)[1] & 0xFFFF)) {
+		for(uint32_t i = 0; ; i++) {
+			auto leaf = common::x86::cpuid(0xB, i);
+			auto type = (leaf[2] >> 8) & 0xFF;
+			if(!type)
+				break;
+			if(type == 1) {
+				smtShift = leaf[0] & 0x1F;
+			}else if(type == 2) {
+				coreShift = leaf[0] & 0x1F;
+			}
+		}
+		if(coreShift < smtShift)
+			coreShift = smtShift;
+	}else if(common::x86::cpuid(1)[3] & (uint32_t{1} << 28)) {
+		// Legacy enumeration: leaf 1 reports the number of logical processors per package.
+		uint32_t logicalPerPackage = (common::x86::cpuid(1)[1] >> 16) & 0xFF;
+		uint32_t coresPerPackage = 1;
+		if(common::x86::cpuid(0)[0] >= 4)
+			coresPerPackage = ((common::x86::cpuid(4, 0)[0] >> 26) & 0x3F) + 1;
+		coreShift = ceilLog2(logicalPerPackage);
+		smtShift = ceilLog2(frg::max(logicalPerPackage / coresPerPackage, uint32_t{1}));
+	}else{
+		// Single core without SMT: keep the flat topology.
+		updateCpuNumaNode(cpuData, apicId);
+		return;
+	}
+
+	// Without cache information, assume that the LLC is shared by the package.
+	unsigned int llcShift = coreShift;
+	if(auto shift = determineLlcShift(); shift)
+		llcShift = *shift;
+
+	auto &topology = cpuData->topology;
+	topology.threadId = apicId & ((uint32_t{1} << smtShift) - 1);
+	topology.coreId = (apicId >> smtShift) & ((uint32_t{1} << (coreShift - smtShift)) - 1);
+	topology.packageId = apicId >> coreShift;
+	topology.llcId = apicId >> llcShift;
+	updateCpuNumaNode(cpuData, apicId);
+}
+
+} // anonymous namespace
+
 void initializeThisProcessor() {
 	auto cpuData = getCpuData();
 
+	detectCpuTopology(cpuData);
+
 	// Allocate per-CPU areas.
 	cpuData->dfStack = UniqueKernelStack::make();
 	cpuData->nmiStack = UniqueKernelStack::make();
@@ -713,6 +911,12 @@ void initializeThisProcessor() {
 		// Validate that the pre-computed XSAVE size matches the CPU-reported XSAVE size.
 		// This must happen *after* the xcr0 write.
 		assert(common::x86::cpuid(0xD)[1] == getGlobalCpuFeatures()->xsaveRegionSize);
+
+		// We do not enable any supervisor state components.
+		if(getGlobalCpuFeatures()->haveXsaves) {
+			common::x86::wrmsr(common::x86::kMsrXss, 0);
+			assert(common::x86::cpuid(0xD, 1)[1] == getGlobalCpuFeatures()->xsaveCompactedSize);
+		}
 	}
 
 	// Enable the SMAP extension.
@@ -4,8 +4,10 @@
 #include <thor-internal/ipl.hpp>
 #include <thor-internal/profile.hpp>
 #include <thor-internal/thread.hpp>
+#include <thor-internal/timer.hpp>
 #include <thor-internal/traps.hpp>
 #include <thor-internal/arch-generic/cpu.hpp>
+#include <thor-internal/arch/paging.hpp>
 #include <thor-internal/arch/pmc-amd.hpp>
 #include <thor-internal/arch/pmc-intel.hpp>
 #include <thor-internal/arch/stack.hpp>
@@ -445,7 +447,18 @@ extern "C" void onPlatformIrq(IrqImageAccessor image, int number) {
 	assert(!irqMutex().nesting());
 	disableUserAccess();
 
-	handleIrq(image, globalIrqSlots[number].pin());
+	// MSIs use per-CPU slots, everything else uses global slots.
+	auto pin = localIrqSlots.get().slots[number].pin();
+	if(!pin)
+		pin = globalIrqSlots[number].pin();
+
+	if(pin) {
+		handleIrq(image, pin);
+	}else{
+		// This can happen if an MSI was re-routed while it was in flight.
+		infoLogger() << "thor: Spurious IRQ on slot " << number << frg::endlog;
+		acknowledgeIrq(0);
+	}
 
 	if (image.inUserMode()) {
 		auto thisThread = getCurrentThread();
@@ -494,6 +507,84 @@ extern "C" void onPlatformLegacyIrq(IrqImageAccessor image, int number) {
 	iplLeaveContext(*image.iplState());
 }
 
+namespace {
+	// Reads a word of the currently active user space by walking the page tables.
+	// In contrast to regular user accesses, this never faults and is thus safe in IRQ context.
+	// Page tables are only freed after the address space is unbound from all CPUs.
+	bool peekUserWord(uintptr_t address, uintptr_t &word) {
+		if(inHigherHalf(address) || (address & (sizeof(uintptr_t) - 1)))
+			return false;
+
+		uintptr_t cr3;
+		asm volatile ("mov %%cr3, %0" : "=r"(cr3));
+		PhysicalAddr physical = cr3 & pteAddress;
+		for(int level = 3; level >= 0; level--) {
+			PageAccessor accessor{physical};
+			auto index = (address >> (12 + 9 * level)) & 0x1FF;
+			auto pte = __atomic_load_n(reinterpret_cast<uint64_t *>(accessor.get()) + index,
+					__ATOMIC_RELAXED);
+			if(!(pte & ptePresent) || !(pte & pteUser))
+				return false;
+			// We do not map huge pages into user space.
+			if(level && (pte & 0x80))
+				return false;
+			physical = pte & pteAddress;
+		}
+
+		PageAccessor accessor{physical};
+		word = *reinterpret_cast<uintptr_t *>(
+				reinterpret_cast<char *>(accessor.get()) + (address & (kPageSize - 1)));
+		return true;
+	}
+
+	// Timer-based samples have the same format as PMC samples (see onPlatformNmi())
+	// but the header is followed by the low word of the thread's credentials.
+	void emitTimerProfileSample(IrqImageAccessor image) {
+		constexpr size_t maxDepth = 15;
+		uintptr_t buffer[maxDepth + 2];
+		size_t n = 0;
+		uint32_t flags = profileSampleThread;
+
+		uint64_t threadId = 0;
+		if(auto thisThread = getCurrentThread(); thisThread) {
+			auto credentials = thisThread->credentials();
+			memcpy(&threadId, credentials.data(), sizeof(uint64_t));
+		}
+		buffer[1] = threadId;
+
+		buffer[2 + n++] = *image.ip();
+		if(image.inUserMode()) {
+			flags |= profileSampleUser;
+			// Walk the user stack as long as it uses frame pointers and the frames are present.
+			// Frames must be at increasing addresses; this also guarantees termination.
+			uintptr_t bp = *image.bp();
+			while(n < maxDepth && bp) {
+				uintptr_t next, ip;
+				if(!peekUserWord(bp, next) || !peekUserWord(bp + sizeof(uintptr_t), ip))
+					break;
+				if(!ip)
+					break;
+				buffer[2 + n++] = ip;
+				if(next <= bp)
+					break;
+				bp = next;
+			}
+		}else{
+#ifdef THOR_HAS_FRAME_POINTERS
+			walkStack(reinterpret_cast<void *>(*image.bp()), [&] (uintptr_t ip) {
+				if(n < maxDepth)
+					buffer[2 + n++] = ip;
+			});
+#endif
+		}
+
+		if(!image.intsEnabled())
+			flags |= profileSampleNoInts;
+		buffer[0] = n | (static_cast<uint64_t>(flags) << 32);
+		getCpuData()->localProfileRing->enqueue(buffer, (2 + n) * sizeof(uintptr_t));
+	}
+} // namespace anonymous
+
 extern "C" void onPlatformPreemption(IrqImageAccessor image) {
 	iplSave(*image.iplState());
 	iplEnterContext(ipl::interrupt, *image.iplState());
@@ -515,6 +606,8 @@ extern "C" void onPlatformPreemption(IrqImageAccessor image) {
 	disableUserAccess();
 
 	handleTimerInterrupt();
+	if(takeProfileTick())
+		emitTimerProfileSample(image);
 
 	getCpuData()->heartbeat.fetch_add(1, std::memory_order_relaxed);
 
@@ -756,7 +849,7 @@ extern "C" void onPlatformNmi(NmiImageAccessor image, uint64_t expectedGs) {
 #endif
 		uint32_t flags{0};
 		if (!(*image.rflags() & 0x200))
-			flags |= 1;
+			flags |= profileSampleNoInts;
 		buffer[0] = n | (static_cast<uint64_t>(flags) << 32);
 		cpuData->localProfileRing->enqueue(buffer, (1 + n) * sizeof(uintptr_t));
 	};
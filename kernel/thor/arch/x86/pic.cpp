@@ -117,6 +117,13 @@ void IrqSlot::link(IrqPin *pin) {
 	_pin.store(pin, std::memory_order_release);
 }
 
+void IrqSlot::unlink() {
+	assert(_pin.load(std::memory_order_relaxed));
+	_pin.store(nullptr, std::memory_order_release);
+}
+
+THOR_DEFINE_PERCPU(localIrqSlots);
+
 // --------------------------------------------------------
 // Local APIC timer
 // --------------------------------------------------------
@@ -451,72 +458,217 @@ void sendGlobalNmi() {
 // --------------------------------------------------------
 
 namespace {
+	// Protects the allocation of IRQ slots and the routing of IRQs to CPUs.
 	IrqSpinlock irqAllocationLock;
-	static bool irqSlotAllocated[numIrqSlots]{};
+	// Bit mask of globally allocated slots.
+	uint64_t globalIrqSlotsAllocated = 0;
 
-	std::optional<int> allocateIrqSlot() {
+	// Allocates a slot that is free on all CPUs.
+	std::optional<int> allocateGlobalIrqSlot() {
 		auto guard = frg::guard(&irqAllocationLock);
 
+		auto inUse = globalIrqSlotsAllocated;
+		for(size_t cpu = 0; cpu < getCpuCount(); cpu++)
+			inUse |= localIrqSlots.getFor(cpu).allocated;
+
 		for(int i = 0; i < numIrqSlots; i++) {
-			if(irqSlotAllocated[i])
+			if(inUse & (uint64_t{1} << i))
+				continue;
+			globalIrqSlotsAllocated |= uint64_t{1} << i;
+			return i;
+		}
+
+		return std::nullopt;
+	}
+
+	// Allocates a slot on a single CPU. Must be called with irqAllocationLock held.
+	std::optional<int> allocateLocalIrqSlot(size_t cpu) {
+		auto &local = localIrqSlots.getFor(cpu);
+		auto inUse = globalIrqSlotsAllocated | local.allocated;
+
+		// Search from the top such that global slots (which are allocated from the bottom)
+		// are less likely to collide with per-CPU slots.
+		for(int i = numIrqSlots - 1; i >= 0; i--) {
+			if(inUse & (uint64_t{1} << i))
 				continue;
-			irqSlotAllocated[i] = true;
+			local.allocated |= uint64_t{1} << i;
 			return i;
 		}
 
 		return std::nullopt;
 	}
 
+	// Must be called with irqAllocationLock held.
+	void freeLocalIrqSlot(size_t cpu, int slot) {
+		auto &local = localIrqSlots.getFor(cpu);
+		assert(local.allocated & (uint64_t{1} << slot));
+		local.slots[slot].unlink();
+		local.allocated &= ~(uint64_t{1} << slot);
+	}
+
+	// IRQs can only target CPUs whose local APIC is initialized; before that,
+	// the CPU's localApicId is not valid yet.
+	// Without interrupt remapping, MSIs and I/O APIC pins can only target 8-bit APIC IDs.
+	bool isValidIrqTarget(size_t cpu) {
+		if(cpu >= getCpuCount())
+			return false;
+		auto cpuData = getCpuData(cpu);
+		if(!cpuData->cpuInitialized.load(std::memory_order_acquire))
+			return false;
+		return cpuData->localApicId <= 0xFF;
+	}
+
+	// Returns the CPU that serves the fewest IRQs. Must be called with irqAllocationLock held.
+	// IRQs that are allocated before the APs are booted end up on the BSP;
+	// they can be re-routed by setAffinity() later.
+	size_t pickIrqCpu() {
+		size_t best = 0;
+		for(size_t cpu = 1; cpu < getCpuCount(); cpu++) {
+			if(!isValidIrqTarget(cpu))
+				continue;
+			if(localIrqSlots.getFor(cpu).numRouted < localIrqSlots.getFor(best).numRouted)
+				best = cpu;
+		}
+		return best;
+	}
+
 	struct ApicMsiPin final : MsiPin {
-		ApicMsiPin(frg::string<KernelAlloc> name, unsigned int vector)
-		: MsiPin{std::move(name)}, vector_{vector} { }
+		ApicMsiPin(frg::string<KernelAlloc> name, MsiDevice *device, size_t index,
+				size_t cpu, int slot)
+		: MsiPin{std::move(name), device, index}, cpu_{cpu}, slot_{slot} { }
 
 		IrqStrategy program(TriggerMode mode, Polarity) override {
 			assert(mode == TriggerMode::edge);
+			if(_device && _device->canMaskMsi())
+				return irq_strategy::maskable | irq_strategy::endOfInterrupt;
 			return irq_strategy::endOfInterrupt;
 		}
 
 		void mask() override {
-			// TODO: This may be worth implementing (but it is not needed for correctness).
+			assert(_device);
+			_device->maskMsi(_index, true);
 		}
 
 		void unmask() override {
-			// TODO: This may be worth implementing (but it is not needed for correctness).
+			if(_device && _device->canMaskMsi())
+				_device->maskMsi(_index, false);
 		}
 
 		void endOfInterrupt() override {
 			acknowledgeIrq(0);
+
+			// The first IRQ on the new CPU completes a pending move.
+			// At this point, the device cannot target the old slot anymore.
+			if(moving_.load(std::memory_order_relaxed)) {
+				auto guard = frg::guard(&irqAllocationLock);
+				if(prevSlot_ >= 0 && static_cast<size_t>(getCpuData()->cpuIndex) == cpu_)
+					completeMove_();
+			}
+		}
+
+		Error setAffinity(size_t cpu) override {
+			if(!_device || !_device->canRetargetMsi())
+				return Error::noHardwareSupport;
+			if(!isValidIrqTarget(cpu))
+				return Error::illegalArgs;
+
+			// Serializes moves of this pin. programMsi() performs (slow) config space
+			// accesses, hence it runs without irqAllocationLock. Since cpu_ and slot_
+			// only change while programMutex_ is held, programMsi() reads consistent values.
+			auto programLock = frg::guard(&programMutex_);
+
+			{
+				auto guard = frg::guard(&irqAllocationLock);
+
+				if(cpu == cpu_)
+					return Error::success;
+
+				// Only one move can be in flight at a time.
+				if(prevSlot_ >= 0)
+					completeMove_();
+
+				auto newSlot = allocateLocalIrqSlot(cpu);
+				if(!newSlot)
+					return Error::noMemory;
+				localIrqSlots.getFor(cpu).slots[*newSlot].link(this);
+				localIrqSlots.getFor(cpu).numRouted++;
+				localIrqSlots.getFor(cpu_).numRouted--;
+
+				prevCpu_ = cpu_;
+				prevSlot_ = slot_;
+				cpu_ = cpu;
+				slot_ = *newSlot;
+				moving_.store(true, std::memory_order_relaxed);
+			}
+
+			_device->programMsi(this, _index);
+			return Error::success;
+		}
+
+		size_t getAffinity() override {
+			auto guard = frg::guard(&irqAllocationLock);
+			return cpu_;
 		}
 
 		uint64_t getMessageAddress() override {
-			return 0xFEE00000;
+			// Fixed delivery in physical destination mode.
+			return 0xFEE00000 | (static_cast<uint64_t>(getCpuData(cpu_)->localApicId) << 12);
 		}
 
 		uint32_t getMessageData() override {
-			return vector_;
+			return 64 + slot_;
 		}
 
 	private:
-		unsigned int vector_;
+		// Must be called with irqAllocationLock held.
+		void completeMove_() {
+			freeLocalIrqSlot(prevCpu_, prevSlot_);
+			prevSlot_ = -1;
+			moving_.store(false, std::memory_order_relaxed);
+		}
+
+		// Held while the MSI is re-routed (see setAffinity()).
+		frg::ticket_spinlock programMutex_;
+
+		// The following fields are protected by irqAllocationLock.
+		// cpu_ and slot_ are additionally protected by programMutex_.
+		size_t cpu_;
+		int slot_;
+		// Slot that the MSI was routed to before the last setAffinity().
+		// The slot remains linked until the first IRQ arrives on the new slot.
+		size_t prevCpu_ = 0;
+		int prevSlot_ = -1;
+
+		std::atomic<bool> moving_{false};
 	};
 }
 
-smarter::shared_ptr<MsiPin> allocateApicMsi(frg::string<KernelAlloc> name) {
-	auto maybeSlotIndex = allocateIrqSlot();
-	if (!maybeSlotIndex)
-		return nullptr;
-	auto slotIndex = *maybeSlotIndex;
+smarter::shared_ptr<MsiPin> allocateApicMsi(frg::string<KernelAlloc> name,
+		MsiDevice *device, size_t index) {
+	size_t cpu;
+	int slotIndex;
+	{
+		auto guard = frg::guard(&irqAllocationLock);
+
+		// MSIs that cannot be re-routed later stay on the boot CPU (like I/O APIC pins).
+		cpu = device ? pickIrqCpu() : 0;
+		auto maybeSlotIndex = allocateLocalIrqSlot(cpu);
+		if (!maybeSlotIndex)
+			return nullptr;
+		slotIndex = *maybeSlotIndex;
+		localIrqSlots.getFor(cpu).numRouted++;
+	}
 
 	// Create an IRQ pin for the MSI.
-	auto pin = createIrqPin<ApicMsiPin>(std::move(name), 64 + slotIndex);
+	auto pin = createIrqPin<ApicMsiPin>(std::move(name), device, index, cpu, slotIndex);
 	pin->configure(IrqConfiguration{
 		.trigger = TriggerMode::edge,
 		.polarity = Polarity::high
 	});
 
 	infoLogger() << "thor: Allocating IRQ slot " << slotIndex
-			<< " to " << pin->name() << frg::endlog;
-	globalIrqSlots[slotIndex].link(pin.get());
+			<< " on CPU " << cpu << " to " << pin->name() << frg::endlog;
+	localIrqSlots.getFor(cpu).slots[slotIndex].link(pin.get());
 
 	// Leak a reference until IrqPin teardown exists;
 	// otherwise the slot dangles once the last sink goes away.
@@ -564,11 +716,15 @@ namespace {
 			void mask() override;
 			void unmask() override;
 			void endOfInterrupt() override;
+			Error setAffinity(size_t cpu) override;
+			size_t getAffinity() override;
 
 		private:
 			IoApic *_chip;
 			unsigned int _index;
 			int _vector = -1;
+			// Protected by irqAllocationLock.
+			size_t _cpu = 0;
 
 			// The following variables store the current pin configuration.
 			bool _levelTriggered;
@@ -668,13 +824,17 @@ namespace {
 
 		// Allocate an IRQ vector for the I/O APIC pin.
 		if(_vector == -1) {
-			auto maybeSlotIndex = allocateIrqSlot();
+			auto maybeSlotIndex = allocateGlobalIrqSlot();
 			if (!maybeSlotIndex)
 				panicLogger() << "thor: Could not allocate interrupt vector for "
 						<< name() << frg::endlog;
 			auto slotIndex = *maybeSlotIndex;
 			globalIrqSlots[slotIndex].link(this);
+
+			auto guard = frg::guard(&irqAllocationLock);
+			auto lock = frg::guard(&_chip->_mutex);
 			_vector = 64 + slotIndex;
+			localIrqSlots.getFor(_cpu).numRouted++;
 		}
 
 		{
@@ -682,7 +842,7 @@ namespace {
 			auto lock = frg::guard(&_chip->_mutex);
 
 			_chip->_storeRegister(kIoApicInts + _index * 2 + 1,
-					static_cast<uint32_t>(pin_word2::destination(0)));
+					static_cast<uint32_t>(pin_word2::destination(getCpuData(_cpu)->localApicId)));
 			_chip->_storeRegister(kIoApicInts + _index * 2,
 					static_cast<uint32_t>(pin_word1::vector(_vector)
 					| pin_word1::deliveryMode(0) | pin_word1::levelTriggered(_levelTriggered)
@@ -726,6 +886,31 @@ namespace {
 		acknowledgeIrq(0);
 	}
 
+	Error IoApic::Pin::setAffinity(size_t cpu) {
+		if(!isValidIrqTarget(cpu))
+			return Error::illegalArgs;
+
+		// I/O APIC pins use global slots, hence we only need to update the destination.
+		auto guard = frg::guard(&irqAllocationLock);
+		auto lock = frg::guard(&_chip->_mutex);
+
+		// Pins without a vector are not accounted for yet.
+		if(_vector != -1) {
+			localIrqSlots.getFor(_cpu).numRouted--;
+			localIrqSlots.getFor(cpu).numRouted++;
+		}
+		_cpu = cpu;
+
+		_chip->_storeRegister(kIoApicInts + _index * 2 + 1,
+				static_cast<uint32_t>(pin_word2::destination(getCpuData(cpu)->localApicId)));
+		return Error::success;
+	}
+
+	size_t IoApic::Pin::getAffinity() {
+		auto guard = frg::guard(&irqAllocationLock);
+		return _cpu;
+	}
+
 	IoApic::IoApic(int apic_id, arch::mem_space space)
 	: _apicId(apic_id), _space{std::move(space)} {
 		_numPins = ((_loadRegister(kIoApicVersion) >> 16) & 0xFF) + 1;
@@ -152,6 +152,7 @@ struct IrqImageAccessor {
 	friend void saveExecutor(Executor *executor, IrqImageAccessor accessor);
 
 	Word *ip() { return &_frame()->rip; }
+	Word *bp() { return &_frame()->rbp; }
 
 	// TODO: These are only exposed for debugging.
 	Word *cs() { return &_frame()->cs; }
@@ -295,7 +296,8 @@ struct Executor {
 	friend void restoreExecutor(Executor *executor);
 	friend void doForkExecutor(Executor *executor, void (*functor)(void *), void *context);
 
-	static size_t determineSize();
+	static size_t determineSize(bool withSimd);
+	// Size of a SIMD save area in the standard (i.e., non-compacted) format.
 	static size_t determineSimdSize();
 
 	Executor();
@@ -426,6 +428,16 @@ public:
 		return _uar;
 	}
 
+	// Kernel fibers never touch SIMD registers; their executors do not have a SIMD save area.
+	bool hasSimdState() {
+		return _hasSimdState;
+	}
+
+	// Copy the SIMD state from/to a buffer of determineSimdSize() bytes in the standard
+	// XSAVE (or FXSAVE) format. The executor itself may use the compacted format.
+	void readSimdState(void *buffer);
+	void writeSimdState(const void *buffer);
+
 private:
 	// Private function only used for the static_assert check.
 	//
@@ -440,6 +452,7 @@ private:
 	void *_syscallStack;
 	common::x86::Tss64 *_tss;
 	UserAccessRegion *_uar;
+	bool _hasSimdState;
 };
 
 struct CpuFeatures {
@@ -448,6 +461,8 @@ struct CpuFeatures {
 
 	bool haveFred;
 	bool haveXsave;
+	bool haveXsaveopt;
+	bool haveXsaves;
 	bool haveAvx;
 	bool haveZmm;
 	bool haveInvariantTsc;
@@ -459,6 +474,8 @@ struct CpuFeatures {
 	uint64_t xcr0Mask;
 	// Size of the XSAVE region required for the components in xcr0Mask.
 	size_t xsaveRegionSize;
+	// Same as xsaveRegionSize but for the compacted format (only valid if haveXsaves).
+	size_t xsaveCompactedSize;
 };
 
 extern bool cpuFeaturesKnown;
@@ -482,10 +499,20 @@ void initializeThisProcessor();
 void bootSecondary(unsigned int apic_id, size_t cpuIndex);
 
 // Save the current SIMD register state into the given executor.
+// XSAVES and XSAVEOPT skip components that are in their initial configuration
+// or that were not modified since they were restored from the same executor.
 inline void saveCurrentSimdState(Executor *executor) {
-	if(getGlobalCpuFeatures()->haveXsave) {
+	if(!executor->hasSimdState())
+		return;
+
+	auto features = getGlobalCpuFeatures();
+	if(features->haveXsaves) {
+		common::x86::xsaves((uint8_t*)executor->_fxState(), ~0);
+	}else if(features->haveXsaveopt) {
+		common::x86::xsaveopt((uint8_t*)executor->_fxState(), ~0);
+	}else if(features->haveXsave) {
 		common::x86::xsave((uint8_t*)executor->_fxState(), ~0);
-	} else {
+	}else{
 		asm volatile ("fxsaveq %0" : : "m" (*executor->_fxState()));
 	}
 }
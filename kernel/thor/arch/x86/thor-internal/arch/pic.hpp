@@ -5,6 +5,7 @@
 #include <arch/mem_space.hpp>
 #include <x86/machine.hpp>
 #include <initgraph.hpp>
+#include <thor-internal/cpu-data.hpp>
 #include <thor-internal/irq.hpp>
 #include <thor-internal/timer.hpp>
 #include <thor-internal/types.hpp>
@@ -25,6 +26,9 @@ struct IrqSlot {
 	// From now on all IRQ raises will go to this IrqPin.
 	void link(IrqPin *pin);
 
+	// Unlinks the IrqPin from this slot.
+	void unlink();
+
 	IrqPin *pin() {
 		return _pin.load(std::memory_order_acquire);
 	}
@@ -35,6 +39,23 @@ private:
 
 extern IrqSlot globalIrqSlots[numIrqSlots];
 
+// Per-CPU IRQ slots. A slot index is either allocated globally
+// (i.e., on all CPUs, e.g., for I/O APIC pins) or on individual CPUs (for MSIs).
+struct LocalIrqSlots {
+	IrqSlot slots[numIrqSlots];
+
+	// The following fields are protected by the IRQ allocation lock.
+
+	// Bit mask of slots that are allocated on this CPU.
+	uint64_t allocated = 0;
+	// Number of IRQs that are routed to this CPU. Used to spread IRQs across CPUs.
+	size_t numRouted = 0;
+};
+
+static_assert(numIrqSlots <= 64);
+
+extern PerCpu<LocalIrqSlots> localIrqSlots;
+
 // --------------------------------------------------------
 // Local APIC management
 // --------------------------------------------------------
@@ -118,7 +139,10 @@ void sendGlobalNmi();
 // MSI management
 // --------------------------------------------------------
 
-smarter::shared_ptr<MsiPin> allocateApicMsi(frg::string<KernelAlloc> name);
+// Allocates a vector for an MSI on the CPU that currently serves the fewest IRQs.
+// If device is non-null, the MSI can be masked and re-routed to other CPUs.
+smarter::shared_ptr<MsiPin> allocateApicMsi(frg::string<KernelAlloc> name,
+		MsiDevice *device = nullptr, size_t index = 0);
 
 // --------------------------------------------------------
 // I/O APIC management
@@ -1272,6 +1272,73 @@ coroutine<size_t> VirtualSpace::writePartialSpace(uintptr_t address,
 	co_return progress;
 }
 
+coroutine<frg::expected<Error, size_t>>
+VirtualSpace::pinRange(uintptr_t address, frg::span<PhysicalAddr> physicals,
+		MemoryViewLockHandle &lockHandle) {
+	assert(currentIpl() == ipl::exceptionalWork);
+	assert(!(address & (kPageSize - 1)));
+	assert(physicals.size());
+
+	// We do not take _consistencyMutex here since we are only interested in a snapshot.
+	smarter::shared_ptr<Mapping> mapping;
+	{
+		auto irqLock = frg::guard(&irqMutex());
+		auto spaceGuard = frg::guard(&_snapshotMutex);
+
+		mapping = _findMapping(address);
+	}
+	if(!mapping)
+		co_return Error::fault;
+
+	// Pinned pages bypass the page tables, hence we need to check permissions here.
+	auto mappingFlags = mapping->flags.load(std::memory_order_relaxed);
+	if(!(mappingFlags & MappingFlags::protRead))
+		co_return Error::fault;
+
+	FetchFlags fetchFlags = 0;
+	if(mappingFlags & MappingFlags::dontRequireBacking)
+		fetchFlags |= fetchDisallowBacking;
+
+	// Since mappings are page-aligned, whole pages are contained in the mapping.
+	auto numPages = frg::min(physicals.size(),
+			(mapping->address + mapping->length - address) / kPageSize);
+	auto viewOffset = mapping->viewOffset + (address - mapping->address);
+	co_return co_await pinViewRange(mapping->view, viewOffset, fetchFlags,
+			frg::span<PhysicalAddr>{physicals.data(), numPages}, lockHandle);
+}
+
+coroutine<frg::expected<Error, size_t>>
+pinViewRange(smarter::shared_ptr<MemoryView> view, uintptr_t offset, FetchFlags fetchFlags,
+		frg::span<PhysicalAddr> physicals, MemoryViewLockHandle &lockHandle) {
+	assert(currentIpl() == ipl::exceptionalWork);
+	assert(!(offset & (kPageSize - 1)));
+	assert(physicals.size());
+
+	// Lock and fault in the whole range at once; this amortizes the locking
+	// over all pages of the range.
+	auto size = physicals.size() * kPageSize;
+	MemoryViewLockHandle handle{view, offset, size};
+	handle.acquire();
+	if(!handle)
+		co_return Error::fault;
+
+	FRG_CO_TRY(co_await view->touchRange(offset, size, fetchFlags));
+	size_t numPages = 0;
+	while(numPages < physicals.size()) {
+		auto range = view->peekRange(offset + numPages * kPageSize, fetchFlags);
+		assert(range.physical != PhysicalAddr(-1));
+		// Device memory cannot be accessed through the direct physical mapping.
+		if(range.cachingMode != CachingMode::null && range.cachingMode != CachingMode::writeBack)
+			break;
+		physicals[numPages++] = range.physical;
+	}
+	if(!numPages)
+		co_return Error::illegalObject;
+
+	lockHandle = std::move(handle);
+	co_return numPages;
+}
+
 // --------------------------------------------------------
 // AddressSpace
 // --------------------------------------------------------
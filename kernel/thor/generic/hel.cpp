@@ -395,7 +395,9 @@ HelError helGetCredentials(HelHandle handle, uint32_t flags, char *credentials)
 	return kHelErrNone;
 }
 
-HelError helCloseDescriptor(HelHandle universeHandle, HelHandle handle) {
+namespace {
+
+HelError closeDescriptor(HelHandle universeHandle, HelHandle handle) {
 	auto thisThread = getCurrentThread();
 	auto thisUniverse = thisThread->getUniverse();
 
@@ -418,6 +420,32 @@ HelError helCloseDescriptor(HelHandle universeHandle, HelHandle handle) {
 	return kHelErrNone;
 }
 
+} // anonymous namespace
+
+HelError helCloseDescriptor(HelHandle universeHandle, HelHandle handle) {
+	return closeDescriptor(universeHandle, handle);
+}
+
+HelError doSubmitCloseDescriptor(HelHandle universeHandle, smarter::shared_ptr<IpcQueue> queue,
+		HelHandle handle, uintptr_t context) {
+	if(!queue->validSize(ipcSourceSize(sizeof(HelSimpleResult))))
+		return kHelErrQueueTooSmall;
+
+	// Unlike the other submissions, we report a missing descriptor through the
+	// completion such that batched closes can be matched to their results.
+	auto error = closeDescriptor(universeHandle, handle);
+
+	[](smarter::shared_ptr<IpcQueue> queue, HelError error, uintptr_t context,
+			enable_detached_coroutine) -> void {
+		HelSimpleResult helResult{.error = error, .reserved = {}};
+		QueueSource ipcSource{&helResult, sizeof(HelSimpleResult), nullptr};
+		co_await queue->submit(&ipcSource, context);
+	}(std::move(queue), error, context,
+			enable_detached_coroutine{getCurrentThread()->mainWorkQueue().lock()});
+
+	return kHelErrNone;
+}
+
 HelError helCreateQueue(const HelQueueParameters *paramsPtr, HelHandle *handle) {
 	auto thisThread = getCurrentThread();
 	auto thisUniverse = thisThread->getUniverse();
@@ -464,12 +492,14 @@ HelError helDriveQueue(HelHandle handle, uint32_t flags, uint32_t notifyMask) {
 	// If requested, wait until userNotify & kNotifyProgress is non-zero.
 	if(flags & kHelDriveWait) {
 		if (!queue->checkUserNotify((int)notifyMask)) {
+			auto waitStart = getClockNanos();
 			auto outcome = Thread::asyncBlockCurrentInterruptible(
 				async::lambda([&](async::cancellation_token ct) {
 					return queue->waitUserEvent((int)notifyMask, ct);
 				}),
 				thisThread->mainWorkQueue().get()
 			);
+			thisThread->accountIpcWait(getClockNanos() - waitStart);
 			if (!outcome) {
 				return kHelErrCancelled;
 			}
@@ -1211,8 +1241,22 @@ HelError helGetRandomBytes(void *buffer, size_t wantedSize, size_t *actualSize)
 	return kHelErrNone;
 }
 
-HelError helMapMemory(HelHandle memory_handle, HelHandle space_handle,
-		void *pointer, uintptr_t offset, size_t length, uint32_t flags, void **actualPointer) {
+namespace {
+
+// Arguments of helMapMemory() and kHelSubmitMapMemory after resolving descriptors.
+struct MapArguments {
+	smarter::shared_ptr<MemorySlice> slice;
+	smarter::shared_ptr<AddressSpace, BindableHandle> space;
+	smarter::shared_ptr<VirtualSpace> vspace;
+	bool isVspace = false;
+	VirtualAddr pointer = 0;
+	uintptr_t offset = 0;
+	size_t length = 0;
+	uint32_t mapFlags = 0;
+};
+
+HelError resolveMapArguments(HelHandle memory_handle, HelHandle space_handle,
+		void *pointer, uintptr_t offset, size_t length, uint32_t flags, MapArguments &args) {
 	if(length == 0)
 		return kHelErrIllegalArgs;
 	if((uintptr_t)pointer % kPageSize != 0)
@@ -1246,11 +1290,6 @@ HelError helMapMemory(HelHandle memory_handle, HelHandle space_handle,
 	if(flags & kHelMapDontRequireBacking)
 		map_flags |= AddressSpace::kMapDontRequireBacking;
 
-	smarter::shared_ptr<MemorySlice> slice;
-	smarter::shared_ptr<AddressSpace, BindableHandle> space;
-	smarter::shared_ptr<VirtualSpace> vspace;
-	bool isVspace = false;
-
 	uint32_t requiredRights = kHelRightAssign;
 	if (flags & kHelMapProtRead)
 		requiredRights |= kHelRightRead;
@@ -1265,7 +1304,7 @@ HelError helMapMemory(HelHandle memory_handle, HelHandle space_handle,
 			auto sliceOutcome = desc.resolveObject<DescriptorType::memorySlice>(requiredRights);
 			if(!sliceOutcome)
 				return std::unexpected{sliceOutcome.error()};
-			slice = std::move(*sliceOutcome);
+			args.slice = std::move(*sliceOutcome);
 		}else if(desc.is<DescriptorType::memoryView>()) {
 			auto viewOutcome = desc.resolveObject<DescriptorType::memoryView>(requiredRights);
 			if(!viewOutcome)
@@ -1275,7 +1314,7 @@ HelError helMapMemory(HelHandle memory_handle, HelHandle space_handle,
 			auto sliceOutcome = MemorySlice::create(std::move(memory), 0, sliceLength);
 			if(!sliceOutcome)
 				return std::unexpected{sliceOutcome.error()};
-			slice = std::move(*sliceOutcome);
+			args.slice = std::move(*sliceOutcome);
 		}else if(desc.is<DescriptorType::queue>()) {
 			auto queueOutcome = desc.resolveObject<DescriptorType::queue>(requiredRights);
 			if(!queueOutcome)
@@ -1285,7 +1324,7 @@ HelError helMapMemory(HelHandle memory_handle, HelHandle space_handle,
 			auto sliceOutcome = MemorySlice::create(std::move(memory), 0, sliceLength);
 			if(!sliceOutcome)
 				return std::unexpected{sliceOutcome.error()};
-			slice = std::move(*sliceOutcome);
+			args.slice = std::move(*sliceOutcome);
 		}else{
 			return std::unexpected{Error::badDescriptor};
 		}
@@ -1295,7 +1334,7 @@ HelError helMapMemory(HelHandle memory_handle, HelHandle space_handle,
 		return translateError(memoryOutcome.error());
 
 	if(space_handle == kHelNullHandle) {
-		space = this_thread->getAddressSpace().lock();
+		args.space = this_thread->getAddressSpace().lock();
 	}else{
 		auto spaceOutcome = this_universe->inspectDescriptor(space_handle,
 				[&](AnyDescriptor &desc) -> std::expected<void, Error> {
@@ -1303,19 +1342,19 @@ HelError helMapMemory(HelHandle memory_handle, HelHandle space_handle,
 				auto addressSpaceOutcome = desc.resolveObject<DescriptorType::addressSpace>(kHelRightGrant);
 				if(!addressSpaceOutcome)
 					return std::unexpected{addressSpaceOutcome.error()};
-				space = std::move(*addressSpaceOutcome);
+				args.space = std::move(*addressSpaceOutcome);
 			} else if(desc.is<DescriptorType::virtualizedSpace>()) {
 				auto vspaceOutcome = desc.resolveObject<DescriptorType::virtualizedSpace>(kHelRightGrant);
 				if(!vspaceOutcome)
 					return std::unexpected{vspaceOutcome.error()};
-				isVspace = true;
-				vspace = std::move(*vspaceOutcome);
+				args.isVspace = true;
+				args.vspace = std::move(*vspaceOutcome);
 			} else if(desc.is<DescriptorType::dmaSpace>()) {
 				auto dmaOutcome = desc.resolveObject<DescriptorType::dmaSpace>(kHelRightGrant);
 				if(!dmaOutcome)
 					return std::unexpected{dmaOutcome.error()};
-				isVspace = true;
-				vspace = std::move(*dmaOutcome);
+				args.isVspace = true;
+				args.vspace = std::move(*dmaOutcome);
 			} else {
 				return std::unexpected{Error::badDescriptor};
 			}
@@ -1327,37 +1366,81 @@ HelError helMapMemory(HelHandle memory_handle, HelHandle space_handle,
 
 	// TODO: check proper alignment
 
-	frg::expected<Error, VirtualAddr> mapResult;
-	if(!isVspace) {
-		if(map_flags & AddressSpace::kMapFixed && !pointer)
-			return kHelErrIllegalArgs; // Non-vspaces aren't allowed to map at NULL
+	if(!args.isVspace && (map_flags & AddressSpace::kMapFixed) && !pointer)
+		return kHelErrIllegalArgs; // Non-vspaces aren't allowed to map at NULL
 
-		mapResult = Thread::asyncBlockCurrent(
-			space->map(slice, (VirtualAddr)pointer, offset, length, map_flags),
-			getCurrentThread()->pagingWorkQueue().get()
-		);
-	} else {
-		mapResult = Thread::asyncBlockCurrent(
-			vspace->map(slice, (VirtualAddr)pointer, offset, length, map_flags),
-			getCurrentThread()->pagingWorkQueue().get()
-		);
-	}
+	args.pointer = reinterpret_cast<VirtualAddr>(pointer);
+	args.offset = offset;
+	args.length = length;
+	args.mapFlags = map_flags;
+	return kHelErrNone;
+}
+
+coroutine<frg::expected<Error, VirtualAddr>> performMap(MapArguments &args) {
+	if(!args.isVspace)
+		return args.space->map(args.slice, args.pointer, args.offset, args.length, args.mapFlags);
+	return args.vspace->map(args.slice, args.pointer, args.offset, args.length, args.mapFlags);
+}
 
-	if(!mapResult) {
-		assert(mapResult.error() == Error::bufferTooSmall || mapResult.error() == Error::alreadyExists || mapResult.error() == Error::noMemory);
+HelError translateMapError(Error error) {
+	assert(error == Error::bufferTooSmall || error == Error::alreadyExists || error == Error::noMemory);
 
-		if(mapResult.error() == Error::bufferTooSmall)
-			return kHelErrBufferTooSmall;
-		else if(mapResult.error() == Error::noMemory)
-			return kHelErrNoMemory;
-		else if(mapResult.error() == Error::alreadyExists)
-			return kHelErrAlreadyExists;
-	}
+	if(error == Error::bufferTooSmall)
+		return kHelErrBufferTooSmall;
+	else if(error == Error::noMemory)
+		return kHelErrNoMemory;
+	return kHelErrAlreadyExists;
+}
+
+} // anonymous namespace
+
+HelError helMapMemory(HelHandle memory_handle, HelHandle space_handle,
+		void *pointer, uintptr_t offset, size_t length, uint32_t flags, void **actualPointer) {
+	MapArguments args;
+	if(auto error = resolveMapArguments(memory_handle, space_handle,
+			pointer, offset, length, flags, args); error != kHelErrNone)
+		return error;
+
+	auto mapResult = Thread::asyncBlockCurrent(
+		performMap(args),
+		getCurrentThread()->pagingWorkQueue().get()
+	);
+	if(!mapResult)
+		return translateMapError(mapResult.error());
 
 	*actualPointer = (void *)mapResult.value();
 	return kHelErrNone;
 }
 
+HelError doSubmitMapMemory(HelHandle memoryHandle, HelHandle spaceHandle,
+		smarter::shared_ptr<IpcQueue> queue,
+		void *pointer, uintptr_t offset, size_t length, uint32_t flags, uintptr_t context) {
+	MapArguments args;
+	if(auto error = resolveMapArguments(memoryHandle, spaceHandle,
+			pointer, offset, length, flags, args); error != kHelErrNone)
+		return error;
+
+	if(!queue->validSize(ipcSourceSize(sizeof(HelMapResult))))
+		return kHelErrQueueTooSmall;
+
+	[](MapArguments args, smarter::shared_ptr<IpcQueue> queue, uintptr_t context,
+			enable_detached_coroutine) -> void {
+		auto mapResult = co_await onExceptionalWq(performMap(args));
+
+		HelMapResult helResult{.error = kHelErrNone, .reserved = {}, .pointer = nullptr};
+		if(mapResult) {
+			helResult.pointer = reinterpret_cast<void *>(mapResult.value());
+		}else{
+			helResult.error = translateMapError(mapResult.error());
+		}
+		QueueSource ipcSource{&helResult, sizeof(HelMapResult), nullptr};
+		co_await queue->submit(&ipcSource, context);
+	}(std::move(args), std::move(queue), context,
+			enable_detached_coroutine{getCurrentThread()->mainWorkQueue().lock()});
+
+	return kHelErrNone;
+}
+
 HelError doSubmitProtectMemory(HelHandle space_handle, smarter::shared_ptr<IpcQueue> queue,
 		void *pointer, size_t length, uint32_t flags, uintptr_t context) {
 	auto this_thread = getCurrentThread();
@@ -1404,13 +1487,14 @@ HelError doSubmitProtectMemory(HelHandle space_handle, smarter::shared_ptr<IpcQu
 	return kHelErrNone;
 }
 
-HelError helUnmapMemory(HelHandle space_handle, void *pointer, size_t length) {
+namespace {
+
+HelError resolveUnmapSpace(HelHandle space_handle,
+		smarter::shared_ptr<AddressSpace, BindableHandle> &space,
+		smarter::shared_ptr<VirtualSpace> &vspace) {
 	auto this_thread = getCurrentThread();
 	auto this_universe = this_thread->getUniverse();
 
-	smarter::shared_ptr<AddressSpace, BindableHandle> space;
-	smarter::shared_ptr<VirtualSpace> vspace;
-
 	if(space_handle == kHelNullHandle) {
 		space = this_thread->getAddressSpace().lock();
 	}else{
@@ -1436,6 +1520,17 @@ HelError helUnmapMemory(HelHandle space_handle, void *pointer, size_t length) {
 			return translateError(spaceOutcome.error());
 	}
 
+	return kHelErrNone;
+}
+
+} // anonymous namespace
+
+HelError helUnmapMemory(HelHandle space_handle, void *pointer, size_t length) {
+	smarter::shared_ptr<AddressSpace, BindableHandle> space;
+	smarter::shared_ptr<VirtualSpace> vspace;
+	if(auto error = resolveUnmapSpace(space_handle, space, vspace); error != kHelErrNone)
+		return error;
+
 	frg::expected<thor::Error> outcome = Error::illegalArgs;
 	if (space) {
 		outcome = Thread::asyncBlockCurrent(
@@ -1457,6 +1552,43 @@ HelError helUnmapMemory(HelHandle space_handle, void *pointer, size_t length) {
 	return kHelErrNone;
 }
 
+HelError doSubmitUnmapMemory(HelHandle spaceHandle, smarter::shared_ptr<IpcQueue> queue,
+		void *pointer, size_t length, uintptr_t context) {
+	smarter::shared_ptr<AddressSpace, BindableHandle> space;
+	smarter::shared_ptr<VirtualSpace> vspace;
+	if(auto error = resolveUnmapSpace(spaceHandle, space, vspace); error != kHelErrNone)
+		return error;
+
+	if(!queue->validSize(ipcSourceSize(sizeof(HelSimpleResult))))
+		return kHelErrQueueTooSmall;
+
+	[](smarter::shared_ptr<AddressSpace, BindableHandle> space,
+			smarter::shared_ptr<VirtualSpace> vspace,
+			smarter::shared_ptr<IpcQueue> queue,
+			VirtualAddr pointer, size_t length, uintptr_t context,
+			enable_detached_coroutine) -> void {
+		frg::expected<Error> outcome = Error::illegalArgs;
+		if(space) {
+			outcome = co_await onExceptionalWq(space->unmap(pointer, length));
+		}else{
+			assert(vspace);
+			outcome = co_await onExceptionalWq(vspace->unmap(pointer, length));
+		}
+
+		HelSimpleResult helResult{.error = kHelErrNone, .reserved = {}};
+		if(!outcome) {
+			assert(outcome.error() == Error::illegalArgs);
+			helResult.error = kHelErrIllegalArgs;
+		}
+		QueueSource ipcSource{&helResult, sizeof(HelSimpleResult), nullptr};
+		co_await queue->submit(&ipcSource, context);
+	}(std::move(space), std::move(vspace), std::move(queue),
+			reinterpret_cast<VirtualAddr>(pointer), length, context,
+			enable_detached_coroutine{getCurrentThread()->mainWorkQueue().lock()});
+
+	return kHelErrNone;
+}
+
 HelError doSubmitSynchronizeSpace(HelHandle spaceHandle, smarter::shared_ptr<IpcQueue> queue,
 		void *pointer, size_t length, uintptr_t context) {
 	auto thisThread = getCurrentThread();
@@ -1855,6 +1987,9 @@ HelError doSubmitManageMemory(HelHandle handle, smarter::shared_ptr<IpcQueue> qu
 				case ManageRequest::writeback:
 					manageRequest = kHelManageWriteback;
 					break;
+				case ManageRequest::discard:
+					manageRequest = kHelManageDiscard;
+					break;
 			}
 			assert(manageRequest); // The switch needs to be exhaustive.
 			helResult = HelManageResult{
@@ -1887,6 +2022,9 @@ HelError helUpdateMemory(HelHandle handle, int type,
 	case kHelManageWriteback:
 		error = memory->updateRange(ManageRequest::writeback, offset, length);
 		break;
+	case kHelManageDiscard:
+		error = memory->updateRange(ManageRequest::discard, offset, length);
+		break;
 	default:
 		return kHelErrIllegalArgs;
 	}
@@ -2051,6 +2189,24 @@ HelError helCreateThread(HelHandle universe_handle, HelHandle space_handle,
 	return kHelErrNone;
 }
 
+namespace {
+
+HelThreadStats translateThreadStatistics(const ThreadStatistics &statistics) {
+	HelThreadStats stats;
+	memset(&stats, 0, sizeof(HelThreadStats));
+	stats.userTime = statistics.schedule.runTime;
+	stats.waitTime = statistics.schedule.waitTime;
+	stats.timeslices = statistics.schedule.timeslices;
+	stats.voluntarySwitches = statistics.schedule.voluntarySwitches;
+	stats.involuntarySwitches = statistics.schedule.involuntarySwitches;
+	stats.migrations = statistics.schedule.migrations;
+	stats.ipcWaitTime = statistics.ipcWaitTime;
+	stats.faultTime = statistics.faultTime;
+	return stats;
+}
+
+} // anonymous namespace
+
 HelError helQueryThreadStats(HelHandle handle, HelThreadStats *user_stats) {
 	auto this_thread = getCurrentThread();
 	auto this_universe = this_thread->getUniverse();
@@ -2065,11 +2221,27 @@ HelError helQueryThreadStats(HelHandle handle, HelThreadStats *user_stats) {
 		thread = smarter::rc_policy_downcast<smarter::default_rc_policy>(std::move(*threadOutcome));
 	}
 
-	HelThreadStats stats;
-	memset(&stats, 0, sizeof(HelThreadStats));
-	stats.userTime = thread->runTime();
+	if(!writeUserObject(user_stats, translateThreadStatistics(thread->statistics())))
+		return kHelErrFault;
+
+	return kHelErrNone;
+}
+
+HelError helQueryUniverseStats(HelHandle handle, HelThreadStats *user_stats) {
+	auto this_thread = getCurrentThread();
+	auto this_universe = this_thread->getUniverse();
 
-	if(!writeUserObject(user_stats, stats))
+	smarter::shared_ptr<Universe> universe;
+	if(handle == kHelThisUniverse) {
+		universe = this_universe.lock();
+	}else{
+		auto universeOutcome = this_universe->resolveObject<DescriptorType::universe>(handle, kHelRightNull);
+		if(!universeOutcome)
+			return translateError(universeOutcome.error());
+		universe = std::move(*universeOutcome);
+	}
+
+	if(!writeUserObject(user_stats, translateThreadStatistics(universe->threadStatistics())))
 		return kHelErrFault;
 
 	return kHelErrNone;
@@ -2094,6 +2266,113 @@ HelError helSetPriority(HelHandle handle, int priority) {
 	return kHelErrNone;
 }
 
+HelError helSetSchedulingParameters(HelHandle handle, const HelSchedulingParameters *paramsPtr) {
+	auto thisThread = getCurrentThread();
+	auto thisUniverse = thisThread->getUniverse();
+
+	HelSchedulingParameters userParams;
+	if(!readUserObject(paramsPtr, userParams))
+		return kHelErrFault;
+
+	SchedulingParameters params;
+	switch(userParams.policy) {
+	case kHelSchedulingFair: params.policy = SchedulingPolicy::fair; break;
+	case kHelSchedulingFifo: params.policy = SchedulingPolicy::fifo; break;
+	case kHelSchedulingRoundRobin: params.policy = SchedulingPolicy::roundRobin; break;
+	case kHelSchedulingDeadline: params.policy = SchedulingPolicy::deadline; break;
+	default:
+		return kHelErrIllegalArgs;
+	}
+	params.priority = userParams.priority;
+	params.runtime = userParams.runtime;
+	params.deadline = userParams.deadline;
+	params.period = userParams.period;
+
+	smarter::shared_ptr<Thread> thread;
+	if(handle == kHelThisThread) {
+		thread = thisThread.lock();
+	}else{
+		auto threadOutcome = thisUniverse->resolveObject<DescriptorType::thread>(handle, kHelRightManage);
+		if(!threadOutcome)
+			return translateError(threadOutcome.error());
+		thread = smarter::rc_policy_downcast<smarter::default_rc_policy>(std::move(*threadOutcome));
+	}
+
+	// EDF is only feasible per CPU. Hence, deadline threads reserve their bandwidth
+	// on the CPU that they are assigned to and are excluded from load balancing.
+	auto *lbCb = thread->_lbCb;
+	auto *cpu = lbCb ? lbCb->getAssignedCpu() : getCpuData();
+	if(auto error = Scheduler::setParameters(thread.get(), params, &localScheduler.get(cpu));
+			error != Error::success)
+		return translateError(error);
+
+	if(lbCb) {
+		if(params.policy == SchedulingPolicy::deadline) {
+			// The load balancer might have re-assigned the thread in the meantime.
+			if(lbCb->pin(cpu))
+				Thread::migrateOther(thread);
+		}else{
+			lbCb->unpin();
+		}
+	}
+
+	return kHelErrNone;
+}
+
+HelError helGetSchedulingParameters(HelHandle handle, HelSchedulingParameters *paramsPtr) {
+	auto thisThread = getCurrentThread();
+	auto thisUniverse = thisThread->getUniverse();
+
+	smarter::shared_ptr<Thread> thread;
+	if(handle == kHelThisThread) {
+		thread = thisThread.lock();
+	}else{
+		auto threadOutcome = thisUniverse->resolveObject<DescriptorType::thread>(handle, kHelRightNull);
+		if(!threadOutcome)
+			return translateError(threadOutcome.error());
+		thread = smarter::rc_policy_downcast<smarter::default_rc_policy>(std::move(*threadOutcome));
+	}
+
+	auto params = thread->schedulingParameters();
+
+	HelSchedulingParameters userParams;
+	memset(&userParams, 0, sizeof(HelSchedulingParameters));
+	switch(params.policy) {
+	case SchedulingPolicy::fair: userParams.policy = kHelSchedulingFair; break;
+	case SchedulingPolicy::fifo: userParams.policy = kHelSchedulingFifo; break;
+	case SchedulingPolicy::roundRobin: userParams.policy = kHelSchedulingRoundRobin; break;
+	case SchedulingPolicy::deadline: userParams.policy = kHelSchedulingDeadline; break;
+	}
+	userParams.priority = params.priority;
+	userParams.runtime = params.runtime;
+	userParams.deadline = params.deadline;
+	userParams.period = params.period;
+
+	if(!writeUserObject(paramsPtr, userParams))
+		return kHelErrFault;
+
+	return kHelErrNone;
+}
+
+HelError helSetTimerSlack(HelHandle handle, uint64_t slack) {
+	auto thisThread = getCurrentThread();
+	auto thisUniverse = thisThread->getUniverse();
+
+	smarter::shared_ptr<Thread> thread;
+	if(handle == kHelThisThread) {
+		thread = thisThread.lock();
+	}else{
+		auto threadOutcome = thisUniverse->resolveObject<DescriptorType::thread>(handle, kHelRightManage);
+		if(!threadOutcome)
+			return translateError(threadOutcome.error());
+		thread = smarter::rc_policy_downcast<smarter::default_rc_policy>(std::move(*threadOutcome));
+	}
+
+	thread->setTimerSlack(slack);
+
+	return kHelErrNone;
+}
+
 HelError helYield() {
 	Thread::deferCurrent();
 
@@ -2359,7 +2638,7 @@ HelError helLoadRegisters(HelHandle handle, int set, void *image) {
 		frg::unique_memory<KernelAlloc> buffer{*kernelAlloc, simdSize};
 		auto accessOutcome = thread->accessRegisters([&](Executor *executor) {
 #if defined(__x86_64__)
-			memcpy(buffer.data(), executor->_fxState(), simdSize);
+			executor->readSimdState(buffer.data());
 #elif defined(__aarch64__)
 			memcpy(buffer.data(), executor->fp(), simdSize);
 #elif defined(__riscv) && __riscv_xlen == 64
@@ -2647,7 +2926,7 @@ HelError helStoreRegisters(HelHandle handle, int set, const void *image) {
 			return kHelErrFault;
 		auto accessOutcome = thread->accessRegisters([&](Executor *executor) {
 #if defined(__x86_64__)
-			memcpy(executor->_fxState(), buffer.data(), simdSize);
+			executor->writeSimdState(buffer.data());
 #elif defined(__aarch64__)
 			memcpy(executor->fp(), buffer.data(), simdSize);
 #elif defined(__riscv) && __riscv_xlen == 64
@@ -2780,14 +3059,17 @@ HelError helGetClock(uint64_t *counter) {
 }
 
 HelError doSubmitAwaitClock(smarter::shared_ptr<IpcQueue> queue, uint64_t counter,
-		uintptr_t context, CancelGuard cg) {
+		uint64_t slack, uintptr_t context, CancelGuard cg) {
 	if(!queue->validSize(ipcSourceSize(sizeof(HelSimpleResult))))
 		return kHelErrQueueTooSmall;
 
-	[](smarter::shared_ptr<IpcQueue> queue, uint64_t counter, uintptr_t context,
+	if(slack == kHelTimerSlackDefault)
+		slack = getCurrentThread()->timerSlack();
+
+	[](smarter::shared_ptr<IpcQueue> queue, uint64_t counter, uint64_t slack, uintptr_t context,
 			CancelGuard cg,
 			enable_detached_coroutine) -> void {
-		bool succeeded = co_await generalTimerEngine()->sleep(counter, cg.token());
+		bool succeeded = co_await generalTimerEngine()->sleep(counter, cg.token(), slack);
 
 		queue->unregisterTag(std::move(cg));
 
@@ -2795,7 +3077,7 @@ HelError doSubmitAwaitClock(smarter::shared_ptr<IpcQueue> queue, uint64_t counte
 		HelSimpleResult helResult{.error = error, .reserved = {}};
 		QueueSource ipcSource{&helResult, sizeof(HelSimpleResult), nullptr};
 		co_await queue->submit(&ipcSource, context);
-	}(std::move(queue), counter, context, std::move(cg),
+	}(std::move(queue), counter, slack, context, std::move(cg),
 		enable_detached_coroutine{getCurrentThread()->mainWorkQueue().lock()});
 
 	return kHelErrNone;
@@ -2849,6 +3131,10 @@ HelError doSubmitExchangeMsgs(HelHandle laneHandle, smarter::shared_ptr<IpcQueue
 		StreamNode transmit;
 		QueueSource mainSource;
 		QueueSource dataSource;
+		// For kHelActionSendFromMemory.
+		smarter::shared_ptr<MemoryView> memoryView;
+		// For kHelActionSendFromBufferSg: index of the first segment in sgItems.
+		size_t sgBegin = 0;
 		union {
 			HelSimpleResult helSimpleResult;
 			HelHandleResult helHandleResult;
@@ -2867,6 +3153,9 @@ HelError doSubmitExchangeMsgs(HelHandle laneHandle, smarter::shared_ptr<IpcQueue
 	frg::small_vector<size_t, 4, KernelAlloc> linkStack{*kernelAlloc};
 	linkStack.push_back(noIndex);
 
+	// Segments of all kHelActionSendFromBufferSg items.
+	frg::vector<HelSgItem, KernelAlloc> sgItems{*kernelAlloc};
+
 	// Read the message items.
 	size_t ipcSize = 0;
 	size_t numFlows = 0;
@@ -2949,7 +3238,7 @@ HelError doSubmitExchangeMsgs(HelHandle laneHandle, smarter::shared_ptr<IpcQueue
 				break;
 			case kHelActionSendFromBufferSg: {
 				size_t length = 0;
-				frg::small_vector<HelSgItem, 8, KernelAlloc> sgItems{*kernelAlloc};
+				items[i].sgBegin = sgItems.size();
 				auto sglist = reinterpret_cast<HelSgItem *>(recipe->buffer);
 				for(size_t j = 0; j < recipe->length; j++) {
 					HelSgItem item;
@@ -2960,28 +3249,63 @@ HelError doSubmitExchangeMsgs(HelHandle laneHandle, smarter::shared_ptr<IpcQueue
 					sgItems.push_back(item);
 				}
 
-				frg::unique_memory<KernelAlloc> buffer(*kernelAlloc, length);
-				size_t offset = 0;
-				for(size_t j = 0; j < recipe->length; j++) {
-					const auto &item = sgItems[j];
-					if(!readUserMemory(reinterpret_cast<char *>(buffer.data()) + offset,
-							reinterpret_cast<char *>(item.buffer), item.length))
-						return kHelErrFault;
-					offset += item.length;
-				}
+				// Like kHelActionSendFromBuffer, large transfers use the flow protocol
+				// such that the segments' pages can be pinned instead of copied.
+				if(length <= kPageSize) {
+					frg::unique_memory<KernelAlloc> buffer(*kernelAlloc, length);
+					size_t offset = 0;
+					for(size_t j = 0; j < recipe->length; j++) {
+						const auto &item = sgItems[items[i].sgBegin + j];
+						if(!readUserMemory(reinterpret_cast<char *>(buffer.data()) + offset,
+								reinterpret_cast<char *>(item.buffer), item.length))
+							return kHelErrFault;
+						offset += item.length;
+					}
 
-				node->_tag = kTagSendKernelBuffer;
-				node->_inBuffer = std::move(buffer);
+					node->_tag = kTagSendKernelBuffer;
+					node->_inBuffer = std::move(buffer);
+				}else{
+					node->_tag = kTagSendFlow;
+					node->_maxLength = length;
+					++numFlows;
+				}
 				ipcSize += ipcSourceSize(sizeof(HelSimpleResult));
 				break;
 			}
-			case kHelActionRecvInline:
-				// TODO: For now, we hardcode a size of 128 bytes.
+			case kHelActionSendFromMemory: {
+				auto viewOutcome = thisUniverse->resolveObject<DescriptorType::memoryView>(
+						recipe->handle, kHelRightRead);
+				if(!viewOutcome)
+					return translateError(viewOutcome.error());
+
+				uintptr_t limit;
+				if(!(frg::safe_int{recipe->offset} + frg::safe_int{recipe->length}).into(limit))
+					return kHelErrIllegalArgs;
+
+				// The data is always transferred by the detached coroutine below
+				// since reading from the memory object may need to block.
+				items[i].memoryView = std::move(*viewOutcome);
+				node->_tag = kTagSendFlow;
+				node->_maxLength = recipe->length;
+				++numFlows;
+				ipcSize += ipcSourceSize(sizeof(HelSimpleResult));
+				break;
+			}
+			case kHelActionRecvInline: {
+				size_t maxLength = recipe->length;
+				if(!maxLength)
+					maxLength = kHelRecvInlineDefaultLength;
+				// Inline data is always posted to a single chunk.
+				// Note that this check also ensures that ipcSourceSize() does not overflow.
+				if(!queue->validSize(maxLength))
+					return kHelErrQueueTooSmall;
+
 				node->_tag = kTagRecvKernelBuffer;
-				node->_maxLength = 128;
+				node->_maxLength = maxLength;
 				ipcSize += ipcSourceSize(sizeof(HelLengthResult));
-				ipcSize += ipcSourceSize(128);
+				ipcSize += ipcSourceSize(maxLength);
 				break;
+			}
 			case kHelActionRecvToBuffer:
 				node->_tag = kTagRecvFlow;
 				node->_maxLength = recipe->length;
@@ -3032,8 +3356,8 @@ HelError doSubmitExchangeMsgs(HelHandle laneHandle, smarter::shared_ptr<IpcQueue
 	// From this point on, the function must not fail, since we now link our items
 	// into intrusive linked lists.
 
-	[](frg::dyn_array<Item, KernelAlloc> items, size_t count,
-			smarter::weak_ptr<Universe> weakUniverse,
+	[](frg::dyn_array<Item, KernelAlloc> items, frg::vector<HelSgItem, KernelAlloc> sgItems,
+			size_t count, smarter::weak_ptr<Universe> weakUniverse,
 			smarter::shared_ptr<IpcQueue> queue, uintptr_t context,
 			smarter::shared_ptr<Stream, LanePolicy> lane, size_t numFlows, smarter::shared_ptr<Thread> thread,
 			enable_detached_coroutine) -> void {
@@ -3070,6 +3394,23 @@ HelError doSubmitExchangeMsgs(HelHandle laneHandle, smarter::shared_ptr<IpcQueue
 			// The size of this array must be a power of two.
 			frg::array<frg::unique_memory<KernelAlloc>, 2> xferBuffers;
 
+			// Maximal number of pages that are pinned at once for zero-copy transfers.
+			constexpr size_t maxPinnedPages = 16;
+
+			// Returns the segments of user memory that a send item transfers.
+			// For kHelActionSendFromMemory, the segment's buffer is an offset into the view.
+			auto sendSegments = [&] (Item *item, HelSgItem &single) -> frg::span<const HelSgItem> {
+				auto recipe = &item->recipe;
+				if(recipe->type == kHelActionSendFromBufferSg)
+					return {sgItems.data() + item->sgBegin, recipe->length};
+				if(recipe->type == kHelActionSendFromMemory) {
+					single = {reinterpret_cast<void *>(recipe->offset), recipe->length};
+				}else{
+					single = {recipe->buffer, recipe->length};
+				}
+				return {&single, 1};
+			};
+
 			size_t i = 0;
 			size_t seenFlows = 0; // Iterates through flows.
 			while(seenFlows < numFlows) {
@@ -3091,12 +3432,23 @@ HelError doSubmitExchangeMsgs(HelHandle laneHandle, smarter::shared_ptr<IpcQueue
 					continue;
 				}
 
-				if(recipe->type == kHelActionSendFromBuffer
+				if((recipe->type == kHelActionSendFromBuffer
+							|| recipe->type == kHelActionSendFromBufferSg)
 						&& node->tag() == kTagSendFlow
 						&& peer->tag() == kTagRecvKernelBuffer) {
-					frg::unique_memory<KernelAlloc> buffer(*kernelAlloc, recipe->length);
-
-					auto outcome = readUserMemory(buffer.data(), recipe->buffer, recipe->length);
+					frg::unique_memory<KernelAlloc> buffer(*kernelAlloc, node->_maxLength);
+
+					HelSgItem single;
+					bool outcome = true;
+					size_t offset = 0;
+					for(const auto &segment : sendSegments(item, single)) {
+						if(!readUserMemory(reinterpret_cast<std::byte *>(buffer.data()) + offset,
+								segment.buffer, segment.length)) {
+							outcome = false;
+							break;
+						}
+						offset += segment.length;
+					}
 					if(!outcome) {
 						// We complete with fault; the remote with success.
 						// TODO: it probably makes sense to introduce a "remote fault" error.
@@ -3111,11 +3463,61 @@ HelError doSubmitExchangeMsgs(HelHandle laneHandle, smarter::shared_ptr<IpcQueue
 					peer->_transmitBuffer = std::move(buffer);
 					peer->complete();
 					node->complete();
-				}else if(recipe->type == kHelActionSendFromBuffer
+				}else if(recipe->type == kHelActionSendFromMemory
+						&& peer->tag() == kTagRecvKernelBuffer) {
+					frg::unique_memory<KernelAlloc> buffer(*kernelAlloc, recipe->length);
+
+					auto outcome = co_await onExceptionalWq(item->memoryView->copyFrom(
+							recipe->offset, buffer.data(), recipe->length));
+					if(!outcome) {
+						peer->_error = Error::success;
+						node->_error = outcome.error();
+						peer->complete();
+						node->complete();
+						continue;
+					}
+
+					// Both nodes complete successfully.
+					peer->_transmitBuffer = std::move(buffer);
+					peer->complete();
+					node->complete();
+				}else if((recipe->type == kHelActionSendFromBuffer
+							|| recipe->type == kHelActionSendFromBufferSg
+							|| recipe->type == kHelActionSendFromMemory)
 						&& node->tag() == kTagSendFlow
 						&& peer->tag() == kTagRecvFlow) {
+					auto length = node->_maxLength;
 					// Empty packets are handled by the generic stream code.
-					assert(recipe->length);
+					assert(length);
+
+					bool fromMemory = recipe->type == kHelActionSendFromMemory;
+					HelSgItem single;
+					auto segments = sendSegments(item, single);
+					size_t segmentIndex = 0;
+					size_t segmentProgress = 0;
+					// Moves the cursor forward, skipping empty segments.
+					auto advance = [&] (size_t n) {
+						segmentProgress += n;
+						while(segmentIndex < segments.size()
+								&& segmentProgress == segments[segmentIndex].length) {
+							++segmentIndex;
+							segmentProgress = 0;
+						}
+					};
+					advance(0);
+
+					// Page-aligned, page-sized portions are not copied into a bounce buffer.
+					// Instead, we pin the pages such that the receiver can copy directly
+					// out of the direct physical mapping. To amortize the cost of pinning,
+					// we pin up to maxPinnedPages contiguous pages at once.
+					// Two windows of pinned pages alternate. When a window is replaced,
+					// at most one packet is in flight and that packet does not belong
+					// to the replaced window (acks arrive in order).
+					frg::array<MemoryViewLockHandle, 2> pinLocks;
+					PhysicalAddr pinnedPages[maxPinnedPages];
+					size_t pinWindow = 0;
+					uintptr_t pinBase = 0;
+					size_t numPinned = 0;
 
 					size_t progress = 0;
 					size_t numSent = 0;
@@ -3166,14 +3568,88 @@ HelError doSubmitExchangeMsgs(HelHandle laneHandle, smarter::shared_ptr<IpcQueue
 						// Prepare a buffer an send it.
 						assert(numSent - numAcked < xferBuffers.size());
 						auto &xb = xferBuffers[numSent & (xferBuffers.size() - 1)];
-						if(!xb.size())
-							xb = frg::unique_memory<KernelAlloc>{*kernelAlloc, 4096};
 
-						auto chunkSize = frg::min(recipe->length - progress, xb.size());
-						assert(chunkSize);
+						void *xferData = nullptr;
+						size_t chunkSize = 0;
+						bool outcome = true;
+
+						assert(segmentIndex < segments.size());
+						auto pinnable = [&] (uintptr_t source, size_t remaining) {
+							return !(source & (kPageSize - 1)) && remaining >= kPageSize;
+						};
+						auto source = reinterpret_cast<uintptr_t>(segments[segmentIndex].buffer)
+								+ segmentProgress;
+						auto remaining = segments[segmentIndex].length - segmentProgress;
+						if(pinnable(source, remaining)) {
+							if(source - pinBase >= numPinned * kPageSize) {
+								pinWindow ^= 1;
+								pinLocks[pinWindow] = MemoryViewLockHandle{};
+								numPinned = 0;
+
+								frg::span<PhysicalAddr> physicals{pinnedPages,
+										frg::min(remaining / kPageSize, maxPinnedPages)};
+								frg::expected<Error, size_t> pinOutcome{Error::fault};
+								if(fromMemory) {
+									pinOutcome = co_await onExceptionalWq(pinViewRange(
+											item->memoryView, source, 0, physicals, pinLocks[pinWindow]));
+								}else{
+									auto space = thread->getAddressSpace().lock();
+									if(space)
+										pinOutcome = co_await onExceptionalWq(
+												space->pinRange(source, physicals, pinLocks[pinWindow]));
+								}
+								if(pinOutcome) {
+									pinBase = source;
+									numPinned = pinOutcome.value();
+								}
+							}
 
-						auto outcome = readUserMemory(xb.data(),
-								reinterpret_cast<std::byte *>(recipe->buffer) + progress, chunkSize);
+							if(source - pinBase < numPinned * kPageSize) {
+								PageAccessor accessor{pinnedPages[(source - pinBase) / kPageSize]};
+								xferData = accessor.get();
+								chunkSize = kPageSize;
+								advance(chunkSize);
+							}
+						}
+
+						// Unaligned heads and tails (and pages that cannot be pinned)
+						// fall back to the bounce buffer.
+						if(!xferData) {
+							if(!xb.size())
+								xb = frg::unique_memory<KernelAlloc>{*kernelAlloc, 4096};
+
+							xferData = xb.data();
+							if(fromMemory) {
+								// Stop at the next page boundary such that the following
+								// chunks can be pinned.
+								chunkSize = frg::min(remaining, kPageSize - (source & (kPageSize - 1)));
+								assert(chunkSize);
+
+								auto copyOutcome = co_await onExceptionalWq(
+										item->memoryView->copyFrom(source, xb.data(), chunkSize));
+								outcome = static_cast<bool>(copyOutcome);
+								advance(chunkSize);
+							}else{
+								// Gather consecutive segments until the buffer is full
+								// or until we reach a page that can be pinned.
+								while(chunkSize < xb.size() && segmentIndex < segments.size()) {
+									source = reinterpret_cast<uintptr_t>(segments[segmentIndex].buffer)
+											+ segmentProgress;
+									remaining = segments[segmentIndex].length - segmentProgress;
+									if(chunkSize && pinnable(source, remaining))
+										break;
+
+									auto n = frg::min(remaining, xb.size() - chunkSize);
+									if(!readUserMemory(reinterpret_cast<std::byte *>(xb.data()) + chunkSize,
+											reinterpret_cast<const void *>(source), n)) {
+										outcome = false;
+										break;
+									}
+									chunkSize += n;
+									advance(n);
+								}
+							}
+						}
 						if(!outcome) {
 							// Send the packet (may deallocate the peer!).
 							peer->flowQueue.put({ .terminate = true, .fault = true });
@@ -3191,10 +3667,10 @@ HelError doSubmitExchangeMsgs(HelHandle laneHandle, smarter::shared_ptr<IpcQueue
 							break;
 						}
 
-						lastTransferSent = (progress + chunkSize == recipe->length);
+						lastTransferSent = (progress + chunkSize == length);
 						// Send the packet (may deallocate the peer!).
 						peer->flowQueue.put({
-							.data = xb.data(),
+							.data = xferData,
 							.size = chunkSize,
 							.terminate = lastTransferSent
 						});
@@ -3353,7 +3829,8 @@ HelError doSubmitExchangeMsgs(HelHandle laneHandle, smarter::shared_ptr<IpcQueue
 						sizeof(HelCredentialsResult));
 				link(&item->mainSource);
 			}else if(recipe->type == kHelActionSendFromBuffer
-					|| recipe->type == kHelActionSendFromBufferSg) {
+					|| recipe->type == kHelActionSendFromBufferSg
+					|| recipe->type == kHelActionSendFromMemory) {
 				item->helSimpleResult = {translateError(node->error()), 0};
 				item->mainSource.setup(&item->helSimpleResult, sizeof(HelSimpleResult));
 				link(&item->mainSource);
@@ -3402,7 +3879,7 @@ HelError doSubmitExchangeMsgs(HelHandle laneHandle, smarter::shared_ptr<IpcQueue
 		}
 
 		co_await queue->submit(&items[0].mainSource, context);
-	}(std::move(items), count, thisUniverse.lock(), std::move(queue), context,
+	}(std::move(items), std::move(sgItems), count, thisUniverse.lock(), std::move(queue), context,
 			lane, numFlows, thisThread.lock(),
 			enable_detached_coroutine{getCurrentThread()->mainWorkQueue().lock()});
 
@@ -3443,6 +3920,7 @@ HelError helFutexWait(int *pointer, int expected, int64_t deadline) {
 	}else{
 		Error waitErr;
 		bool timeout = false;
+		auto slack = thisThread->timerSlack();
 
 		Thread::asyncBlockCurrentInterruptible(async::lambda([&](async::cancellation_token ct) {
 			return async::race_and_cancel(
@@ -3452,7 +3930,7 @@ HelError helFutexWait(int *pointer, int expected, int64_t deadline) {
 				    );
 			    }),
 			    async::lambda([&](async::cancellation_token cancellation) -> coroutine<void> {
-				    timeout = co_await generalTimerEngine()->sleep(deadline, cancellation);
+				    timeout = co_await generalTimerEngine()->sleep(deadline, cancellation, slack);
 			    }),
 			    async::lambda([ct](async::cancellation_token cancellation) {
 				    return async::suspend_indefinitely(ct, cancellation);
@@ -3486,6 +3964,93 @@ HelError helFutexWake(int *pointer, unsigned int count) {
 	return kHelErrNone;
 }
 
+HelError doSubmitFutexWait(smarter::shared_ptr<IpcQueue> queue,
+		int *pointer, int expected, int64_t deadline, uintptr_t context, CancelGuard cg) {
+	if(deadline < -1) {
+		queue->unregisterTag(std::move(cg));
+		return kHelErrIllegalArgs;
+	}
+	if(!queue->validSize(ipcSourceSize(sizeof(HelSimpleResult)))) {
+		queue->unregisterTag(std::move(cg));
+		return kHelErrQueueTooSmall;
+	}
+
+	auto thisThread = getCurrentThread();
+	auto space = thisThread->getAddressSpace().lock();
+	auto slack = thisThread->timerSlack();
+
+	[](smarter::shared_ptr<AddressSpace, BindableHandle> space,
+			smarter::shared_ptr<IpcQueue> queue,
+			uintptr_t address, int expected, int64_t deadline, uint64_t slack, uintptr_t context,
+			CancelGuard cg,
+			enable_detached_coroutine) -> void {
+		Error waitErr = Error::success;
+		bool timeout = false;
+
+		if(deadline < 0) {
+			waitErr = co_await onExceptionalWq(getGlobalFutexRealm()->wait(
+				space->globalFutexSpace(), address, expected, cg.token()
+			));
+		}else{
+			co_await onExceptionalWq(async::race_and_cancel(
+				async::lambda([&](async::cancellation_token cancellation) -> coroutine<void> {
+					waitErr = co_await getGlobalFutexRealm()->wait(
+						space->globalFutexSpace(), address, expected, cancellation
+					);
+				}),
+				async::lambda([&](async::cancellation_token cancellation) -> coroutine<void> {
+					timeout = co_await generalTimerEngine()->sleep(deadline, cancellation, slack);
+				}),
+				async::lambda([ct = cg.token()](async::cancellation_token cancellation) {
+					return async::suspend_indefinitely(ct, cancellation);
+				})
+			));
+		}
+
+		queue->unregisterTag(std::move(cg));
+
+		HelError error;
+		if(waitErr == Error::cancelled) {
+			error = timeout ? kHelErrTimeout : kHelErrCancelled;
+		}else{
+			error = translateError(waitErr);
+		}
+		HelSimpleResult helResult{.error = error, .reserved = {}};
+		QueueSource ipcSource{&helResult, sizeof(HelSimpleResult), nullptr};
+		co_await queue->submit(&ipcSource, context);
+	}(std::move(space), std::move(queue), reinterpret_cast<uintptr_t>(pointer),
+			expected, deadline, slack, context, std::move(cg),
+			enable_detached_coroutine{thisThread->mainWorkQueue().lock()});
+
+	return kHelErrNone;
+}
+
+HelError doSubmitFutexWake(smarter::shared_ptr<IpcQueue> queue,
+		int *pointer, unsigned int count, uintptr_t context) {
+	if(!queue->validSize(ipcSourceSize(sizeof(HelSimpleResult))))
+		return kHelErrQueueTooSmall;
+
+	auto thisThread = getCurrentThread();
+	auto space = thisThread->getAddressSpace().lock();
+
+	[](smarter::shared_ptr<AddressSpace, BindableHandle> space,
+			smarter::shared_ptr<IpcQueue> queue,
+			uintptr_t address, unsigned int count, uintptr_t context,
+			enable_detached_coroutine) -> void {
+		auto result = co_await onExceptionalWq(getGlobalFutexRealm()->wake(
+			space->globalFutexSpace(), address, count
+		));
+
+		HelSimpleResult helResult{.error = result ? kHelErrNone : kHelErrFault, .reserved = {}};
+		QueueSource ipcSource{&helResult, sizeof(HelSimpleResult), nullptr};
+		co_await queue->submit(&ipcSource, context);
+	}(std::move(space), std::move(queue), reinterpret_cast<uintptr_t>(pointer),
+			count, context,
+			enable_detached_coroutine{thisThread->mainWorkQueue().lock()});
+
+	return kHelErrNone;
+}
+
 HelError helCreateOneshotEvent(HelHandle *handle) {
 	auto this_thread = getCurrentThread();
 	auto this_universe = this_thread->getUniverse();
@@ -3780,6 +4345,42 @@ HelError helAutomateIrq(HelHandle handle, uint32_t flags, HelHandle kernlet_hand
 	return kHelErrNone;
 }
 
+HelError helSetIrqAffinity(HelHandle handle, uint32_t cpu) {
+	auto this_thread = getCurrentThread();
+	auto this_universe = this_thread->getUniverse();
+
+	auto irqOutcome = this_universe->resolveObject<DescriptorType::irq>(handle, kHelRightSignal);
+	if(!irqOutcome)
+		return translateError(irqOutcome.error());
+	auto irq = std::move(*irqOutcome);
+
+	auto pin = irq->getPin();
+	if(!pin)
+		return kHelErrIllegalState;
+
+	if(auto e = pin->setAffinity(cpu); e != Error::success)
+		return translateError(e);
+
+	return kHelErrNone;
+}
+
+HelError helGetIrqAffinity(HelHandle handle, uint32_t *cpu) {
+	auto this_thread = getCurrentThread();
+	auto this_universe = this_thread->getUniverse();
+
+	auto irqOutcome = this_universe->resolveObject<DescriptorType::irq>(handle, kHelRightWait);
+	if(!irqOutcome)
+		return translateError(irqOutcome.error());
+	auto irq = std::move(*irqOutcome);
+
+	auto pin = irq->getPin();
+	if(!pin)
+		return kHelErrIllegalState;
+
+	*cpu = pin->getAffinity();
+	return kHelErrNone;
+}
+
 HelError helAccessIo(
 	HelHandle accessHandle, const uintptr_t *portArray, size_t numPorts, HelHandle *handle
 ) {
@@ -3969,6 +4570,9 @@ HelError helSetAffinity(HelHandle handle, uint8_t *mask, size_t size) {
 	auto this_universe = this_thread->getUniverse();
 
 	if(handle == kHelThisThread) {
+		// Deadline threads stay on the CPU that their bandwidth is reserved on.
+		if(this_thread->_lbCb->isPinned())
+			return kHelErrIllegalState;
 		this_thread->_lbCb->setAffinityMask({buf.data(), maskSize});
 		Thread::migrateCurrent();
 	} else {
@@ -3977,6 +4581,8 @@ HelError helSetAffinity(HelHandle handle, uint8_t *mask, size_t size) {
 			return translateError(threadOutcome.error());
 		auto thread = smarter::rc_policy_downcast<smarter::default_rc_policy>(std::move(*threadOutcome));
 
+		if(thread->_lbCb->isPinned())
+			return kHelErrIllegalState;
 		thread->_lbCb->setAffinityMask({buf.data(), maskSize});
 		infoLogger() << "thor: TODO: helSetAffinity does not migrate other threads!" << frg::endlog;
 	}
@@ -4117,15 +4723,17 @@ void thor::submitFromSq(smarter::shared_ptr<IpcQueue> queue, uint32_t opcode,
 		break;
 	}
 	case kHelSubmitAwaitClock: {
-		if(sqSpan.size() < sizeof(HelSqAwaitClock)) {
+		// The slack field is optional.
+		if(sqSpan.size() < offsetof(HelSqAwaitClock, slack)) {
 			infoLogger() << "Bad length for kSubmitAwaitClock" << frg::endlog;
 			error = kHelErrBufferTooSmall;
 			break;
 		}
 		HelSqAwaitClock sqData;
-		memcpy(&sqData, sqSpan.data(), sizeof(sqData));
+		sqData.slack = kHelTimerSlackDefault;
+		memcpy(&sqData, sqSpan.data(), frg::min(sqSpan.size(), sizeof(sqData)));
 		auto cg = queue->registerTag(sqData.cancellationTag);
-		error = doSubmitAwaitClock(queue, sqData.counter, context, std::move(cg));
+		error = doSubmitAwaitClock(queue, sqData.counter, sqData.slack, context, std::move(cg));
 		break;
 	}
 	case kHelSubmitAwaitEvent: {
@@ -4277,6 +4885,65 @@ void thor::submitFromSq(smarter::shared_ptr<IpcQueue> queue, uint32_t opcode,
 		error = doSubmitPopulateSpace(sqData.handle, queue, sqData.address, sqData.length, context);
 		break;
 	}
+	case kHelSubmitMapMemory: {
+		if(sqSpan.size() < sizeof(HelSqMapMemory)) {
+			infoLogger() << "Bad length for kHelSubmitMapMemory" << frg::endlog;
+			error = kHelErrBufferTooSmall;
+			break;
+		}
+		HelSqMapMemory sqData;
+		memcpy(&sqData, sqSpan.data(), sizeof(sqData));
+		error = doSubmitMapMemory(sqData.memoryHandle, sqData.spaceHandle, queue,
+				sqData.pointer, sqData.offset, sqData.length, sqData.flags, context);
+		break;
+	}
+	case kHelSubmitUnmapMemory: {
+		if(sqSpan.size() < sizeof(HelSqUnmapMemory)) {
+			infoLogger() << "Bad length for kHelSubmitUnmapMemory" << frg::endlog;
+			error = kHelErrBufferTooSmall;
+			break;
+		}
+		HelSqUnmapMemory sqData;
+		memcpy(&sqData, sqSpan.data(), sizeof(sqData));
+		error = doSubmitUnmapMemory(sqData.spaceHandle, queue,
+				sqData.pointer, sqData.length, context);
+		break;
+	}
+	case kHelSubmitCloseDescriptor: {
+		if(sqSpan.size() < sizeof(HelSqCloseDescriptor)) {
+			infoLogger() << "Bad length for kHelSubmitCloseDescriptor" << frg::endlog;
+			error = kHelErrBufferTooSmall;
+			break;
+		}
+		HelSqCloseDescriptor sqData;
+		memcpy(&sqData, sqSpan.data(), sizeof(sqData));
+		error = doSubmitCloseDescriptor(sqData.universeHandle, queue, sqData.handle, context);
+		break;
+	}
+	case kHelSubmitFutexWait: {
+		if(sqSpan.size() < sizeof(HelSqFutexWait)) {
+			infoLogger() << "Bad length for kHelSubmitFutexWait" << frg::endlog;
+			error = kHelErrBufferTooSmall;
+			break;
+		}
+		HelSqFutexWait sqData;
+		memcpy(&sqData, sqSpan.data(), sizeof(sqData));
+		auto cg = queue->registerTag(sqData.cancellationTag);
+		error = doSubmitFutexWait(queue, sqData.pointer, sqData.expected,
+				sqData.deadline, context, std::move(cg));
+		break;
+	}
+	case kHelSubmitFutexWake: {
+		if(sqSpan.size() < sizeof(HelSqFutexWake)) {
+			infoLogger() << "Bad length for kHelSubmitFutexWake" << frg::endlog;
+			error = kHelErrBufferTooSmall;
+			break;
+		}
+		HelSqFutexWake sqData;
+		memcpy(&sqData, sqSpan.data(), sizeof(sqData));
+		error = doSubmitFutexWake(queue, sqData.pointer, sqData.count, context);
+		break;
+	}
 	default:
 		error = kHelErrIllegalSyscall;
 		infoLogger() << "thor: Bad opcode " << opcode << " in submission queue" << frg::endlog;
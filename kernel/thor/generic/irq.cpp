@@ -1,3 +1,5 @@
+#include <frg/manual_box.hpp>
+#include <frg/vector.hpp>
 #include <thor-internal/coroutine.hpp>
 #include <thor-internal/cpu-data.hpp>
 #include <thor-internal/debug.hpp>
@@ -8,6 +10,24 @@ namespace thor {
 
 namespace {
 	constexpr bool logService = false;
+
+	IrqSpinlock irqPinRegistryMutex;
+	// Protected by irqPinRegistryMutex.
+	frg::manual_box<frg::vector<IrqPin *, KernelAlloc>> irqPinRegistry;
+}
+
+size_t getIrqPinCount() {
+	auto lock = frg::guard(&irqPinRegistryMutex);
+	if(!irqPinRegistry)
+		return 0;
+	return irqPinRegistry->size();
+}
+
+IrqPin *getIrqPin(uint64_t id) {
+	auto lock = frg::guard(&irqPinRegistryMutex);
+	if(!irqPinRegistry || id >= irqPinRegistry->size())
+		return nullptr;
+	return (*irqPinRegistry)[id];
 }
 
 // --------------------------------------------------------
@@ -131,6 +151,15 @@ IrqPin::IrqPin(frg::string<KernelAlloc> name)
 		_inService{false}, _dueSinks{0},
 		_maskState{0} {
 	_hash = frg::hash<frg::string<KernelAlloc>>{}(_name);
+	_cpuStats = frg::construct_n<IrqCpuStatistics>(*kernelAlloc, getCpuCount());
+
+	{
+		auto lock = frg::guard(&irqPinRegistryMutex);
+		if(!irqPinRegistry)
+			irqPinRegistry.initialize(*kernelAlloc);
+		_id = irqPinRegistry->size();
+		irqPinRegistry->push_back(this);
+	}
 
 	[] (IrqPin *self, enable_detached_coroutine) -> void {
 		while(true) {
@@ -256,6 +285,12 @@ void IrqPin::raise() {
 		endOfInterrupt();
 }
 
+void IrqPin::accountRaise(uint64_t nanos) {
+	auto &stats = _cpuStats[getCpuData()->cpuIndex];
+	stats.increment(stats.raises);
+	stats.increment(stats.raiseNanos, nanos);
+}
+
 void IrqPin::_acknowledge() {
 	assert(_inService);
 	assert(_dueSinks);
@@ -371,6 +406,15 @@ void IrqPin::dumpHardwareState() {
 	infoLogger() << "thor: No dump available for IRQ pin " << name() << frg::endlog;
 }
 
+Error IrqPin::setAffinity(size_t) {
+	return Error::noHardwareSupport;
+}
+
+size_t IrqPin::getAffinity() {
+	// Unless the controller supports re-routing, IRQs are delivered to the boot CPU.
+	return 0;
+}
+
 void IrqPin::endOfInterrupt() {
 	// Default implementation is a no-op: not all IRQ controllers need endOfInterrupt().
 }
@@ -426,6 +470,13 @@ void IrqPin::_doService() {
 		}
 	}
 
+	auto &stats = _cpuStats[getCpuData()->cpuIndex];
+	if(numAsynchronous) {
+		stats.increment(stats.asynchronousDispatches);
+	}else if(anyAck) {
+		stats.increment(stats.synchronousAcks);
+	}
+
 	if(!numAsynchronous) {
 		if(anyAck) {
 			if(logService)
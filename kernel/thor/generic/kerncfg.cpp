@@ -2,14 +2,20 @@
 
 #include <thor-internal/universe.hpp>
 #include <thor-internal/coroutine.hpp>
+#include <thor-internal/irq.hpp>
 #include <thor-internal/fiber.hpp>
 #include <thor-internal/kerncfg.hpp>
+#include <thor-internal/kernel-heap.hpp>
 #include <thor-internal/ostrace.hpp>
 #include <thor-internal/kernel-log.hpp>
+#include <thor-internal/load-balancing.hpp>
 #include <thor-internal/profile.hpp>
+#include <thor-internal/schedule.hpp>
 #include <thor-internal/stream.hpp>
 #include <thor-internal/timer.hpp>
+#include <thor-internal/topology.hpp>
 #include <thor-internal/mbus.hpp>
+#include <thor-internal/memory-view.hpp>
 #include <thor-internal/physical.hpp>
 #include <thor-internal/elf-notes.hpp>
 #include <eir/interface.hpp>
@@ -89,6 +95,7 @@ private:
 			resp.set_error(managarm::kerncfg::Error::SUCCESS);
 			resp.set_total_usable_memory(physicalAllocator->numTotalPages());
 			resp.set_available_memory(physicalAllocator->numFreePages());
+			resp.set_reclaimable_memory(getNumReclaimablePages());
 			resp.set_memory_unit(kPageSize);
 
 			frg::unique_memory<KernelAlloc> respBuffer{*kernelAlloc, resp.size_of_head()};
@@ -144,6 +151,218 @@ private:
 			resp.set_size(0);
 #endif
 
+			frg::unique_memory<KernelAlloc> respBuffer{*kernelAlloc, resp.size_of_head()};
+			bragi::write_head_only(resp, respBuffer);
+			auto respError = co_await sendBuffer(lane, std::move(respBuffer));
+			if(respError != Error::success)
+				co_return respError;
+		}else if(preamble.id() == bragi::message_id<managarm::kerncfg::GetHeapStatisticsRequest>) {
+			auto req = bragi::parse_head_only<managarm::kerncfg::GetHeapStatisticsRequest>(reqBuffer, *kernelAlloc);
+
+			if (!req)
+				co_return Error::protocolViolation;
+
+			HeapClassStatistics stats[HeapMagazines::numClasses];
+			getHeapStatistics(stats);
+
+			managarm::kerncfg::GetHeapStatisticsResponse<KernelAlloc> resp(*kernelAlloc);
+			resp.set_error(managarm::kerncfg::Error::SUCCESS);
+			for(auto &classStats : stats) {
+				managarm::kerncfg::HeapClassStatistics<KernelAlloc> entry(*kernelAlloc);
+				entry.set_object_size(classStats.objectSize);
+				entry.set_allocations(classStats.allocations);
+				entry.set_frees(classStats.frees);
+				entry.set_magazine_hits(classStats.magazineHits);
+				entry.set_flushed_objects(classStats.flushedObjects);
+				entry.set_cached_objects(classStats.cachedObjects);
+				resp.add_classes(std::move(entry));
+			}
+
+			frg::unique_memory<KernelAlloc> headBuffer{*kernelAlloc, resp.size_of_head()};
+			frg::unique_memory<KernelAlloc> tailBuffer{*kernelAlloc, resp.size_of_tail()};
+			bragi::write_head_tail(resp, headBuffer, tailBuffer);
+			auto headError = co_await sendBuffer(lane, std::move(headBuffer));
+			if(headError != Error::success)
+				co_return headError;
+			auto tailError = co_await sendBuffer(lane, std::move(tailBuffer));
+			if(tailError != Error::success)
+				co_return tailError;
+		}else if(preamble.id() == bragi::message_id<managarm::kerncfg::GetIrqStatisticsRequest>) {
+			auto req = bragi::parse_head_only<managarm::kerncfg::GetIrqStatisticsRequest>(reqBuffer, *kernelAlloc);
+
+			if (!req)
+				co_return Error::protocolViolation;
+
+			managarm::kerncfg::GetIrqStatisticsResponse<KernelAlloc> resp(*kernelAlloc);
+			resp.set_error(managarm::kerncfg::Error::SUCCESS);
+			for(size_t id = 0; id < getIrqPinCount(); id++) {
+				auto pin = getIrqPin(id);
+				// Skip pins that are not in use (e.g., unused I/O APIC pins).
+				if(!pin->isConfigured())
+					continue;
+
+				managarm::kerncfg::IrqStatistics<KernelAlloc> entry(*kernelAlloc);
+				entry.set_id(id);
+				entry.set_name(pin->name());
+				entry.set_affinity(pin->getAffinity());
+				for(size_t cpu = 0; cpu < getCpuCount(); cpu++) {
+					auto &stats = pin->cpuStatistics(cpu);
+					managarm::kerncfg::IrqCpuStatistics<KernelAlloc> cpuEntry(*kernelAlloc);
+					cpuEntry.set_raises(stats.raises.load(std::memory_order_relaxed));
+					cpuEntry.set_raise_nanos(stats.raiseNanos.load(std::memory_order_relaxed));
+					cpuEntry.set_synchronous_acks(stats.synchronousAcks.load(std::memory_order_relaxed));
+					cpuEntry.set_asynchronous_dispatches(
+							stats.asynchronousDispatches.load(std::memory_order_relaxed));
+					entry.add_cpus(std::move(cpuEntry));
+				}
+				resp.add_irqs(std::move(entry));
+			}
+			for(size_t cpu = 0; cpu < getCpuCount(); cpu++) {
+				resp.add_cpu_loads(lbNode.getFor(cpu).totalLoad);
+				auto timerStats = getTimerStatistics(cpu);
+				resp.add_cpu_timer_interrupts(timerStats.interrupts);
+				resp.add_cpu_timer_expirations(timerStats.expirations);
+			}
+
+			frg::unique_memory<KernelAlloc> headBuffer{*kernelAlloc, resp.size_of_head()};
+			frg::unique_memory<KernelAlloc> tailBuffer{*kernelAlloc, resp.size_of_tail()};
+			bragi::write_head_tail(resp, headBuffer, tailBuffer);
+			auto headError = co_await sendBuffer(lane, std::move(headBuffer));
+			if(headError != Error::success)
+				co_return headError;
+			auto tailError = co_await sendBuffer(lane, std::move(tailBuffer));
+			if(tailError != Error::success)
+				co_return tailError;
+		}else if(preamble.id() == bragi::message_id<managarm::kerncfg::SetIrqAffinityRequest>) {
+			auto req = bragi::parse_head_only<managarm::kerncfg::SetIrqAffinityRequest>(reqBuffer, *kernelAlloc);
+
+			if (!req)
+				co_return Error::protocolViolation;
+
+			managarm::kerncfg::SvrResponse<KernelAlloc> resp(*kernelAlloc);
+			auto pin = getIrqPin(req->id());
+			if(!pin || req->cpu() >= getCpuCount()) {
+				resp.set_error(managarm::kerncfg::Error::ILLEGAL_ARGUMENTS);
+			}else{
+				auto error = pin->setAffinity(req->cpu());
+				if(error == Error::success) {
+					resp.set_error(managarm::kerncfg::Error::SUCCESS);
+				}else if(error == Error::noHardwareSupport) {
+					resp.set_error(managarm::kerncfg::Error::NO_HARDWARE_SUPPORT);
+				}else{
+					resp.set_error(managarm::kerncfg::Error::ILLEGAL_ARGUMENTS);
+				}
+			}
+
+			frg::unique_memory<KernelAlloc> respBuffer{*kernelAlloc, resp.size_of_head()};
+			bragi::write_head_only(resp, respBuffer);
+			auto respError = co_await sendBuffer(lane, std::move(respBuffer));
+			if(respError != Error::success)
+				co_return respError;
+		}else if(preamble.id() == bragi::message_id<managarm::kerncfg::GetCpuTopologyRequest>) {
+			auto req = bragi::parse_head_only<managarm::kerncfg::GetCpuTopologyRequest>(reqBuffer, *kernelAlloc);
+
+			if (!req)
+				co_return Error::protocolViolation;
+
+			managarm::kerncfg::GetCpuTopologyResponse<KernelAlloc> resp(*kernelAlloc);
+			resp.set_error(managarm::kerncfg::Error::SUCCESS);
+			resp.set_num_numa_nodes(getNumaNodeCount());
+			for(size_t cpu = 0; cpu < getCpuCount(); cpu++) {
+				auto &topology = getCpuData(cpu)->topology;
+				managarm::kerncfg::CpuTopology<KernelAlloc> entry(*kernelAlloc);
+				entry.set_package_id(topology.packageId);
+				entry.set_core_id(topology.coreId);
+				entry.set_thread_id(topology.threadId);
+				entry.set_llc_id(topology.llcId);
+				entry.set_numa_node(topology.numaNode);
+				resp.add_cpus(std::move(entry));
+			}
+
+			frg::unique_memory<KernelAlloc> headBuffer{*kernelAlloc, resp.size_of_head()};
+			frg::unique_memory<KernelAlloc> tailBuffer{*kernelAlloc, resp.size_of_tail()};
+			bragi::write_head_tail(resp, headBuffer, tailBuffer);
+			auto headError = co_await sendBuffer(lane, std::move(headBuffer));
+			if(headError != Error::success)
+				co_return headError;
+			auto tailError = co_await sendBuffer(lane, std::move(tailBuffer));
+			if(tailError != Error::success)
+				co_return tailError;
+		}else if(preamble.id() == bragi::message_id<managarm::kerncfg::GetCpuStatisticsRequest>) {
+			auto req = bragi::parse_head_only<managarm::kerncfg::GetCpuStatisticsRequest>(reqBuffer, *kernelAlloc);
+
+			if (!req)
+				co_return Error::protocolViolation;
+
+			managarm::kerncfg::GetCpuStatisticsResponse<KernelAlloc> resp(*kernelAlloc);
+			resp.set_error(managarm::kerncfg::Error::SUCCESS);
+			for(size_t cpu = 0; cpu < getCpuCount(); cpu++) {
+				auto &scheduler = localScheduler.getFor(cpu);
+
+				uint64_t irqNanos = 0;
+				for(size_t id = 0; id < getIrqPinCount(); id++) {
+					auto pin = getIrqPin(id);
+					if(!pin->isConfigured())
+						continue;
+					irqNanos += pin->cpuStatistics(cpu).raiseNanos.load(std::memory_order_relaxed);
+				}
+
+				managarm::kerncfg::CpuStatistics<KernelAlloc> entry(*kernelAlloc);
+				entry.set_busy_nanos(scheduler.busyTime());
+				entry.set_idle_nanos(scheduler.idleTime());
+				entry.set_irq_nanos(irqNanos);
+				entry.set_context_switches(scheduler.contextSwitches());
+				resp.add_cpus(std::move(entry));
+			}
+
+			frg::unique_memory<KernelAlloc> headBuffer{*kernelAlloc, resp.size_of_head()};
+			frg::unique_memory<KernelAlloc> tailBuffer{*kernelAlloc, resp.size_of_tail()};
+			bragi::write_head_tail(resp, headBuffer, tailBuffer);
+			auto headError = co_await sendBuffer(lane, std::move(headBuffer));
+			if(headError != Error::success)
+				co_return headError;
+			auto tailError = co_await sendBuffer(lane, std::move(tailBuffer));
+			if(tailError != Error::success)
+				co_return tailError;
+		}else if(preamble.id() == bragi::message_id<managarm::kerncfg::GetProfileFrequencyRequest>) {
+			auto req = bragi::parse_head_only<managarm::kerncfg::GetProfileFrequencyRequest>(reqBuffer, *kernelAlloc);
+
+			if (!req)
+				co_return Error::protocolViolation;
+
+			managarm::kerncfg::GetProfileFrequencyResponse<KernelAlloc> resp(*kernelAlloc);
+			if(!getGlobalProfileRing()) {
+				resp.set_error(managarm::kerncfg::Error::ILLEGAL_REQUEST);
+			}else if(!usingTimerProfile()) {
+				resp.set_error(managarm::kerncfg::Error::NO_HARDWARE_SUPPORT);
+			}else{
+				resp.set_error(managarm::kerncfg::Error::SUCCESS);
+				resp.set_frequency(getProfileFrequency());
+			}
+
+			frg::unique_memory<KernelAlloc> respBuffer{*kernelAlloc, resp.size_of_head()};
+			bragi::write_head_only(resp, respBuffer);
+			auto respError = co_await sendBuffer(lane, std::move(respBuffer));
+			if(respError != Error::success)
+				co_return respError;
+		}else if(preamble.id() == bragi::message_id<managarm::kerncfg::SetProfileFrequencyRequest>) {
+			auto req = bragi::parse_head_only<managarm::kerncfg::SetProfileFrequencyRequest>(reqBuffer, *kernelAlloc);
+
+			if (!req)
+				co_return Error::protocolViolation;
+
+			managarm::kerncfg::SvrResponse<KernelAlloc> resp(*kernelAlloc);
+			if(!getGlobalProfileRing()) {
+				resp.set_error(managarm::kerncfg::Error::ILLEGAL_REQUEST);
+			}else if(!usingTimerProfile()) {
+				resp.set_error(managarm::kerncfg::Error::NO_HARDWARE_SUPPORT);
+			}else if(!req->frequency() || req->frequency() > maxProfileFrequency) {
+				resp.set_error(managarm::kerncfg::Error::ILLEGAL_ARGUMENTS);
+			}else{
+				setProfileFrequency(req->frequency());
+				resp.set_error(managarm::kerncfg::Error::SUCCESS);
+			}
+
 			frg::unique_memory<KernelAlloc> respBuffer{*kernelAlloc, resp.size_of_head()};
 			bragi::write_head_only(resp, respBuffer);
 			auto respError = co_await sendBuffer(lane, std::move(respBuffer));
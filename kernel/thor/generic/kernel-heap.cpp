@@ -13,10 +13,111 @@
 namespace thor {
 
 THOR_DEFINE_PERCPU_UNINITIALIZED(heapSlabPool);
+THOR_DEFINE_PERCPU_UNINITIALIZED(heapMagazines);
 THOR_DEFINE_PERCPU(inSlabPool);
 
 namespace {
 
+// Free objects in a batch are linked through their first word.
+// The first object of each batch links to the next batch through its second word.
+struct HeapBatch {
+	HeapBatch *nextObject;
+	HeapBatch *nextBatch;
+};
+
+static_assert(sizeof(HeapBatch) <= (size_t{1} << HeapMagazines::minClassShift));
+
+// Upper bound on the number of batches per size class that are kept in the depot.
+// Further batches are returned to the slab pool.
+constexpr size_t maxDepotBatches = 64;
+
+struct HeapDepot {
+	IrqSpinlock mutex;
+	HeapBatch *batches = nullptr;
+	size_t numBatches = 0;
+};
+
+constinit HeapDepot heapDepots[HeapMagazines::numClasses];
+
+} // anonymous namespace
+
+bool HeapMagazines::refill(int sc) {
+	auto &depot = heapDepots[sc];
+	HeapBatch *batch;
+	{
+		auto lock = frg::guard(&depot.mutex);
+		batch = depot.batches;
+		if(!batch)
+			return false;
+		depot.batches = batch->nextBatch;
+		depot.numBatches--;
+	}
+
+	auto &magazine = magazines_[sc];
+	assert(!magazine.count);
+	for(auto object = batch; object; object = object->nextObject)
+		magazine.objects[magazine.count++] = object;
+	assert(magazine.count == batchSize);
+	return true;
+}
+
+void HeapMagazines::flush(int sc, frg::sharded_slab_pool<HeapSlabPolicy> &pool) {
+	auto &magazine = magazines_[sc];
+	// Keep the most recently freed (i.e., cache-hot) objects.
+	size_t n = batchSize;
+	for(size_t i = 0; i < n; ++i) {
+		auto object = static_cast<HeapBatch *>(magazine.objects[i]);
+		object->nextObject = (i + 1 < n) ? static_cast<HeapBatch *>(magazine.objects[i + 1]) : nullptr;
+	}
+
+	auto &depot = heapDepots[sc];
+	bool deposited = false;
+	{
+		auto lock = frg::guard(&depot.mutex);
+		if(depot.numBatches < maxDepotBatches) {
+			auto batch = static_cast<HeapBatch *>(magazine.objects[0]);
+			batch->nextBatch = depot.batches;
+			depot.batches = batch;
+			depot.numBatches++;
+			deposited = true;
+		}
+	}
+
+	if(!deposited) {
+		for(size_t i = 0; i < n; ++i)
+			pool.deallocate(magazine.objects[i]);
+		stats_[sc].flushedObjects += n;
+	}
+	memmove(magazine.objects, magazine.objects + n, (magazine.count - n) * sizeof(void *));
+	magazine.count -= n;
+}
+
+void HeapMagazines::accumulateStatistics(HeapClassStatistics *stats) {
+	for(int sc = 0; sc < numClasses; ++sc) {
+		stats[sc].objectSize = classSize(sc);
+		stats[sc].allocations += stats_[sc].allocations;
+		stats[sc].frees += stats_[sc].frees;
+		stats[sc].magazineHits += stats_[sc].magazineHits;
+		stats[sc].flushedObjects += stats_[sc].flushedObjects;
+		stats[sc].cachedObjects += magazines_[sc].count;
+	}
+}
+
+void getHeapStatistics(HeapClassStatistics *stats) {
+	for(int sc = 0; sc < HeapMagazines::numClasses; ++sc)
+		stats[sc] = HeapClassStatistics{};
+	// The counters are only updated by their own CPU; we accept torn snapshots here.
+	for(size_t i = 0; i < getCpuCount(); ++i)
+		heapMagazines.getFor(i).accumulateStatistics(stats);
+	for(int sc = 0; sc < HeapMagazines::numClasses; ++sc) {
+		auto &depot = heapDepots[sc];
+		auto lock = frg::guard(&depot.mutex);
+		stats[sc].cachedObjects += depot.numBatches * HeapMagazines::batchSize;
+	}
+}
+
+namespace {
+
 constinit std::atomic<size_t> kernelVirtualUsage{0};
 constinit std::atomic<size_t> kernelCoreUsage{0};
 constinit std::atomic<size_t> kernelHeapUsage{0};
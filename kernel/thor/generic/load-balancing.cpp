@@ -1,6 +1,8 @@
 #include <frg/unique.hpp>
 #include <thor-internal/load-balancing.hpp>
+#include <thor-internal/schedule.hpp>
 #include <thor-internal/timer.hpp>
+#include <thor-internal/topology.hpp>
 
 namespace thor {
 
@@ -11,6 +13,13 @@ constexpr bool debugLb = false;
 // Basic settings.
 constexpr bool enableLb = true;
 constexpr uint64_t lbInterval = 100'000'000;
+// Whether idle CPUs steal threads in between rounds of load balancing.
+constexpr bool enableIdleStealing = true;
+// Whether woken up threads are placed on idle CPUs.
+constexpr bool enableWakePlacement = true;
+
+// Number of threads that are considered when stealing work.
+constexpr size_t maxStealCandidates = 4;
 
 // Load decay factor (scale is hardcoded to 8 below) and decay interval.
 constexpr uint64_t lbDecay = 184;
@@ -18,6 +27,33 @@ constexpr uint64_t lbDecayInterval = 1'000'000'000;
 
 frg::eternal<LoadBalancer> loadBalancer;
 
+// Levels at which we balance load, in the order in which we pull load.
+// SMT siblings are balanced together with the remaining CPUs that share the LLC.
+constexpr TopologyLevel balancingLevels[] = {
+	TopologyLevel::llc,
+	TopologyLevel::numa,
+	TopologyLevel::system
+};
+
+TopologyLevel balancingLevel(CpuData *a, CpuData *b) {
+	return frg::max(commonTopologyLevel(a, b), TopologyLevel::llc);
+}
+
+// Migrations that leave the LLC (or the NUMA node) lose cache (or memory) locality.
+// We only do them if they fix an imbalance that exceeds this margin.
+uint64_t balancingMargin(TopologyLevel level, uint64_t idealLoad) {
+	switch (level) {
+	case TopologyLevel::smt:
+	case TopologyLevel::llc:
+		return 0;
+	case TopologyLevel::numa:
+		return idealLoad / 8;
+	case TopologyLevel::system:
+		return idealLoad / 4;
+	}
+	__builtin_unreachable();
+}
+
 } // namespace
 
 THOR_DEFINE_PERCPU(lbNode);
@@ -89,6 +125,14 @@ coroutine<void> LoadBalancer::run_(CpuData *cpu) {
 				&LbControlBlock::hook_
 			>
 		> staleCbs;
+		frg::intrusive_list<
+			LbControlBlock,
+			frg::locate_member<
+				LbControlBlock,
+				frg::default_list_hook<LbControlBlock>,
+				&LbControlBlock::hook_
+			>
+		> reassignedCbs;
 		{
 			auto irqLock = frg::guard(&irqMutex());
 			auto lock = frg::guard(&thisNode->mutex);
@@ -108,6 +152,14 @@ coroutine<void> LoadBalancer::run_(CpuData *cpu) {
 					continue;
 				}
 
+				// placeWakee() can re-assign threads without taking the LbNode's mutex.
+				// Hand such threads over to the node of their new CPU.
+				if (auto *assignedCpu = cb->getAssignedCpu(); assignedCpu != cpu) {
+					thisNode->tasks.erase(currentIt);
+					reassignedCbs.push_back(cb);
+					continue;
+				}
+
 				thread->updateLoad();
 				if (applyDecay)
 					thread->decayLoad(lbDecay, 8);
@@ -123,6 +175,17 @@ coroutine<void> LoadBalancer::run_(CpuData *cpu) {
 		while(!staleCbs.empty())
 			frg::destruct(*kernelAlloc, staleCbs.pop_front());
 
+		while(!reassignedCbs.empty()) {
+			auto *cb = reassignedCbs.pop_front();
+			auto *dstNode = &lbNode.get(cb->getAssignedCpu());
+
+			auto irqLock = frg::guard(&irqMutex());
+			auto lock = frg::guard(&dstNode->mutex);
+
+			cb->node_ = dstNode;
+			dstNode->tasks.push_back(cb);
+		}
+
 		if (debugLb)
 			infoLogger() << "CPU #" << cpu->cpuIndex << " has load " << load << frg::endlog;
 
@@ -142,13 +205,18 @@ coroutine<void> LoadBalancer::run_(CpuData *cpu) {
 
 		if (enableLb) {
 			// Distribute load from other CPUs to this CPU.
-			// TODO: This loop probably does not scale very well since all CPUs try to pull from
-			//       all other CPUs in the same order (and this can cause lock contention).
+			// We first pull from CPUs that share our LLC, then from our NUMA node and only then
+			// from the rest of the system. Within each level, each CPU starts at its successor
+			// such that CPUs do not all contend for the same locks.
 			uint64_t newLoad = thisNode->totalLoad;
-			for (size_t i = 0; i < getCpuCount(); ++i) {
-				auto *toCpu = getCpuData(i);
-				if (cpu != toCpu)
-					balanceBetween_(&lbNode.get(toCpu), thisNode, newLoad, idealLoad);
+			for (auto level : balancingLevels) {
+				auto margin = balancingMargin(level, idealLoad);
+				for (size_t k = 1; k < getCpuCount(); ++k) {
+					auto *toCpu = getCpuData((cpu->cpuIndex + k) % getCpuCount());
+					if (balancingLevel(cpu, toCpu) != level)
+						continue;
+					balanceBetween_(&lbNode.get(toCpu), thisNode, newLoad, idealLoad, margin);
+				}
 			}
 		}
 
@@ -161,7 +229,164 @@ coroutine<void> LoadBalancer::run_(CpuData *cpu) {
 	co_return;
 }
 
-void LoadBalancer::balanceBetween_(LbNode *srcNode, LbNode *dstNode, uint64_t &newLoad, uint64_t idealLoad) {
+void LoadBalancer::stealWork(CpuData *cpu) {
+	if (!enableIdleStealing)
+		return;
+
+	auto *thisNode = &lbNode.get(cpu);
+	if (!thisNode->cpu)
+		return;
+	// Do not steal if work was already resumed on this CPU.
+	if (!localScheduler.get(cpu).isIdle())
+		return;
+
+	// Find the closest CPU that has at least one waiting entity.
+	// Among CPUs at the same topology level, prefer the one with the most runnable entities.
+	LbNode *srcNode = nullptr;
+	auto srcLevel = TopologyLevel::system;
+	size_t maxRunnable = 1;
+	for (size_t i = 0; i < getCpuCount(); ++i) {
+		auto *otherCpu = getCpuData(i);
+		if (otherCpu == cpu || !lbNode.get(otherCpu).cpu)
+			continue;
+		auto n = localScheduler.get(otherCpu).numRunnable();
+		if (n <= 1)
+			continue;
+		auto level = balancingLevel(cpu, otherCpu);
+		if (srcNode && (level > srcLevel || (level == srcLevel && n <= maxRunnable)))
+			continue;
+		srcNode = &lbNode.get(otherCpu);
+		srcLevel = level;
+		maxRunnable = n;
+	}
+	if (!srcNode)
+		return;
+
+	// Collect the threads with the highest load that are allowed to run on this CPU.
+	// We cannot check whether threads are runnable here since that requires the thread mutex.
+	struct Candidate {
+		LbControlBlock *cb;
+		smarter::shared_ptr<Thread> thread;
+	};
+	Candidate candidates[maxStealCandidates];
+	size_t numCandidates = 0;
+	{
+		auto irqLock = frg::guard(&irqMutex());
+		auto lock = frg::guard(&srcNode->mutex);
+
+		for (auto *cb : srcNode->tasks) {
+			if (!cb->load_)
+				continue;
+			if (numCandidates == maxStealCandidates
+					&& cb->load_ <= candidates[numCandidates - 1].cb->load_)
+				continue;
+			if (!cb->canMigrateTo(cpu->cpuIndex))
+				continue;
+			auto thread = cb->thread_.lock();
+			if (!thread)
+				continue;
+
+			// Insert into the candidate list (sorted by decreasing load).
+			size_t k = frg::min(numCandidates, maxStealCandidates - 1);
+			while (k > 0 && candidates[k - 1].cb->load_ < cb->load_) {
+				candidates[k] = std::move(candidates[k - 1]);
+				--k;
+			}
+			candidates[k] = Candidate{cb, std::move(thread)};
+			if (numCandidates < maxStealCandidates)
+				++numCandidates;
+		}
+	}
+
+	// Prefer running threads: they migrate immediately once they are notified, while waiting
+	// threads only migrate after they are scheduled on their old CPU.
+	Candidate *victim = nullptr;
+	for (size_t k = 0; k < numCandidates; ++k) {
+		auto r = candidates[k].thread->runnability();
+		if (r == Thread::Runnability::running) {
+			victim = &candidates[k];
+			break;
+		}
+		if (r == Thread::Runnability::waiting && !victim)
+			victim = &candidates[k];
+	}
+	if (!victim)
+		return;
+
+	if (moveTask_(victim->cb, srcNode, thisNode) && debugLb)
+		infoLogger() << "CPU #" << cpu->cpuIndex << " steals thread with load "
+				<< victim->cb->load_ << " from CPU " << srcNode->cpu->cpuIndex << frg::endlog;
+}
+
+CpuData *LoadBalancer::placeWakee(LbControlBlock *cb, CpuData *waker) {
+	if (!enableWakePlacement)
+		return nullptr;
+
+	// If the thread's CPU is idle, keep the thread there (its cache is likely still warm).
+	auto *prevCpu = cb->getAssignedCpu();
+	if (localScheduler.get(prevCpu).isIdle())
+		return nullptr;
+
+	// Search for an idle CPU close to the waker (since the wakee likely consumes data that was
+	// produced by the waker). We do not leave the waker's NUMA node; moving threads across
+	// NUMA nodes is left to periodic load balancing.
+	for (auto level : {TopologyLevel::smt, TopologyLevel::llc, TopologyLevel::numa}) {
+		for (size_t k = 0; k < getCpuCount(); ++k) {
+			auto i = (waker->cpuIndex + k) % getCpuCount();
+			auto *cpu = getCpuData(i);
+			if (cpu == prevCpu || !lbNode.get(cpu).cpu)
+				continue;
+			if (commonTopologyLevel(waker, cpu) != level)
+				continue;
+			auto &scheduler = localScheduler.get(cpu);
+			if (!scheduler.isIdle())
+				continue;
+			if (!cb->canMigrateTo(i))
+				continue;
+			if (!scheduler.tryClaimIdle())
+				continue;
+
+			// Ownership of cb is transferred to the new node during the next round of balancing.
+			// The thread might have been pinned concurrently.
+			if (!cb->tryAssign(cpu))
+				return nullptr;
+			return cpu;
+		}
+	}
+	return nullptr;
+}
+
+bool LoadBalancer::moveTask_(LbControlBlock *cb, LbNode *srcNode, LbNode *dstNode) {
+	{
+		auto irqLock = frg::guard(&irqMutex());
+		auto lock = frg::guard(&srcNode->mutex);
+
+		// The CB might have been moved (or pinned) concurrently.
+		if (cb->node_ != srcNode || cb->getAssignedCpu() != srcNode->cpu)
+			return false;
+		if (!cb->tryAssign(dstNode->cpu))
+			return false;
+		srcNode->tasks.erase(srcNode->tasks.iterator_to(cb));
+		srcNode->currentLoad -= frg::min(srcNode->currentLoad, cb->load_);
+		cb->node_ = dstNode;
+	}
+
+	{
+		auto irqLock = frg::guard(&irqMutex());
+		auto lock = frg::guard(&dstNode->mutex);
+
+		dstNode->tasks.push_back(cb);
+		dstNode->currentLoad += cb->load_;
+	}
+
+	// Notify the thread such that it eventually moves to its assigned CPU.
+	if (auto thread = cb->thread_.lock())
+		Thread::migrateOther(thread);
+	return true;
+}
+
+void LoadBalancer::balanceBetween_(LbNode *srcNode, LbNode *dstNode, uint64_t &newLoad,
+		uint64_t idealLoad, uint64_t margin) {
 	auto improvesBalance = [] (uint64_t srcLoad, uint64_t dstLoad, uint64_t stolenLoad) -> bool {
 		uint64_t srcLoadPostMove = srcLoad - stolenLoad;
 		uint64_t dstLoadPostMove = dstLoad + stolenLoad;
@@ -196,14 +421,18 @@ void LoadBalancer::balanceBetween_(LbNode *srcNode, LbNode *dstNode, uint64_t &n
 			if (srcNode->currentLoad < idealLoad && newLoad < idealLoad)
 				break;
 
+			// Do not migrate across topology levels for small imbalances.
+			if (srcNode->currentLoad < newLoad + margin)
+				break;
+
 			// Do not move threads with tiny contributions to the total load.
 			if (!cb->load_)
 				continue;
 
-			if (!cb->inAffinityMask(dstNode->cpu->cpuIndex))
+			if (!improvesBalance(srcNode->currentLoad, newLoad, cb->load_))
 				continue;
 
-			if (!improvesBalance(srcNode->currentLoad, newLoad, cb->load_))
+			if (!cb->tryAssign(dstNode->cpu))
 				continue;
 
 			if (debugLb)
@@ -215,7 +444,6 @@ void LoadBalancer::balanceBetween_(LbNode *srcNode, LbNode *dstNode, uint64_t &n
 			assert(cb->node_ == srcNode);
 			srcNode->tasks.erase(currentIt);
 			cb->node_ = dstNode;
-			cb->_assignedCpu.store(dstNode->cpu, std::memory_order_relaxed);
 			stolenTasks.push_back(cb);
 
 			srcNode->currentLoad -= cb->load_;
@@ -453,8 +453,10 @@ void handlePageFault(FaultImageAccessor image, uintptr_t address, Word errorCode
 		flags |= AddressSpace::kFaultExecute;
 
 	auto wq = this_thread->pagingWorkQueue();
+	auto faultStart = getClockNanos();
 	auto handledError =
 	    Thread::asyncBlockCurrent(address_space->handleFault(address, flags), wq.get());
+	this_thread->accountFault(getClockNanos() - faultStart);
 	// if the page fault was handled, return.
 	if(handledError)
 		return;
@@ -547,7 +549,9 @@ void handleIrq(IrqImageAccessor, IrqPin *irq) {
 	if(logEveryIrq)
 		infoLogger() << "thor: IRQ " << irq->name() << frg::endlog;
 
+	auto raiseStart = getClockNanos();
 	irq->raise();
+	irq->accountRaise(getClockNanos() - raiseStart);
 
 	// Inject IRQ timing entropy into the PRNG accumulator.
 	// Since we track the sequence number per CPU, we also include the CPU number.
@@ -762,9 +766,23 @@ void handleSyscall(SyscallImageAccessor image) {
 	case kHelCallQueryThreadStats: {
 		*image.error() = helQueryThreadStats((HelHandle)arg0, (HelThreadStats *)arg1);
 	} break;
+	case kHelCallQueryUniverseStats: {
+		*image.error() = helQueryUniverseStats((HelHandle)arg0, (HelThreadStats *)arg1);
+	} break;
 	case kHelCallSetPriority: {
 		*image.error() = helSetPriority((HelHandle)arg0, (int)arg1);
 	} break;
+	case kHelCallSetSchedulingParameters: {
+		*image.error() = helSetSchedulingParameters((HelHandle)arg0,
+				(const HelSchedulingParameters *)arg1);
+	} break;
+	case kHelCallGetSchedulingParameters: {
+		*image.error() = helGetSchedulingParameters((HelHandle)arg0,
+				(HelSchedulingParameters *)arg1);
+	} break;
+	case kHelCallSetTimerSlack: {
+		*image.error() = helSetTimerSlack((HelHandle)arg0, (uint64_t)arg1);
+	} break;
 	case kHelCallYield: {
 		*image.error() = helYield();
 	} break;
@@ -851,6 +869,14 @@ void handleSyscall(SyscallImageAccessor image) {
 	case kHelCallAutomateIrq: {
 		*image.error() = helAutomateIrq((HelHandle)arg0, (uint32_t)arg1, (HelHandle)arg2);
 	} break;
+	case kHelCallSetIrqAffinity: {
+		*image.error() = helSetIrqAffinity((HelHandle)arg0, (uint32_t)arg1);
+	} break;
+	case kHelCallGetIrqAffinity: {
+		uint32_t cpu;
+		*image.error() = helGetIrqAffinity((HelHandle)arg0, &cpu);
+		*image.out0() = cpu;
+	} break;
 
 	case kHelCallAccessIo: {
 		HelHandle handle;
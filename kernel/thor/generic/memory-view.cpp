@@ -46,6 +46,9 @@ struct MemoryReclaimer {
 			bundle->genLists_[bundle->newestGen_].push_back(page);
 			page->flags |= CachePage::reclaimRegistered;
 		}
+		// Bundles only register clean pages (see ManagedSpace::markDirty()).
+		if(!bundle->anonymous)
+			numFilePages_.fetch_add(1, std::memory_order_relaxed);
 
 		rotationTurnaround_.fetch_add(1, std::memory_order_relaxed);
 		if (shouldRotate_())
@@ -71,6 +74,12 @@ struct MemoryReclaimer {
 			bundle->genLists_[page->generation].erase(it);
 		}
 		page->flags &= ~CachePage::reclaimRegistered;
+		if(!bundle->anonymous)
+			numFilePages_.fetch_sub(1, std::memory_order_relaxed);
+	}
+
+	size_t numFilePages() {
+		return numFilePages_.load(std::memory_order_relaxed);
 	}
 
 	void bumpPage(CachePage *page) {
@@ -271,6 +280,10 @@ private:
 	// Number of pages bumped since the last generation rotation.
 	std::atomic<size_t> rotationTurnaround_{0};
 
+	// Number of registered pages of non-anonymous bundles,
+	// i.e., clean file-backed pages that can be evicted without writeback.
+	std::atomic<size_t> numFilePages_{0};
+
 	async::recurring_event rotationEvent_;
 };
 
@@ -291,6 +304,12 @@ static initgraph::Task initReclaim{&globalInitEngine, "generic.init-reclaim",
 	}
 };
 
+size_t getNumReclaimablePages() {
+	if(!globalReclaimer)
+		return 0;
+	return globalReclaimer->numFilePages();
+}
+
 // --------------------------------------------------------
 // MemoryView.
 // --------------------------------------------------------
@@ -935,7 +954,8 @@ std::expected<smarter::shared_ptr<ManagedSpace>, Error> ManagedSpace::create(
 }
 
 ManagedSpace::ManagedSpace(size_t length, bool readahead)
-: pages{*kernelAlloc}, numPages{length >> kPageShift}, readahead{readahead} {
+: pages{*kernelAlloc}, numPages{length >> kPageShift}, readahead{readahead},
+		_discardQueue{*kernelAlloc}, _discardsInFlight{frg::hash<uint64_t>{}, *kernelAlloc} {
 	assert(!(length & (kPageSize - 1)));
 
 	globalReclaimer->registerBundle(this);
@@ -1102,7 +1122,9 @@ coroutine<void> ManagedSpace::_runDrainLoop() {
 		co_await _dirtyEvent.async_wait_if([this] () -> bool {
 			auto irqLock = frg::guard(&irqMutex());
 			auto lock = frg::guard(&mutex);
-			return _dirtyList.empty() || _drainBlocked;
+			// Also wake up to hand out discard notifications to waiting management requests.
+			bool deliverDiscards = !_discardQueue.empty() && !_managementQueue.empty();
+			return (_dirtyList.empty() || _drainBlocked) && !deliverDiscards;
 		});
 
 		frg::intrusive_list<
@@ -1129,10 +1151,8 @@ coroutine<void> ManagedSpace::_runDrainLoop() {
 			if(pending.empty() && !_dirtyList.empty())
 				_drainBlocked = true;
 		}
-		if (pending.empty())
-			continue;
-
-		co_await _evictQueue.fenceDirty();
+		if(!pending.empty())
+			co_await _evictQueue.fenceDirty();
 
 		ManageList mgmtPending;
 		bool anyDiscardQueued = false;
@@ -1146,7 +1166,7 @@ coroutine<void> ManagedSpace::_runDrainLoop() {
 				assert(page->transactionState == TxState::pendingWriteback);
 				if(page->discarded) {
 					// The page was discarded while we were waiting for the fence.
-					// Note that claimSwapBudget() already ran for this page - _pageDiscarded() undoes the claim.
+					// Note that claimSwapBudget() already ran for this page - _pageDiscarded() takes care of the claim.
 					page->transactionState = TxState::none;
 					// .erased is ignored - the drain re-checks its predicate on loop-around.
 					if(_disposeDiscarded(page).queued)
@@ -1278,6 +1298,7 @@ std::expected<smarter::shared_ptr<SwapSpace>, Error> SwapSpace::create() {
 SwapSpace::SwapSpace()
 : ManagedSpace{UINT64_C(1) << 32, false}, _buddyMetadata{*kernelAlloc} {
 	isSwapSpace = true;
+	anonymous = true;
 
 	assert(numPages);
 	auto tableOrder = BuddyAccessor::suitableOrder(numPages);
@@ -1298,13 +1319,40 @@ bool SwapSpace::claimSwapBudget(ManagedPage *page) {
 }
 
 void SwapSpace::_pageDiscarded(ManagedPage *page) {
+	auto offset = page->cachePage.identity;
 	if(page->swapBudgetClaimed) {
-		assert(_budgetClaimed);
-		_budgetClaimed--;
+		// The driver may still hold a copy of the page. The offset and the
+		// swap budget are released once it acknowledges the discard.
 		page->swapBudgetClaimed = false;
-		_drainBlocked = false;
+		_discardQueue.push(offset);
+		_discardsInFlight.insert(offset, false);
+		return;
 	}
-	_freeOffset(page->cachePage.identity);
+	_freeOffset(offset);
+}
+
+Error SwapSpace::completeDiscard(uintptr_t offset, size_t length) {
+	{
+		auto irqLock = frg::guard(&irqMutex());
+		auto lock = frg::guard(&mutex);
+
+		// Validate the whole range before freeing any offset such that failure is atomic.
+		for(size_t pg = 0; pg < length; pg += kPageSize) {
+			auto notified = _discardsInFlight.get((offset + pg) >> kPageShift);
+			if(!notified || !*notified)
+				return Error::illegalArgs;
+		}
+
+		for(size_t pg = 0; pg < length; pg += kPageSize) {
+			auto index = (offset + pg) >> kPageShift;
+			_discardsInFlight.remove(index);
+			_freeOffset(index);
+			assert(_budgetClaimed);
+			_budgetClaimed--;
+		}
+	}
+	_wakeDrain();
+	return Error::success;
 }
 
 void SwapSpace::setBudget(size_t numSlots) {
@@ -1411,10 +1459,36 @@ void ManagedSpace::submitManagement(ManageNode *node) {
 }
 
 void ManagedSpace::_progressManagement(ManageList &pending) {
-	// For now, we prefer writeback to initialization.
+	// For now, we prefer discards (which free space in the backing store)
+	// to writeback and writeback to initialization.
 	// "Proper" priorization should probably be done in the userspace driver
 	// (we do not want to store per-page priorities here).
 
+	while(!_discardQueue.empty() && !_managementQueue.empty()) {
+		auto index = _discardQueue.back();
+		_discardQueue.pop();
+
+		// Fuse the request with adjacent offsets. Pages are usually discarded
+		// in ascending order, so the queue is processed back to front.
+		ptrdiff_t count = 1;
+		while(!_discardQueue.empty() && _discardQueue.back() == index - 1) {
+			index--;
+			count++;
+			_discardQueue.pop();
+		}
+
+		for(ptrdiff_t i = 0; i < count; i++) {
+			auto notified = _discardsInFlight.get(index + i);
+			assert(notified && !*notified);
+			*notified = true;
+		}
+
+		auto node = _managementQueue.pop_front();
+		node->setup(Error::success, ManageRequest::discard,
+				index << kPageShift, count << kPageShift);
+		pending.push_back(node);
+	}
+
 	while(!_writebackList.empty() && !_managementQueue.empty()) {
 		auto page = _writebackList.front();
 		auto index = page->identity;
@@ -1689,6 +1763,12 @@ Error BackingMemory::updateRange(ManageRequest type, size_t offset, size_t lengt
 	if (length & (kPageSize - 1))
 		return Error::illegalArgs;
 
+	if (type == ManageRequest::discard) {
+		if(!_managed->isSwapSpace)
+			return Error::illegalArgs;
+		return static_cast<SwapSpace *>(_managed.get())->completeDiscard(offset, length);
+	}
+
 	frg::intrusive_list<
 		ManagedSpace::TransactionMonitor,
 		frg::locate_member<
@@ -2101,7 +2181,7 @@ SwappableMemory::SwappableMemory(CtorToken, smarter::shared_ptr<SwapSpace> space
 SwappableMemory::~SwappableMemory() {
 	for(auto it = _table.begin(); it != _table.end(); ++it)
 		_space->discardPage(*it);
-	// Discarding may have released swap budget.
+	// Discarded pages may release swap budget or require discard notifications.
 	_space->_wakeDrain();
 }
 
@@ -265,6 +265,11 @@ initgraph::Task initOsTraceMbus{&globalInitEngine, "generic.init-ostrace-sinks",
 // Kernel ostrace infrastructure.
 // --------------------------------------------------------------------------------------
 
+constinit ostrace::Event ostEvtRcuGracePeriod{"thor.rcu-grace-period"};
+constinit ostrace::UintAttribute ostAttrRcuLatency{"latency"};
+constinit ostrace::UintAttribute ostAttrRcuBacklog{"backlog"};
+constinit ostrace::UintAttribute ostAttrRcuForcedCpus{"forced-cpus"};
+
 namespace ostrace {
 
 std::atomic<bool> available{false};
@@ -272,7 +277,7 @@ std::atomic<bool> available{false};
 THOR_DEFINE_PERCPU(context);
 
 void setup() {
-	[[maybe_unused]] auto setupTerm = [] (ostrace::Term &term) {
+	auto setupTerm = [] (ostrace::Term &term) {
 		assert(!term.id_);
 		term.id_ = nextId.fetch_add(1, std::memory_order_relaxed);
 
@@ -282,6 +287,11 @@ void setup() {
 		commitOsTrace(std::move(record));
 	};
 
+	setupTerm(ostEvtRcuGracePeriod);
+	setupTerm(ostAttrRcuLatency);
+	setupTerm(ostAttrRcuBacklog);
+	setupTerm(ostAttrRcuForcedCpus);
+
 	available.store(true, std::memory_order_relaxed);
 }
 
@@ -3,6 +3,7 @@
 #include <thor-internal/cpu-data.hpp>
 #include <thor-internal/debug.hpp>
 #include <thor-internal/physical.hpp>
+#include <thor-internal/topology.hpp>
 
 namespace thor {
 
@@ -113,20 +114,40 @@ PhysicalAddr PhysicalChunkAllocator::allocate(size_t size, int addressBits) {
 		Pass{.allowLow = false},
 		Pass{.allowLow = true},
 	};
+	auto localNode = getLocalNumaNode();
+	auto numNodes = getNumaNodeCount();
 	for(auto pass : passes) {
-		for(int i = 0; i < _numRegions; i++) {
-			// Note that Eir cuts regions in such a way that they never cross 4GiB.
-			if(!pass.allowLow && _allRegions[i].physicalBase < (PhysicalAddr{1} << 32))
-				continue;
-			if(target > _allRegions[i].buddyAccessor.tableOrder())
-				continue;
-
-			auto physical = _allRegions[i].buddyAccessor.allocate(target, addressBits);
-			if(physical == BuddyAccessor::illegalAddress)
-				continue;
-		//	infoLogger() << "Allocate " << (void *)physical << frg::endlog;
-			assert(!(physical % (size_t(kPageSize) << target)));
-			return physical;
+		// Visit NUMA nodes in order of increasing distance from the local node.
+		uint64_t visitedNodes = 0;
+		for(size_t k = 0; k < numNodes; k++) {
+			uint32_t node = 0;
+			unsigned int nodeDistance = ~0u;
+			for(uint32_t n = 0; n < numNodes; n++) {
+				if(visitedNodes & (uint64_t{1} << n))
+					continue;
+				if(auto distance = getNumaDistance(localNode, n); distance < nodeDistance) {
+					node = n;
+					nodeDistance = distance;
+				}
+			}
+			visitedNodes |= uint64_t{1} << node;
+
+			for(int i = 0; i < _numRegions; i++) {
+				if(_allRegions[i].numaNode != node)
+					continue;
+				// Note that Eir cuts regions in such a way that they never cross 4GiB.
+				if(!pass.allowLow && _allRegions[i].physicalBase < (PhysicalAddr{1} << 32))
+					continue;
+				if(target > _allRegions[i].buddyAccessor.tableOrder())
+					continue;
+
+				auto physical = _allRegions[i].buddyAccessor.allocate(target, addressBits);
+				if(physical == BuddyAccessor::illegalAddress)
+					continue;
+			//	infoLogger() << "Allocate " << (void *)physical << frg::endlog;
+				assert(!(physical % (size_t(kPageSize) << target)));
+				return physical;
+			}
 		}
 	}
 
@@ -159,6 +180,18 @@ void PhysicalChunkAllocator::free(PhysicalAddr address, size_t size) {
 	assert(!"Physical page is not part of any region");
 }
 
+void PhysicalChunkAllocator::setNumaNode(PhysicalAddr address, size_t size, uint32_t node) {
+	auto irq_lock = frg::guard(&irqMutex());
+	auto lock = frg::guard(&_mutex);
+
+	for(int i = 0; i < _numRegions; i++) {
+		if(_allRegions[i].physicalBase < address
+				|| _allRegions[i].physicalBase - address >= size)
+			continue;
+		_allRegions[i].numaNode = node;
+	}
+}
+
 PhysicalWindow::PhysicalWindow(PhysicalAddr physical, size_t size, CachingMode caching)
 : size_{size} {
 	uintptr_t lowAddr = physical & ~(kPageSize - 1);
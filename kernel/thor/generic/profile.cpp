@@ -15,6 +15,10 @@ bool wantKernelProfile = false;
 namespace {
 	frg::manual_box<LogRingBuffer> globalProfileRing;
 
+	// Set if the timer-based fallback is used instead of PMCs.
+	bool timerProfile = false;
+	std::atomic<uint64_t> profileFrequency{defaultProfileFrequency};
+
 	initgraph::Task initProfilingSinks{&globalInitEngine, "generic.init-profiling-sinks",
 		initgraph::Requires{getFibersAvailableStage(),
 			getIoChannelsDiscoveredStage()},
@@ -41,11 +45,13 @@ void initializeProfile() {
 	if(!wantKernelProfile)
 		return;
 
+	// Without PMC support (e.g., in most VMs), we fall back to sampling from the timer IRQ.
+	// Samples are then only taken while IRQs are enabled.
 	if(!(getGlobalCpuFeatures()->profileFlags & CpuFeatures::profileIntelSupported)
 			&& !(getGlobalCpuFeatures()->profileFlags & CpuFeatures::profileAmdSupported)) {
-		urgentLogger() << "thor: Kernel profiling was requested but"
-				" no hardware support is available" << frg::endlog;
-		return;
+		infoLogger() << "thor: No hardware support for kernel profiling,"
+				" falling back to timer-based sampling" << frg::endlog;
+		timerProfile = true;
 	}
 
 	void *profileMemory = kernelAlloc->allocate(1 << 20);
@@ -56,7 +62,22 @@ void initializeProfile() {
 		infoLogger() << "thor: Profiling on CPU " << getCpuData()->cpuIndex << frg::endlog;
 		getCpuData()->localProfileRing = frg::construct<SingleContextRecordRing>(*kernelAlloc);
 
-		if(getGlobalCpuFeatures()->profileFlags & CpuFeatures::profileIntelSupported) {
+		uint64_t tickInterval = 0;
+		auto updateTickInterval = [&] {
+			auto interval = 1'000'000'000 / profileFrequency.load(std::memory_order_relaxed);
+			if(interval == tickInterval)
+				return;
+			tickInterval = interval;
+
+			StatelessIrqLock irqLock;
+			setProfileTickInterval(tickInterval);
+		};
+
+		if(timerProfile) {
+			getCpuData()->profileMechanism.store(ProfileMechanism::timer,
+					std::memory_order_release);
+			updateTickInterval();
+		}else if(getGlobalCpuFeatures()->profileFlags & CpuFeatures::profileIntelSupported) {
 			initializeIntelPmc();
 			getCpuData()->profileMechanism.store(ProfileMechanism::intelPmc,
 					std::memory_order_release);
@@ -75,6 +96,9 @@ void initializeProfile() {
 					deqPtr, buffer, 128);
 			deqPtr = newPtr;
 			if(!success) {
+				// Changes of the frequency are picked up whenever the local ring is drained.
+				if(timerProfile)
+					updateTickInterval();
 				KernelFiber::asyncBlockCurrent(generalTimerEngine()->sleepFor(1'000'000));
 				continue;
 			}
@@ -90,6 +114,19 @@ void initializeProfile() {
 #endif
 }
 
+bool usingTimerProfile() {
+	return timerProfile;
+}
+
+uint64_t getProfileFrequency() {
+	return profileFrequency.load(std::memory_order_relaxed);
+}
+
+void setProfileFrequency(uint64_t frequency) {
+	assert(frequency && frequency <= maxProfileFrequency);
+	profileFrequency.store(frequency, std::memory_order_relaxed);
+}
+
 LogRingBuffer *getGlobalProfileRing() {
 	if(!globalProfileRing.valid())
 		return nullptr;
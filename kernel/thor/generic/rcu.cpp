@@ -1,6 +1,10 @@
 #include <async/algorithm.hpp>
 #include <thor-internal/cpu-data.hpp>
+#include <thor-internal/kernel-heap.hpp>
+#include <thor-internal/ostrace.hpp>
 #include <thor-internal/rcu.hpp>
+#include <thor-internal/schedule.hpp>
+#include <thor-internal/timer.hpp>
 #include <thor-internal/work-queue.hpp>
 
 namespace thor {
@@ -8,89 +12,202 @@ namespace thor {
 namespace {
 
 constexpr bool logRcuCalls = false;
+constexpr bool logGracePeriods = false;
+
+// Interval in which the grace period driver checks for quiescent states.
+constexpr uint64_t rcuPollInterval = 1'000'000;
+// Delay after which CPUs that did not report a quiescent state are forced through one.
+constexpr uint64_t rcuForceDelay = 10'000'000;
+// If a CPU accumulates this many callbacks, it expedites the next grace period
+// to bound the memory that is held by pending callbacks.
+constexpr size_t rcuBatchWatermark = 1024;
 
 frg::eternal<RcuEngine> rcuEngine;
 
+// Number of callbacks that are waiting for a grace period on all CPUs.
+size_t rcuBacklog();
+
 } // namespace
 
-// barrier() guarantees that we see at least one quiescent state on all CPUs before returning.
-// A quiescent state for this purpose is a point Q in the execution of CPU C such that:
+// A quiescent state for RcuEngine is a point Q in the execution of CPU C such that:
 // * Scheduling is enabled at Q.
 // * No memory accesses on C that preceeded Q and that executed while scheduling was disabled
-//   can be re-ordered with any memory accesses that follow barrier() on the current thread.
+//   can be re-ordered with any memory accesses that follow the end of the grace period.
 //
-// Note that to force a quiescent state, it is enough to force scheduling to a work queue
+// The scheduler reports a quiescent state whenever it (re-)schedules; in addition,
+// to force a quiescent state, it is enough to force scheduling to a work queue
 // of CPU C followed by an appropriate memory barrier.
+
+namespace {
+
+struct RcuCpuState {
+	// Incremented whenever the CPU goes through a quiescent state.
+	std::atomic<uint64_t> qsSeq{0};
+};
+
+} // namespace
+
+extern PerCpu<RcuCpuState> rcuCpuState;
+THOR_DEFINE_PERCPU(rcuCpuState);
+
+void reportRcuQuiescentState() {
+	auto &state = rcuCpuState.get();
+	auto seq = state.qsSeq.load(std::memory_order_relaxed);
+	state.qsSeq.store(seq + 1, std::memory_order_release);
+	// Pairs with the fence at the start of the grace period: either the driver observes
+	// the new qsSeq or read-side critical sections that follow see the updater's stores.
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
 coroutine<void> RcuEngine::barrier() {
-	// We are using states that consist of a sequence number and a busy bit in this
-	// implementation. We guarantee correctness through the following properties,
-	// where s is the sequence number at barrier() entry:
-	// * All CPUs will go through a quiescent state during the transition from state
-	//   ((s + 1) | stateBusy) to (s + 1).
-	// * At barrier() entry, we are not in ((s + 1) | stateBusy) yet.
-	// * We will only return from barrier() once we reach state (s + 1).
-	// Hence, it is guaranteed that each CPU goes through a quiescent state before we return.
-	//
-	// Note that we are either in state s or in (s | stateBusy) at barrier() entry,
-	// so there are two possible state transition paths to (s + 1):
-	//                    s => ((s + 1) | stateBusy) => (s + 1)
-	// (s | stateBusy) => s => ((s + 1) | stateBusy) => (s + 1)
+	co_await awaitGracePeriod(requestGracePeriod(true));
+}
 
-	auto current = state_.load(std::memory_order_relaxed);
-	auto s = current & stateSeq;
+uint64_t RcuEngine::requestGracePeriod(bool expedite) {
+	// Order the caller's updates before the load of startedGp_.
+	std::atomic_thread_fence(std::memory_order_seq_cst);
 
-	// If we are in (s | stateBusy), wait for the transition to s.
-	while (current == (s | stateBusy)) {
-		co_await seqEvent_.async_wait_if([&] {
-			current = state_.load(std::memory_order_relaxed);
-			return current == (s | stateBusy);
+	// If a grace period is in progress, it may have taken its snapshot of quiescent states
+	// before the caller's updates; hence, we need to wait for the next one.
+	auto gp = startedGp_.load(std::memory_order_relaxed) + 1;
+
+	auto raiseTo = [] (std::atomic<uint64_t> &var, uint64_t value) {
+		auto current = var.load(std::memory_order_relaxed);
+		while(current < value) {
+			if(var.compare_exchange_weak(current, value, std::memory_order_relaxed))
+				return true;
+		}
+		return false;
+	};
+
+	if(expedite)
+		raiseTo(expeditedGp_, gp);
+	if(raiseTo(requestedGp_, gp) || expedite)
+		requestEvent_.raise();
+	return gp;
+}
+
+coroutine<void> RcuEngine::awaitGracePeriod(uint64_t gp) {
+	co_await completionEvent_.async_wait_if([&] {
+		return completedGp_.load(std::memory_order_acquire) < gp;
+	});
+}
+
+void RcuEngine::run() {
+	runDriver_(enable_detached_coroutine{.wq = getCpuData()->generalWorkQueue});
+}
+
+void RcuEngine::runDriver_(enable_detached_coroutine) {
+	frg::vector<uint64_t, KernelAlloc> snapshot{*kernelAlloc};
+	frg::vector<bool, KernelAlloc> pending{*kernelAlloc};
+	frg::vector<bool, KernelAlloc> forced{*kernelAlloc};
+	snapshot.resize(getCpuCount());
+	pending.resize(getCpuCount());
+	forced.resize(getCpuCount());
+
+	while(true) {
+		co_await requestEvent_.async_wait_if([&] {
+			return requestedGp_.load(std::memory_order_relaxed)
+					<= completedGp_.load(std::memory_order_relaxed);
 		});
-	}
 
-	// We may need to initiate the transition from s to ((s + 1) | stateBusy) ourselves.
-	bool initiate = false;
-	if (current == s) {
-		initiate = state_.compare_exchange_strong(
-			current,
-			(s + 1) | stateBusy,
-			std::memory_order_relaxed,
-			std::memory_order_relaxed
-		);
-	}
-	if (initiate) {
-		transitionWg_.add(getCpuCount());
-		for (size_t c = 0; c < getCpuCount(); ++c) {
-			auto cpu = &cpuData.getFor(c);
-			// TODO: We can do this without allocation by putting the operations into a member vector.
-			spawnOnWorkQueue(
-				Allocator{},
-				cpu->generalWorkQueue,
-				async::invocable([this] {
-					// Perform an explicit fence here since WorkQueue::schedule() may not be strong enough
-					// (e.g., when scheduling to the current thread's WQ).
-					// It may be possible to weaken the barrier here by specifying
-					// the guarantees that WorkQueue::schedule() should provide.
-					std::atomic_thread_fence(std::memory_order_seq_cst);
-					transitionWg_.done();
-				})
-			);
+		auto gp = completedGp_.load(std::memory_order_relaxed) + 1;
+		auto startClock = getClockNanos();
+		startedGp_.store(gp, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+
+		for(size_t c = 0; c < getCpuCount(); ++c) {
+			snapshot[c] = rcuCpuState.getFor(c).qsSeq.load(std::memory_order_acquire);
+			pending[c] = true;
+		}
+		size_t numPending = getCpuCount();
+
+		// Idle CPUs do not reschedule by themselves. Note that we cannot treat them as
+		// quiescent since IRQ handlers (e.g., of shootdown IPIs) may be in read-side
+		// critical sections. Waking them up is cheap, so force them right away.
+		size_t numForced = 0;
+		for(size_t c = 0; c < getCpuCount(); ++c) {
+			forced[c] = localScheduler.get(getCpuData(c)).isIdle();
+			if(forced[c]) {
+				pending[c] = false;
+				--numPending;
+				++numForced;
+			}
 		}
-		co_await transitionWg_.wait();
+		if(numForced)
+			co_await forceQuiescentStates_(forced.data());
+
+		uint64_t waited = 0;
+		while(numPending) {
+			if(expeditedGp_.load(std::memory_order_relaxed) >= gp || waited >= rcuForceDelay) {
+				numForced += numPending;
+				co_await forceQuiescentStates_(pending.data());
+				break;
+			}
 
-		state_.store(s + 1, std::memory_order_relaxed);
-		seqEvent_.raise();
-	} else {
-		assert((current & stateSeq) > s);
+			co_await generalTimerEngine()->sleepFor(rcuPollInterval);
+			waited += rcuPollInterval;
 
-		// If another CPU initiated ((s + 1) | stateBusy), wait for transition out of it.
-		while (current == ((s + 1) | stateBusy)) {
-			co_await seqEvent_.async_wait_if([&] {
-				current = state_.load(std::memory_order_relaxed);
-				return current == ((s + 1) | stateBusy);
-			});
+			// We resumed from a work queue, hence our current CPU went through a quiescent state.
+			auto self = getCpuData()->cpuIndex;
+			if(pending[self]) {
+				pending[self] = false;
+				--numPending;
+			}
+			for(size_t c = 0; c < getCpuCount(); ++c) {
+				if(!pending[c])
+					continue;
+				auto seq = rcuCpuState.getFor(c).qsSeq.load(std::memory_order_acquire);
+				if(seq != snapshot[c]) {
+					pending[c] = false;
+					--numPending;
+				}
+			}
 		}
-		assert(current == s + 1 || (current & stateSeq) > s + 1);
+
+		completedGp_.store(gp, std::memory_order_release);
+		completionEvent_.raise();
+
+		if(ostrace::available.load(std::memory_order_relaxed)) {
+			ostrace::emit(ostEvtRcuGracePeriod,
+					ostAttrRcuLatency(getClockNanos() - startClock),
+					ostAttrRcuBacklog(rcuBacklog()),
+					ostAttrRcuForcedCpus(numForced));
+		}
+		if(logGracePeriods)
+			infoLogger() << "thor: RCU grace period " << gp << " took "
+					<< (getClockNanos() - startClock) / 1000 << " us, "
+					<< numForced << " CPUs forced" << frg::endlog;
+	}
+}
+
+coroutine<void> RcuEngine::forceQuiescentStates_(bool *pending) {
+	size_t n = 0;
+	for (size_t c = 0; c < getCpuCount(); ++c) {
+		if (pending[c])
+			++n;
 	}
+
+	transitionWg_.add(n);
+	for (size_t c = 0; c < getCpuCount(); ++c) {
+		if (!pending[c])
+			continue;
+		auto cpu = &cpuData.getFor(c);
+		// TODO: We can do this without allocation by putting the operations into a member vector.
+		spawnOnWorkQueue(
+			Allocator{},
+			cpu->generalWorkQueue,
+			async::invocable([this] {
+				// Perform an explicit fence here since WorkQueue::schedule() may not be strong enough
+				// (e.g., when scheduling to the current thread's WQ).
+				// It may be possible to weaken the barrier here by specifying
+				// the guarantees that WorkQueue::schedule() should provide.
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+				transitionWg_.done();
+			})
+		);
+	}
+	co_await transitionWg_.wait();
 }
 
 coroutine<void> LocalRcuEngine::barrier() {
@@ -160,8 +277,11 @@ coroutine<void> LocalRcuEngine::barrier() {
 	}
 }
 
-// Allows the registration of callbacks that run after an RCU barrier.
+// Allows the registration of callbacks that run after an RCU grace period.
 // This is per-CPU. The calls run on the CPU's generalWorkQueue.
+// Callbacks are kept in two segments: callbacks that wait for the grace period
+// waitGp_ and callbacks that were submitted afterwards (and that will be batched
+// into the next grace period).
 struct RcuDispatcher {
 	RcuDispatcher(CpuData *cpu)
 	: cpu_{cpu} { }
@@ -170,17 +290,31 @@ struct RcuDispatcher {
 		runLoop_(enable_detached_coroutine{.wq = cpu_->generalWorkQueue});
 	}
 
-	void submit(RcuCallable *callable, void (*call)(RcuCallable *)) {
+	void submit(RcuCallable *callable, void (*call)(RcuCallable *), bool expedite) {
 		callable->call_ = call;
 
 		bool wasEmpty;
 		{
 			auto lock = frg::guard(&mutex_);
-			wasEmpty = queue_.empty();
-			queue_.push_back(callable);
+			wasEmpty = nextSegment_.empty();
+			nextSegment_.push_back(callable);
+			++numNext_;
+			if (numNext_ == rcuBatchWatermark)
+				expedite = true;
+			if (expedite)
+				expediteNext_ = true;
 		}
+		backlog_.fetch_add(1, std::memory_order_relaxed);
 		if (wasEmpty)
 			pendingEvent_.raise();
+		// This also expedites the grace period that runLoop_() currently waits for
+		// (if any) since requestGracePeriod() never returns smaller numbers.
+		if (expedite)
+			rcuEngine->requestGracePeriod(true);
+	}
+
+	size_t backlog() {
+		return backlog_.load(std::memory_order_relaxed);
 	}
 
 private:
@@ -197,25 +331,31 @@ private:
 		while(true) {
 			co_await pendingEvent_.async_wait_if([&] {
 				auto lock = frg::guard(&mutex_);
-				return queue_.empty();
+				return nextSegment_.empty();
 			});
 
-			CallableList collected;
+			bool expedite;
 			{
 				auto lock = frg::guard(&mutex_);
-				collected.splice(collected.end(), queue_);
+				waitSegment_.splice(waitSegment_.end(), nextSegment_);
+				numNext_ = 0;
+				expedite = expediteNext_;
+				expediteNext_ = false;
 			}
-			if (collected.empty())
+			if (waitSegment_.empty())
 				continue;
 
-			co_await rcuEngine->barrier();
+			// Callbacks that are submitted while we wait are batched into the next grace period.
+			waitGp_ = rcuEngine->requestGracePeriod(expedite);
+			co_await rcuEngine->awaitGracePeriod(waitGp_);
 
 			size_t n = 0;
-			while (!collected.empty()) {
-				auto callable = collected.pop_front();
+			while (!waitSegment_.empty()) {
+				auto callable = waitSegment_.pop_front();
 				callable->call_(callable);
 				++n;
 			}
+			backlog_.fetch_sub(n, std::memory_order_relaxed);
 			if (logRcuCalls)
 				infoLogger() << "thor: " << n << " RCU calls on CPU " << cpu_->cpuIndex << frg::endlog;
 		}
@@ -223,7 +363,14 @@ private:
 
 	CpuData *cpu_;
 	IrqSpinlock mutex_;
-	CallableList queue_;
+	// Protected by mutex_.
+	CallableList nextSegment_;
+	size_t numNext_{0};
+	bool expediteNext_{false};
+	// Only accessed by runLoop_().
+	CallableList waitSegment_;
+	uint64_t waitGp_{0};
+	std::atomic<size_t> backlog_{0};
 	async::recurring_event pendingEvent_;
 };
 
@@ -231,12 +378,30 @@ private:
 extern PerCpu<RcuDispatcher> rcuDispatcher;
 THOR_DEFINE_PERCPU(rcuDispatcher);
 
+namespace {
+
+size_t rcuBacklog() {
+	size_t n = 0;
+	for (size_t c = 0; c < getCpuCount(); ++c)
+		n += rcuDispatcher.get(getCpuData(c)).backlog();
+	return n;
+}
+
+} // namespace
+
 void setRcuOnline(CpuData *cpu) {
+	// The grace period driver runs on the boot CPU.
+	if (!cpu->cpuIndex)
+		rcuEngine->run();
 	rcuDispatcher.get(cpu).run();
 }
 
 void submitRcu(RcuCallable *callable, void (*call)(RcuCallable *)) {
-	rcuDispatcher.get().submit(callable, call);
+	rcuDispatcher.get().submit(callable, call, false);
+}
+
+void submitRcuExpedited(RcuCallable *callable, void (*call)(RcuCallable *)) {
+	rcuDispatcher.get().submit(callable, call, true);
 }
 
 } // namespace thor
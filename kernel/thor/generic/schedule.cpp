@@ -4,6 +4,8 @@
 #include <thor-internal/arch-generic/ints.hpp>
 #include <thor-internal/cpu-data.hpp>
 #include <thor-internal/debug.hpp>
+#include <thor-internal/load-balancing.hpp>
+#include <thor-internal/rcu.hpp>
 #include <thor-internal/schedule.hpp>
 #include <thor-internal/thread.hpp>
 #include <thor-internal/timer.hpp>
@@ -21,6 +23,25 @@ namespace {
 	// Minimum length of a preemption time slice in ns.
 	constexpr int64_t sliceGranularity = 10'000'000;
 
+	// Length of the time slices of round robin entities in ns.
+	constexpr uint64_t roundRobinSlice = 100'000'000;
+
+	// Minimum runtime of deadline entities in ns.
+	constexpr uint64_t minDeadlineRuntime = 10'000;
+
+	// Bandwidths are fixed point numbers with bandwidthShift fractional bits.
+	constexpr int bandwidthShift = 20;
+	// Maximal bandwidth that deadline entities can reserve per CPU.
+	// The remaining CPU time is left to real-time and fair entities.
+	// Since EDF is only feasible if no CPU is overcommitted, this limit applies to each CPU
+	// individually and deadline entities do not migrate between CPUs.
+	constexpr uint64_t maxDeadlineBandwidth = (UINT64_C(95) << bandwidthShift) / 100;
+
+	// Start of the next period of a deadline entity.
+	uint64_t nextPeriodStart(uint64_t deadline, const SchedulingParameters &params) {
+		return deadline - params.deadline + params.period;
+	}
+
 	struct IdleTask final : ScheduleEntity {
 		IdleTask()
 		: ScheduleEntity{ScheduleType::idle} { }
@@ -31,6 +52,9 @@ namespace {
 					infoLogger() << "System is idle" << frg::endlog;
 				// Restore IPL (as in restoreExecutor() for threads/fibers).
 				iplLeaveContext(IplState{.context = ipl::passive, .current = ipl::exceptional});
+				// Instead of waiting for the next round of load balancing,
+				// try to pull work from other CPUs immediately.
+				LoadBalancer::singleton().stealWork(getCpuData());
 				suspendSelf();
 				__builtin_trap();
 			}, getCpuData()->idleStack.base());
@@ -71,12 +95,24 @@ namespace {
 int ScheduleEntity::orderPriority(const ScheduleEntity *a, const ScheduleEntity *b) {
 	assert(a->type() == ScheduleType::regular);
 	assert(b->type() == ScheduleType::regular);
+	if(auto rank = b->_classRank() - a->_classRank(); rank)
+		return rank; // Prefer higher scheduling classes.
 	return b->priority - a->priority; // Prefer larger priority.
 }
 
 bool ScheduleEntity::scheduleBefore(const ScheduleEntity *a, const ScheduleEntity *b) {
 	assert(a->type() == ScheduleType::regular);
 	assert(b->type() == ScheduleType::regular);
+	assert(a->_classRank() == b->_classRank());
+	switch(a->_params.policy) {
+	case SchedulingPolicy::deadline:
+		return a->_dlDeadline < b->_dlDeadline; // Prefer earlier deadlines.
+	case SchedulingPolicy::fifo:
+	case SchedulingPolicy::roundRobin:
+		return a->_rtSequence < b->_rtSequence; // Prefer entities that were enqueued first.
+	case SchedulingPolicy::fair:
+		break;
+	}
 	return a->baseUnfairness - a->refProgress
 			> b->baseUnfairness - b->refProgress; // Prefer greater unfairness.
 }
@@ -87,6 +123,30 @@ ScheduleEntity::ScheduleEntity(ScheduleType type)
 
 ScheduleEntity::~ScheduleEntity() {
 	assert(state == ScheduleState::null);
+
+	if(_reservedScheduler)
+		_reservedScheduler->_deadlineBandwidth.fetch_sub(_reservedBandwidth,
+				std::memory_order_relaxed);
+}
+
+SchedulingParameters ScheduleEntity::schedulingParameters() {
+	auto irqLock = frg::guard(&irqMutex());
+	auto lock = frg::guard(&_paramsMutex);
+
+	return _requestedParams;
+}
+
+int ScheduleEntity::_classRank() const {
+	switch(_params.policy) {
+	case SchedulingPolicy::fair:
+		return 0;
+	case SchedulingPolicy::fifo:
+	case SchedulingPolicy::roundRobin:
+		return 1;
+	case SchedulingPolicy::deadline:
+		return 2;
+	}
+	__builtin_unreachable();
 }
 
 void Scheduler::associate(ScheduleEntity *entity, Scheduler *scheduler) {
@@ -94,7 +154,10 @@ void Scheduler::associate(ScheduleEntity *entity, Scheduler *scheduler) {
 
 //	infoLogger() << "associate " << entity << frg::endlog;
 	assert(entity->state == ScheduleState::null);
+	if(entity->_lastScheduler && entity->_lastScheduler != scheduler)
+		entity->_migrations++;
 	entity->_scheduler = scheduler;
+	entity->_lastScheduler = scheduler;
 	entity->state = ScheduleState::attached;
 }
 
@@ -124,7 +187,90 @@ void Scheduler::setPriority(ScheduleEntity *entity, int priority) {
 	// Otherwise, we would have to remove-reinsert into the queue.
 	assert(entity == self->_current);
 
-	entity->priority = priority;
+	if(entity->_params.policy == SchedulingPolicy::fair) {
+		entity->priority = priority;
+		entity->_params.priority = priority;
+	}
+
+	auto lock = frg::guard(&entity->_paramsMutex);
+	entity->_fairPriority = priority;
+	if(entity->_requestedParams.policy == SchedulingPolicy::fair)
+		entity->_requestedParams.priority = priority;
+}
+
+Error Scheduler::setParameters(ScheduleEntity *entity, const SchedulingParameters &params,
+		Scheduler *target) {
+	assert(entity->type() == ScheduleType::regular);
+
+	auto effectiveParams = params;
+	uint64_t bandwidth = 0;
+	switch(params.policy) {
+	case SchedulingPolicy::fair:
+		break;
+	case SchedulingPolicy::fifo:
+	case SchedulingPolicy::roundRobin:
+		if(params.priority < minRealTimePriority || params.priority > maxRealTimePriority)
+			return Error::illegalArgs;
+		break;
+	case SchedulingPolicy::deadline:
+		// Like Linux, we use the relative deadline as period if no period is given.
+		if(!effectiveParams.period)
+			effectiveParams.period = params.deadline;
+		if(params.runtime < minDeadlineRuntime
+				|| params.runtime > params.deadline
+				|| params.deadline > effectiveParams.period)
+			return Error::illegalArgs;
+		effectiveParams.priority = 0;
+		bandwidth = (static_cast<unsigned __int128>(params.runtime) << bandwidthShift)
+				/ effectiveParams.period;
+		break;
+	}
+
+	Scheduler *self;
+	{
+		auto irqLock = frg::guard(&irqMutex());
+		auto lock = frg::guard(&entity->_paramsMutex);
+
+		// Like Linux' nice value, the fair priority survives changes of the policy.
+		if(params.policy == SchedulingPolicy::fair)
+			effectiveParams.priority = entity->_fairPriority;
+
+		// Admission control. Bandwidth that is already reserved on the target CPU is reused;
+		// note that we do not need to re-check if the entity's bandwidth does not increase.
+		auto oldScheduler = entity->_reservedScheduler;
+		auto oldBandwidth = entity->_reservedBandwidth;
+		uint64_t reused = (oldScheduler == target) ? oldBandwidth : 0;
+		if(bandwidth > reused) {
+			assert(target);
+			auto total = target->_deadlineBandwidth.load(std::memory_order_relaxed);
+			do {
+				if(total - reused + bandwidth > maxDeadlineBandwidth)
+					return Error::illegalState;
+			} while(!target->_deadlineBandwidth.compare_exchange_weak(total,
+					total - reused + bandwidth, std::memory_order_relaxed));
+		}else if(bandwidth < reused) {
+			target->_deadlineBandwidth.fetch_sub(reused - bandwidth, std::memory_order_relaxed);
+		}
+		if(oldScheduler && oldScheduler != target)
+			oldScheduler->_deadlineBandwidth.fetch_sub(oldBandwidth, std::memory_order_relaxed);
+		entity->_reservedBandwidth = bandwidth;
+		entity->_reservedScheduler = bandwidth ? target : nullptr;
+
+		entity->_requestedParams = effectiveParams;
+		entity->_paramsChanged.store(true, std::memory_order_release);
+		self = entity->_scheduler;
+	}
+
+	// Make sure that the entity's scheduler re-evaluates its current entity.
+	// This applies the new parameters immediately if the entity is running.
+	if(self) {
+		if(self == &localScheduler.get()) {
+			self->_mustCallPreemption = true;
+		}else{
+			sendPingIpi(self->_cpuContext);
+		}
+	}
+	return Error::success;
 }
 
 void Scheduler::resume(ScheduleEntity *entity) {
@@ -146,6 +292,7 @@ void Scheduler::resume(ScheduleEntity *entity) {
 		wasEmpty = self->_pendingList.empty();
 		self->_pendingList.push_back(entity);
 	}
+	self->_idle.store(false, std::memory_order_relaxed);
 
 	if(wasEmpty) {
 		if(self == &localScheduler.get()) {
@@ -179,6 +326,7 @@ void Scheduler::suspendCurrent() {
 	// Update the unfairness on suspend.
 	self->_updateEntityStats(entity);
 	entity->state = ScheduleState::attached;
+	entity->_voluntarySwitches++;
 
 	self->_current = nullptr;
 }
@@ -209,6 +357,17 @@ int64_t Scheduler::_liveRuntime(const ScheduleEntity *entity) {
 	}
 }
 
+int64_t Scheduler::_liveBudget(const ScheduleEntity *entity) {
+	assert(entity->type() == ScheduleType::regular);
+	assert(entity->_params.policy == SchedulingPolicy::deadline);
+
+	if(entity == _current) {
+		return entity->_dlBudget - static_cast<int64_t>(_refClock - entity->_refClock);
+	}else{
+		return entity->_dlBudget;
+	}
+}
+
 void Scheduler::suppressRenewalUntilInterrupt() {
 	if (getPreemptionDeadline())
 		_mustCallPreemption = false;
@@ -236,6 +395,10 @@ void Scheduler::updateState() {
 	auto now = getClockNanos();
 	auto deltaTime = now - _refClock;
 	_refClock = now;
+
+	auto &timeCounter = (_current->type() == ScheduleType::idle) ? _idleTime : _busyTime;
+	timeCounter.store(timeCounter.load(std::memory_order_relaxed) + deltaTime,
+			std::memory_order_relaxed);
 	if(n)
 		_systemProgress += deltaTime * static_cast<Progress>(fixedInverse(n));
 
@@ -267,16 +430,27 @@ void Scheduler::updateQueue() {
 		entity->_refClock = _refClock;
 		entity->state = ScheduleState::active;
 
-		_waitQueue.push(entity);
-		_numWaiting++;
+		_enqueue(entity, EnqueueReason::wakeup);
 	}
+	_releaseThrottled();
+	_publishState();
 }
 
 bool Scheduler::maybeReschedule() {
 	assert(!intsAreEnabled());
 	assert(_current);
 
-	auto wantToSchedule = [this] () -> bool {
+	auto reason = EnqueueReason::requeue;
+	auto wantToSchedule = [this, &reason] () -> bool {
+		// Re-insert entities whose parameters changed and entities that exhausted their budget
+		// (such that they are throttled), even if there are no other entities.
+		if(_current->type() == ScheduleType::regular) {
+			if(_current->_paramsChanged.load(std::memory_order_relaxed))
+				return true;
+			if(_current->_params.policy == SchedulingPolicy::deadline && _liveBudget(_current) <= 0)
+				return true;
+		}
+
 		// If there are no waiters, we keep the current entity.
 		// Otherwise, if the current entity is not active anymore, we always switch.
 		if(_waitQueue.empty())
@@ -287,13 +461,29 @@ bool Scheduler::maybeReschedule() {
 		assert(_current->type() == ScheduleType::regular);
 		assert(_current->state == ScheduleState::active);
 
-		// Switch based on entity priority.
+		// Switch based on scheduling class and entity priority.
 		if(auto po = ScheduleEntity::orderPriority(_current, _waitQueue.top()); po > 0) {
+			reason = EnqueueReason::preemption;
 			return true;
 		}else if(po < 0) {
 			return false;
 		}
 
+		switch(_current->_params.policy) {
+		case SchedulingPolicy::fifo:
+			return false;
+		case SchedulingPolicy::roundRobin:
+			return _refClock - _sliceClock >= roundRobinSlice;
+		case SchedulingPolicy::deadline:
+			if(_waitQueue.top()->_dlDeadline < _current->_dlDeadline) {
+				reason = EnqueueReason::preemption;
+				return true;
+			}
+			return false;
+		case SchedulingPolicy::fair:
+			break;
+		}
+
 		// Switch based on unfairness.
 		auto diff = _liveUnfairness(_current)
 				+ (static_cast<Progress>(sliceGranularity) << progressShift)
@@ -304,7 +494,7 @@ bool Scheduler::maybeReschedule() {
 	if(!wantToSchedule())
 		return false;
 
-	_unschedule();
+	_unschedule(reason);
 	_schedule();
 	return true;
 }
@@ -313,7 +503,7 @@ void Scheduler::forceReschedule() {
 	assert(!intsAreEnabled());
 
 	if(_current)
-		_unschedule();
+		_unschedule(EnqueueReason::requeue);
 	_schedule();
 }
 
@@ -324,10 +514,15 @@ void Scheduler::forceReschedule() {
 	_current = _scheduled;
 	_scheduled = nullptr;
 	_sliceClock = _refClock;
+	_contextSwitches.store(_contextSwitches.load(std::memory_order_relaxed) + 1,
+			std::memory_order_relaxed);
 	_mustCallPreemption = false;
+	_publishState();
 
-	if(!getPreemptionDeadline())
-		_updatePreemption();
+	// We only reschedule at points where scheduling is enabled.
+	reportRcuQuiescentState();
+
+	_updatePreemption();
 
 	currentRunnable()->invoke();
 }
@@ -335,8 +530,9 @@ void Scheduler::forceReschedule() {
 void Scheduler::renewSchedule() {
 	_mustCallPreemption = false;
 
-	if(!getPreemptionDeadline())
-		_updatePreemption();
+	reportRcuQuiescentState();
+
+	_updatePreemption();
 }
 
 ScheduleEntity *Scheduler::currentRunnable() {
@@ -344,19 +540,107 @@ ScheduleEntity *Scheduler::currentRunnable() {
 	return _current;
 }
 
-void Scheduler::_unschedule() {
+void Scheduler::_unschedule(EnqueueReason reason) {
 	assert(_current);
 
 	// Decrease the unfairness at the end of the time slice.
 	_updateEntityStats(_current);
 
-	if(_current->type() == ScheduleType::regular
-			|| _current->state == ScheduleState::active) {
-		_waitQueue.push(_current);
-		_numWaiting++;
+	auto entity = _current;
+	_current = nullptr;
+	if(entity->type() == ScheduleType::regular)
+		entity->_involuntarySwitches++;
+	if(entity->type() == ScheduleType::regular
+			|| entity->state == ScheduleState::active)
+		_enqueue(entity, reason);
+}
+
+void Scheduler::_enqueue(ScheduleEntity *entity, EnqueueReason reason) {
+	assert(entity->type() == ScheduleType::regular);
+	assert(entity->state == ScheduleState::active);
+	assert(entity != _current);
+
+	_applyParameters(entity);
+
+	auto &params = entity->_params;
+	switch(params.policy) {
+	case SchedulingPolicy::fair:
+		break;
+	case SchedulingPolicy::fifo:
+	case SchedulingPolicy::roundRobin:
+		// As required by POSIX, preempted entities stay at the head of their priority level.
+		if(reason == EnqueueReason::preemption) {
+			entity->_rtSequence = --_rtHeadSequence;
+		}else{
+			entity->_rtSequence = ++_rtTailSequence;
+		}
+		break;
+	case SchedulingPolicy::deadline:
+		// CBS wakeup rule: start a new period if the remaining budget cannot be consumed
+		// until the deadline without exceeding the entity's bandwidth.
+		if(reason == EnqueueReason::wakeup
+				&& (_refClock >= entity->_dlDeadline
+					|| static_cast<__int128>(entity->_dlBudget) * params.period
+						> static_cast<__int128>(entity->_dlDeadline - _refClock) * params.runtime)) {
+			entity->_dlDeadline = _refClock + params.deadline;
+			entity->_dlBudget = params.runtime;
+		}
+
+		if(entity->_dlBudget <= 0) {
+			auto release = nextPeriodStart(entity->_dlDeadline, params);
+			if(release > _refClock) {
+				// Throttle the entity until its next period starts.
+				auto it = _throttledList.begin();
+				while(it != _throttledList.end()
+						&& nextPeriodStart((*it)->_dlDeadline, (*it)->_params) <= release)
+					++it;
+				_throttledList.insert(it, entity);
+				return;
+			}
+
+			entity->_dlDeadline = _refClock + params.deadline;
+			entity->_dlBudget = params.runtime;
+		}
+		break;
 	}
 
-	_current = nullptr;
+	_waitQueue.push(entity);
+	_numWaiting++;
+}
+
+void Scheduler::_applyParameters(ScheduleEntity *entity) {
+	if(!entity->_paramsChanged.load(std::memory_order_acquire))
+		return;
+
+	auto irqLock = frg::guard(&irqMutex());
+	auto lock = frg::guard(&entity->_paramsMutex);
+
+	entity->_paramsChanged.store(false, std::memory_order_relaxed);
+	entity->_params = entity->_requestedParams;
+	entity->priority = entity->_params.priority;
+	if(entity->_params.policy == SchedulingPolicy::deadline) {
+		// Start a new period.
+		entity->_dlDeadline = _refClock + entity->_params.deadline;
+		entity->_dlBudget = entity->_params.runtime;
+	}
+}
+
+// Move throttled entities whose next period started to the waiting queue.
+void Scheduler::_releaseThrottled() {
+	while(!_throttledList.empty()) {
+		auto entity = _throttledList.front();
+		auto release = nextPeriodStart(entity->_dlDeadline, entity->_params);
+		if(release > _refClock)
+			break;
+		_throttledList.pop_front();
+
+		// Replenish the budget.
+		entity->_dlDeadline = release + entity->_params.deadline;
+		entity->_dlBudget = entity->_params.runtime;
+		// Throttling does not count as waiting time.
+		entity->_refClock = _refClock;
+		_enqueue(entity, EnqueueReason::requeue);
+	}
 }
 
 void Scheduler::_schedule() {
@@ -378,6 +662,7 @@ void Scheduler::_schedule() {
 	assert(entity->state == ScheduleState::active);
 	_updateWaitingEntity(entity);
 	_updateEntityStats(entity);
+	entity->_timeslices++;
 
 	if(logScheduling) {
 //		infoLogger() << "System progress: " << progressToNanos(_systemProgress) / (1000 * 1000)
@@ -396,29 +681,53 @@ void Scheduler::_schedule() {
 	_scheduled = entity;
 }
 
-// Returns true if preemption should be done immediately.
 void Scheduler::_updatePreemption() {
 	if(disablePreemption)
 		return;
 
-	// Disable preemption if there are no other threads.
-	if(_waitQueue.empty())
-		return;
+	// Note that we never postpone a preemption deadline that is already set.
+	auto currentDeadline = getPreemptionDeadline();
+	frg::optional<uint64_t> deadline;
+	auto consider = [&] (uint64_t candidate) {
+		if(!deadline || candidate < *deadline)
+			deadline = candidate;
+	};
+
+	// Wake up when the next throttled entity becomes runnable again.
+	if(!_throttledList.empty()) {
+		auto entity = _throttledList.front();
+		consider(nextPeriodStart(entity->_dlDeadline, entity->_params));
+	}
 
-	// If there was no current entity, we would have rescheduled.
 	assert(_current);
-	assert(_current->type() == ScheduleType::regular);
-	assert(_current->state == ScheduleState::active);
+	if(_current->type() == ScheduleType::regular) {
+		assert(_current->state == ScheduleState::active);
 
-	if(auto po = ScheduleEntity::orderPriority(_current, _waitQueue.top()); po < 0) {
-		// Disable preemption if we have higher priority.
-		return;
-	}else{
 		// If there was an entity with higher priority, we would have rescheduled.
-		assert(!po);
+		// Otherwise, we only need to preempt in favor of entities of the same priority.
+		bool havePeers = !_waitQueue.empty()
+				&& !ScheduleEntity::orderPriority(_current, _waitQueue.top());
+		switch(_current->_params.policy) {
+		case SchedulingPolicy::deadline:
+			// Preempt deadline entities when their budget is exhausted.
+			consider(_refClock + frg::max(_liveBudget(_current), int64_t{0}));
+			break;
+		case SchedulingPolicy::roundRobin:
+			if(havePeers)
+				consider(_sliceClock + roundRobinSlice);
+			break;
+		case SchedulingPolicy::fifo:
+			break;
+		case SchedulingPolicy::fair:
+			// Time slices only start if there is no deadline yet.
+			if(havePeers && !currentDeadline)
+				consider(getClockNanos() + sliceGranularity);
+			break;
+		}
 	}
 
-	setPreemptionDeadline(getClockNanos() + sliceGranularity);
+	if(deadline && (!currentDeadline || *deadline < *currentDeadline))
+		setPreemptionDeadline(*deadline);
 }
 
 void Scheduler::_updateCurrentEntity() {
@@ -456,11 +765,35 @@ void Scheduler::_updateEntityStats(ScheduleEntity *entity) {
 	assert(entity->state == ScheduleState::active
 			|| entity == _current);
 
-	if(entity == _current)
+	if(entity == _current) {
 		entity->_runTime += _refClock - entity->_refClock;
+		if(entity->_params.policy == SchedulingPolicy::deadline)
+			entity->_dlBudget -= static_cast<int64_t>(_refClock - entity->_refClock);
+	}else{
+		// The entity waited in the run queue since its reference clock was last updated.
+		entity->_waitTime += _refClock - entity->_refClock;
+	}
 	entity->_refClock = _refClock;
 }
 
+void Scheduler::_publishState() {
+	size_t n = _numWaiting;
+	if(_current && _current->type() == ScheduleType::regular)
+		n++;
+	_numRunnable.store(n, std::memory_order_relaxed);
+
+	// Note that resume() clears _idle after adding to _pendingList,
+	// hence we only ever set _idle if the pending list is empty.
+	if(_current && _current->type() == ScheduleType::idle && !_numWaiting) {
+		auto irqLock = frg::guard(&irqMutex());
+		auto lock = frg::guard(&_mutex);
+		if(_pendingList.empty())
+			_idle.store(true, std::memory_order_relaxed);
+	}else{
+		_idle.store(false, std::memory_order_relaxed);
+	}
+}
+
 namespace {
 
 template<typename ImageAccessor>
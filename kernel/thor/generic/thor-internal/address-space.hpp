@@ -9,6 +9,7 @@
 #include <async/recurring-event.hpp>
 #include <frg/container_of.hpp>
 #include <frg/expected.hpp>
+#include <frg/span.hpp>
 #include <thor-internal/coroutine.hpp>
 #include <thor-internal/memory-view.hpp>
 #include <thor-internal/mm-rc.hpp>
@@ -40,6 +41,7 @@ private:
 };
 
 struct VirtualSpace;
+struct MemoryViewLockHandle;
 
 struct PagesAffected {
 	ptrdiff_t rssIncrease{0};
@@ -660,6 +662,15 @@ public:
 		);
 	}
 
+	// Locks up to physicals.size() (readable) pages starting at the given page-aligned
+	// address and makes them available. The range is truncated at the end of the mapping.
+	// Stores the physical addresses of the pages in physicals and returns their number.
+	// On success, the pages stay resident until lockHandle is released.
+	// This allows other address spaces to access the pages without copying them first.
+	coroutine<frg::expected<Error, size_t>>
+	pinRange(uintptr_t address, frg::span<PhysicalAddr> physicals,
+			MemoryViewLockHandle &lockHandle);
+
 	// ----------------------------------------------------------------------------------
 	// GlobalFutex support.
 	// ----------------------------------------------------------------------------------
@@ -946,6 +957,15 @@ private:
 	bool _active = false;
 };
 
+// Locks up to physicals.size() pages starting at the given page-aligned offset of
+// a memory object and makes them available. Stores the physical addresses of the pages
+// in physicals and returns their number; the range is truncated before the first page
+// that cannot be accessed through the direct physical mapping.
+// On success, the pages stay resident until lockHandle is released.
+coroutine<frg::expected<Error, size_t>>
+pinViewRange(smarter::shared_ptr<MemoryView> view, uintptr_t offset, FetchFlags fetchFlags,
+		frg::span<PhysicalAddr> physicals, MemoryViewLockHandle &lockHandle);
+
 struct NamedMemoryViewLock {
 private:
 	struct CtorToken {};
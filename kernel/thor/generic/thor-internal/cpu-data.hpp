@@ -22,7 +22,9 @@ struct WorkQueue;
 enum class ProfileMechanism {
 	none,
 	intelPmc,
-	amdPmc
+	amdPmc,
+	// Samples are taken from the timer IRQ.
+	timer
 };
 
 // "Interrupt priority level". This is our version of the IRQL that the NT kernel uses.
@@ -68,6 +70,19 @@ struct IplState {
 	Ipl current{ipl::passive};
 };
 
+// Position of a CPU in the system's topology.
+// IDs are only compared for equality; they are not necessarily contiguous.
+struct CpuTopology {
+	uint32_t packageId{0};
+	// Unique within the package. SMT siblings have the same coreId.
+	uint32_t coreId{0};
+	// Unique within the core.
+	uint32_t threadId{0};
+	// CPUs that share the last level cache have the same llcId.
+	uint32_t llcId{0};
+	uint32_t numaNode{0};
+};
+
 struct alignas(8) IntState {
 	std::atomic<unsigned int> nesting{0};
 	Ipl outerIpl{ipl::bad};
@@ -91,6 +106,8 @@ struct CpuData : public PlatformCpuData {
 	bool haveVirtualization;
 
 	int cpuIndex;
+	// Filled in by architecture specific code during initializeThisProcessor().
+	CpuTopology topology;
 
 	ExecutorContext *executorContext{nullptr};
 	smarter::borrowed_ptr<Thread> activeThread;
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <atomic>
 #include <concepts>
 #include <expected>
 
@@ -153,6 +154,22 @@ constexpr IrqStrategy endOfService = IrqStrategy{1} << 9;
 
 } // namespace irq_strategy
 
+// Per-CPU IRQ statistics of an IrqPin.
+// Each instance is only written by its own CPU, hence no atomic RMW operations are needed.
+struct IrqCpuStatistics {
+	void increment(std::atomic<uint64_t> &counter, uint64_t n = 1) {
+		counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+	}
+
+	std::atomic<uint64_t> raises{0};
+	// Time spent in the kernel's IRQ handler.
+	std::atomic<uint64_t> raiseNanos{0};
+	// IRQs that were acked synchronously (e.g., by a kernlet).
+	std::atomic<uint64_t> synchronousAcks{0};
+	// IRQs that were dispatched to userspace.
+	std::atomic<uint64_t> asynchronousDispatches{0};
+};
+
 // Represents a (not necessarily physical) "pin" of an interrupt controller.
 // This class handles the IRQ configuration and acknowledgement.
 struct IrqPin {
@@ -182,11 +199,27 @@ public:
 		return _hash;
 	}
 
+	// Unique ID of the pin, see getIrqPin().
+	uint64_t id() const {
+		return _id;
+	}
+
+	bool isConfigured() {
+		return _configured;
+	}
+
+	IrqCpuStatistics &cpuStatistics(size_t cpu) {
+		return _cpuStats[cpu];
+	}
+
 	void configure(IrqConfiguration cfg);
 
 	// This function is called from handleIrq().
 	void raise();
 
+	// Called by handleIrq() after raise() to account the time spent in the IRQ handler.
+	void accountRaise(uint64_t nanos);
+
 	// Set by createIrqPin().
 	smarter::borrowed_ptr<IrqPin> selfPtr;
 
@@ -201,6 +234,13 @@ public:
 
 	virtual void dumpHardwareState();
 
+	// Routes the IRQ to the given CPU.
+	// Returns Error::noHardwareSupport if the IRQ cannot be re-routed.
+	virtual Error setAffinity(size_t cpu);
+
+	// Returns the CPU that the IRQ is currently routed to.
+	virtual size_t getAffinity();
+
 protected:
 	virtual IrqStrategy program(TriggerMode mode, Polarity polarity) = 0;
 
@@ -223,6 +263,10 @@ private:
 	frg::string<KernelAlloc> _name;
 	// Hash of the IRQ name. Mostly useful when extracting entropy from IRQs.
 	uint32_t _hash;
+	uint64_t _id;
+
+	// Array of getCpuCount() elements.
+	IrqCpuStatistics *_cpuStats;
 
 	// Must be protected against IRQs.
 	frg::ticket_spinlock _mutex;
@@ -264,17 +308,48 @@ private:
 	> _sinkList;
 };
 
+struct MsiPin;
+
+// Represents a device that raises MSIs (e.g., a PCI function).
+// This allows MsiPins to mask MSIs and to re-route them to different CPUs.
+struct MsiDevice {
+	// Writes the current message address and data of the pin to the device.
+	virtual void programMsi(MsiPin *pin, size_t index) = 0;
+
+	// Whether programMsi() can safely be called while the MSI is enabled,
+	// i.e., whether the device can mask the MSI while its message is rewritten.
+	// Otherwise, the device could raise an MSI with a torn address/data pair.
+	virtual bool canRetargetMsi() = 0;
+
+	// Whether individual MSIs can be masked at the device.
+	// maskMsi() may be called from IRQ context.
+	virtual bool canMaskMsi() = 0;
+	virtual void maskMsi(size_t index, bool masked) = 0;
+
+protected:
+	~MsiDevice() = default;
+};
+
 struct MsiPin : IrqPin {
-	MsiPin(frg::string<KernelAlloc> name)
-	: IrqPin{std::move(name)} { }
+	MsiPin(frg::string<KernelAlloc> name, MsiDevice *device = nullptr, size_t index = 0)
+	: IrqPin{std::move(name)}, _device{device}, _index{index} { }
 
 	virtual uint64_t getMessageAddress() = 0;
 	virtual uint32_t getMessageData() = 0;
 
 protected:
 	~MsiPin() = default;
+
+	// Device that raises this MSI (or nullptr if the MSI is not associated with a MsiDevice).
+	MsiDevice *_device;
+	size_t _index;
 };
 
+// All IrqPins are registered globally (IrqPins are never destructed).
+// IrqPin IDs are dense, i.e., they range from zero to getIrqPinCount() - 1.
+size_t getIrqPinCount();
+IrqPin *getIrqPin(uint64_t id);
+
 // Allocates an IrqPin and sets up its self-pointer.
 template<typename Pin, typename... Args>
 requires std::derived_from<Pin, IrqPin>
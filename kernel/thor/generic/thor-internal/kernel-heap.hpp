@@ -83,6 +83,110 @@ extern PerCpu<frg::sharded_slab_pool<HeapSlabPolicy>> heapSlabPool;
 // We use this variable to check for reentrancy (i.e., for error checking).
 extern PerCpu<std::atomic<bool>> inSlabPool;
 
+// Magazines bypass the poisoning and tracing hooks of the slab pool.
+#if defined(THOR_KASAN) || defined(KERNEL_LOG_ALLOCATIONS)
+inline constexpr bool enableHeapMagazines = false;
+#else
+inline constexpr bool enableHeapMagazines = true;
+#endif
+
+// Statistics of a single size class of the heap magazines.
+struct HeapClassStatistics {
+	size_t objectSize = 0;
+	// Number of allocations and frees that went through this size class.
+	uint64_t allocations = 0;
+	uint64_t frees = 0;
+	// Number of allocations that were served from a magazine.
+	uint64_t magazineHits = 0;
+	// Number of objects that were returned to the slab pool due to a full depot.
+	uint64_t flushedObjects = 0;
+	// Number of objects that are currently cached in magazines or in the depot.
+	uint64_t cachedObjects = 0;
+};
+
+// Per-CPU cache of free objects for small size classes.
+// Objects that are freed on a CPU (including objects that were allocated on other CPUs,
+// e.g., IPC nodes that complete remotely) are kept in that CPU's magazine and
+// handed out again by subsequent allocations on the same CPU.
+// Full magazines move half of their objects to a global per-class depot in a single batch;
+// empty magazines take a whole batch from the depot before falling back to the slab pool.
+// Hence, objects that are allocated on one CPU and freed on another
+// cross CPUs in batches instead of one by one.
+struct HeapMagazines {
+	static constexpr int minClassShift = 4;
+	static constexpr int numClasses = 6;
+	static constexpr size_t maxObjectSize = size_t{1} << (minClassShift + numClasses - 1);
+	static constexpr size_t capacity = 32;
+	static constexpr size_t batchSize = capacity / 2;
+
+	static int sizeClass(size_t size) {
+		if(size <= (size_t{1} << minClassShift))
+			return 0;
+		return (sizeof(size_t) * 8 - __builtin_clzl(size - 1)) - minClassShift;
+	}
+
+	static size_t classSize(int sc) {
+		return size_t{1} << (sc + minClassShift);
+	}
+
+	// Returns the size class of an object of the given (slab) size
+	// or -1 if the object cannot be cached in a magazine.
+	static int exactSizeClass(size_t size) {
+		if(size < classSize(0) || size > maxObjectSize)
+			return -1;
+		auto sc = sizeClass(size);
+		if(classSize(sc) != size)
+			return -1;
+		return sc;
+	}
+
+	void *pop(int sc) {
+		auto &magazine = magazines_[sc];
+		stats_[sc].allocations++;
+		if(!magazine.count && !refill(sc))
+			return nullptr;
+		stats_[sc].magazineHits++;
+		return magazine.objects[--magazine.count];
+	}
+
+	void push(int sc, void *p, frg::sharded_slab_pool<HeapSlabPolicy> &pool) {
+		auto &magazine = magazines_[sc];
+		stats_[sc].frees++;
+		if(magazine.count == capacity)
+			flush(sc, pool);
+		magazine.objects[magazine.count++] = p;
+	}
+
+	void accumulateStatistics(HeapClassStatistics *stats);
+
+private:
+	// Takes a batch of objects from the depot. Only called on empty magazines.
+	bool refill(int sc);
+	// Moves a batch of objects to the depot (or to the slab pool if the depot is full).
+	void flush(int sc, frg::sharded_slab_pool<HeapSlabPolicy> &pool);
+
+	struct Magazine {
+		void *objects[capacity];
+		size_t count = 0;
+	};
+
+	struct ClassCounters {
+		uint64_t allocations = 0;
+		uint64_t frees = 0;
+		uint64_t magazineHits = 0;
+		uint64_t flushedObjects = 0;
+	};
+
+	Magazine magazines_[numClasses];
+	ClassCounters stats_[numClasses];
+};
+
+extern PerCpu<HeapMagazines> heapMagazines;
+
+// Sums up the magazine statistics of all CPUs.
+// stats must point to an array of HeapMagazines::numClasses elements.
+void getHeapStatistics(HeapClassStatistics *stats);
+
 struct CoreSlabPolicy {
 	static constexpr size_t sb_size = kPageSize;
 	static constexpr size_t slabsize = kPageSize;
@@ -115,13 +219,28 @@ struct Allocator {
 	void *allocate(size_t size) const {
 		Guard guard;
 		auto &pool = heapSlabPool.get();
+		if(enableHeapMagazines && size <= HeapMagazines::maxObjectSize) {
+			// Always allocate the full class size such that the object can be
+			// recycled through the magazine of its size class.
+			auto sc = HeapMagazines::sizeClass(size);
+			if(auto p = heapMagazines.get().pop(sc); p)
+				return p;
+			return pool.allocate(HeapMagazines::classSize(sc));
+		}
 		return pool.allocate(size);
 	}
 
-	void deallocate(void *p, size_t size) const {
-		(void)size;
+	void deallocate(void *p, size_t) const {
 		Guard guard;
 		auto &pool = heapSlabPool.get();
+		if(enableHeapMagazines && p) {
+			// Do not trust the size passed by the caller; a mismatch would put
+			// the object into the wrong size class. Ask the slab that owns p instead.
+			if(auto sc = HeapMagazines::exactSizeClass(pool.get_size(p)); sc >= 0) {
+				heapMagazines.get().push(sc, p, pool);
+				return;
+			}
+		}
 		pool.deallocate(p);
 	}
 
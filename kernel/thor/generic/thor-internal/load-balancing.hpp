@@ -57,7 +57,57 @@ struct LbControlBlock {
 		return affinityMask_[cpuIndex / 8] & (1 << (cpuIndex % 8));
 	}
 
+	// Whether the load balancer may move the thread to the given CPU.
+	bool canMigrateTo(size_t cpuIndex) {
+		auto irqLock = frg::guard(&irqMutex());
+		auto lock = frg::guard(&mutex_);
+
+		return canMigrateToLocked_(cpuIndex);
+	}
+
+	// Assigns the thread to cpu unless canMigrateTo() forbids that.
+	bool tryAssign(CpuData *cpu) {
+		auto irqLock = frg::guard(&irqMutex());
+		auto lock = frg::guard(&mutex_);
+
+		if (!canMigrateToLocked_(cpu->cpuIndex))
+			return false;
+		_assignedCpu.store(cpu, std::memory_order_relaxed);
+		return true;
+	}
+
+	// Excludes the thread from load balancing and assigns it to cpu.
+	// Used for deadline threads whose bandwidth is reserved on cpu.
+	// Returns true if the thread needs to migrate to cpu.
+	bool pin(CpuData *cpu) {
+		auto irqLock = frg::guard(&irqMutex());
+		auto lock = frg::guard(&mutex_);
+
+		pinnedCpu_ = cpu;
+		return _assignedCpu.exchange(cpu, std::memory_order_relaxed) != cpu;
+	}
+
+	void unpin() {
+		auto irqLock = frg::guard(&irqMutex());
+		auto lock = frg::guard(&mutex_);
+
+		pinnedCpu_ = nullptr;
+	}
+
+	bool isPinned() {
+		auto irqLock = frg::guard(&irqMutex());
+		auto lock = frg::guard(&mutex_);
+
+		return pinnedCpu_ != nullptr;
+	}
+
 private:
+	bool canMigrateToLocked_(size_t cpuIndex) {
+		if (pinnedCpu_)
+			return pinnedCpu_->cpuIndex == cpuIndex;
+		return affinityMask_[cpuIndex / 8] & (1 << (cpuIndex % 8));
+	}
+
 	// Immutable.
 	smarter::weak_ptr<Thread> thread_;
 
@@ -81,6 +131,9 @@ private:
 
 	// Protected by mutex_;
 	frg::vector<uint8_t, KernelAlloc> affinityMask_;
+
+	// CPU that the thread is pinned to (see pin()). Protected by mutex_.
+	CpuData *pinnedCpu_{nullptr};
 };
 
 // Per-CPU load balancing data structure.
@@ -125,12 +178,29 @@ struct LoadBalancer {
 	// The thread is detached from the load balancer when the weak reference goes out of scope.
 	void connect(Thread *thread, CpuData *cpu);
 
+	// Called when cpu is about to become idle.
+	// Pulls a runnable thread from the closest CPU that has waiting entities (if any).
+	void stealWork(CpuData *cpu);
+
+	// Called when a thread is woken up by a thread running on the waker CPU.
+	// If the thread's assigned CPU is busy, this assigns the thread to an idle CPU
+	// in the waker's NUMA node (preferring CPUs that share a cache with the waker)
+	// and returns that CPU. Otherwise, returns nullptr.
+	// The caller must hold the thread's mutex and move the thread to the returned CPU.
+	CpuData *placeWakee(LbControlBlock *cb, CpuData *waker);
+
 private:
 	coroutine<void> run_(CpuData *cpu);
 
+	// Transfers ownership of cb from srcNode to dstNode and notifies the thread.
+	// Returns false if cb is not owned by srcNode anymore.
+	bool moveTask_(LbControlBlock *cb, LbNode *srcNode, LbNode *dstNode);
+
 	// Move tasks from srcNode to dstNode to balance load.
 	// newLoad: newLoad at dstNode after balancing.
-	void balanceBetween_(LbNode *srcNode, LbNode *dstNode, uint64_t &newLoad, uint64_t idealLoad);
+	// margin: only move tasks if srcNode exceeds newLoad by at least this amount.
+	void balanceBetween_(LbNode *srcNode, LbNode *dstNode, uint64_t &newLoad,
+			uint64_t idealLoad, uint64_t margin);
 
 	async::barrier barrier_;
 };
@@ -8,6 +8,7 @@
 #include <async/oneshot-event.hpp>
 #include <async/post-ack.hpp>
 #include <async/recurring-event.hpp>
+#include <frg/hash_map.hpp>
 #include <frg/list.hpp>
 #include <frg/rcu_radixtree.hpp>
 #include <frg/shared_ptr.hpp>
@@ -26,7 +27,9 @@ namespace thor {
 enum class ManageRequest {
 	null,
 	initialize,
-	writeback
+	writeback,
+	// Only used by SwapSpace: the backing store's copy of the range is unused.
+	discard
 };
 
 struct Mapping;
@@ -81,6 +84,10 @@ struct CacheBundle {
 
 	virtual void markDirty(CachePage *page) = 0;
 
+	// Whether the pages of this bundle cache anonymous memory instead of file data.
+	// Such pages do not count towards getNumReclaimablePages().
+	bool anonymous = false;
+
 private:
 	frg::ticket_spinlock reclaimMutex_;
 
@@ -453,6 +460,9 @@ struct ImmediateMemory;
 
 smarter::shared_ptr<MemoryView> getZeroMemory();
 
+// Returns the number of clean file-backed pages that the reclaimer can evict on memory pressure.
+size_t getNumReclaimablePages();
+
 // Memory that is allocated by the kernel and never swapped out.
 // In contrast to most other memory objects, it can be accessed synchronously.
 struct ImmediateMemory final : MemoryView {
@@ -827,6 +837,16 @@ struct ManagedSpace : CacheBundle {
 	// Protected by mutex.
 	CachePagesList _discardList;
 
+	// Swap offsets (in pages) whose copies in the backing store became unused.
+	// The driver is notified via ManageRequest::discard; the offsets are only freed
+	// once it acknowledges the notification. Only used by SwapSpace.
+	// Protected by mutex.
+	frg::vector<uint64_t, KernelAlloc> _discardQueue;
+
+	// Maps swap offsets that await acknowledgement to whether the driver was notified.
+	// Only used by SwapSpace. Protected by mutex.
+	frg::hash_map<uint64_t, bool, frg::hash<uint64_t>, KernelAlloc> _discardsInFlight;
+
 	ManageList _managementQueue;
 
 	async::recurring_event _dirtyEvent;
@@ -851,6 +871,10 @@ struct SwapSpace final : ManagedSpace {
 
 	void setBudget(size_t numSlots);
 
+	// Called when the driver acknowledges a ManageRequest::discard.
+	// Frees the swap offsets and the swap budget of the range.
+	Error completeDiscard(uintptr_t offset, size_t length);
+
 private:
 	friend struct SwappableMemory;
 
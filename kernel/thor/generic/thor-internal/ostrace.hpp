@@ -124,4 +124,13 @@ void emit(const Event &event, Args... args) {
 
 } // namespace ostrace
 
+// Emitted whenever an RCU grace period completes.
+extern ostrace::Event ostEvtRcuGracePeriod;
+// Time from the start to the end of the grace period (in nanoseconds).
+extern ostrace::UintAttribute ostAttrRcuLatency;
+// Number of RCU callbacks that are still waiting for a grace period.
+extern ostrace::UintAttribute ostAttrRcuBacklog;
+// Number of CPUs that were forced through a quiescent state.
+extern ostrace::UintAttribute ostAttrRcuForcedCpus;
+
 } // namespace thor
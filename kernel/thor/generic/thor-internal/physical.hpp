@@ -130,9 +130,13 @@ public:
 	void bootstrapRegion(PhysicalAddr address,
 			int order, size_t numRoots, int8_t *buddyTree);
 
+	// Prefers memory from the NUMA node of the current CPU.
 	PhysicalAddr allocate(size_t size, int addressBits = 64);
 	void free(PhysicalAddr address, size_t size);
 
+	// Assigns regions that start within the given range to a NUMA node.
+	void setNumaNode(PhysicalAddr address, size_t size, uint32_t node);
+
 	size_t numTotalPages() {
 		return _totalPages.load(std::memory_order_relaxed);
 	}
@@ -150,6 +154,7 @@ private:
 		PhysicalAddr physicalBase;
 		PhysicalAddr regionSize;
 		BuddyAccessor buddyAccessor;
+		uint32_t numaNode = 0;
 	};
 
 	Region _allRegions[eirMaxMemoryRegions];
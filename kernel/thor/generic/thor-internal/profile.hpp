@@ -6,7 +6,25 @@ namespace thor {
 
 extern bool wantKernelProfile;
 
+// Flags in the header word of profiling samples.
+// Bit 0 (interrupts were disabled) is set by all mechanisms.
+inline constexpr uint32_t profileSampleNoInts = 1;
+// The header is followed by a word that identifies the sampled thread.
+inline constexpr uint32_t profileSampleThread = 2;
+// The sample was taken in user mode; the IPs are user space addresses.
+inline constexpr uint32_t profileSampleUser = 4;
+
+inline constexpr uint64_t defaultProfileFrequency = 1000;
+inline constexpr uint64_t maxProfileFrequency = 10000;
+
 void initializeProfile();
 LogRingBuffer *getGlobalProfileRing();
 
+// Returns true if the timer-based fallback profiler is in use
+// (i.e., if there is no PMC support).
+bool usingTimerProfile();
+// Sampling frequency (in Hz) of the timer-based profiler.
+uint64_t getProfileFrequency();
+void setProfileFrequency(uint64_t frequency);
+
 } // namespace thor
@@ -14,20 +14,44 @@
 namespace thor {
 
 // RcuEngine implements an RCU mechanism where disabling scheduling acts as an RCU read-side lock.
+// Grace periods are driven by a single coroutine. CPUs report quiescent states whenever
+// they reschedule (see reportRcuQuiescentState()); CPUs that do not report a quiescent state
+// in time (or all CPUs, for expedited grace periods) are forced through one by scheduling
+// work onto their work queues.
 struct RcuEngine {
+	// Waits for an expedited grace period.
 	coroutine<void> barrier();
 
+	// Returns the number of a grace period that ends only after all CPUs went through
+	// a quiescent state after the call. If expedite is true, the grace period does not
+	// wait for CPUs to report quiescent states by themselves.
+	uint64_t requestGracePeriod(bool expedite);
+
+	coroutine<void> awaitGracePeriod(uint64_t gp);
+
+	// Starts the coroutine that drives grace periods.
+	void run();
+
 private:
-	// Sequence number of the RCU state transition.
-	static constexpr uint64_t stateSeq = (UINT64_C(1) << 63) - 1;
-	// This bit is set when there is an ongoing state transition.
-	static constexpr uint64_t stateBusy = UINT64_C(1) << 63;
+	void runDriver_(enable_detached_coroutine);
 
-	std::atomic<uint64_t> state_{0};
-	// This event is raised whenever the busy bit transitions to clear.
-	async::recurring_event seqEvent_;
+	// Forces a quiescent state on all CPUs c with pending[c] set.
+	coroutine<void> forceQuiescentStates_(bool *pending);
+
+	// Number of the latest grace period that was started / that completed.
+	// If both are equal, no grace period is in progress.
+	std::atomic<uint64_t> startedGp_{0};
+	std::atomic<uint64_t> completedGp_{0};
+	// Maximal grace period number that was requested (with expedite = true).
+	std::atomic<uint64_t> requestedGp_{0};
+	std::atomic<uint64_t> expeditedGp_{0};
 
-	// Used to wait until the transition is done on all CPUs.
+	// Raised when requestedGp_ increases.
+	async::recurring_event requestEvent_;
+	// Raised when completedGp_ increases.
+	async::recurring_event completionEvent_;
+
+	// Used to wait until forced quiescent states are done.
 	async::wait_group transitionWg_{0};
 };
 
@@ -130,8 +154,15 @@ private:
 
 void setRcuOnline(CpuData *cpu);
 
+// Called by the scheduler whenever it (re-)schedules on the current CPU.
+void reportRcuQuiescentState();
+
 void submitRcu(RcuCallable *callable, void (*call)(RcuCallable *));
 
+// Like submitRcu() but expedites the grace period that the callback waits for.
+// This is more expensive since it forces all CPUs through a quiescent state.
+void submitRcuExpedited(RcuCallable *callable, void (*call)(RcuCallable *));
+
 // Policy class for frigg::rcu_radixtree.
 struct RcuPolicy {
 	template<typename T, typename D>
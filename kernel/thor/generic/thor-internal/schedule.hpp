@@ -3,10 +3,13 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include <atomic>
+
 #include <frg/list.hpp>
 #include <frg/pairing_heap.hpp>
 #include <frg/spinlock.hpp>
 #include <thor-internal/cpu-data.hpp>
+#include <thor-internal/error.hpp>
 #include <thor-internal/ipl.hpp>
 #include <thor-internal/arch-generic/cpu.hpp>
 
@@ -29,6 +32,33 @@ enum class ScheduleType {
 	regular
 };
 
+enum class SchedulingPolicy {
+	// Fair scheduling among entities of the same priority.
+	fair,
+	// Fixed priority real-time scheduling. Entities run until they block,
+	// yield or are preempted by an entity of higher priority.
+	fifo,
+	// Like fifo but entities of the same priority share the CPU in time slices.
+	roundRobin,
+	// Earliest deadline first scheduling. Each entity is a constant bandwidth server
+	// that may consume runtime nanoseconds in each period.
+	deadline
+};
+
+// Real-time priorities range from minRealTimePriority to maxRealTimePriority.
+constexpr int minRealTimePriority = 1;
+constexpr int maxRealTimePriority = 99;
+
+struct SchedulingParameters {
+	SchedulingPolicy policy = SchedulingPolicy::fair;
+	// Priority of fair and real-time entities. Ignored for deadline entities.
+	int priority = 0;
+	// Parameters of deadline entities (in nanoseconds, relative to the start of each period).
+	uint64_t runtime = 0;
+	uint64_t deadline = 0;
+	uint64_t period = 0;
+};
+
 enum class ScheduleState {
 	null,
 	attached,
@@ -49,6 +79,40 @@ inline int64_t progressToNanos(Progress p) {
 	return static_cast<int64_t>(p >> progressShift);
 }
 
+struct ScheduleStatistics {
+	// Time that the entity spent running.
+	uint64_t runTime = 0;
+	// Time that the entity spent waiting in a run queue (i.e., while it was runnable).
+	uint64_t waitTime = 0;
+	// Number of time slices that the entity received.
+	uint64_t timeslices = 0;
+	// Number of times that the entity blocked (voluntary) or was preempted (involuntary).
+	uint64_t voluntarySwitches = 0;
+	uint64_t involuntarySwitches = 0;
+	// Number of times that the entity moved to a different CPU.
+	uint64_t migrations = 0;
+};
+
+// Statistics of a thread, also aggregated per universe.
+struct ThreadStatistics {
+	ScheduleStatistics schedule;
+	// Time that the thread spent waiting for IPC completions.
+	uint64_t ipcWaitTime = 0;
+	// Time that the thread spent resolving page faults.
+	uint64_t faultTime = 0;
+
+	void accumulate(const ThreadStatistics &other) {
+		schedule.runTime += other.schedule.runTime;
+		schedule.waitTime += other.schedule.waitTime;
+		schedule.timeslices += other.schedule.timeslices;
+		schedule.voluntarySwitches += other.schedule.voluntarySwitches;
+		schedule.involuntarySwitches += other.schedule.involuntarySwitches;
+		schedule.migrations += other.schedule.migrations;
+		ipcWaitTime += other.ipcWaitTime;
+		faultTime += other.faultTime;
+	}
+};
+
 struct ScheduleEntity {
 	friend struct Scheduler;
 
@@ -84,7 +148,24 @@ public:
 		return _runTime;
 	}
 
+	// Like runTime(), this can be called from any CPU but the values may be slightly stale.
+	ScheduleStatistics statistics() {
+		return {
+			.runTime = _runTime,
+			.waitTime = _waitTime,
+			.timeslices = _timeslices,
+			.voluntarySwitches = _voluntarySwitches,
+			.involuntarySwitches = _involuntarySwitches,
+			.migrations = _migrations
+		};
+	}
+
+	SchedulingParameters schedulingParameters();
+
 private:
+	// Precedence of the entity's scheduling class (higher values take precedence).
+	int _classRank() const;
+
 	const ScheduleType type_;
 
 	frg::ticket_spinlock _associationMutex;
@@ -99,12 +180,46 @@ private:
 	uint64_t _refClock;
 	uint64_t _runTime;
 
+	// See ScheduleStatistics.
+	uint64_t _waitTime = 0;
+	uint64_t _timeslices = 0;
+	uint64_t _voluntarySwitches = 0;
+	uint64_t _involuntarySwitches = 0;
+	uint64_t _migrations = 0;
+	// Scheduler that the entity was last associated with (to detect migrations).
+	Scheduler *_lastScheduler = nullptr;
+
 	// Scheduler::_systemProgress value at some slice T.
 	// Invariant: This entity's state did not change since T.
 	Progress refProgress;
 
 	// Unfairness value at slice T.
 	Progress baseUnfairness;
+
+	// Parameters that are currently in effect.
+	SchedulingParameters _params;
+
+	// Parameters requested by Scheduler::setParameters().
+	// They are applied the next time that the entity enters the wait queue.
+	// Protected by _paramsMutex.
+	frg::ticket_spinlock _paramsMutex;
+	SchedulingParameters _requestedParams;
+	// Priority that the entity uses under SchedulingPolicy::fair (see Scheduler::setPriority()).
+	int _fairPriority = 0;
+	// Deadline bandwidth reserved for _requestedParams (see Scheduler::setParameters())
+	// and the scheduler that the bandwidth is reserved on.
+	uint64_t _reservedBandwidth = 0;
+	Scheduler *_reservedScheduler = nullptr;
+	std::atomic<bool> _paramsChanged{false};
+
+	// Order of real-time entities of the same priority.
+	int64_t _rtSequence = 0;
+
+	// State of deadline entities.
+	// Absolute deadline of the current period.
+	uint64_t _dlDeadline = 0;
+	// Runtime that remains in the current period.
+	int64_t _dlBudget = 0;
 };
 
 struct ScheduleGreater {
@@ -116,6 +231,8 @@ struct ScheduleGreater {
 };
 
 struct Scheduler {
+	friend struct ScheduleEntity;
+
 	// Note: the scheduler's methods (e.g., associate, unassociate, resume, ...)
 	// may be called from any CPU, *however*, calling them on the same ScheduleEntity is
 	// *not* thread-safe without additional synchronization!
@@ -125,6 +242,18 @@ struct Scheduler {
 
 	static void setPriority(ScheduleEntity *entity, int priority);
 
+	// Changes the scheduling policy and priority of an entity.
+	// Fair entities keep the priority that was set by setPriority(), i.e., the priority
+	// in params is ignored for SchedulingPolicy::fair.
+	// Deadline entities are subject to admission control: the sum of runtime/period
+	// over all deadline entities on the given scheduler's CPU cannot exceed a fixed share
+	// of that CPU. Returns Error::illegalState if the bandwidth is exhausted.
+	// The caller must ensure that deadline entities only run on that CPU.
+	// Can be called on any entity; the change takes effect the next time
+	// that the entity is (re-)scheduled.
+	static Error setParameters(ScheduleEntity *entity, const SchedulingParameters &params,
+			Scheduler *target);
+
 	static void resume(ScheduleEntity *entity);
 	static void suspendCurrent();
 
@@ -137,6 +266,7 @@ struct Scheduler {
 private:
 	Progress _liveUnfairness(const ScheduleEntity *entity);
 	int64_t _liveRuntime(const ScheduleEntity *entity);
+	int64_t _liveBudget(const ScheduleEntity *entity);
 
 public:
 	// This function *must* be called in IRQ/fault/syscall exit paths
@@ -162,6 +292,40 @@ public:
 	// This avoids unnecessary calls into checkPreemption().
 	void suppressRenewalUntilInterrupt();
 
+	// The following functions can be called from any CPU.
+	// They only provide hints for placement decisions (the state may change concurrently).
+
+	// True if the scheduler runs the idle task and no entities were resumed since.
+	bool isIdle() {
+		return _idle.load(std::memory_order_relaxed);
+	}
+
+	// Clears the idle state. Returns true if the scheduler was idle before.
+	// This prevents concurrent wakeups from all choosing the same idle CPU.
+	bool tryClaimIdle() {
+		return _idle.exchange(false, std::memory_order_relaxed);
+	}
+
+	// Number of running or waiting entities (as of the last update of the queue).
+	size_t numRunnable() {
+		return _numRunnable.load(std::memory_order_relaxed);
+	}
+
+	// Time that this CPU spent running the idle task (or other entities).
+	// Only updated when the scheduler updates its state.
+	uint64_t idleTime() {
+		return _idleTime.load(std::memory_order_relaxed);
+	}
+
+	uint64_t busyTime() {
+		return _busyTime.load(std::memory_order_relaxed);
+	}
+
+	// Number of context switches on this CPU.
+	uint64_t contextSwitches() {
+		return _contextSwitches.load(std::memory_order_relaxed);
+	}
+
 	void checkPreemption(IrqImageAccessor image) {
 		assert(image.intsEnabled());
 		if (!mustCallPreemption())
@@ -190,9 +354,23 @@ public:
 	ScheduleEntity *currentRunnable();
 
 private:
-	void _unschedule();
+	enum class EnqueueReason {
+		// The entity was resumed.
+		wakeup,
+		// The entity was preempted by an entity of higher precedence.
+		preemption,
+		// The entity yielded or its time slice (or budget) expired.
+		requeue
+	};
+
+	void _unschedule(EnqueueReason reason);
 	void _schedule();
 
+	// Inserts an active entity into the wait queue (or into the throttled list).
+	void _enqueue(ScheduleEntity *entity, EnqueueReason reason);
+	void _applyParameters(ScheduleEntity *entity);
+	void _releaseThrottled();
+
 private:
 	void _updatePreemption();
 
@@ -201,6 +379,8 @@ private:
 
 	void _updateEntityStats(ScheduleEntity *entity);
 
+	void _publishState();
+
 	CpuData *_cpuContext;
 
 	ScheduleEntity *_current;
@@ -218,9 +398,37 @@ private:
 
 	size_t _numWaiting = 0;
 
+	// Deadline entities that exhausted their budget until their next period.
+	// Sorted by the end of their current period.
+	frg::intrusive_list<
+		ScheduleEntity,
+		frg::locate_member<
+			ScheduleEntity,
+			frg::default_list_hook<ScheduleEntity>,
+			&ScheduleEntity::listHook
+		>
+	> _throttledList;
+
+	// Sum of the bandwidths that deadline entities reserved on this CPU.
+	std::atomic<uint64_t> _deadlineBandwidth{0};
+
+	// Used to order real-time entities of the same priority.
+	int64_t _rtHeadSequence = 0;
+	int64_t _rtTailSequence = 0;
+
 	// See mustCallPreemption().
 	bool _mustCallPreemption{false};
 
+	// See isIdle() and numRunnable().
+	std::atomic<bool> _idle{false};
+	std::atomic<size_t> _numRunnable{0};
+
+	// See idleTime(), busyTime() and contextSwitches().
+	// Only written by the CPU that owns the scheduler.
+	std::atomic<uint64_t> _idleTime{0};
+	std::atomic<uint64_t> _busyTime{0};
+	std::atomic<uint64_t> _contextSwitches{0};
+
 	// The last tick at which the scheduler's state (i.e. progress) was updated.
 	// In our model this is the time point at which slice T started.
 	uint64_t _refClock = 0;
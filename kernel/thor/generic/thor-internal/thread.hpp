@@ -9,6 +9,7 @@
 #include <thor-internal/cpu-data.hpp>
 #include <thor-internal/error.hpp>
 #include <thor-internal/schedule.hpp>
+#include <thor-internal/timer.hpp>
 #include <thor-internal/universe.hpp>
 #include <thor-internal/work-queue.hpp>
 
@@ -290,6 +291,16 @@ public:
 	static void migrateOther(smarter::borrowed_ptr<Thread> thread);
 	static Error resumeOther(smarter::borrowed_ptr<Thread> thread);
 
+	enum class Runnability {
+		blocked,
+		// The thread is in the queue of some scheduler.
+		waiting,
+		running
+	};
+
+	// Snapshot of the run state; used by the load balancer.
+	Runnability runnability();
+
 	enum Flags : uint32_t {
 		kFlagServer = 1
 	};
@@ -310,6 +321,35 @@ public:
 	smarter::borrowed_ptr<Universe> getUniverse();
 	smarter::borrowed_ptr<AddressSpace, BindableHandle> getAddressSpace();
 
+	// Amount of time by which the thread's timers (e.g., futex timeouts) may expire
+	// late such that the timer engine can coalesce them with other timers.
+	uint64_t timerSlack() {
+		return _timerSlack.load(std::memory_order_relaxed);
+	}
+
+	void setTimerSlack(uint64_t slack) {
+		_timerSlack.store(slack, std::memory_order_relaxed);
+	}
+
+	ThreadStatistics statistics() {
+		return {
+			.schedule = ScheduleEntity::statistics(),
+			.ipcWaitTime = _ipcWaitTime.load(std::memory_order_relaxed),
+			.faultTime = _faultTime.load(std::memory_order_relaxed)
+		};
+	}
+
+	// The following functions must only be called by the thread itself.
+	void accountIpcWait(uint64_t nanos) {
+		_ipcWaitTime.store(_ipcWaitTime.load(std::memory_order_relaxed) + nanos,
+				std::memory_order_relaxed);
+	}
+
+	void accountFault(uint64_t nanos) {
+		_faultTime.store(_faultTime.load(std::memory_order_relaxed) + nanos,
+				std::memory_order_relaxed);
+	}
+
 	// ----------------------------------------------------------------------------------
 	// observe() and its boilerplate.
 	// ----------------------------------------------------------------------------------
@@ -534,6 +574,12 @@ private:
 	smarter::shared_ptr<Universe> _universe;
 	smarter::shared_ptr<AddressSpace, BindableHandle> _addressSpace;
 
+	std::atomic<uint64_t> _timerSlack{defaultTimerSlack};
+
+	// See ThreadStatistics.
+	std::atomic<uint64_t> _ipcWaitTime{0};
+	std::atomic<uint64_t> _faultTime{0};
+
 	using ObserveQueue = frg::intrusive_list<
 		ObserveNode,
 		frg::locate_member<
@@ -8,6 +8,7 @@
 #include <frg/intrusive.hpp>
 #include <frg/pairing_heap.hpp>
 #include <frg/spinlock.hpp>
+#include <hel.h>
 #include <thor-internal/arch-generic/timer.hpp>
 #include <thor-internal/cancel.hpp>
 #include <thor-internal/work-queue.hpp>
@@ -17,6 +18,9 @@ namespace thor {
 struct CpuData;
 struct PrecisionTimerEngine;
 
+// Default slack of user space timers (i.e., futex timeouts and kHelSubmitAwaitClock).
+inline constexpr uint64_t defaultTimerSlack = kHelDefaultTimerSlack;
+
 struct ClockSource {
 	virtual uint64_t currentNanos() = 0;
 
@@ -61,14 +65,30 @@ struct PrecisionTimerNode {
 		_elapsed = elapsed;
 	}
 
+	// Allows the timer to expire up to slack nanoseconds after its deadline.
+	// The timer engine uses this to coalesce the expiration of multiple timers
+	// into a single interrupt.
+	void setSlack(uint64_t slack) {
+		_slack = slack;
+	}
+
 	bool wasCancelled() {
 		return _wasCancelled;
 	}
 
 	frg::pairing_heap_hook<PrecisionTimerNode> hook;
+	frg::pairing_heap_hook<PrecisionTimerNode> latestHook;
 
 private:
+	// Latest point in time at which the timer may expire.
+	uint64_t _latest() const {
+		if(_deadline + _slack < _deadline)
+			return UINT64_MAX;
+		return _deadline + _slack;
+	}
+
 	uint64_t _deadline;
+	uint64_t _slack = 0;
 	async::cancellation_token _cancelToken;
 	WorkQueue *_wq;
 	Worklet *_elapsed;
@@ -87,6 +107,19 @@ struct CompareTimer {
 	}
 };
 
+struct CompareTimerLatest {
+	bool operator() (const PrecisionTimerNode *a, const PrecisionTimerNode *b) const {
+		return a->_latest() > b->_latest();
+	}
+};
+
+struct TimerStatistics {
+	// Number of timer interrupts.
+	uint64_t interrupts;
+	// Number of timers that expired.
+	uint64_t expirations;
+};
+
 struct PrecisionTimerEngine final {
 	friend struct PrecisionTimerNode;
 
@@ -119,14 +152,17 @@ public:
 		PrecisionTimerEngine *self;
 		uint64_t deadline;
 		async::cancellation_token cancellation;
+		uint64_t slack;
 	};
 
-	SleepSender sleep(uint64_t deadline, async::cancellation_token cancellation = {}) {
-		return {this, deadline, cancellation};
+	SleepSender sleep(uint64_t deadline, async::cancellation_token cancellation = {},
+			uint64_t slack = 0) {
+		return {this, deadline, cancellation, slack};
 	}
 
-	SleepSender sleepFor(uint64_t nanos, async::cancellation_token cancellation = {}) {
-		return {this, getClockNanos() + nanos, cancellation};
+	SleepSender sleepFor(uint64_t nanos, async::cancellation_token cancellation = {},
+			uint64_t slack = 0) {
+		return {this, getClockNanos() + nanos, cancellation, slack};
 	}
 
 	template<typename R>
@@ -144,6 +180,7 @@ public:
 				async::execution::set_value(op->receiver_, !op->node_.wasCancelled());
 			});
 			node_.setup(s_.deadline, s_.cancellation, WorkQueue::generalQueue().get(), &worklet_);
+			node_.setSlack(s_.slack);
 			s_.self->installTimer(&node_);
 		}
 
@@ -174,6 +211,7 @@ private:
 
 	Mutex _mutex;
 
+	// Ordered by deadline.
 	frg::pairing_heap<
 		PrecisionTimerNode,
 		frg::locate_member<
@@ -184,6 +222,19 @@ private:
 		CompareTimer
 	> _timerQueue;
 
+	// Contains the same timers as _timerQueue but ordered by deadline + slack.
+	// The hardware timer is programmed to the top of this queue; once it fires,
+	// all timers whose deadline passed expire.
+	frg::pairing_heap<
+		PrecisionTimerNode,
+		frg::locate_member<
+			PrecisionTimerNode,
+			frg::pairing_heap_hook<PrecisionTimerNode>,
+			&PrecisionTimerNode::latestHook
+		>,
+		CompareTimerLatest
+	> _latestQueue;
+
 	size_t _activeTimers;
 };
 
@@ -200,4 +251,13 @@ void setPreemptionDeadline(frg::optional<uint64_t> deadline);
 // is none.
 frg::optional<uint64_t> getPreemptionDeadline();
 
+// Arms (or disarms) the periodic tick of the timer-based profiler on this CPU.
+// While armed, the tick is re-armed every interval nanoseconds.
+void setProfileTickInterval(frg::optional<uint64_t> interval);
+// Returns true if the last call to handleTimerInterrupt() on this CPU
+// hit the profiler tick. Clears the indication.
+bool takeProfileTick();
+
+TimerStatistics getTimerStatistics(size_t cpu);
+
 } // namespace thor
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <thor-internal/cpu-data.hpp>
+
+namespace thor {
+
+// Levels of the CPU topology, ordered from closest to farthest.
+enum class TopologyLevel {
+	// Same core (i.e., SMT siblings).
+	smt,
+	// Same last level cache.
+	llc,
+	// Same NUMA node.
+	numa,
+	system
+};
+
+constexpr size_t maxNumaNodes = 64;
+
+// Assigns a topology in which each CPU is a separate core in the same package.
+// Architecture specific code refines this if the hardware or firmware provides more information.
+void setFlatCpuTopology(CpuData *cpu);
+
+// Returns the closest level that both CPUs share.
+TopologyLevel commonTopologyLevel(CpuData *a, CpuData *b);
+
+inline bool sharesTopologyLevel(CpuData *a, CpuData *b, TopologyLevel level) {
+	return commonTopologyLevel(a, b) <= level;
+}
+
+// Number of NUMA nodes. Equal to 1 if the firmware does not describe NUMA nodes.
+size_t getNumaNodeCount();
+
+// Relative memory access latency between NUMA nodes (as in ACPI's SLIT).
+// Local accesses have a distance of 10.
+unsigned int getNumaDistance(uint32_t from, uint32_t to);
+
+// NUMA node of the current CPU.
+uint32_t getLocalNumaNode();
+
+// The following functions are called by firmware parsing code (ACPI SRAT/SLIT or DTB).
+void registerNumaNode(uint32_t node);
+void setNumaDistance(uint32_t from, uint32_t to, unsigned int distance);
+// Records that the CPU with the given hardware ID (APIC ID, MPIDR, hart ID) belongs to node.
+void addCpuNumaAffinity(uint64_t hwId, uint32_t node);
+// Updates cpu->topology.numaNode from the affinities recorded by addCpuNumaAffinity().
+void updateCpuNumaNode(CpuData *cpu, uint64_t hwId);
+
+void dumpCpuTopology();
+
+} // namespace thor
@@ -6,11 +6,13 @@
 #include <type_traits>
 #include <utility>
 #include <frg/optional.hpp>
+#include <frg/vector.hpp>
 #include <assert.h>
 #include <smarter.hpp>
 #include <thor-internal/error.hpp>
 #include <thor-internal/ipl.hpp>
 #include <thor-internal/mm-rc.hpp>
+#include <thor-internal/schedule.hpp>
 #include <thor-internal/virtualization.hpp>
 
 namespace thor {
@@ -474,9 +476,22 @@ public:
 
 	frg::optional<AnyDescriptor> detachDescriptor(Handle handle);
 
+	// Threads register themselves such that their statistics can be aggregated.
+	void attachThread(Thread *thread);
+	// Adds the statistics of the thread to the universe's total.
+	void detachThread(Thread *thread);
+
+	// Statistics of all threads that ever ran in this universe.
+	ThreadStatistics threadStatistics();
+
 	Lock lock;
 
 private:
+	frg::ticket_spinlock _threadsMutex;
+	frg::vector<Thread *, KernelAlloc> _threads;
+	// Accumulated statistics of detached threads.
+	ThreadStatistics _detachedStatistics;
+
 	frg::hash_map<
 		Handle,
 		AnyDescriptor,
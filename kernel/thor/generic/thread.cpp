@@ -501,6 +501,17 @@ void Thread::unblockOther(smarter::borrowed_ptr<Thread> thread) {
 
 	thread->_updateRunTime();
 	thread->_runState = kRunDeferred;
+
+	// Instead of waiting in the queue of a busy CPU, run the thread on an idle CPU.
+	if (thread->_lbCb) {
+		if (auto *cpu = LoadBalancer::singleton().placeWakee(thread->_lbCb, getCpuData()); cpu) {
+			if(logMigration)
+				infoLogger() << "thor: " << (void *)thread.get()
+						<< " is woken up on CPU " << cpu->cpuIndex << frg::endlog;
+			Scheduler::unassociate(thread.get());
+			Scheduler::associate(thread.get(), &localScheduler.get(cpu));
+		}
+	}
 	Scheduler::resume(thread.get());
 }
 
@@ -538,6 +549,17 @@ Error Thread::resumeOther(smarter::borrowed_ptr<Thread> thread) {
 	return Error::success;
 }
 
+Thread::Runnability Thread::runnability() {
+	auto irqLock = frg::guard(&irqMutex());
+	auto lock = frg::guard(&_mutex);
+
+	if (_runState == kRunActive)
+		return Runnability::running;
+	if (_runState == kRunDeferred)
+		return Runnability::waiting;
+	return Runnability::blocked;
+}
+
 void Thread::raiseCondition_(Condition c) {
 	auto irqLock = frg::guard(&irqMutex());
 
@@ -592,6 +614,7 @@ Thread::Thread(CtorToken, smarter::shared_ptr<Universe> universe,
 	// TODO: Alternatively, we could add a separate observation for new launched threads.
 	intrState_ = IntrState::inInterrupt;
 	_lastInterrupt = kIntrRequested;
+	_universe->attachThread(this);
 }
 
 Thread::~Thread() {
@@ -599,6 +622,7 @@ Thread::~Thread() {
 		infoLogger() << "thor: Thread is destructed" << frg::endlog;
 	assert(_runState == kRunTerminated);
 	assert(_observeQueue.empty());
+	_universe->detachThread(this);
 	ExecutorContext::retire(_executorContext);
 }
 
@@ -12,10 +12,21 @@ static constexpr bool logProgress = false;
 namespace {
 
 struct DeadlineState {
+	// The timer engine must be invoked before timerDeadline but invoking it
+	// before timerEarliest does not make progress.
+	frg::optional<uint64_t> timerEarliest{};
 	frg::optional<uint64_t> timerDeadline{};
 	frg::optional<uint64_t> preemptionDeadline{};
+	frg::optional<uint64_t> profileDeadline{};
 
 	frg::optional<uint64_t> currentDeadline{};
+
+	frg::optional<uint64_t> profileInterval{};
+	bool profileTick{false};
+
+	// Only written by the CPU that owns the state.
+	std::atomic<uint64_t> interrupts{0};
+	std::atomic<uint64_t> expirations{0};
 };
 
 extern PerCpu<DeadlineState> deadlineState;
@@ -36,6 +47,7 @@ void updateDeadline_() {
 
 	consider(state.timerDeadline);
 	consider(state.preemptionDeadline);
+	consider(state.profileDeadline);
 
 	// No need to do anything if the current deadline didn't change.
 
@@ -50,9 +62,11 @@ void updateDeadline_() {
 	setTimerDeadline(state.currentDeadline);
 }
 
-void setTimerEngineDeadline(frg::optional<uint64_t> deadline) {
+void setTimerEngineDeadline(frg::optional<uint64_t> earliest, frg::optional<uint64_t> deadline) {
 	assert(!intsAreEnabled());
-	deadlineState.get().timerDeadline = deadline;
+	auto &state = deadlineState.get();
+	state.timerEarliest = earliest;
+	state.timerDeadline = deadline;
 	updateDeadline_();
 }
 
@@ -70,6 +84,23 @@ void setPreemptionDeadline(frg::optional<uint64_t> deadline) {
 	return deadlineState.get().preemptionDeadline;
 }
 
+void setProfileTickInterval(frg::optional<uint64_t> interval) {
+	assert(!intsAreEnabled());
+	auto &state = deadlineState.get();
+	state.profileInterval = interval;
+	if (interval)
+		state.profileDeadline = getClockNanos() + *interval;
+	else
+		state.profileDeadline = frg::null_opt;
+	updateDeadline_();
+}
+
+bool takeProfileTick() {
+	assert(!intsAreEnabled());
+	auto &state = deadlineState.get();
+	return std::exchange(state.profileTick, false);
+}
+
 
 void handleTimerInterrupt() {
 	auto &state = deadlineState.get();
@@ -83,8 +114,23 @@ void handleTimerInterrupt() {
 		return true;
 	};
 
-	auto timerExpired = checkAndClear(state.timerDeadline);
+	state.interrupts.store(state.interrupts.load(std::memory_order_relaxed) + 1,
+			std::memory_order_relaxed);
+
+	// If the IRQ was raised for preemption but the timers' slack window already began,
+	// we process the timers now to save an IRQ later on.
+	bool timerExpired = false;
+	if (state.timerEarliest && now >= *state.timerEarliest) {
+		state.timerEarliest = frg::null_opt;
+		state.timerDeadline = frg::null_opt;
+		timerExpired = true;
+	}
 	auto preemptionExpired = checkAndClear(state.preemptionDeadline);
+	if (checkAndClear(state.profileDeadline)) {
+		assert(state.profileInterval);
+		state.profileDeadline = now + *state.profileInterval;
+		state.profileTick = true;
+	}
 
 	// Update the timer hardware.
 	updateDeadline_();
@@ -97,6 +143,14 @@ void handleTimerInterrupt() {
 		localScheduler.get().forcePreemptionCall();
 }
 
+TimerStatistics getTimerStatistics(size_t cpu) {
+	auto &state = deadlineState.getFor(cpu);
+	return {
+		.interrupts = state.interrupts.load(std::memory_order_relaxed),
+		.expirations = state.expirations.load(std::memory_order_relaxed)
+	};
+}
+
 
 extern PerCpu<PrecisionTimerEngine> timerEngine;
 THOR_DEFINE_PERCPU(timerEngine);
@@ -125,6 +179,7 @@ void PrecisionTimerEngine::installTimer(PrecisionTimerNode *timer) {
 	}
 
 	_timerQueue.push(timer);
+	_latestQueue.push(timer);
 	_activeTimers++;
 	timer->_state = TimerState::queued;
 
@@ -137,6 +192,7 @@ void PrecisionTimerEngine::cancelTimer(PrecisionTimerNode *timer) {
 
 	if(timer->_state == TimerState::queued) {
 		_timerQueue.remove(timer);
+		_latestQueue.remove(timer);
 		_activeTimers--;
 		timer->_wasCancelled = true;
 	}else{
@@ -162,6 +218,7 @@ void PrecisionTimerEngine::firedAlarm() {
 void PrecisionTimerEngine::_progress() {
 	assert(getCpuData() == _ourCpu);
 
+	auto &state = deadlineState.get();
 	auto current = getClockNanos();
 	do {
 		// Process all timers that elapsed in the past.
@@ -169,7 +226,7 @@ void PrecisionTimerEngine::_progress() {
 			infoLogger() << "thor: Processing timers until " << current << frg::endlog;
 		while(true) {
 			if(_timerQueue.empty()) {
-				setTimerEngineDeadline(frg::null_opt);
+				setTimerEngineDeadline(frg::null_opt, frg::null_opt);
 				return;
 			}
 
@@ -179,7 +236,10 @@ void PrecisionTimerEngine::_progress() {
 			auto timer = _timerQueue.top();
 			assert(timer->_state == TimerState::queued);
 			_timerQueue.pop();
+			_latestQueue.remove(timer);
 			_activeTimers--;
+			state.expirations.store(state.expirations.load(std::memory_order_relaxed) + 1,
+					std::memory_order_relaxed);
 			if(logProgress)
 				infoLogger() << "thor: Timer completed" << frg::endlog;
 			if(timer->_cancelCb.try_reset()) {
@@ -191,9 +251,10 @@ void PrecisionTimerEngine::_progress() {
 			}
 		}
 
-		// Setup the interrupt.
+		// Setup the interrupt. Delaying it until the earliest deadline + slack
+		// allows us to handle all timers that expire within the slack window at once.
 		assert(!_timerQueue.empty());
-		setTimerEngineDeadline(_timerQueue.top()->_deadline);
+		setTimerEngineDeadline(_timerQueue.top()->_deadline, _latestQueue.top()->_latest());
 
 		// We iterate if there was a race.
 		// Technically, this is optional but it may help to avoid unnecessary IRQs.
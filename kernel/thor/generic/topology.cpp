@@ -0,0 +1,118 @@
+#include <frg/manual_box.hpp>
+#include <frg/vector.hpp>
+#include <thor-internal/debug.hpp>
+#include <thor-internal/kernel-heap.hpp>
+#include <thor-internal/topology.hpp>
+
+namespace thor {
+
+namespace {
+
+struct CpuNumaAffinity {
+	uint64_t hwId;
+	uint32_t node;
+};
+
+// Highest NUMA node + 1.
+std::atomic<size_t> numNumaNodes{1};
+
+uint8_t numaDistances[maxNumaNodes][maxNumaNodes];
+bool haveNumaDistances = false;
+
+frg::manual_box<frg::vector<CpuNumaAffinity, KernelAlloc>> cpuNumaAffinities;
+
+} // anonymous namespace
+
+void setFlatCpuTopology(CpuData *cpu) {
+	cpu->topology = CpuTopology{
+		.packageId = 0,
+		.coreId = static_cast<uint32_t>(cpu->cpuIndex),
+		.threadId = 0,
+		.llcId = 0,
+		.numaNode = 0,
+	};
+}
+
+TopologyLevel commonTopologyLevel(CpuData *a, CpuData *b) {
+	auto &ta = a->topology;
+	auto &tb = b->topology;
+	if (ta.packageId == tb.packageId && ta.coreId == tb.coreId)
+		return TopologyLevel::smt;
+	if (ta.packageId == tb.packageId && ta.llcId == tb.llcId)
+		return TopologyLevel::llc;
+	if (ta.numaNode == tb.numaNode)
+		return TopologyLevel::numa;
+	return TopologyLevel::system;
+}
+
+size_t getNumaNodeCount() {
+	return numNumaNodes.load(std::memory_order_relaxed);
+}
+
+unsigned int getNumaDistance(uint32_t from, uint32_t to) {
+	if (from == to)
+		return 10;
+	if (!haveNumaDistances || from >= maxNumaNodes || to >= maxNumaNodes)
+		return 20;
+	return numaDistances[from][to];
+}
+
+uint32_t getLocalNumaNode() {
+	if (getNumaNodeCount() == 1)
+		return 0;
+	return getCpuData()->topology.numaNode;
+}
+
+void registerNumaNode(uint32_t node) {
+	assert(node < maxNumaNodes);
+	if (node + 1 > numNumaNodes.load(std::memory_order_relaxed))
+		numNumaNodes.store(node + 1, std::memory_order_relaxed);
+}
+
+void setNumaDistance(uint32_t from, uint32_t to, unsigned int distance) {
+	if (from >= maxNumaNodes || to >= maxNumaNodes)
+		return;
+	if (!haveNumaDistances) {
+		for (size_t i = 0; i < maxNumaNodes; ++i)
+			for (size_t j = 0; j < maxNumaNodes; ++j)
+				numaDistances[i][j] = (i == j) ? 10 : 20;
+		haveNumaDistances = true;
+	}
+	numaDistances[from][to] = distance;
+}
+
+void addCpuNumaAffinity(uint64_t hwId, uint32_t node) {
+	if (node >= maxNumaNodes) {
+		warningLogger() << "thor: Ignoring NUMA node " << node
+				<< " of CPU 0x" << frg::hex_fmt{hwId} << frg::endlog;
+		return;
+	}
+	if (!cpuNumaAffinities.valid())
+		cpuNumaAffinities.initialize(*kernelAlloc);
+	cpuNumaAffinities->push_back({hwId, node});
+	registerNumaNode(node);
+}
+
+void updateCpuNumaNode(CpuData *cpu, uint64_t hwId) {
+	if (!cpuNumaAffinities.valid())
+		return;
+	for (auto &affinity : *cpuNumaAffinities) {
+		if (affinity.hwId == hwId) {
+			cpu->topology.numaNode = affinity.node;
+			return;
+		}
+	}
+}
+
+void dumpCpuTopology() {
+	for (size_t i = 0; i < getCpuCount(); ++i) {
+		auto &topology = getCpuData(i)->topology;
+		infoLogger() << "thor: CPU #" << i << " is thread " << topology.threadId
+				<< " of core " << topology.coreId
+				<< " in package " << topology.packageId
+				<< " (LLC " << topology.llcId
+				<< ", NUMA node " << topology.numaNode << ")" << frg::endlog;
+	}
+}
+
+} // namespace thor
@@ -99,7 +99,7 @@ std::expected<smarter::shared_ptr<Universe>, Error> Universe::create() {
 }
 
 Universe::Universe(CtorToken)
-: _descriptorMap{frg::hash<Handle>{}, *kernelAlloc}, _nextHandle{1} { }
+: _threads{*kernelAlloc}, _descriptorMap{frg::hash<Handle>{}, *kernelAlloc}, _nextHandle{1} { }
 
 Universe::~Universe() {
 	if(logCleanup)
@@ -134,4 +134,36 @@ frg::optional<AnyDescriptor> Universe::detachDescriptor(Handle handle) {
 	return _descriptorMap.remove(handle);
 }
 
+void Universe::attachThread(Thread *thread) {
+	auto irqLock = frg::guard(&irqMutex());
+	auto lock = frg::guard(&_threadsMutex);
+
+	_threads.push_back(thread);
+}
+
+void Universe::detachThread(Thread *thread) {
+	auto irqLock = frg::guard(&irqMutex());
+	auto lock = frg::guard(&_threadsMutex);
+
+	for(size_t i = 0; i < _threads.size(); i++) {
+		if(_threads[i] != thread)
+			continue;
+		_threads[i] = _threads.back();
+		_threads.resize(_threads.size() - 1);
+		_detachedStatistics.accumulate(thread->statistics());
+		return;
+	}
+	assert(!"thread is not attached to universe");
+}
+
+ThreadStatistics Universe::threadStatistics() {
+	auto irqLock = frg::guard(&irqMutex());
+	auto lock = frg::guard(&_threadsMutex);
+
+	auto stats = _detachedStatistics;
+	for(auto thread : _threads)
+		stats.accumulate(thread->statistics());
+	return stats;
+}
+
 } // namespace thor
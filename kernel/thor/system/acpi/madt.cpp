@@ -13,6 +13,8 @@
 #include <thor-internal/kernel-heap.hpp>
 #include <thor-internal/main.hpp>
 #include <thor-internal/pci/pci.hpp>
+#include <thor-internal/physical.hpp>
+#include <thor-internal/topology.hpp>
 
 #ifdef __x86_64__
 #include <thor-internal/arch/pic.hpp>
@@ -60,6 +62,50 @@ namespace local_flags {
 static constexpr uint32_t enabled = 1;
 };
 
+struct [[gnu::packed]] SratHeader {
+	uint32_t reserved1;
+	uint64_t reserved2;
+};
+
+struct [[gnu::packed]] SratLocalEntry {
+	MadtGenericEntry generic;
+	uint8_t proximityDomainLow;
+	uint8_t localApicId;
+	uint32_t flags;
+	uint8_t localSapicEid;
+	uint8_t proximityDomainHigh[3];
+	uint32_t clockDomain;
+};
+
+struct [[gnu::packed]] SratMemoryEntry {
+	MadtGenericEntry generic;
+	uint32_t proximityDomain;
+	uint16_t reserved1;
+	uint64_t base;
+	uint64_t length;
+	uint32_t reserved2;
+	uint32_t flags;
+	uint64_t reserved3;
+};
+
+struct [[gnu::packed]] SratLocalX2Entry {
+	MadtGenericEntry generic;
+	uint16_t reserved1;
+	uint32_t proximityDomain;
+	uint32_t localX2ApicId;
+	uint32_t flags;
+	uint32_t clockDomain;
+	uint32_t reserved2;
+};
+
+namespace srat_flags {
+static constexpr uint32_t enabled = 1;
+};
+
+struct [[gnu::packed]] SlitHeader {
+	uint64_t numLocalities;
+};
+
 struct [[gnu::packed]] MadtIoEntry {
 	MadtGenericEntry generic;
 	uint8_t ioApicId;
@@ -194,6 +240,89 @@ void bootOtherProcessors() {
 
 // --------------------------------------------------------
 
+namespace {
+
+void parseSrat() {
+	uacpi_table sratTbl;
+
+	if (uacpi_table_find_by_signature("SRAT", &sratTbl) != UACPI_STATUS_OK)
+		return;
+	frg::scope_exit finish{[&] { uacpi_table_unref(&sratTbl); }};
+	auto *srat = sratTbl.hdr;
+
+	size_t offset = sizeof(acpi_sdt_hdr) + sizeof(SratHeader);
+	while (offset < srat->length) {
+		auto generic = (MadtGenericEntry *)(sratTbl.virt_addr + offset);
+		if (!generic->length)
+			break;
+		switch (generic->type) {
+			case 0: {
+				auto entry = (SratLocalEntry *)generic;
+				if (!(entry->flags & srat_flags::enabled))
+					break;
+
+				uint32_t domain = entry->proximityDomainLow
+						| (uint32_t{entry->proximityDomainHigh[0]} << 8)
+						| (uint32_t{entry->proximityDomainHigh[1]} << 16)
+						| (uint32_t{entry->proximityDomainHigh[2]} << 24);
+				addCpuNumaAffinity(entry->localApicId, domain);
+			} break;
+			case 1: {
+				auto entry = (SratMemoryEntry *)generic;
+				if (!(entry->flags & srat_flags::enabled) || !entry->length)
+					break;
+				if (entry->proximityDomain >= maxNumaNodes) {
+					warningLogger() << "thor: Ignoring memory of NUMA node "
+							<< entry->proximityDomain << frg::endlog;
+					break;
+				}
+
+				infoLogger() << "thor: Memory at 0x" << frg::hex_fmt{entry->base}
+						<< ", size: 0x" << frg::hex_fmt{entry->length}
+						<< " belongs to NUMA node " << entry->proximityDomain << frg::endlog;
+				registerNumaNode(entry->proximityDomain);
+				physicalAllocator->setNumaNode(entry->base, entry->length,
+						entry->proximityDomain);
+			} break;
+			case 2: {
+				auto entry = (SratLocalX2Entry *)generic;
+				if (!(entry->flags & srat_flags::enabled))
+					break;
+				addCpuNumaAffinity(entry->localX2ApicId, entry->proximityDomain);
+			} break;
+			default:
+				// Do nothing.
+		}
+		offset += generic->length;
+	}
+}
+
+void parseSlit() {
+	uacpi_table slitTbl;
+
+	if (uacpi_table_find_by_signature("SLIT", &slitTbl) != UACPI_STATUS_OK)
+		return;
+	frg::scope_exit finish{[&] { uacpi_table_unref(&slitTbl); }};
+	auto *slit = slitTbl.hdr;
+
+	auto header = (SlitHeader *)(slitTbl.virt_addr + sizeof(acpi_sdt_hdr));
+	auto n = header->numLocalities;
+	auto matrix = (uint8_t *)(slitTbl.virt_addr + sizeof(acpi_sdt_hdr) + sizeof(SlitHeader));
+	if (sizeof(acpi_sdt_hdr) + sizeof(SlitHeader) + n * n > slit->length) {
+		warningLogger() << "thor: SLIT is truncated" << frg::endlog;
+		return;
+	}
+
+	for (uint64_t i = 0; i < n; i++) {
+		for (uint64_t j = 0; j < n; j++)
+			setNumaDistance(i, j, matrix[i * n + j]);
+	}
+}
+
+} // anonymous namespace
+
+// --------------------------------------------------------
+
 void dumpMadt() {
 	uacpi_table madtTbl;
 
@@ -527,12 +656,32 @@ static initgraph::Task loadAcpiNamespaceTask{
     }
 };
 
+static initgraph::Task discoverNumaTask{
+    &globalInitEngine,
+    "acpi.discover-numa",
+    initgraph::Requires{getTablesDiscoveredStage(), getFibersAvailableStage()},
+    initgraph::Entails{getTaskingAvailableStage()},
+    [] {
+	    if (!acpiRsdpNote->rsdp)
+		    return;
+
+	    parseSrat();
+	    parseSlit();
+
+	    // APs determine their NUMA node when they are booted; the BSP is already running.
+#ifdef __x86_64__
+	    updateCpuNumaNode(getCpuData(0), getCpuData(0)->localApicId);
+#endif
+    }
+};
+
 static initgraph::Task bootApsTask{
     &globalInitEngine, "acpi.boot-aps", initgraph::Requires{&loadAcpiNamespaceTask}, [] {
 	    if (!acpiRsdpNote->rsdp)
 		    return;
 
 	    bootOtherProcessors();
+	    dumpCpuTopology();
     }
 };
 
@@ -2,6 +2,7 @@
 #include <thor-internal/debug.hpp>
 #include <thor-internal/elf-notes.hpp>
 #include <thor-internal/main.hpp>
+#include <thor-internal/topology.hpp>
 #include <thor-internal/arch-generic/paging.hpp>
 #include <frg/manual_box.hpp>
 #include <eir/interface.hpp>
@@ -289,6 +290,31 @@ uint64_t DeviceTreeNode::translateAddress(uint64_t addr) const {
 	__builtin_unreachable();
 }
 
+void parseCpuTopologyFromDt(DeviceTreeNode *node, CpuData *cpu) {
+	if (auto prop = node->dtNode().findProperty("numa-node-id"); prop) {
+		auto numaNode = prop->asU32();
+		if (numaNode < maxNumaNodes) {
+			registerNumaNode(numaNode);
+			cpu->topology.numaNode = numaNode;
+		}
+	}
+
+	// The last cache in the next-level-cache chain is the LLC.
+	// Limit the depth in case the chain is cyclic.
+	auto cache = node;
+	for (int depth = 0; depth < 8; ++depth) {
+		auto prop = cache->dtNode().findProperty("next-level-cache");
+		if (!prop)
+			break;
+		auto next = getDeviceTreeNodeByPhandle(prop->asU32());
+		if (!next)
+			break;
+		cache = next;
+	}
+	if (cache != node)
+		cpu->topology.llcId = cache->phandle();
+}
+
 DeviceTreeNode *getDeviceTreeNodeByPhandle(uint32_t phandle) {
 	auto it = phandles->find(phandle);
 	if (it == phandles->end())
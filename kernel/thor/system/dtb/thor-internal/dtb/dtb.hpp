@@ -17,6 +17,8 @@ namespace thor {
 
 extern ManagarmElfNote<DtData> dtDataNote;
 
+struct CpuData;
+
 namespace dt {
 struct IrqController;
 struct MbusNode;
@@ -218,6 +220,10 @@ DeviceTreeNode *getDeviceTreeRoot();
 
 initgraph::Stage *getDeviceTreeParsedStage();
 
+// Determines the NUMA node (numa-node-id) and the LLC (end of the next-level-cache chain)
+// of a CPU from its DT node.
+void parseCpuTopologyFromDt(DeviceTreeNode *node, CpuData *cpu);
+
 static inline frg::array<frg::string_view, 12> dtGicV2Compatible = {
 	"arm,arm11mp-gic",
 	"arm,cortex-a15-gic",
@@ -266,8 +266,9 @@ static initgraph::Task discoverAcpiRootBuses{&globalInitEngine, "pci.discover-ac
 				#ifdef __x86_64__
 					struct ApicMsiController final : PciMsiController {
 						smarter::shared_ptr<MsiPin> allocateMsiPin(
-								frg::string<KernelAlloc> name) override {
-							return allocateApicMsi(std::move(name));
+								frg::string<KernelAlloc> name,
+								MsiDevice *device, size_t index) override {
+							return allocateApicMsi(std::move(name), device, index);
 						}
 					};
 
@@ -416,7 +416,8 @@ coroutine<frg::expected<Error>> PciEntity::handleRequest(smarter::shared_ptr<Str
 				+ frg::string<KernelAlloc>{*kernelAlloc, "-"}
 				+ frg::to_allocated_string(*kernelAlloc, function)
 				+ frg::string<KernelAlloc>{*kernelAlloc, "."}
-				+ frg::to_allocated_string(*kernelAlloc, req->index()));
+				+ frg::to_allocated_string(*kernelAlloc, req->index()),
+				static_cast<PciDevice *>(this), req->index());
 		if(!interrupt) {
 			infoLogger() << "thor: Could not allocate interrupt vector for MSI" << frg::endlog;
 
@@ -883,15 +884,45 @@ void PciDevice::enableIrq() {
 }
 
 void PciDevice::setupMsi(MsiPin *msi, size_t index) {
+	programMsi(msi, index);
+
+	if (msixIndex >= 0) {
+		auto lock = frg::guard(&msixMutex);
+		auto space = arch::mem_space{msixMapping}.subspace(index * 16);
+		space.store(msixVectorControl,
+				space.load(msixVectorControl) & ~uint32_t{1});
+	} else {
+		assert(msiIndex >= 0);
+
+		if (msiEnabled) {
+			auto io = parentBus->io;
+			auto offset = caps[msiIndex].offset;
+
+			// Enable MSI
+			auto msgControl = io->readConfigHalf(parentBus,
+					slot, function, offset + 2);
+			msgControl |= 0x0001;
+
+			io->writeConfigHalf(parentBus,
+					slot, function, offset + 2, msgControl);
+		}
+
+		msiInstalled = true;
+	}
+}
+
+void PciDevice::programMsi(MsiPin *msi, size_t index) {
 	auto io = parentBus->io;
 
 	if (msixIndex >= 0) {
-		// Setup the MSI-X table.
+		// The message must not be modified while the vector is unmasked.
+		auto lock = frg::guard(&msixMutex);
 		auto space = arch::mem_space{msixMapping}.subspace(index * 16);
+		auto vectorControl = space.load(msixVectorControl);
+		space.store(msixVectorControl, vectorControl | 1);
 		space.store(msixMessageAddress, msi->getMessageAddress());
 		space.store(msixMessageData, msi->getMessageData());
-		space.store(msixVectorControl,
-				space.load(msixVectorControl) & ~uint32_t{1});
+		space.store(msixVectorControl, vectorControl);
 	} else {
 		assert(msiIndex >= 0);
 
@@ -903,6 +934,17 @@ void PciDevice::setupMsi(MsiPin *msi, size_t index) {
 				slot, function, offset + 2);
 
 		bool is64Capable = msgControl & (1 << 7);
+		bool perVectorMasking = msgControl & (1 << 8);
+
+		// The message must not be modified while the MSI is unmasked.
+		// Without per-vector masking, this is only safe before the MSI is enabled
+		// (see canRetargetMsi()).
+		auto maskOffset = offset + (is64Capable ? 16 : 12);
+		uint32_t maskBits = 0;
+		if (perVectorMasking) {
+			maskBits = io->readConfigWord(parentBus, slot, function, maskOffset);
+			io->writeConfigWord(parentBus, slot, function, maskOffset, maskBits | 1);
+		}
 
 		io->writeConfigWord(parentBus,
 				slot, function, offset + 4, msi->getMessageAddress() & 0xFFFFFFFF);
@@ -920,15 +962,37 @@ void PciDevice::setupMsi(MsiPin *msi, size_t index) {
 				slot, function, offset + 8, msi->getMessageData());
 		}
 
-		if (msiEnabled) {
-			// Enable MSI
-			msgControl |= 0x0001;
+		// Pending MSIs are delivered with the new message once we unmask.
+		if (perVectorMasking)
+			io->writeConfigWord(parentBus, slot, function, maskOffset, maskBits);
+	}
+}
 
-			io->writeConfigHalf(parentBus,
-					slot, function, offset + 2, msgControl);
-		}
+bool PciDevice::canRetargetMsi() {
+	if (msixIndex >= 0)
+		return true;
+	assert(msiIndex >= 0);
+	auto msgControl = parentBus->io->readConfigHalf(parentBus,
+			slot, function, caps[msiIndex].offset + 2);
+	return msgControl & (1 << 8);
+}
 
-		msiInstalled = true;
+bool PciDevice::canMaskMsi() {
+	// maskMsi() can be called from IRQ context. MSI-X vectors are masked through MMIO;
+	// we do not use the MSI mask bits since they require config space accesses.
+	return msixIndex >= 0;
+}
+
+void PciDevice::maskMsi(size_t index, bool masked) {
+	assert(msixIndex >= 0);
+
+	auto lock = frg::guard(&msixMutex);
+	auto space = arch::mem_space{msixMapping}.subspace(index * 16);
+	auto vectorControl = space.load(msixVectorControl);
+	if (masked) {
+		space.store(msixVectorControl, vectorControl | 1);
+	} else {
+		space.store(msixVectorControl, vectorControl & ~uint32_t{1});
 	}
 }
 
@@ -393,7 +393,7 @@ struct PciBridge final : PciEntity {
 	async::oneshot_event mbusPublished;
 };
 
-struct PciDevice final : PciEntity {
+struct PciDevice final : PciEntity, MsiDevice {
 	PciDevice(PciBus *parentBus_, uint32_t seg, uint32_t bus, uint32_t slot, uint32_t function,
 			uint16_t vendor, uint16_t device_id, uint8_t revision,
 			uint8_t class_code, uint8_t sub_class, uint8_t interface, uint16_t subsystem_vendor, uint16_t subsystem_device)
@@ -416,12 +416,21 @@ struct PciDevice final : PciEntity {
 	void setupMsi(MsiPin *msi, size_t index);
 	void enableMsi();
 
+	// MsiDevice implementation.
+	void programMsi(MsiPin *msi, size_t index) override;
+	bool canRetargetMsi() override;
+	bool canMaskMsi() override;
+	void maskMsi(size_t index, bool masked) override;
+
 	uint16_t subsystemVendor;
 	uint16_t subsystemDevice;
 
 	smarter::shared_ptr<IrqPin> interrupt;
 	Iommu *associatedIommu = nullptr;
 
+	// Protects read-modify-write cycles of the MSI-X vector control registers.
+	IrqSpinlock msixMutex;
+
 	// device configuration
 	PciBar bars[6];
 
@@ -549,7 +558,8 @@ protected:
 };
 
 struct PciMsiController {
-	virtual smarter::shared_ptr<MsiPin> allocateMsiPin(frg::string<KernelAlloc> name) = 0;
+	virtual smarter::shared_ptr<MsiPin> allocateMsiPin(frg::string<KernelAlloc> name,
+			MsiDevice *device, size_t index) = 0;
 
 protected:
 	~PciMsiController() = default;
@@ -1,11 +1,15 @@
 
+#include <limits.h>
 #include <string.h>
 #include <print>
+#include <vector>
 
 #include <async/recurring-event.hpp>
 #include <frg/intrusive.hpp>
 #include <frg/manual_box.hpp>
 #include <helix/ipc.hpp>
+#include <helix/memory.hpp>
+#include <protocols/posix/data.hpp>
 #include "common.hpp"
 #include "epoll.hpp"
 #include "fs.hpp"
@@ -18,6 +22,11 @@ constexpr int epollFlags = EPOLLET | EPOLLONESHOT | EPOLLWAKEUP | EPOLLEXCLUSIVE
 
 bool logEpoll = false;
 
+// Number of entries in ring mode. The entries follow the EpollRing header.
+constexpr size_t ringEntries = 256;
+static_assert(sizeof(posix::EpollRing) + ringEntries * sizeof(posix::EpollRingEntry)
+		<= epoll::ringMemorySize);
+
 struct OpenFile : FileWithDefaults {
 	// ------------------------------------------------------------------------
 	// Internal API.
@@ -62,6 +71,8 @@ private:
 		smarter::shared_ptr<File> file;
 		int eventMask;
 		uint64_t cookie;
+		// Identifies the item's events in the ring (see _ringItemIds).
+		uint64_t ringId = 0;
 
 		async::cancellation_event cancelPoll;
 
@@ -168,6 +179,7 @@ public:
 		auto item = smarter::make_shared<Item>(smarter::static_pointer_cast<OpenFile>(weakFile().lock()),
 				process, std::move(file), mask, cookie);
 		item->self = item;
+		item->ringId = ++_lastRingId;
 
 		item->state |= statePending | stateActive;
 
@@ -197,6 +209,8 @@ public:
 		item->eventMask = mask;
 		item->cookie = cookie;
 		item->cancelPoll.cancel();
+		// Published events still carry the old cookie. The item becomes pending again below.
+		_scrubRing(item->ringId);
 
 		// Mark the item as pending.
 		if(!(item->state & statePending)) {
@@ -222,15 +236,18 @@ public:
 		auto item = it->second;
 
 		item->cancelPoll.cancel();
+		_scrubRing(item->ringId);
 
 		_fileMap.erase(it);
 		item->state &= ~stateAlive;
 		return Error::success;
 	}
 
+	// If items is non-null, it receives the item of each returned event.
 	async::result<size_t>
 	waitForEvents(struct epoll_event *events, size_t max_events,
-			async::cancellation_token cancellation) {
+			async::cancellation_token cancellation,
+			smarter::shared_ptr<Item> *items = nullptr) {
 		assert(max_events);
 		if(logEpoll)
 			std::println("posix.epoll \e[1;34m{}\e[0m: Entering wait. There are {} pending items; cancellation is {}",
@@ -242,8 +259,8 @@ public:
 			frg::locate_member<Item, frg::default_list_hook<Item>, &Item::hook_>
 		> repoll_queue;
 		while(true) {
-			// TODO: Stop waiting in this case.
-			assert(isOpen());
+			if(!isOpen())
+				break;
 
 			while(!_pendingQueue.empty()) {
 				auto item = _pendingQueue.front()->self.lock();
@@ -298,6 +315,8 @@ public:
 					memset(events + k, 0, sizeof(struct epoll_event));
 					events[k].events = status;
 					events[k].data.u64 = item->cookie;
+					if(items)
+						items[k] = item;
 					k++;
 
 					if(item->eventMask & EPOLLONESHOT)
@@ -354,11 +373,198 @@ public:
 		co_return k;
 	}
 
+	bool inRingMode() {
+		return static_cast<bool>(_ringMemory);
+	}
+
+	// Switches to ring mode (if not done already) and returns the ring's memory object.
+	// In ring mode, ready events are published to the ring without waiting for epoll_wait().
+	helix::BorrowedDescriptor setupRing() {
+		if(!_ringMemory) {
+			HelHandle memory;
+			HEL_CHECK(helAllocateMemory(epoll::ringMemorySize, 0, nullptr, &memory));
+			_ringMemory = helix::UniqueDescriptor{memory};
+			_ringMapping = helix::Mapping{_ringMemory, 0, epoll::ringMemorySize};
+			_ringItemIds.resize(ringEntries);
+
+			// Consumers can write to the ring, so we use ringEntries instead of
+			// reading numEntries back.
+			auto ring = new (_ringMapping.get()) posix::EpollRing{};
+			ring->numEntries = ringEntries;
+			async::detach(_publishToRing(
+					smarter::static_pointer_cast<OpenFile>(weakFile().lock())));
+		}
+		return _ringMemory;
+	}
+
+	// Takes events from the ring on behalf of epoll_wait() requests,
+	// e.g., if the C library does not consume the ring itself.
+	async::result<size_t>
+	takeFromRing(struct epoll_event *events, size_t max_events,
+			async::cancellation_token cancellation) {
+		assert(max_events);
+		auto ring = reinterpret_cast<posix::EpollRing *>(_ringMapping.get());
+		auto entries = posix::epollRingEntries(ring);
+
+		while(isOpen()) {
+			auto tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+			auto available = _ringHead - tail;
+			if(available > ringEntries) {
+				// Consumers corrupted tail. Drop everything that was published.
+				if(__atomic_compare_exchange_n(&ring->tail, &tail, _ringHead,
+						false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST))
+					_wakeProducer();
+				continue;
+			}
+
+			if(available) {
+				size_t k = 0;
+				unsigned int n = 0;
+				while(n < available && k < max_events) {
+					auto &entry = entries[(tail + n) % ringEntries];
+					n++;
+
+					// Skip entries that were scrubbed by epoll_ctl().
+					auto entryEvents = __atomic_load_n(&entry.events, __ATOMIC_RELAXED);
+					if(!entryEvents)
+						continue;
+					memset(events + k, 0, sizeof(struct epoll_event));
+					events[k].events = entryEvents;
+					events[k].data.u64 = entry.data;
+					k++;
+				}
+				if(!__atomic_compare_exchange_n(&ring->tail, &tail, tail + n,
+						false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST))
+					continue;
+				_wakeProducer();
+
+				if(k)
+					co_return k;
+				continue;
+			}
+
+			if(!co_await _ringBell.async_wait(cancellation))
+				break;
+		}
+		co_return 0;
+	}
+
+private:
+	// Publishes events until the epoll instance is closed.
+	static async::result<void> _publishToRing(smarter::shared_ptr<OpenFile> self) {
+		auto ring = reinterpret_cast<posix::EpollRing *>(self->_ringMapping.get());
+		auto entries = posix::epollRingEntries(ring);
+		std::vector<struct epoll_event> events(ringEntries);
+		std::vector<smarter::shared_ptr<Item>> items(ringEntries);
+
+		while(self->isOpen()) {
+			// Only collect events once consumers took all published events. Hence, like
+			// with epoll_wait(), level-triggered events are reported once per drained batch.
+			if(!co_await self->_waitForConsumers())
+				break;
+
+			auto k = co_await self->waitForEvents(events.data(), events.size(),
+					self->_cancelRing, items.data());
+			unsigned int n = 0;
+			for(size_t i = 0; i < k; i++) {
+				auto item = std::move(items[i]);
+
+				// Drop events of items that were deleted or modified while we collected events.
+				auto status = events[i].events & (item->eventMask | EPOLLERR | EPOLLHUP);
+				if(!(item->state & stateAlive) || item->cookie != events[i].data.u64)
+					status = 0;
+				if(!status)
+					continue;
+
+				auto slot = (self->_ringHead + n) % ringEntries;
+				entries[slot].events = status;
+				entries[slot].data = events[i].data.u64;
+				self->_ringItemIds[slot] = item->ringId;
+				n++;
+			}
+			if(n)
+				self->_publishHead(self->_ringHead + n);
+		}
+
+		__atomic_store_n(&ring->closed, 1, __ATOMIC_SEQ_CST);
+		__atomic_fetch_add(&ring->wakeSeq, 1, __ATOMIC_SEQ_CST);
+		HEL_CHECK(helFutexWake(reinterpret_cast<int *>(&ring->wakeSeq), UINT_MAX));
+		self->_ringBell.raise();
+	}
+
+	// Returns false if the epoll instance was closed while waiting.
+	async::result<bool> _waitForConsumers() {
+		auto ring = reinterpret_cast<posix::EpollRing *>(_ringMapping.get());
+		while(true) {
+			auto tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+			if(tail == _ringHead)
+				co_return true;
+
+			// Consumers only wake us if they observe producerWaiting after advancing tail.
+			__atomic_store_n(&ring->producerWaiting, 1, __ATOMIC_SEQ_CST);
+			if(__atomic_load_n(&ring->tail, __ATOMIC_SEQ_CST) != tail)
+				continue;
+
+			auto result = co_await helix_ng::futexWait(reinterpret_cast<int *>(&ring->tail),
+					tail, -1, _cancelRing);
+			if(result.error() == kHelErrCancelled)
+				co_return false;
+			HEL_CHECK(result.error());
+		}
+	}
+
+	void _publishHead(unsigned int head) {
+		auto ring = reinterpret_cast<posix::EpollRing *>(_ringMapping.get());
+		_ringHead = head;
+		// Releases the entries to consumers that observe the new head.
+		__atomic_store_n(&ring->head, head, __ATOMIC_SEQ_CST);
+		__atomic_fetch_add(&ring->wakeSeq, 1, __ATOMIC_SEQ_CST);
+		if(__atomic_exchange_n(&ring->consumerWaiting, 0, __ATOMIC_SEQ_CST))
+			HEL_CHECK(helFutexWake(reinterpret_cast<int *>(&ring->wakeSeq), UINT_MAX));
+		_ringBell.raise();
+
+		// The epoll instance itself is readable while the ring holds events.
+		_currentSeq++;
+		_statusBell.raise();
+	}
+
+	// Called after we advance tail on behalf of a consumer.
+	void _wakeProducer() {
+		auto ring = reinterpret_cast<posix::EpollRing *>(_ringMapping.get());
+		if(__atomic_exchange_n(&ring->producerWaiting, 0, __ATOMIC_SEQ_CST))
+			HEL_CHECK(helFutexWake(reinterpret_cast<int *>(&ring->tail), UINT_MAX));
+	}
+
+	// Invalidates the item's events that are published but not consumed yet, such that
+	// consumers do not report them after epoll_ctl() returns. Consumers skip entries
+	// with zero events.
+	void _scrubRing(uint64_t ringId) {
+		if(!_ringMemory)
+			return;
+		auto ring = reinterpret_cast<posix::EpollRing *>(_ringMapping.get());
+		auto entries = posix::epollRingEntries(ring);
+
+		// Consumers can corrupt tail; never look at more than the whole ring.
+		auto tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+		auto n = std::min(_ringHead - tail, static_cast<unsigned int>(ringEntries));
+		for(unsigned int i = 0; i < n; i++) {
+			auto slot = (_ringHead - n + i) % ringEntries;
+			if(_ringItemIds[slot] != ringId)
+				continue;
+			__atomic_store_n(&entries[slot].events, 0, __ATOMIC_RELAXED);
+			_ringItemIds[slot] = 0;
+		}
+	}
+
+public:
 	// ------------------------------------------------------------------------
 	// File implementation.
 	// ------------------------------------------------------------------------
 
 	void handleClose() override {
+		_cancelRing.cancel();
+		_ringBell.raise();
+
 		auto it = _fileMap.begin();
 		while(it != _fileMap.end()) {
 			auto item = it->second;
@@ -409,7 +615,13 @@ public:
 
 	async::result<frg::expected<Error, PollStatusResult>>
 	pollStatus(Process *) override {
-		co_return PollStatusResult{_currentSeq, _pendingQueue.empty() ? 0 : EPOLLIN};
+		bool ready = !_pendingQueue.empty();
+		if(_ringMemory) {
+			// In ring mode, ready events are held in the ring instead.
+			auto ring = reinterpret_cast<posix::EpollRing *>(_ringMapping.get());
+			ready = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) != _ringHead;
+		}
+		co_return PollStatusResult{_currentSeq, ready ? EPOLLIN : 0};
 	}
 
 	helix::BorrowedDescriptor getPassthroughLane() override {
@@ -433,6 +645,18 @@ private:
 	helix::UniqueLane _passthrough;
 	async::cancellation_event _cancelServe;
 
+	// Only used in ring mode.
+	helix::UniqueDescriptor _ringMemory;
+	helix::Mapping _ringMapping;
+	async::cancellation_event _cancelRing;
+	// Published head of the ring; consumers cannot modify this copy.
+	unsigned int _ringHead = 0;
+	// Item::ringId of each ring entry (zero if the entry was scrubbed).
+	std::vector<uint64_t> _ringItemIds;
+	uint64_t _lastRingId = 0;
+	// Raised when events are published or the ring is closed.
+	async::recurring_event _ringBell;
+
 	// Since Item stores a strong pointer to each File,
 	// it is sufficient if Key stores a plain (= non-owning) pointer.
 	using Key = std::pair<File *, int>;
@@ -485,8 +709,20 @@ Error deleteItem(File *epfile, File *file, int fd, int flags) {
 async::result<size_t> wait(File *epfile, struct epoll_event *events,
 		size_t max_events, async::cancellation_token cancellation) {
 	auto epoll = static_cast<OpenFile *>(epfile);
+	// In ring mode, the ring's producer drains the pending queue.
+	if(epoll->inRingMode())
+		return epoll->takeFromRing(events, max_events, cancellation);
 	return epoll->waitForEvents(events, max_events, cancellation);
 }
 
+bool isEpoll(File *file) {
+	return dynamic_cast<OpenFile *>(file);
+}
+
+helix::BorrowedDescriptor setupRing(File *epfile) {
+	auto epoll = static_cast<OpenFile *>(epfile);
+	return epoll->setupRing();
+}
+
 } // namespace epoll
 
@@ -16,5 +16,16 @@ Error deleteItem(File *epfile, File *file, int fd, int flags);
 async::result<size_t> wait(File *epfile, struct epoll_event *events,
 		size_t max_events, async::cancellation_token cancellation = {});
 
+bool isEpoll(File *file);
+
+// Size of the memory object returned by setupRing().
+constexpr size_t ringMemorySize = 0x2000;
+
+// Switches the epoll instance to ring mode and returns the memory object that holds
+// the posix::EpollRing. In ring mode, the posix server publishes ready events into the ring
+// such that epoll_wait() does not need a request if events are pending.
+// wait() then takes events from the ring as well.
+helix::BorrowedDescriptor setupRing(File *epfile);
+
 } // namespace epoll
 
@@ -1,5 +1,6 @@
 #include <async/cancellation.hpp>
 #include <sys/epoll.h>
+#include <list>
 #include <map>
 
 #include <bragi/helpers-std.hpp>
@@ -28,6 +29,9 @@ struct Superblock final : FsSuperblock {
 			rename(FsLink *source, FsNode *directory, std::string name) override;
 	async::result<frg::expected<Error, FsStats>> getFsStats() override;
 
+	async::result<std::expected<size_t, Error>> copyFileRange(uint64_t sourceInode, uint64_t sourceOffset,
+			uint64_t targetInode, uint64_t targetOffset, size_t length);
+
 	std::string getFsType() override {
 		return "ext2";
 	}
@@ -53,6 +57,96 @@ private:
 	std::shared_ptr<UnixDevice> device_;
 };
 
+// Caches the results of lookups in the directories of all extern_fs superblocks,
+// including lookups that failed with ENOENT (e.g., PATH searches and library probing).
+// The file system servers are only modified through this subsystem, hence entries are
+// invalidated whenever we send a request that adds, removes or renames a link.
+struct DentryCache {
+	using Key = std::tuple<Superblock *, uint64_t, std::string>;
+
+	static constexpr size_t capacity = 4096;
+
+	// Returns std::nullopt if the lookup is not cached and a null link for negative entries.
+	std::optional<std::shared_ptr<FsLink>> lookup(Superblock *sb, uint64_t directory,
+			const std::string &name) {
+		auto it = _map.find(Key{sb, directory, name});
+		if(it == _map.end()) {
+			_stats.misses++;
+			return std::nullopt;
+		}
+
+		_lru.splice(_lru.begin(), _lru, it->second);
+		_stats.hits++;
+		if(!it->second->link)
+			_stats.negativeHits++;
+		return it->second->link;
+	}
+
+	// Lookups capture the generation before they send their request; their results are
+	// only inserted if no invalidation happened in the meantime.
+	uint64_t generation() {
+		return _generation;
+	}
+
+	void insert(uint64_t generation, Superblock *sb, uint64_t directory,
+			std::string name, std::shared_ptr<FsLink> link) {
+		if(generation != _generation)
+			return;
+
+		Key key{sb, directory, std::move(name)};
+		if(auto it = _map.find(key); it != _map.end())
+			_erase(it);
+
+		_lru.push_front(Item{key, std::move(link)});
+		_map.emplace(std::move(key), _lru.begin());
+		_stats.entries++;
+		if(!_lru.front().link)
+			_stats.negativeEntries++;
+
+		while(_lru.size() > capacity) {
+			_erase(_map.find(_lru.back().key));
+			_stats.evictions++;
+		}
+	}
+
+	void invalidate(Superblock *sb, uint64_t directory, const std::string &name) {
+		_generation++;
+		if(auto it = _map.find(Key{sb, directory, name}); it != _map.end()) {
+			_erase(it);
+			_stats.invalidations++;
+		}
+	}
+
+	DentryCacheStatistics statistics() {
+		auto stats = _stats;
+		stats.capacity = capacity;
+		return stats;
+	}
+
+private:
+	struct Item {
+		Key key;
+		// Null for negative entries.
+		std::shared_ptr<FsLink> link;
+	};
+
+	void _erase(std::map<Key, std::list<Item>::iterator>::iterator it) {
+		_stats.entries--;
+		if(!it->second->link)
+			_stats.negativeEntries--;
+		_lru.erase(it->second);
+		_map.erase(it);
+	}
+
+	// Most recently used items are at the front.
+	std::list<Item> _lru;
+	std::map<Key, std::list<Item>::iterator> _map;
+	uint64_t _generation = 0;
+	DentryCacheStatistics _stats;
+};
+
+DentryCache dentryCache;
+
 struct Node : FsNode {
 	async::result<frg::expected<Error, FileStats>> getStats() override {
 		managarm::fs::CntRequest req;
@@ -216,6 +310,10 @@ private:
 
 struct OpenFile final : File {
 private:
+	static bool isRegular(FsLink *link) {
+		return link && link->getTarget()->getType() == VfsType::regular;
+	}
+
 	async::result<frg::expected<Error, off_t>> seek(off_t offset, VfsSeek whence) override {
 		if(whence == VfsSeek::absolute) {
 			co_await _file.seekAbsolute(offset);
@@ -241,6 +339,20 @@ private:
 		co_return res.transform_error(toPosixError);
 	}
 
+	async::result<std::expected<size_t, Error>>
+	pread(Process *, int64_t offset, void *buffer, size_t length) override {
+		auto res = co_await _file.pread(offset, buffer, length);
+		co_return res.transform_error(toPosixError);
+	}
+
+	async::result<frg::expected<Error, size_t>>
+	pwrite(Process *, int64_t offset, const void *data, size_t length) override {
+		auto res = co_await _file.pwrite(offset, data, length);
+		if(!res)
+			co_return res.error() | toPosixError;
+		co_return res.value();
+	}
+
 	async::result<frg::expected<Error, PollWaitResult>>
 	pollWait(Process *, uint64_t sequence, int mask,
 			async::cancellation_token cancellation) override {
@@ -271,7 +383,8 @@ private:
 public:
 	OpenFile(helix::UniqueLane control, helix::UniqueLane lane,
 			std::shared_ptr<MountView> mount, std::shared_ptr<FsLink> link)
-	: File{FileKind::unknown, StructName::get("externfs.file"), std::move(mount), std::move(link)},
+	: File{FileKind::unknown, StructName::get("externfs.file"), std::move(mount), link,
+			isRegular(link.get()) ? File::defaultHasContentMemory : 0},
 			_control{std::move(control)}, _file{std::move(lane)} { }
 
 	~OpenFile() override {
@@ -539,6 +652,7 @@ private:
 		managarm::fs::GetLinkOrCreateResponse resp;
 		resp.ParseFromArray(recv_resp.data(), recv_resp.length());
 		recv_resp.reset();
+		dentryCache.invalidate(_sb, getInode(), name);
 		if(resp.error() == managarm::fs::Errors::SUCCESS) {
 			HEL_CHECK(pull_node.error());
 
@@ -558,6 +672,17 @@ private:
 
 	async::result<frg::expected<Error, std::pair<std::shared_ptr<FsLink>, size_t>>>
 	traverseLinks(std::deque<std::string> path) override {
+		// Only the first component is resolved from the cache, such that our caller
+		// handles mount points and symlinks before we continue with the remaining ones.
+		if(!path.empty() && path.front() != "." && path.front() != "..") {
+			if(auto cached = dentryCache.lookup(_sb, getInode(), path.front()); cached) {
+				if(!*cached)
+					co_return Error::noSuchFile;
+				co_return std::make_pair(std::move(*cached), size_t{1});
+			}
+		}
+		auto generation = dentryCache.generation();
+
 		managarm::fs::NodeTraverseLinksRequest req;
 		for (auto &i : path)
 			req.add_path_segments(i);
@@ -607,8 +732,22 @@ private:
 			co_return Error::ioError;
 		}
 
-		if(resp.error() != managarm::fs::Errors::SUCCESS)
-			co_return resp.error() | toPosixError;
+		if(resp.error() != managarm::fs::Errors::SUCCESS) {
+			auto error = resp.error() | toPosixError;
+			if(error == Error::noSuchFile && path.size() == 1) {
+				dentryCache.insert(generation, _sb, getInode(), path.front(), nullptr);
+			}else if(error == Error::noSuchFile
+					&& path.front() != "." && path.front() != "..") {
+				// The response does not tell us which component is missing. Look up the
+				// first one on its own, such that repeated resolutions hit the cache.
+				auto first = co_await getLink(path.front());
+				if(!first)
+					co_return first.error();
+				if(first.value()->getTarget()->getType() == VfsType::directory)
+					co_return std::make_pair(first.value(), size_t{1});
+			}
+			co_return error;
+		}
 
 		HEL_CHECK(pull_desc.error());
 		helix::UniqueLane pull_lane = pull_desc.descriptor();
@@ -625,19 +764,26 @@ private:
 
 			HEL_CHECK(pull_node.error());
 
+			auto parentInode = parentNode->getInode();
+			std::shared_ptr<FsLink> childLink;
 			if (i != resp.ids().size() - 1
 					|| resp.file_type() == managarm::fs::FileType::DIRECTORY) {
 				auto child = _sb->internalizeStructural(parentNode.get(), path[i],
 						resp.ids()[i], pull_node.descriptor());
+				childLink = child->treeLink();
 				if (i != resp.ids().size() - 1)
 					parentNode = child;
 				else
-					link = child->treeLink();
+					link = childLink;
 			}else{
 				auto child = _sb->internalizePeripheralNode(resp.file_type(), resp.ids()[i],
 						pull_node.descriptor());
-				link = _sb->internalizePeripheralLink(parentNode.get(), path[i], std::move(child));
+				childLink = _sb->internalizePeripheralLink(parentNode.get(), path[i], std::move(child));
+				link = childLink;
 			}
+
+			if (path[i] != "." && path[i] != "..")
+				dentryCache.insert(generation, _sb, parentInode, path[i], std::move(childLink));
 		}
 
 		co_return std::make_pair(link, resp.links_traversed());
@@ -669,6 +815,7 @@ private:
 		managarm::fs::SvrResponse resp;
 		resp.ParseFromArray(recvResp.data(), recvResp.length());
 		recvResp.reset();
+		dentryCache.invalidate(_sb, getInode(), name);
 		if(resp.error() == managarm::fs::Errors::SUCCESS) {
 			HEL_CHECK(pullNode.error());
 
@@ -707,6 +854,7 @@ private:
 		managarm::fs::SvrResponse resp;
 		resp.ParseFromArray(recvResp.data(), recvResp.length());
 		recvResp.reset();
+		dentryCache.invalidate(_sb, getInode(), name);
 		if(resp.error() == managarm::fs::Errors::SUCCESS) {
 			HEL_CHECK(pullNode.error());
 
@@ -728,6 +876,13 @@ private:
 
 	async::result<frg::expected<Error, std::shared_ptr<FsLink>>>
 			getLink(std::string name) override {
+		if(auto cached = dentryCache.lookup(_sb, getInode(), name); cached) {
+			if(!*cached)
+				co_return Error::noSuchFile;
+			co_return std::move(*cached);
+		}
+		auto generation = dentryCache.generation();
+
 		managarm::fs::GetLinkRequest req;
 		req.set_path(name);
 
@@ -750,16 +905,21 @@ private:
 		if(resp.error() == managarm::fs::Errors::SUCCESS) {
 			HEL_CHECK(pull_node.error());
 
+			std::shared_ptr<FsLink> link;
 			if(resp.file_type() == managarm::fs::FileType::DIRECTORY) {
 				auto child = _sb->internalizeStructural(this, name,
 						resp.id(), pull_node.descriptor());
-				co_return child->treeLink();
+				link = child->treeLink();
 			}else{
 				auto child = _sb->internalizePeripheralNode(resp.file_type(), resp.id(),
 						pull_node.descriptor());
-				co_return _sb->internalizePeripheralLink(this, name, std::move(child));
+				link = _sb->internalizePeripheralLink(this, name, std::move(child));
 			}
+			dentryCache.insert(generation, _sb, getInode(), name, link);
+			co_return link;
 		}else{
+			if(resp.error() == managarm::fs::Errors::FILE_NOT_FOUND)
+				dentryCache.insert(generation, _sb, getInode(), name, nullptr);
 			co_return resp.error() | toPosixError;
 		}
 	}
@@ -786,6 +946,7 @@ private:
 		managarm::fs::SvrResponse resp;
 		resp.ParseFromArray(recv_resp.data(), recv_resp.length());
 		recv_resp.reset();
+		dentryCache.invalidate(_sb, getInode(), name);
 		if(resp.error() == managarm::fs::Errors::SUCCESS) {
 			HEL_CHECK(pull_node.error());
 
@@ -822,6 +983,7 @@ private:
 		managarm::fs::SvrResponse resp;
 		resp.ParseFromArray(recv_resp.data(), recv_resp.length());
 		recv_resp.reset();
+		dentryCache.invalidate(_sb, getInode(), name);
 		if(resp.error() != managarm::fs::Errors::SUCCESS)
 			co_return resp.error() | toPosixError;
 
@@ -847,6 +1009,7 @@ private:
 		managarm::fs::SvrResponse resp;
 		resp.ParseFromArray(recv_resp.data(), recv_resp.length());
 		recv_resp.reset();
+		dentryCache.invalidate(_sb, getInode(), name);
 
 		if(resp.error() != managarm::fs::Errors::SUCCESS)
 			co_return resp.error() | toPosixError;
@@ -982,6 +1145,8 @@ async::result<frg::expected<Error, std::shared_ptr<FsLink>>>
 	managarm::fs::SvrResponse resp;
 	resp.ParseFromArray(recv_resp.data(), recv_resp.length());
 	recv_resp.reset();
+	dentryCache.invalidate(this, source_node->getInode(), source->getName());
+	dentryCache.invalidate(this, target_node->getInode(), name);
 	if(resp.error() == managarm::fs::Errors::SUCCESS)
 		co_return internalizePeripheralLink(target_node, name, shared_node);
 	co_return resp.error() | toPosixError;
@@ -1090,6 +1255,35 @@ async::result<frg::expected<Error, FsStats>> Superblock::getFsStats() {
 	co_return stats;
 }
 
+async::result<std::expected<size_t, Error>>
+Superblock::copyFileRange(uint64_t sourceInode, uint64_t sourceOffset,
+		uint64_t targetInode, uint64_t targetOffset, size_t length) {
+	managarm::fs::CopyFileRangeRequest req;
+	req.set_inode_source(sourceInode);
+	req.set_offset_source(sourceOffset);
+	req.set_inode_target(targetInode);
+	req.set_offset_target(targetOffset);
+	req.set_size(length);
+
+	auto [offer, send_req, recv_resp] = co_await helix_ng::exchangeMsgs(
+		_lane,
+		helix_ng::offer(
+			helix_ng::sendBragiHeadOnly(req, frg::stl_allocator{}),
+			helix_ng::recvInline()
+		)
+	);
+	HEL_CHECK(offer.error());
+	HEL_CHECK(send_req.error());
+	HEL_CHECK(recv_resp.error());
+
+	managarm::fs::CopyFileRangeResponse resp;
+	resp.ParseFromArray(recv_resp.data(), recv_resp.length());
+	recv_resp.reset();
+	if(resp.error() != managarm::fs::Errors::SUCCESS)
+		co_return std::unexpected{resp.error() | toPosixError};
+	co_return resp.size();
+}
+
 } // anonymous namespace
 
 std::shared_ptr<FsLink> createRoot(helix::UniqueLane sb_lane, helix::UniqueLane lane, std::shared_ptr<UnixDevice> device) {
@@ -1107,5 +1301,24 @@ createFile(helix::UniqueLane lane, std::shared_ptr<MountView> mount, std::shared
 	return File::constructHandle(std::move(file));
 }
 
+async::result<std::expected<size_t, Error>>
+copyFileRange(File *in, uint64_t inOffset, File *out, uint64_t outOffset, size_t length) {
+	if(!dynamic_cast<OpenFile *>(in) || !dynamic_cast<OpenFile *>(out))
+		co_return std::unexpected{Error::notSupported};
+
+	auto inNode = std::dynamic_pointer_cast<Node>(in->associatedLink()->getTarget());
+	auto outNode = std::dynamic_pointer_cast<Node>(out->associatedLink()->getTarget());
+	if(!inNode || !outNode || inNode->superblock() != outNode->superblock())
+		co_return std::unexpected{Error::notSupported};
+
+	auto sb = static_cast<Superblock *>(inNode->superblock());
+	co_return co_await sb->copyFileRange(inNode->getInode(), inOffset,
+			outNode->getInode(), outOffset, length);
+}
+
+DentryCacheStatistics getDentryCacheStatistics() {
+	return dentryCache.statistics();
+}
+
 } // namespace extern_fs
 
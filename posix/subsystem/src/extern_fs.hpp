@@ -5,9 +5,31 @@
 
 namespace extern_fs {
 
+struct DentryCacheStatistics {
+	// Number of cached lookup results, including negative entries.
+	size_t entries = 0;
+	// Number of cached lookups that failed with ENOENT.
+	size_t negativeEntries = 0;
+	size_t capacity = 0;
+	// Lookups that were answered from the cache (positive or negative).
+	uint64_t hits = 0;
+	uint64_t negativeHits = 0;
+	// Lookups that required a request to the file system server.
+	uint64_t misses = 0;
+	uint64_t invalidations = 0;
+	uint64_t evictions = 0;
+};
+
 std::shared_ptr<FsLink> createRoot(helix::UniqueLane sb_lane, helix::UniqueLane lane, std::shared_ptr<UnixDevice> device);
 
 smarter::shared_ptr<File, FileHandle>
 createFile(helix::UniqueLane lane, std::shared_ptr<MountView> mount, std::shared_ptr<FsLink> link);
 
+// Copies data between two files on the same file system server without transferring
+// the data to the posix subsystem. Fails with Error::notSupported if that is not possible.
+async::result<std::expected<size_t, Error>>
+copyFileRange(File *in, uint64_t inOffset, File *out, uint64_t outOffset, size_t length);
+
+DentryCacheStatistics getDentryCacheStatistics();
+
 } // namespace extern_fs
@@ -2,14 +2,17 @@
 #include <async/cancellation.hpp>
 #include <string.h>
 #include <sys/epoll.h>
+#include <bit>
+#include <deque>
 #include <iostream>
 #include <map>
+#include <memory>
 #include <print>
+#include <vector>
 
 #include <async/recurring-event.hpp>
 #include <bragi/helpers-std.hpp>
 #include <core/dispatch.hpp>
-#include <frg/ringbuffer.hpp>
 #include <helix/ipc.hpp>
 #include "fifo.hpp"
 #include "fs.bragi.hpp"
@@ -24,9 +27,30 @@ constexpr bool logFifos = false;
 
 constexpr size_t defaultFifoBufferSize = 65536;
 
+// Pipes store their data in page-sized segments.
+constexpr size_t segmentSize = 4096;
+
+// Upper limit for F_SETPIPE_SZ by unprivileged processes (/proc/sys/fs/pipe-max-size).
+size_t maxPipeSize = 1024 * 1024;
+
+// Pipe capacities are powers of two that hold at least one segment.
+size_t roundPipeSize(size_t size) {
+	if(size <= segmentSize)
+		return segmentSize;
+	return std::bit_ceil(size);
+}
+
+// Segments only reference their page. This allows tee() to share pages between pipes
+// and splice() to move pages from one pipe to another without copying the data.
+struct Segment {
+	std::shared_ptr<uint8_t[]> page;
+	size_t offset;
+	size_t length;
+};
+
 struct Channel {
-	Channel(size_t capacity) : writerCount{0}, readerCount{0}, ring{capacity} {
-		assert(capacity);
+	Channel(size_t capacity) : writerCount{0}, readerCount{0}, capacity{capacity} {
+		assert(capacity >= segmentSize);
 		assert(std::has_single_bit(capacity));
 	}
 
@@ -44,7 +68,119 @@ struct Channel {
 	async::recurring_event readerPresent;
 	async::recurring_event writerPresent;
 
-	frg::byte_ring_buffer<frg::stl_allocator> ring;
+	// Capacity in bytes. Like on Linux, this also limits the number of segments
+	// to capacity / segmentSize, even if the segments are only partially filled.
+	size_t capacity;
+	// Total length of all segments.
+	size_t size = 0;
+	std::deque<Segment> segments;
+
+	bool empty() {
+		return !size;
+	}
+
+	bool canAppendSegment() {
+		return segments.size() < capacity / segmentSize && size < capacity;
+	}
+
+	// Returns true if write() can fill up the last segment instead of appending a new one.
+	bool canExtendLastSegment() {
+		if(segments.empty())
+			return false;
+		auto &last = segments.back();
+		// Do not modify pages that other pipes still reference.
+		return last.page.use_count() == 1 && last.offset + last.length < segmentSize;
+	}
+
+	// Number of bytes that write() accepts.
+	size_t availableSpace() {
+		if(size >= capacity)
+			return 0;
+		size_t space = 0;
+		if(segments.size() < capacity / segmentSize)
+			space += (capacity / segmentSize - segments.size()) * segmentSize;
+		if(canExtendLastSegment())
+			space += segmentSize - segments.back().offset - segments.back().length;
+		return std::min(space, capacity - size);
+	}
+
+	void append(Segment segment) {
+		size += segment.length;
+		segments.push_back(std::move(segment));
+	}
+
+	// Copies data into the buffer. Returns the number of bytes written.
+	size_t write(const uint8_t *data, size_t length) {
+		length = std::min(length, availableSpace());
+		size_t progress = 0;
+		while(progress < length) {
+			if(!canExtendLastSegment())
+				segments.push_back(Segment{std::shared_ptr<uint8_t[]>{new uint8_t[segmentSize]}, 0, 0});
+			auto &last = segments.back();
+			auto chunk = std::min(length - progress, segmentSize - last.offset - last.length);
+			memcpy(last.page.get() + last.offset + last.length, data + progress, chunk);
+			last.length += chunk;
+			progress += chunk;
+		}
+		size += length;
+		return length;
+	}
+
+	// Copies data out of the buffer and consumes it. Returns the number of bytes read.
+	size_t read(uint8_t *data, size_t maxLength) {
+		size_t progress = 0;
+		while(progress < maxLength && !segments.empty()) {
+			auto &front = segments.front();
+			auto chunk = std::min(maxLength - progress, front.length);
+			memcpy(data + progress, front.page.get() + front.offset, chunk);
+			progress += chunk;
+			consumeFront(chunk);
+		}
+		return progress;
+	}
+
+	// Appends up to maxLength bytes from the front of this buffer to target.
+	// The data is consumed unless share is set. No data is copied in either case.
+	size_t transferTo(Channel &target, size_t maxLength, bool share) {
+		size_t progress = 0;
+		size_t index = 0;
+		while(progress < maxLength && index < segments.size() && target.canAppendSegment()) {
+			auto &segment = segments[index];
+			auto chunk = std::min({segment.length, maxLength - progress, target.capacity - target.size});
+			if(!share && chunk == segment.length) {
+				target.append(std::move(segment));
+				segments.pop_front();
+				size -= chunk;
+			} else {
+				target.append(Segment{segment.page, segment.offset, chunk});
+				if(share)
+					index++;
+				else
+					consumeFront(chunk);
+			}
+			progress += chunk;
+		}
+		return progress;
+	}
+
+	// Fails if the data in the buffer does not fit into the new capacity.
+	bool resize(size_t newCapacity) {
+		if(segments.size() > newCapacity / segmentSize || size > newCapacity)
+			return false;
+		capacity = newCapacity;
+		return true;
+	}
+
+private:
+	void consumeFront(size_t length) {
+		auto &front = segments.front();
+		assert(length <= front.length);
+		front.offset += length;
+		front.length -= length;
+		size -= length;
+		if(!front.length)
+			segments.pop_front();
+	}
 };
 
 struct OpenFile : FileWithDefaults {
@@ -99,7 +235,7 @@ public:
 
 		size_t chunk = 0;
 		while (true) {
-			chunk = _channel->ring.dequeue({static_cast<uint8_t *>(data), maxLength});
+			chunk = _channel->read(static_cast<uint8_t *>(data), maxLength);
 			if (chunk)
 				break;
 
@@ -109,7 +245,7 @@ public:
 				co_return std::unexpected{Error::wouldBlock};
 
 			if (!(co_await _channel->statusBell.async_wait_if([&]() {
-				return !_channel->ring.size();
+				return _channel->empty();
 			}, ce)))
 				co_return std::unexpected{Error::interrupted};
 		}
@@ -130,7 +266,7 @@ public:
 
 		size_t chunk = 0;
 		while (true) {
-			chunk = _channel->ring.enqueue({static_cast<const uint8_t *>(data), maxLength});
+			chunk = _channel->write(static_cast<const uint8_t *>(data), maxLength);
 			if (chunk)
 				break;
 
@@ -138,7 +274,7 @@ public:
 				co_return Error::wouldBlock;
 
 			co_await _channel->statusBell.async_wait_if([&]() {
-				return !_channel->ring.available_space();
+				return !_channel->availableSpace();
 			}); // TODO: EINTR
 		}
 
@@ -147,6 +283,122 @@ public:
 		co_return chunk;
 	}
 
+	// Moves data from this pipe into the pipe of sink.
+	// If share is set, the data is not consumed and the pages are shared instead (i.e., tee()).
+	async::result<std::expected<size_t, Error>>
+	transferTo(OpenFile *sink, size_t maxLength, bool share, bool nonBlock) {
+		if (!isReader_ || !sink->isWriter_)
+			co_return std::unexpected{Error::badFileDescriptor};
+		if (_channel == sink->_channel)
+			co_return std::unexpected{Error::illegalArguments};
+		if (!maxLength)
+			co_return size_t{0};
+
+		// Keep both channels alive even if the files are closed while we wait.
+		auto source = _channel;
+		auto target = sink->_channel;
+
+		while (true) {
+			if (!target->readerCount)
+				co_return std::unexpected{Error::brokenPipe};
+			if (!source->empty() && target->canAppendSegment())
+				break;
+
+			if (source->empty() && !source->writerCount)
+				co_return size_t{0};
+			if (nonBlock)
+				co_return std::unexpected{Error::wouldBlock};
+
+			if (source->empty()) {
+				co_await source->statusBell.async_wait_if([&]() {
+					return source->empty() && source->writerCount;
+				});
+			} else {
+				co_await target->statusBell.async_wait_if([&]() {
+					return !target->canAppendSegment() && target->readerCount;
+				});
+			}
+		}
+
+		auto chunk = source->transferTo(*target, maxLength, share);
+		assert(chunk);
+
+		if (!share) {
+			source->outSeq = ++source->currentSeq;
+			source->statusBell.raise();
+		}
+		target->inSeq = ++target->currentSeq;
+		target->statusBell.raise();
+		co_return chunk;
+	}
+
+	// Lets fill() write up to maxLength bytes directly into new segments.
+	async::result<std::expected<size_t, Error>>
+	fillFrom(size_t maxLength, FillFunction &fill) {
+		if (!isWriter_)
+			co_return std::unexpected{Error::badFileDescriptor};
+		if (!maxLength)
+			co_return size_t{0};
+
+		auto channel = _channel;
+		while (true) {
+			if (!channel->readerCount)
+				co_return std::unexpected{Error::brokenPipe};
+			if (channel->canAppendSegment())
+				break;
+			if (nonBlock_)
+				co_return std::unexpected{Error::wouldBlock};
+
+			co_await channel->statusBell.async_wait_if([&]() {
+				return !channel->canAppendSegment() && channel->readerCount;
+			});
+		}
+
+		auto numSegments = channel->capacity / segmentSize - channel->segments.size();
+		auto length = std::min({maxLength, channel->capacity - channel->size,
+				numSegments * segmentSize});
+		// Round up to whole pages such that each segment gets its own page-sized slice of block.
+		// The slices share the control block of block, hence write() does not extend them
+		// (see canExtendLastSegment()) while more than one of them is alive.
+		auto numPages = (length + segmentSize - 1) / segmentSize;
+		std::shared_ptr<uint8_t[]> block{new uint8_t[numPages * segmentSize]};
+
+		auto result = co_await fill(block.get(), length);
+		if (!result || !result.value())
+			co_return result;
+
+		// Other writers may have appended data while fill() was running. In that case,
+		// we exceed the capacity temporarily instead of dropping data that was already read.
+		for (size_t offset = 0; offset < result.value(); offset += segmentSize)
+			channel->append(Segment{std::shared_ptr<uint8_t[]>{block, block.get() + offset},
+					0, std::min(segmentSize, result.value() - offset)});
+
+		channel->inSeq = ++channel->currentSeq;
+		channel->statusBell.raise();
+		co_return result.value();
+	}
+
+	size_t pipeSize() {
+		return _channel->capacity;
+	}
+
+	// Returns the new capacity.
+	std::expected<size_t, Error> resizePipe(size_t size, bool privileged) {
+		// The capacity is returned as an int by fcntl().
+		if (size > (size_t{1} << 30))
+			return std::unexpected{Error::illegalArguments};
+		auto capacity = roundPipeSize(size);
+		if (capacity > maxPipeSize && !privileged)
+			return std::unexpected{Error::insufficientPermissions};
+		if (!_channel->resize(capacity))
+			return std::unexpected{Error::resourceBusy};
+
+		// Writers may be waiting for space.
+		_channel->outSeq = ++_channel->currentSeq;
+		_channel->statusBell.raise();
+		return capacity;
+	}
+
 	async::result<frg::expected<Error, PollWaitResult>>
 	pollWait(Process *, uint64_t pastSeq, int mask,
 			async::cancellation_token cancellation) override {
@@ -190,11 +442,11 @@ public:
 		if (isReader_) {
 			if(!_channel->writerCount)
 				events |= EPOLLHUP;
-			if(!_channel->ring.empty())
+			if(!_channel->empty())
 				events |= EPOLLIN;
 		}
 		if (isWriter_) {
-			if(_channel->ring.available_space())
+			if(_channel->availableSpace())
 				events |= EPOLLOUT;
 			if(!_channel->readerCount)
 				events |= EPOLLERR;
@@ -246,7 +498,7 @@ public:
 				case FIONREAD: {
 					size_t count = 0;
 					if (self->isReader_)
-						count = self->_channel->ring.size();
+						count = self->_channel->size;
 
 					resp.set_fionread_count(count);
 					resp.set_error(managarm::fs::Errors::SUCCESS);
@@ -376,5 +628,57 @@ std::array<smarter::shared_ptr<File, FileHandle>, 2> createPair(bool nonBlock) {
 			File::constructHandle(std::move(w_file))};
 }
 
+bool isPipe(File *file) {
+	return dynamic_cast<OpenFile *>(file);
+}
+
+async::result<std::expected<size_t, Error>>
+tee(File *in, File *out, size_t maxLength, bool nonBlock) {
+	auto source = dynamic_cast<OpenFile *>(in);
+	auto sink = dynamic_cast<OpenFile *>(out);
+	if (!source || !sink)
+		co_return std::unexpected{Error::illegalArguments};
+	co_return co_await source->transferTo(sink, maxLength, true, nonBlock);
+}
+
+async::result<std::expected<size_t, Error>>
+splice(File *in, File *out, size_t maxLength, bool nonBlock) {
+	auto source = dynamic_cast<OpenFile *>(in);
+	auto sink = dynamic_cast<OpenFile *>(out);
+	if (!source || !sink)
+		co_return std::unexpected{Error::illegalArguments};
+	co_return co_await source->transferTo(sink, maxLength, false, nonBlock);
+}
+
+async::result<std::expected<size_t, Error>>
+fill(File *out, size_t maxLength, FillFunction fill) {
+	auto sink = dynamic_cast<OpenFile *>(out);
+	if (!sink)
+		co_return std::unexpected{Error::illegalArguments};
+	co_return co_await sink->fillFrom(maxLength, fill);
+}
+
+std::expected<size_t, Error> getPipeSize(File *file) {
+	auto pipe = dynamic_cast<OpenFile *>(file);
+	if (!pipe)
+		return std::unexpected{Error::badFileDescriptor};
+	return pipe->pipeSize();
+}
+
+std::expected<size_t, Error> setPipeSize(File *file, size_t size, bool privileged) {
+	auto pipe = dynamic_cast<OpenFile *>(file);
+	if (!pipe)
+		return std::unexpected{Error::badFileDescriptor};
+	return pipe->resizePipe(size, privileged);
+}
+
+size_t getMaxPipeSize() {
+	return maxPipeSize;
+}
+
+void setMaxPipeSize(size_t size) {
+	maxPipeSize = roundPipeSize(std::min(size, size_t{1} << 30));
+}
+
 } // namespace fifo
 
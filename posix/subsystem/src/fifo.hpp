@@ -1,5 +1,7 @@
 #pragma once
 
+#include <functional>
+
 #include "file.hpp"
 #include "fs.hpp"
 
@@ -12,5 +14,34 @@ openNamedChannel(std::shared_ptr<MountView> mount, std::shared_ptr<FsLink> link,
 
 std::array<smarter::shared_ptr<File, FileHandle>, 2> createPair(bool nonBlock);
 
+bool isPipe(File *file);
+
+// Duplicates up to maxLength bytes from the pipe in into the pipe out
+// without consuming them (i.e., the backend of tee()).
+async::result<std::expected<size_t, Error>>
+tee(File *in, File *out, size_t maxLength, bool nonBlock);
+
+// Moves up to maxLength bytes from the pipe in into the pipe out.
+// The pages that hold the data are handed over instead of copied.
+async::result<std::expected<size_t, Error>>
+splice(File *in, File *out, size_t maxLength, bool nonBlock);
+
+// Reads data into a buffer and returns the number of bytes read (zero at the end of the input).
+using FillFunction = std::function<async::result<std::expected<size_t, Error>>(uint8_t *, size_t)>;
+
+// Waits until the pipe out has room and lets fill() read up to maxLength bytes
+// directly into new pages of the pipe (i.e., the backend of splice() into a pipe).
+async::result<std::expected<size_t, Error>>
+fill(File *out, size_t maxLength, FillFunction fill);
+
+// Backends of F_GETPIPE_SZ and F_SETPIPE_SZ. Fail with Error::badFileDescriptor
+// if the file is not a pipe. Sizes are rounded up to a power of two of at least one page.
+// Unless privileged is set, the size is limited by getMaxPipeSize().
+std::expected<size_t, Error> getPipeSize(File *file);
+std::expected<size_t, Error> setPipeSize(File *file, size_t size, bool privileged);
+
+size_t getMaxPipeSize();
+void setMaxPipeSize(size_t size);
+
 } // namespace fifo
 
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <assert.h>
+#include <stdint.h>
+#include <bit>
+#include <utility>
+#include <vector>
+
+#include "file.hpp"
+
+struct FileDescriptor {
+	smarter::shared_ptr<File, FileHandle> file;
+	bool closeOnExec;
+};
+
+// Dense table that maps file descriptor numbers to FileDescriptors.
+// Open descriptors are tracked in a two-level bitmap: each bit of _full summarizes
+// whether a word of _used is completely occupied. This allows us to find the lowest
+// free descriptor by looking at a few words instead of probing every descriptor.
+struct FileTable {
+	struct iterator {
+		std::pair<int, const FileDescriptor &> operator* () const {
+			return {fd_, table_->_slots[fd_]};
+		}
+
+		iterator &operator++ () {
+			fd_ = table_->_nextUsed(fd_ + 1);
+			return *this;
+		}
+
+		bool operator== (const iterator &other) const = default;
+
+	private:
+		friend struct FileTable;
+
+		iterator(const FileTable *table, int fd)
+		: table_{table}, fd_{fd} { }
+
+		const FileTable *table_;
+		int fd_;
+	};
+
+	// Iterates over the open descriptors in ascending order.
+	// Erasing the current descriptor does not invalidate the iterator.
+	iterator begin() const {
+		return {this, _nextUsed(0)};
+	}
+
+	// Returns an iterator to the lowest open descriptor >= fd.
+	iterator lowerBound(int fd) const {
+		assert(fd >= 0);
+		return {this, _nextUsed(fd)};
+	}
+
+	iterator end() const {
+		return {this, -1};
+	}
+
+	size_t size() const {
+		return _numUsed;
+	}
+
+	bool contains(int fd) const {
+		assert(fd >= 0);
+		auto word = static_cast<size_t>(fd) / 64;
+		if(word >= _used.size())
+			return false;
+		return _used[word] & (uint64_t{1} << (fd % 64));
+	}
+
+	// Returns nullptr if the descriptor is not open.
+	FileDescriptor *find(int fd) {
+		if(!contains(fd))
+			return nullptr;
+		return &_slots[fd];
+	}
+
+	// Returns the lowest descriptor >= startAt that is not open.
+	int lowestFree(int startAt) const {
+		assert(startAt >= 0);
+		auto word = static_cast<size_t>(startAt) / 64;
+		if(word >= _used.size())
+			return startAt;
+
+		// Treat the bits below startAt as occupied.
+		auto free = ~(_used[word] | ((uint64_t{1} << (startAt % 64)) - 1));
+		if(free)
+			return word * 64 + std::countr_zero(free);
+
+		// Find the first word after startAt's word that is not full.
+		for(auto summary = (word + 1) / 64; summary < _full.size(); summary++) {
+			auto notFull = ~_full[summary];
+			if(summary == (word + 1) / 64)
+				notFull &= ~((uint64_t{1} << ((word + 1) % 64)) - 1);
+			if(!notFull)
+				continue;
+			auto freeWord = summary * 64 + std::countr_zero(notFull);
+			if(freeWord >= _used.size())
+				break;
+			return freeWord * 64 + std::countr_zero(~_used[freeWord]);
+		}
+		return _used.size() * 64;
+	}
+
+	// Inserts or replaces a descriptor.
+	void insert(int fd, FileDescriptor descriptor) {
+		assert(fd >= 0);
+		assert(descriptor.file);
+		auto word = static_cast<size_t>(fd) / 64;
+		if(word >= _used.size()) {
+			_used.resize(word + 1, 0);
+			_full.resize(word / 64 + 1, 0);
+			_slots.resize(_used.size() * 64);
+		}
+
+		auto bit = uint64_t{1} << (fd % 64);
+		if(!(_used[word] & bit)) {
+			_used[word] |= bit;
+			_numUsed++;
+			if(_used[word] == ~uint64_t{0})
+				_full[word / 64] |= uint64_t{1} << (word % 64);
+		}
+		_slots[fd] = std::move(descriptor);
+	}
+
+	// Returns false if the descriptor is not open.
+	bool erase(int fd) {
+		if(!contains(fd))
+			return false;
+		auto word = static_cast<size_t>(fd) / 64;
+		_used[word] &= ~(uint64_t{1} << (fd % 64));
+		_full[word / 64] &= ~(uint64_t{1} << (word % 64));
+		_numUsed--;
+		_slots[fd] = FileDescriptor{};
+		return true;
+	}
+
+private:
+	// Returns the lowest open descriptor >= fd or -1 if there is none.
+	int _nextUsed(int fd) const {
+		auto word = static_cast<size_t>(fd) / 64;
+		if(word >= _used.size())
+			return -1;
+		auto used = _used[word] & ~((uint64_t{1} << (fd % 64)) - 1);
+		while(!used) {
+			if(++word == _used.size())
+				return -1;
+			used = _used[word];
+		}
+		return word * 64 + std::countr_zero(used);
+	}
+
+	std::vector<FileDescriptor> _slots;
+	// Bit (fd % 64) of word (fd / 64) is set iff fd is open.
+	std::vector<uint64_t> _used;
+	// Bit (i % 64) of word (i / 64) is set iff _used[i] is completely occupied.
+	std::vector<uint64_t> _full;
+	size_t _numUsed = 0;
+};
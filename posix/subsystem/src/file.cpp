@@ -110,7 +110,18 @@ async::result<frg::expected<protocols::fs::Error, size_t>> File::ptPwrite(void *
 
 async::result<std::expected<protocols::fs::ReadEntriesResult, managarm::fs::Errors>> File::ptReadEntries(void *object) {
 	auto self = static_cast<File *>(object);
-	return self->readEntries();
+	if(self->_pendingEntry) {
+		auto entry = std::move(*self->_pendingEntry);
+		self->_pendingEntry.reset();
+		co_return entry;
+	}
+	co_return co_await self->readEntries();
+}
+
+async::result<std::expected<void, managarm::fs::Errors>>
+File::ptReadEntriesBatch(void *object, protocols::fs::DirentBuffer &buffer) {
+	auto self = static_cast<File *>(object);
+	return self->readEntriesBatch(buffer);
 }
 
 async::result<frg::expected<protocols::fs::Error>> File::ptTruncate(void *object, size_t size) {
@@ -290,6 +301,10 @@ bool File::mapsAnonymously() {
 	return _defaultOps & defaultMapsAnonymously;
 }
 
+bool File::hasContentMemory() {
+	return _defaultOps & defaultHasContentMemory;
+}
+
 async::result<frg::expected<Error>> File::readExactly(Process *process,
 		void *data, size_t length) {
 	size_t offset = 0;
@@ -358,6 +373,13 @@ async::result<std::expected<protocols::fs::ReadEntriesResult, managarm::fs::Erro
 	throw std::runtime_error("posix: Object has no File::readEntries()");
 }
 
+async::result<std::expected<void, managarm::fs::Errors>>
+File::readEntriesBatch(protocols::fs::DirentBuffer &buffer) {
+	return protocols::fs::fillDirentBuffer(buffer, _pendingEntry, [this] {
+		return readEntries();
+	});
+}
+
 async::result<protocols::fs::RecvResult>
 File::recvMsg(Process *, uint32_t, void *, size_t,
 		void *, size_t, size_t) {
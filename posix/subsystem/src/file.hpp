@@ -144,6 +144,9 @@ enum class Error {
 	// Credentials passed in a request did not match any known process.
 	// Maps to EIO.
 	badProcessCredentials,
+
+	// Corresponds with EBUSY
+	resourceBusy,
 };
 
 inline protocols::fs::Error operator|(Error e, protocols::fs::ToFsProtoError) {
@@ -179,6 +182,7 @@ inline protocols::fs::Error operator|(Error e, protocols::fs::ToFsProtoError) {
 		case Error::notSupported: return protocols::fs::Error::notSupported;
 		case Error::badFileDescriptor: return protocols::fs::Error::badFileDescriptor;
 		case Error::badProcessCredentials: return protocols::fs::Error::internalError;
+		case Error::resourceBusy: return protocols::fs::Error::internalError;
 		default:
 			std::cout << std::format("posix: unmapped Error {}", static_cast<int>(e)) << std::endl;
 			return protocols::fs::Error::internalError;
@@ -219,13 +223,14 @@ inline managarm::posix::Errors operator|(Error e, ToPosixProtoError) {
 		case Error::noFileDescriptorsAvailable: return managarm::posix::Errors::NO_FILE_DESCRIPTORS_AVAILABLE;
 		case Error::notSupported: return managarm::posix::Errors::NOT_SUPPORTED;
 		case Error::badProcessCredentials: return managarm::posix::Errors::INTERNAL_ERROR;
+		case Error::seekOnPipe: return managarm::posix::Errors::SEEK_ON_PIPE;
+		case Error::badFileDescriptor: return managarm::posix::Errors::BAD_FD;
+		case Error::resourceBusy: return managarm::posix::Errors::RESOURCE_IN_USE;
 		case Error::fileClosed:
 		case Error::badExecutable:
-		case Error::seekOnPipe:
 		case Error::notConnected:
 		case Error::noSpaceLeft:
 		case Error::notSocket:
-		case Error::badFileDescriptor:
 			std::cout << std::format("posix: unmapped Error {}", static_cast<int>(e)) << std::endl;
 			return managarm::posix::Errors::INTERNAL_ERROR;
 	}
@@ -336,6 +341,7 @@ public:
 	static inline constexpr DefaultOps defaultIsTerminal = 1 << 1;
 	static inline constexpr DefaultOps defaultPipeLikeSeek = 1 << 2;
 	static inline constexpr DefaultOps defaultMapsAnonymously = 1 << 3;
+	static inline constexpr DefaultOps defaultHasContentMemory = 1 << 4;
 
 	// ------------------------------------------------------------------------
 	// File protocol adapters.
@@ -366,6 +372,9 @@ public:
 	static async::result<std::expected<protocols::fs::ReadEntriesResult, managarm::fs::Errors>>
 	ptReadEntries(void *object);
 
+	static async::result<std::expected<void, managarm::fs::Errors>>
+	ptReadEntriesBatch(void *object, protocols::fs::DirentBuffer &buffer);
+
 	static async::result<frg::expected<protocols::fs::Error>>
 	ptTruncate(void *object, size_t size);
 
@@ -434,6 +443,7 @@ public:
 		.write = &ptWrite,
 		.pwrite = &ptPwrite,
 		.readEntries = &ptReadEntries,
+		.readEntriesBatch = &ptReadEntriesBatch,
 		.accessMemory = &ptAccessMemory,
 		.truncate = &ptTruncate,
 		.fallocate = &ptAllocate,
@@ -531,6 +541,32 @@ public:
 	// Whether mappings of this file are backed by anonymous memory instead of accessMemory().
 	bool mapsAnonymously();
 
+	// Whether accessMemory() returns a memory object that holds the file's contents
+	// (e.g., the page cache of a regular file). Allows copying data without read().
+	bool hasContentMemory();
+
+	// Access mode that the file was opened with. Only set by openat();
+	// other files (e.g., sockets and memfds) can be both read and written.
+	// Requests that bypass the file's own server (e.g., copy_file_range()) check this.
+	void setAccessMode(bool readable, bool writable, bool append) {
+		_readable = readable;
+		_writable = writable;
+		_append = append;
+	}
+
+	bool isReadable() {
+		return _readable;
+	}
+
+	bool isWritable() {
+		return _writable;
+	}
+
+	// Note that O_APPEND is only tracked at open time; fcntl() is handled by the file's server.
+	bool isAppend() {
+		return _append;
+	}
+
 	async::result<frg::expected<Error>> readExactly(Process *process, void *data, size_t length);
 
 	virtual async::result<frg::expected<Error, off_t>>
@@ -554,6 +590,11 @@ public:
 
 	virtual FutureMaybe<std::expected<protocols::fs::ReadEntriesResult, managarm::fs::Errors>> readEntries();
 
+	// Fills the buffer with entries obtained from readEntries().
+	// An entry that does not fit is kept and returned first by the next call.
+	FutureMaybe<std::expected<void, managarm::fs::Errors>>
+	readEntriesBatch(protocols::fs::DirentBuffer &buffer);
+
 	virtual async::result<protocols::fs::RecvResult>
 		recvMsg(Process *process, uint32_t flags,
 			void *data, size_t max_length,
@@ -635,6 +676,13 @@ private:
 	DefaultOps _defaultOps;
 
 	bool _isOpen;
+
+	bool _readable = true;
+	bool _writable = true;
+	bool _append = false;
+
+	// Entry that was obtained from readEntries() but did not fit into the last batch.
+	std::optional<protocols::fs::ReadEntriesResult> _pendingEntry;
 };
 
 struct FileWithDefaults : File {
@@ -24,7 +24,8 @@ async::detached IntervalTimer::arm(std::shared_ptr<IntervalTimer> timer) {
 	timer->nextExpiration_ = timer->initial_;
 
 	if(timer->initial_) {
-		bool awaited = co_await helix::sleepUntil(timer->nextExpiration_, timer->cancelEvt_);
+		// Interval timers are not subject to timer slack (as on Linux).
+		bool awaited = co_await helix::sleepUntil(timer->nextExpiration_, timer->cancelEvt_, 0);
 
 		timer->raise(awaited);
 		if(!awaited)
@@ -36,7 +37,7 @@ async::detached IntervalTimer::arm(std::shared_ptr<IntervalTimer> timer) {
 
 	while(true) {
 		timer->nextExpiration_ = add_sat(timer->nextExpiration_, timer->interval_);
-		auto awaited = co_await helix::sleepUntil(timer->nextExpiration_, timer->cancelEvt_);
+		auto awaited = co_await helix::sleepUntil(timer->nextExpiration_, timer->cancelEvt_, 0);
 
 		timer->raise(awaited);
 		if(!awaited)
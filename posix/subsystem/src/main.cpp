@@ -23,6 +23,7 @@
 #include "requests.hpp"
 #include "subsystem/acpi.hpp"
 #include "subsystem/block.hpp"
+#include "subsystem/cpu.hpp"
 #include "subsystem/drm.hpp"
 #include "subsystem/generic.hpp"
 #include "subsystem/input.hpp"
@@ -37,6 +38,7 @@
 #include "subsystem/graphics.hpp"
 #include "observations.hpp"
 #include "ostrace.hpp"
+#include "swap.hpp"
 
 #include <bragi/helpers-std.hpp>
 #include <kerncfg.bragi.hpp>
@@ -209,6 +211,8 @@ async::result<void> enumeratePm() {
 async::detached runInit() {
 	co_await posix::ostContext.create();
 	co_await enumerateKerncfg();
+	cpu_subsystem::run();
+	co_await swap::initialize();
 	async::detach(enumeratePm());
 	async::detach(net::enumerateNetserver());
 	co_await populateRootView();
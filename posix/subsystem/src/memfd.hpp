@@ -15,7 +15,8 @@ public:
 	}
 
 	MemoryFile(std::shared_ptr<MountView> mount, std::shared_ptr<FsLink> link, bool allowSealing)
-	: FileWithDefaults{FileKind::unknown,  StructName::get("memfd-file"), mount, link}, _offset{0} {
+	: FileWithDefaults{FileKind::unknown,  StructName::get("memfd-file"), mount, link,
+			File::defaultHasContentMemory}, _offset{0} {
 		if(!allowSealing) {
 			_seals = F_SEAL_SEAL;
 		}
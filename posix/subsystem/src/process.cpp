@@ -356,9 +356,9 @@ std::shared_ptr<FileContext> FileContext::create() {
 	context->_universe = helix::UniqueDescriptor(universe);
 
 	HelHandle memory;
-	HEL_CHECK(helAllocateMemory(0x1000, 0, nullptr, &memory));
+	HEL_CHECK(helAllocateMemory(fileTableSize, 0, nullptr, &memory));
 	context->_fileTableMemory = helix::UniqueDescriptor(memory);
-	context->fileTableWindow_ = helix::Mapping{context->_fileTableMemory, 0, 0x1000};
+	context->fileTableWindow_ = helix::Mapping{context->_fileTableMemory, 0, fileTableSize};
 
 	HEL_CHECK(helTransferDescriptor(
 	    posixMbusClient,
@@ -380,16 +380,23 @@ std::shared_ptr<FileContext> FileContext::clone(std::shared_ptr<FileContext> ori
 	context->_universe = helix::UniqueDescriptor(universe);
 
 	HelHandle memory;
-	HEL_CHECK(helAllocateMemory(0x1000, 0, nullptr, &memory));
+	HEL_CHECK(helAllocateMemory(fileTableSize, 0, nullptr, &memory));
 	context->_fileTableMemory = helix::UniqueDescriptor(memory);
-	context->fileTableWindow_ = helix::Mapping{context->_fileTableMemory, 0, 0x1000};
+	context->fileTableWindow_ = helix::Mapping{context->_fileTableMemory, 0, fileTableSize};
 
-	for(auto entry : original->_fileTable) {
-		//std::cout << "Clone FD " << entry.first << std::endl;
-
-		// the new number of fd in the file context is always <= the number of fd in the original
-		auto attachRes = context->attachFile(entry.first, entry.second.file, entry.second.closeOnExec);
-		assert(attachRes);
+	// Copy the table in bulk; only the handles need to be transferred one by one.
+	context->_fileTable = original->_fileTable;
+	for(const auto &[fd, descriptor] : context->_fileTable) {
+		HelHandle handle;
+		HEL_CHECK(helTransferDescriptor(
+			descriptor.file->getPassthroughLane().getHandle(),
+			context->_universe.getHandle(),
+			kHelTransferDescriptorOut,
+			kHelRightInvoke,
+			kHelRightInvoke,
+			&handle
+		));
+		context->fileTableWindow()[fd] = handle;
 	}
 
 	HEL_CHECK(helTransferDescriptor(
@@ -421,20 +428,18 @@ std::expected<int, Error> FileContext::attachFile(smarter::shared_ptr<File, File
 		&handle
 	));
 
-	for(int fd = startAt; ; fd++) {
-		if(_fileTable.find(fd) != _fileTable.end())
-			continue;
-
-		if (static_cast<uint64_t>(fd) >= fdLimit_)
-			return std::unexpected{Error::noFileDescriptorsAvailable};
+	auto fd = _fileTable.lowestFree(startAt);
+	if(static_cast<uint64_t>(fd) >= fdLimit_) {
+		HEL_CHECK(helCloseDescriptor(_universe.getHandle(), handle));
+		return std::unexpected{Error::noFileDescriptorsAvailable};
+	}
 
-		if(logFileAttach)
-			std::cout << "posix: Attaching FD " << fd << std::endl;
+	if(logFileAttach)
+		std::cout << "posix: Attaching FD " << fd << std::endl;
 
-		_fileTable.insert({fd, {std::move(file), closeOnExec}});
-		fileTableWindow()[fd] = handle;
-		return fd;
-	}
+	_fileTable.insert(fd, {std::move(file), closeOnExec});
+	fileTableWindow()[fd] = handle;
+	return fd;
 }
 
 std::expected<void, Error> FileContext::attachFile(int fd, smarter::shared_ptr<File, FileHandle> file,
@@ -455,69 +460,86 @@ std::expected<void, Error> FileContext::attachFile(int fd, smarter::shared_ptr<F
 	if(logFileAttach)
 		std::cout << "posix: Attaching fixed FD " << fd << std::endl;
 
-	auto it = _fileTable.find(fd);
-	if(it != _fileTable.end()) {
-		it->second = {std::move(file), close_on_exec};
-	}else{
-		_fileTable.insert({fd, {std::move(file), close_on_exec}});
-	}
+	// Replacing a descriptor drops the handle of the old file.
+	if(_fileTable.contains(fd))
+		HEL_CHECK(helCloseDescriptor(_universe.getHandle(), fileTableWindow()[fd]));
+	_fileTable.insert(fd, {std::move(file), close_on_exec});
 	fileTableWindow()[fd] = handle;
 
 	return {};
 }
 
 std::optional<FileDescriptor> FileContext::getDescriptor(int fd) {
-	auto file = _fileTable.find(fd);
-	if(file == _fileTable.end())
+	if(fd < 0)
 		return std::nullopt;
-	return file->second;
+	auto descriptor = _fileTable.find(fd);
+	if(!descriptor)
+		return std::nullopt;
+	return *descriptor;
 }
 
 Error FileContext::setDescriptor(int fd, bool close_on_exec) {
-	auto it = _fileTable.find(fd);
-	if(it == _fileTable.end()) {
+	if(fd < 0)
 		return Error::noSuchFile;
-	}
-	it->second.closeOnExec = close_on_exec;
+	auto descriptor = _fileTable.find(fd);
+	if(!descriptor)
+		return Error::noSuchFile;
+	descriptor->closeOnExec = close_on_exec;
 	return Error::success;
 }
 
 smarter::shared_ptr<File, FileHandle> FileContext::getFile(int fd) {
-	auto file = _fileTable.find(fd);
-	if(file == _fileTable.end())
+	if(fd < 0)
 		return smarter::shared_ptr<File, FileHandle>{};
-	return file->second.file;
+	auto descriptor = _fileTable.find(fd);
+	if(!descriptor)
+		return smarter::shared_ptr<File, FileHandle>{};
+	return descriptor->file;
 }
 
 Error FileContext::closeFile(int fd) {
 	if(logFileAttach)
 		std::cout << "posix: Closing FD " << fd << std::endl;
-	auto it = _fileTable.find(fd);
-	if(it == _fileTable.end()) {
+	if(fd < 0 || !_fileTable.contains(fd))
 		return Error::noSuchFile;
-	}
 
 	HEL_CHECK(helCloseDescriptor(_universe.getHandle(), fileTableWindow()[fd]));
 
 	fileTableWindow()[fd] = 0;
-	_fileTable.erase(it);
+	_fileTable.erase(fd);
 	return Error::success;
 }
 
-void FileContext::closeOnExec() {
-	auto it = _fileTable.begin();
-	while(it != _fileTable.end()) {
-		if(it->second.closeOnExec) {
-			HEL_CHECK(helCloseDescriptor(_universe.getHandle(), fileTableWindow()[it->first]));
+void FileContext::closeRange(int first, int last, bool closeOnExec) {
+	assert(first >= 0 && first <= last);
+	for(auto it = _fileTable.lowerBound(first); it != _fileTable.end(); ++it) {
+		auto [fd, descriptor] = *it;
+		if(fd > last)
+			break;
 
-			fileTableWindow()[it->first] = 0;
-			it = _fileTable.erase(it);
+		if(closeOnExec) {
+			_fileTable.find(fd)->closeOnExec = true;
 		}else{
-			it++;
+			HEL_CHECK(helCloseDescriptor(_universe.getHandle(), fileTableWindow()[fd]));
+			fileTableWindow()[fd] = 0;
+			_fileTable.erase(fd);
 		}
 	}
 }
 
+void FileContext::closeOnExec() {
+	for(auto it = _fileTable.begin(); it != _fileTable.end(); ++it) {
+		auto [fd, descriptor] = *it;
+		if(!descriptor.closeOnExec)
+			continue;
+
+		HEL_CHECK(helCloseDescriptor(_universe.getHandle(), fileTableWindow()[fd]));
+
+		fileTableWindow()[fd] = 0;
+		_fileTable.erase(fd);
+	}
+}
+
 // ----------------------------------------------------------------------------
 // SignalContext.
 // ----------------------------------------------------------------------------
@@ -1315,7 +1337,7 @@ async::result<std::shared_ptr<ThreadGroup>> Process::init(std::string path) {
 			reinterpret_cast<void **>(&process->_clientThreadPage)));
 	HEL_CHECK(helMapMemory(process->_fileContext->fileTableMemory().getHandle(),
 			process->_vmContext->getSpace().getHandle(),
-			nullptr, 0, 0x1000, kHelMapProtRead,
+			nullptr, 0, fileTableSize, kHelMapProtRead,
 			&process->_clientFileTable));
 	HEL_CHECK(helMapMemory(clk::trackerPageMemory().getHandle(),
 			process->_vmContext->getSpace().getHandle(),
@@ -1395,7 +1417,7 @@ async::result<std::shared_ptr<Process>> Process::fork(std::shared_ptr<Process> o
 			reinterpret_cast<void **>(&process->_clientThreadPage)));
 	HEL_CHECK(helMapMemory(process->_fileContext->fileTableMemory().getHandle(),
 			process->_vmContext->getSpace().getHandle(),
-			nullptr, 0, 0x1000, kHelMapProtRead,
+			nullptr, 0, fileTableSize, kHelMapProtRead,
 			&process->_clientFileTable));
 	HEL_CHECK(helMapMemory(clk::trackerPageMemory().getHandle(),
 			process->_vmContext->getSpace().getHandle(),
@@ -1423,6 +1445,7 @@ async::result<std::shared_ptr<Process>> Process::fork(std::shared_ptr<Process> o
 	process->_threadDescriptor = helix::UniqueDescriptor{new_thread};
 	process->_posixLane = std::move(server_lane);
 	HEL_CHECK(helGetCredentials(process->_threadDescriptor.getHandle(), 0, process->credentials_.data()));
+	process->setTimerSlack(original->timerSlack());
 
 	auto generation = std::make_shared<Generation>();
 	process->_currentGeneration = generation;
@@ -1558,6 +1581,7 @@ Process::clone(std::shared_ptr<Process> original, void *ip, void *sp, posix::sup
 	process->_threadDescriptor = helix::UniqueDescriptor{new_thread};
 	process->_posixLane = std::move(server_lane);
 	HEL_CHECK(helGetCredentials(process->_threadDescriptor.getHandle(), 0, process->credentials_.data()));
+	process->setTimerSlack(original->timerSlack());
 
 	auto generation = std::make_shared<Generation>();
 	process->_currentGeneration = generation;
@@ -1604,7 +1628,7 @@ async::result<Error> Process::exec(std::shared_ptr<Process> process,
 			&exec_clk_tracker_page));
 	HEL_CHECK(helMapMemory(process->_fileContext->fileTableMemory().getHandle(),
 			exec_vm_context->getSpace().getHandle(),
-			nullptr, 0, 0x1000, kHelMapProtRead,
+			nullptr, 0, fileTableSize, kHelMapProtRead,
 			&exec_client_table));
 
 	// Kill the old thread.
@@ -1627,6 +1651,7 @@ async::result<Error> Process::exec(std::shared_ptr<Process> process,
 	process->_path = std::move(path);
 	process->_posixLane = std::move(server_lane);
 	process->_threadDescriptor = std::move(execResult.thread);
+	process->setTimerSlack(process->timerSlack());
 	process->_vmContext = std::move(exec_vm_context);
 	process->threadGroup()->_signalContext->resetHandlers();
 	process->setAltStackEnabled(false);
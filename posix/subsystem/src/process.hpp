@@ -17,6 +17,7 @@
 #include <sys/time.h>
 
 #include "device.hpp"
+#include "file-table.hpp"
 #include "interval-timer.hpp"
 #include "vfs.hpp"
 #include "procfs.hpp"
@@ -162,10 +163,16 @@ private:
 	mode_t _umask = 0022;
 };
 
-struct FileDescriptor {
-	smarter::shared_ptr<File, FileHandle> file;
-	bool closeOnExec;
-};
+// Upper bound for RLIMIT_NOFILE.
+// The fd -> HelHandle table is reserved for this many descriptors; since the table's
+// memory is populated on demand, only the pages that hold attached descriptors are backed.
+inline constexpr uint64_t maxFdLimit = 1 << 16;
+
+// Size of the fd -> HelHandle table in bytes.
+inline constexpr size_t fileTableSize = maxFdLimit * sizeof(HelHandle);
+
+// Default for RLIMIT_NOFILE.
+inline constexpr uint64_t defaultFdLimit = 1024;
 
 struct FileContext {
 public:
@@ -194,19 +201,21 @@ public:
 
 	Error closeFile(int fd);
 
+	// Closes (or marks as close-on-exec) all open descriptors in [first, last].
+	void closeRange(int first, int last, bool closeOnExec);
+
 	void closeOnExec();
 
 	HelHandle clientMbusLane() {
 		return _clientMbusLane;
 	}
 
-	const std::unordered_map<int, FileDescriptor> &fileTable() {
+	const FileTable &fileTable() {
 		return _fileTable;
 	}
 
 	void setFdLimit(uint64_t limit) {
-		// TODO: increase the limit once we allow more than one shared fd -> HelHandle mapping page
-		fdLimit_ = std::min(limit, 0x1000 / sizeof(HelHandle));
+		fdLimit_ = std::min(limit, maxFdLimit);
 	}
 
 private:
@@ -216,14 +225,12 @@ private:
 
 	helix::UniqueDescriptor _universe;
 
-	// TODO: replace this by a tree that remembers gaps between keys.
-	std::unordered_map<int, FileDescriptor> _fileTable;
+	FileTable _fileTable;
 
 	helix::UniqueDescriptor _fileTableMemory;
 	helix::Mapping fileTableWindow_;
 
-	// TODO: increase the limit once we allow more than one shared fd -> HelHandle mapping page
-	uint64_t fdLimit_ = 0x1000 / sizeof(HelHandle);
+	uint64_t fdLimit_ = defaultFdLimit;
 
 	HelHandle _clientMbusLane;
 };
@@ -578,6 +585,18 @@ public:
 		return _threadDescriptor;
 	}
 
+	// Amount of time by which the thread's timeouts may expire late (see prctl(PR_SET_TIMERSLACK)).
+	// Applies to timeouts handled by the kernel as well as to timeouts of
+	// requests that are handled by posix (e.g., poll() and epoll_wait()).
+	uint64_t timerSlack() {
+		return _timerSlack;
+	}
+
+	void setTimerSlack(uint64_t slack) {
+		_timerSlack = slack;
+		HEL_CHECK(helSetTimerSlack(_threadDescriptor.getHandle(), slack));
+	}
+
 	// As the contexts associated with a process can change (e.g. when unshare() is implemented),
 	// those functions return refcounted pointers.
 	std::shared_ptr<VmContext> vmContext() { return _vmContext; }
@@ -716,6 +735,7 @@ private:
 	std::string _name;
 	helix::UniqueLane _posixLane;
 	helix::UniqueDescriptor _threadDescriptor;
+	uint64_t _timerSlack = kHelDefaultTimerSlack;
 	std::shared_ptr<Generation> _currentGeneration;
 	std::shared_ptr<VmContext> _vmContext;
 	std::shared_ptr<FsContext> _fsContext;
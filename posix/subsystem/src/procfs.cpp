@@ -1,4 +1,6 @@
 #include <async/cancellation.hpp>
+#include <algorithm>
+#include <charconv>
 #include <functional>
 #include <linux/magic.h>
 #include <print>
@@ -8,17 +10,36 @@
 
 #include <core/clock.hpp>
 #include "common.hpp"
+#include "extern_fs.hpp"
+#include "fifo.hpp"
 #include "procfs.hpp"
 #include "process.hpp"
 #include "protocols/fs/common.hpp"
+#include "requests.hpp"
+#include "swap.hpp"
 
 #include <bitset>
 #include <sys/epoll.h>
+#include <bragi/helpers-std.hpp>
+#include <kerncfg.bragi.hpp>
 
 namespace procfs {
 
 SuperBlock procfsSuperblock;
 
+namespace {
+
+// Kernel statistics of the thread; all zeros if the thread already terminated.
+HelThreadStats queryThreadStats(Process *process) {
+	HelThreadStats stats{};
+	auto descriptor = process->threadDescriptor();
+	if(descriptor.getHandle() != kHelNullHandle)
+		HEL_CHECK(helQueryThreadStats(descriptor.getHandle(), &stats));
+	return stats;
+}
+
+} // anonymous namespace
+
 // ----------------------------------------------------------------------------
 // LinkCompare implementation.
 // ----------------------------------------------------------------------------
@@ -96,10 +117,12 @@ RegularFile::readSome(Process *process, void *data, size_t max_length, async::ca
 }
 
 async::result<frg::expected<Error, size_t>>
-RegularFile::writeAll(Process *, const void *data, size_t length) {
+RegularFile::writeAll(Process *process, const void *data, size_t length) {
 	assert(length > 0);
 
 	auto node = static_cast<RegularNode *>(associatedLink()->getTarget().get());
+	if(node->storeNeedsRoot() && !process->threadGroup()->isRoot())
+		co_return Error::accessDenied;
 	co_await node->store(std::string{reinterpret_cast<const char *>(data), length});
 	co_return length;
 }
@@ -306,10 +329,16 @@ std::shared_ptr<Link> DirectoryNode::createRootDirectory() {
 	the_node->_entries.insert(std::move(self_thread_link));
 
 	the_node->directMkregular("uptime", std::make_shared<UptimeNode>());
+	the_node->directMkregular("meminfo", std::make_shared<MeminfoNode>());
+	the_node->directMkregular("swaps", std::make_shared<SwapsNode>());
+	the_node->directMkregular("interrupts", std::make_shared<InterruptsNode>());
+	the_node->directMkregular("stat", std::make_shared<SystemStatNode>());
 	the_node->directMknode("mounts", std::make_shared<MountsLink>());
 
 	auto sysLink = the_node->directMkdir("sys");
 	auto sys = std::static_pointer_cast<DirectoryNode>(sysLink->getTarget());
+	auto fsLink = sys->directMkdir("fs");
+	auto fs = std::static_pointer_cast<DirectoryNode>(fsLink->getTarget());
 	auto kernelLink = sys->directMkdir("kernel");
 	auto kernel = std::static_pointer_cast<DirectoryNode>(kernelLink->getTarget());
 	auto randomLink = kernel->directMkdir("random");
@@ -322,6 +351,9 @@ std::shared_ptr<Link> DirectoryNode::createRootDirectory() {
 
 	random->directMkregular("boot_id", std::make_shared<BootIdNode>());
 
+	fs->directMkregular("dentry-cache", std::make_shared<DentryCacheNode>());
+	fs->directMkregular("pipe-max-size", std::make_shared<PipeMaxSizeNode>());
+
 	return link;
 }
 
@@ -377,6 +409,7 @@ std::shared_ptr<Link> DirectoryNode::createProcDirectory(Process *process) {
 	proc_dir->directMkregular("comm", std::make_shared<CommNode>(process));
 	proc_dir->directMkregular("stat", std::make_shared<StatNode>(process));
 	proc_dir->directMkregular("statm", std::make_shared<StatmNode>(process));
+	proc_dir->directMkregular("schedstat", std::make_shared<SchedstatNode>(process));
 	proc_dir->directMkregular("status", std::make_shared<ProcessStatusNode>(process->threadGroup()->weak_from_this()));
 	proc_dir->directMkregular("cgroup", std::make_shared<CgroupNode>(process));
 	proc_dir->directMkregular("mounts", std::make_shared<MountsNode>(process));
@@ -409,6 +442,7 @@ std::shared_ptr<Link> DirectoryNode::createProcTaskDirectory(Process *process) {
 
 	tid_dir->directMkregular("comm", std::make_shared<CommNode>(process));
 	tid_dir->directMkregular("status", std::make_shared<StatusNode>(process->weak_from_this()));
+	tid_dir->directMkregular("schedstat", std::make_shared<SchedstatNode>(process));
 
 	return tid_link;
 }
@@ -513,6 +547,252 @@ async::result<void> UptimeNode::store(std::string) {
 	co_return;
 }
 
+async::result<std::expected<std::string, Error>> MeminfoNode::show(Process *) {
+	managarm::kerncfg::GetMemoryInformationRequest kerncfgRequest;
+	auto [offer, kerncfgSendResp, kerncfgResp] = co_await helix_ng::exchangeMsgs(
+		getKerncfgLane(),
+		helix_ng::offer(
+			helix_ng::sendBragiHeadOnly(kerncfgRequest, frg::stl_allocator{}),
+			helix_ng::recvInline()
+		)
+	);
+	HEL_CHECK(offer.error());
+	HEL_CHECK(kerncfgSendResp.error());
+	HEL_CHECK(kerncfgResp.error());
+
+	auto kernResp = bragi::parse_head_only<managarm::kerncfg::GetMemoryInformationResponse>(kerncfgResp);
+	kerncfgResp.reset();
+
+	auto unitKiB = kernResp->memory_unit() / 1024;
+	auto swapStats = swap::getStatistics();
+
+	// See man 5 proc for the meaning of the fields.
+	// Zswap and Zswapped report the compressed and the original size of swapped-out pages.
+	auto line = [] (std::stringstream &stream, const char *name, uint64_t kib) {
+		stream << std::left << std::setw(16) << (std::string{name} + ":")
+				<< std::right << std::setw(8) << kib << " kB\n";
+	};
+	std::stringstream stream;
+	line(stream, "MemTotal", kernResp->total_usable_memory() * unitKiB);
+	line(stream, "MemFree", kernResp->available_memory() * unitKiB);
+	// Like Linux, count evictable page cache as available.
+	line(stream, "MemAvailable",
+			(kernResp->available_memory() + kernResp->reclaimable_memory()) * unitKiB);
+	line(stream, "Cached", kernResp->reclaimable_memory() * unitKiB);
+	line(stream, "SwapTotal", swapStats.totalPages * 4);
+	line(stream, "SwapFree", (swapStats.totalPages - std::min(swapStats.usedPages,
+			swapStats.totalPages)) * 4);
+	line(stream, "Zswap", swapStats.compressedBytes / 1024);
+	line(stream, "Zswapped", swapStats.usedPages * 4);
+	// Non-standard fields that describe the compressed swap.
+	stream << std::left << std::setw(16) << "ZswapSameFilled:"
+			<< std::right << std::setw(8) << swapStats.sameFilledPages << "\n";
+	if(swapStats.compressedBytes) {
+		stream << std::left << std::setw(16) << "ZswapRatio:"
+				<< std::right << std::setw(8) << std::fixed << std::setprecision(2)
+				<< (static_cast<double>(swapStats.usedPages) * 4096 / swapStats.compressedBytes) << "\n";
+	}
+	if(swapStats.swapIns) {
+		stream << std::left << std::setw(16) << "SwapInLatency:"
+				<< std::right << std::setw(8) << (swapStats.swapInNanos / swapStats.swapIns) << " ns\n";
+	}
+	co_return stream.str();
+}
+
+async::result<void> MeminfoNode::store(std::string) {
+	// TODO: proper error reporting.
+	std::cout << "posix: Can't store to a /proc/meminfo file" << std::endl;
+	co_return;
+}
+
+async::result<std::expected<std::string, Error>> SwapsNode::show(Process *) {
+	std::stringstream stream;
+	stream << "Filename\t\t\t\tType\t\tSize\t\tUsed\t\tPriority\n";
+	if(!swap::isEnabled())
+		co_return stream.str();
+
+	// There is no block device behind the compressed swap, hence we do not
+	// report a device path but a placeholder name and the type "memory".
+	auto swapStats = swap::getStatistics();
+	stream << std::left << std::setw(40) << "[compressed]" << "memory\t\t"
+			<< (swapStats.totalPages * 4) << "\t\t" << (swapStats.usedPages * 4) << "\t\t-2\n";
+
+	co_return stream.str();
+}
+
+async::result<void> SwapsNode::store(std::string) {
+	// TODO: proper error reporting.
+	std::cout << "posix: Can't store to a /proc/swaps file" << std::endl;
+	co_return;
+}
+
+async::result<std::expected<std::string, Error>> DentryCacheNode::show(Process *) {
+	// Managarm-specific: statistics of the lookup cache of extern_fs (i.e., disk) file systems.
+	auto stats = extern_fs::getDentryCacheStatistics();
+	auto lookups = stats.hits + stats.misses;
+
+	std::stringstream stream;
+	stream << "entries " << stats.entries << "\n";
+	stream << "negative_entries " << stats.negativeEntries << "\n";
+	stream << "capacity " << stats.capacity << "\n";
+	stream << "hits " << stats.hits << "\n";
+	stream << "negative_hits " << stats.negativeHits << "\n";
+	stream << "misses " << stats.misses << "\n";
+	stream << "hit_rate_percent " << (lookups ? stats.hits * 100 / lookups : 0) << "\n";
+	stream << "invalidations " << stats.invalidations << "\n";
+	stream << "evictions " << stats.evictions << "\n";
+	co_return stream.str();
+}
+
+async::result<void> DentryCacheNode::store(std::string) {
+	// TODO: proper error reporting.
+	std::cout << "posix: Can't store to a /proc/sys/fs/dentry-cache file" << std::endl;
+	co_return;
+}
+
+async::result<std::expected<std::string, Error>> PipeMaxSizeNode::show(Process *) {
+	co_return std::to_string(fifo::getMaxPipeSize()) + "\n";
+}
+
+async::result<void> PipeMaxSizeNode::store(std::string value) {
+	size_t size;
+	auto end = value.data() + value.size();
+	auto [ptr, ec] = std::from_chars(value.data(), end, size);
+	if(ec != std::errc{} || (ptr != end && *ptr != '\n')) {
+		// TODO: proper error reporting.
+		std::cout << "posix: Invalid value written to /proc/sys/fs/pipe-max-size" << std::endl;
+		co_return;
+	}
+	fifo::setMaxPipeSize(size);
+}
+
+async::result<std::expected<std::string, Error>> InterruptsNode::show(Process *) {
+	managarm::kerncfg::GetIrqStatisticsRequest kerncfgRequest;
+	auto [offer, kerncfgSendResp, kerncfgResp] = co_await helix_ng::exchangeMsgs(
+		getKerncfgLane(),
+		helix_ng::offer(
+			helix_ng::want_lane,
+			helix_ng::sendBragiHeadOnly(kerncfgRequest, frg::stl_allocator{}),
+			helix_ng::recvInline()
+		)
+	);
+	HEL_CHECK(offer.error());
+	HEL_CHECK(kerncfgSendResp.error());
+	HEL_CHECK(kerncfgResp.error());
+
+	auto preamble = bragi::read_preamble(kerncfgResp);
+	assert(!preamble.error());
+	std::vector<uint8_t> tail(preamble.tail_size());
+	auto [recvTail] = co_await helix_ng::exchangeMsgs(
+		offer.descriptor(),
+		helix_ng::recvBuffer(tail.data(), tail.size())
+	);
+	HEL_CHECK(recvTail.error());
+
+	auto kernResp = *bragi::parse_head_tail<managarm::kerncfg::GetIrqStatisticsResponse>(
+			kerncfgResp, tail);
+	kerncfgResp.reset();
+
+	// Similar to Linux' format: one column of IRQ counts per CPU.
+	// Instead of the interrupt controller, we print the CPU that the IRQ is routed to.
+	auto numCpus = kernResp.cpu_loads().size();
+	std::stringstream stream;
+	stream << std::setw(5) << "";
+	for(size_t cpu = 0; cpu < numCpus; cpu++)
+		stream << std::setw(11) << ("CPU" + std::to_string(cpu));
+	stream << "\n";
+
+	for(auto &irq : kernResp.irqs()) {
+		stream << std::setw(4) << irq.id() << ":";
+		for(auto &cpuStats : irq.cpus())
+			stream << std::setw(11) << cpuStats.raises();
+		stream << "  CPU" << std::left << std::setw(4) << irq.affinity() << std::right
+				<< " " << irq.name() << "\n";
+	}
+
+	stream << std::setw(4) << "LOC" << ":";
+	for(auto count : kernResp.cpu_timer_interrupts())
+		stream << std::setw(11) << count;
+	stream << "   Local timer interrupts\n";
+	stream << std::setw(4) << "TMR" << ":";
+	for(auto count : kernResp.cpu_timer_expirations())
+		stream << std::setw(11) << count;
+	stream << "   Expired timers\n";
+
+	co_return stream.str();
+}
+
+async::result<void> InterruptsNode::store(std::string) {
+	// TODO: proper error reporting.
+	std::cout << "posix: Can't store to a /proc/interrupts file" << std::endl;
+	co_return;
+}
+
+async::result<std::expected<std::string, Error>> SystemStatNode::show(Process *) {
+	managarm::kerncfg::GetCpuStatisticsRequest kerncfgRequest;
+	auto [offer, kerncfgSendResp, kerncfgResp] = co_await helix_ng::exchangeMsgs(
+		getKerncfgLane(),
+		helix_ng::offer(
+			helix_ng::want_lane,
+			helix_ng::sendBragiHeadOnly(kerncfgRequest, frg::stl_allocator{}),
+			helix_ng::recvInline()
+		)
+	);
+	HEL_CHECK(offer.error());
+	HEL_CHECK(kerncfgSendResp.error());
+	HEL_CHECK(kerncfgResp.error());
+
+	auto preamble = bragi::read_preamble(kerncfgResp);
+	assert(!preamble.error());
+	std::vector<uint8_t> tail(preamble.tail_size());
+	auto [recvTail] = co_await helix_ng::exchangeMsgs(
+		offer.descriptor(),
+		helix_ng::recvBuffer(tail.data(), tail.size())
+	);
+	HEL_CHECK(recvTail.error());
+
+	auto kernResp = *bragi::parse_head_tail<managarm::kerncfg::GetCpuStatisticsResponse>(
+			kerncfgResp, tail);
+	kerncfgResp.reset();
+
+	// Times are reported in units of USER_HZ (= 100 Hz).
+	// The kernel does not distinguish between user and system time;
+	// we report all non-idle time outside of IRQ handlers as user time.
+	auto toTicks = [] (uint64_t nanos) { return nanos / 10'000'000; };
+	auto formatCpu = [&] (std::string name, uint64_t busy, uint64_t idle, uint64_t irq) {
+		auto user = busy > irq ? busy - irq : 0;
+		return std::format("{} {} 0 0 {} 0 {} 0 0 0 0\n", name,
+				toTicks(user), toTicks(idle), toTicks(irq));
+	};
+
+	uint64_t totalBusy = 0;
+	uint64_t totalIdle = 0;
+	uint64_t totalIrq = 0;
+	uint64_t contextSwitches = 0;
+	std::string cpuLines;
+	for(size_t cpu = 0; cpu < kernResp.cpus().size(); cpu++) {
+		auto &stats = kernResp.cpus()[cpu];
+		totalBusy += stats.busy_nanos();
+		totalIdle += stats.idle_nanos();
+		totalIrq += stats.irq_nanos();
+		contextSwitches += stats.context_switches();
+		cpuLines += formatCpu("cpu" + std::to_string(cpu),
+				stats.busy_nanos(), stats.idle_nanos(), stats.irq_nanos());
+	}
+
+	std::stringstream stream;
+	stream << formatCpu("cpu ", totalBusy, totalIdle, totalIrq);
+	stream << cpuLines;
+	stream << "ctxt " << contextSwitches << "\n";
+	co_return stream.str();
+}
+
+async::result<void> SystemStatNode::store(std::string) {
+	// TODO: proper error reporting.
+	std::println("posix: Can't store to /proc/stat");
+	co_return;
+}
+
 async::result<std::expected<std::string, Error>> OstypeNode::show(Process *) {
 	// See man 5 proc for more details.
 	// Based on the man page from Linux man-pages 6.01, updated on 2022-10-09.
@@ -855,6 +1135,33 @@ async::result<frg::expected<Error, FileStats>> StatNode::getStats() {
 	co_return co_await getStatsInternal(p->threadGroup());
 }
 
+SchedstatNode::SchedstatNode(Process *process) : _process(process->weak_from_this()) {}
+
+async::result<std::expected<std::string, Error>> SchedstatNode::show(Process *) {
+	auto p = _process.lock();
+	if (!p)
+		co_return std::unexpected(Error::noSuchProcess);
+
+	// Same format as Linux: time spent on the CPU (ns), time spent waiting
+	// on a run queue (ns) and number of time slices run on the CPU.
+	auto stats = queryThreadStats(p.get());
+	co_return std::format("{} {} {}\n", stats.userTime, stats.waitTime, stats.timeslices);
+}
+
+async::result<void> SchedstatNode::store(std::string) {
+	// TODO: proper error reporting.
+	std::println("Can't store to a /proc/schedstat file!");
+	co_return;
+}
+
+async::result<frg::expected<Error, FileStats>> SchedstatNode::getStats() {
+	auto p = _process.lock();
+	if (!p)
+		co_return Error::noSuchProcess;
+
+	co_return co_await getStatsInternal(p->threadGroup());
+}
+
 StatmNode::StatmNode(Process *process) : _process(process->weak_from_this()) {}
 
 async::result<std::expected<std::string, Error>> StatmNode::show(Process *) {
@@ -969,8 +1276,15 @@ async::result<std::expected<std::string, Error>> ProcessStatusNode::show(Process
 	stream << "Cpus_allowed_list: N/A\n";
 	stream << "Mems_allowed: N/A\n";
 	stream << "Mems_allowed_list: N/A\n";
-	stream << "voluntary_ctxt_switches: N/A\n";
-	stream << "nonvoluntary_ctxt_switches: N/A\n";
+	uint64_t voluntarySwitches = 0;
+	uint64_t involuntarySwitches = 0;
+	for(auto &thread : tg->threads()) {
+		auto stats = queryThreadStats(thread.get());
+		voluntarySwitches += stats.voluntarySwitches;
+		involuntarySwitches += stats.involuntarySwitches;
+	}
+	stream << "voluntary_ctxt_switches: " << voluntarySwitches << "\n";
+	stream << "nonvoluntary_ctxt_switches: " << involuntarySwitches << "\n";
 	co_return stream.str();
 }
 
@@ -1073,8 +1387,9 @@ async::result<std::expected<std::string, Error>> StatusNode::show(Process *) {
 	stream << "Cpus_allowed_list: N/A\n";
 	stream << "Mems_allowed: N/A\n";
 	stream << "Mems_allowed_list: N/A\n";
-	stream << "voluntary_ctxt_switches: N/A\n";
-	stream << "nonvoluntary_ctxt_switches: N/A\n";
+	auto stats = queryThreadStats(p.get());
+	stream << "voluntary_ctxt_switches: " << stats.voluntarySwitches << "\n";
+	stream << "nonvoluntary_ctxt_switches: " << stats.involuntarySwitches << "\n";
 	co_return stream.str();
 }
 
@@ -1161,7 +1476,10 @@ void FdDirectoryFile::serve(smarter::shared_ptr<FdDirectoryFile> file) {
 
 FdDirectoryFile::FdDirectoryFile(std::shared_ptr<MountView> mount, std::shared_ptr<FsLink> link, Process *process)
 : FileWithDefaults{FileKind::unknown,  StructName::get("procfs.fddir"), std::move(mount), std::move(link)},
-		_process{process->weak_from_this()}, _fileTable{process->fileContext()->fileTable()}, _iter{_fileTable.begin()} {}
+		_process{process->weak_from_this()} {
+	for(const auto &[fd, _] : process->fileContext()->fileTable())
+		_fds.push_back(fd);
+}
 
 void FdDirectoryFile::handleClose() {
 	_cancelServe.cancel();
@@ -1171,13 +1489,13 @@ FutureMaybe<std::expected<protocols::fs::ReadEntriesResult, managarm::fs::Errors
 	if(auto entry = nextDotEntry(_dots, 0, 0); entry)
 		co_return *entry;
 
-	if(_iter != _fileTable.end()) {
-		auto name = std::to_string((_iter++)->first);
+	if(_index < _fds.size()) {
+		auto name = std::to_string(_fds[_index++]);
 
 		co_return protocols::fs::ReadEntriesResult{
 			.name = name,
 			.inode = 0,
-			.offset = 2 + std::distance(_fileTable.cbegin(), _iter)
+			.offset = static_cast<long>(2 + _index)
 		};
 	}else{
 		co_return std::unexpected(managarm::fs::Errors::END_OF_FILE);
@@ -1233,13 +1551,20 @@ async::result<frg::expected<Error, std::shared_ptr<FsLink>>> FdDirectoryNode::ge
 	if (!p)
 		co_return Error::noSuchProcess;
 
-	for(const auto &[fdnum, fd] : p->fileContext()->fileTable()) {
-		if(name != std::to_string(fdnum))
-			continue;
-		auto pointee = std::make_shared<SymlinkNode>(p.get(), fd.file->associatedMount(), fd.file->associatedLink());
-		co_return std::make_shared<Link>(shared_from_this(), name, pointee);
-	}
-	co_return Error::noSuchFile;
+	if(name.empty() || !std::all_of(name.begin(), name.end(), isdigit))
+		co_return Error::noSuchFile;
+
+	// Reject names that are out of range or (like "01") that do not match
+	// the canonical name of the descriptor.
+	int fdnum;
+	auto [ptr, ec] = std::from_chars(name.data(), name.data() + name.size(), fdnum);
+	if(ec != std::errc{} || ptr != name.data() + name.size() || name != std::to_string(fdnum))
+		co_return Error::noSuchFile;
+	auto fd = p->fileContext()->getDescriptor(fdnum);
+	if(!fd)
+		co_return Error::noSuchFile;
+	auto pointee = std::make_shared<SymlinkNode>(p.get(), fd->file->associatedMount(), fd->file->associatedLink());
+	co_return std::make_shared<Link>(shared_from_this(), name, pointee);
 }
 
 SymlinkNode::SymlinkNode(Process* proc, std::shared_ptr<MountView> mount, std::weak_ptr<FsLink> link)
@@ -1442,9 +1767,12 @@ async::result<frg::expected<Error, std::shared_ptr<FsLink>>> FdInfoDirectoryNode
 	if (!p)
 		co_return Error::noSuchProcess;
 
-	auto nameNum = std::stoi(name);
-	if(p->fileContext()->fileTable().contains(nameNum)) {
-		auto file = p->fileContext()->fileTable().at(nameNum).file;
+	int nameNum;
+	auto [ptr, ec] = std::from_chars(name.data(), name.data() + name.size(), nameNum);
+	if(name.empty() || ec != std::errc{} || ptr != name.data() + name.size())
+		co_return Error::noSuchFile;
+	if(auto fd = p->fileContext()->getDescriptor(nameNum); fd) {
+		auto file = fd->file;
 		auto pointee = std::make_shared<FdInfoNode>(file->associatedMount(), file);
 		co_return std::make_shared<Link>(shared_from_this(), name, pointee);
 	}
@@ -1461,7 +1789,10 @@ void FdInfoDirectoryFile::serve(smarter::shared_ptr<FdInfoDirectoryFile> file) {
 
 FdInfoDirectoryFile::FdInfoDirectoryFile(std::shared_ptr<MountView> mount, std::shared_ptr<FsLink> link, Process* process)
 : FileWithDefaults{FileKind::unknown,  StructName::get("procfs.fdinfodir"), std::move(mount), std::move(link)},
-		_process{process->weak_from_this()}, _fileTable{process->fileContext()->fileTable()}, _iter{_fileTable.begin()} {}
+		_process{process->weak_from_this()} {
+	for(const auto &[fd, _] : process->fileContext()->fileTable())
+		_fds.push_back(fd);
+}
 
 void FdInfoDirectoryFile::handleClose() {
 	_cancelServe.cancel();
@@ -1471,13 +1802,13 @@ FutureMaybe<std::expected<protocols::fs::ReadEntriesResult, managarm::fs::Errors
 	if(auto entry = nextDotEntry(_dots, 0, 0); entry)
 		co_return *entry;
 
-	if(_iter != _fileTable.end()) {
-		auto name = std::to_string((_iter++)->first);
+	if(_index < _fds.size()) {
+		auto name = std::to_string(_fds[_index++]);
 
 		co_return protocols::fs::ReadEntriesResult{
 			.name = name,
 			.inode = 0,
-			.offset = 2 + std::distance(_fileTable.cbegin(), _iter)
+			.offset = static_cast<long>(2 + _index)
 		};
 	}else{
 		co_return std::unexpected(managarm::fs::Errors::END_OF_FILE);
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <vector>
+
 #include <async/cancellation.hpp>
 #include <protocols/fs/server.hpp>
 
@@ -7,7 +9,6 @@
 
 struct Process;
 struct ThreadGroup;
-struct FileDescriptor;
 
 namespace procfs {
 
@@ -116,6 +117,11 @@ protected:
 	virtual async::result<std::expected<std::string, Error>> show(Process *) = 0;
 	virtual async::result<void> store(std::string buffer) = 0;
 
+	// Nodes that control system-wide settings can only be written by root.
+	virtual bool storeNeedsRoot() {
+		return false;
+	}
+
 	async::result<frg::expected<Error, FileStats>> getStatsInternal(ThreadGroup *);
 };
 
@@ -268,6 +274,53 @@ struct UptimeNode final : RegularNode {
 	async::result<void> store(std::string) override;
 };
 
+struct MeminfoNode final : RegularNode {
+	MeminfoNode() {}
+
+	async::result<std::expected<std::string, Error>> show(Process *) override;
+	async::result<void> store(std::string) override;
+};
+
+struct SwapsNode final : RegularNode {
+	SwapsNode() {}
+
+	async::result<std::expected<std::string, Error>> show(Process *) override;
+	async::result<void> store(std::string) override;
+};
+
+struct DentryCacheNode final : RegularNode {
+	DentryCacheNode() {}
+
+	async::result<std::expected<std::string, Error>> show(Process *) override;
+	async::result<void> store(std::string) override;
+};
+
+struct PipeMaxSizeNode final : RegularNode {
+	PipeMaxSizeNode() {}
+
+	async::result<std::expected<std::string, Error>> show(Process *) override;
+	async::result<void> store(std::string) override;
+
+	bool storeNeedsRoot() override {
+		return true;
+	}
+};
+
+struct InterruptsNode final : RegularNode {
+	InterruptsNode() {}
+
+	async::result<std::expected<std::string, Error>> show(Process *) override;
+	async::result<void> store(std::string) override;
+};
+
+// /proc/stat (in contrast to StatNode, which implements /proc/[pid]/stat).
+struct SystemStatNode final : RegularNode {
+	SystemStatNode() {}
+
+	async::result<std::expected<std::string, Error>> show(Process *) override;
+	async::result<void> store(std::string) override;
+};
+
 struct OstypeNode final : RegularNode {
 	OstypeNode() {}
 
@@ -327,6 +380,17 @@ private:
 	std::weak_ptr<Process> _process;
 };
 
+struct SchedstatNode final : RegularNode {
+	SchedstatNode(Process *process);
+
+	async::result<std::expected<std::string, Error>> show(Process *) override;
+	async::result<void> store(std::string) override;
+
+	async::result<frg::expected<Error, FileStats>> getStats() override;
+private:
+	std::weak_ptr<Process> _process;
+};
+
 struct StatmNode final : RegularNode {
 	StatmNode(Process *process);
 
@@ -382,8 +446,9 @@ private:
 	async::cancellation_event _cancelServe;
 
 	DotEntriesPhase _dots = DotEntriesPhase::dot;
-	std::unordered_map<int, FileDescriptor> _fileTable;
-	std::unordered_map<int, FileDescriptor>::const_iterator _iter;
+	// Snapshot of the open descriptors when the directory was opened.
+	std::vector<int> _fds;
+	size_t _index = 0;
 };
 
 struct CgroupNode final : RegularNode {
@@ -487,8 +552,9 @@ private:
 	async::cancellation_event _cancelServe;
 
 	DotEntriesPhase _dots = DotEntriesPhase::dot;
-	std::unordered_map<int, FileDescriptor> _fileTable;
-	std::unordered_map<int, FileDescriptor>::const_iterator _iter;
+	// Snapshot of the open descriptors when the directory was opened.
+	std::vector<int> _fds;
+	size_t _index = 0;
 };
 
 struct FdInfoNode final : RegularNode {
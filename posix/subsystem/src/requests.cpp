@@ -23,11 +23,19 @@ async::result<void> serveRequests(std::shared_ptr<Process> self,
 			managarm::posix::IsTtyRequest,
 			managarm::posix::IoctlFioclexRequest,
 			managarm::posix::CloseRequest,
+			managarm::posix::CloseRangeRequest,
 			managarm::posix::EpollCallRequest,
 			managarm::posix::EpollCtlRequest,
 			managarm::posix::EpollWaitRequest,
+			managarm::posix::EpollRingRequest,
 			managarm::posix::FdGetFlagsRequest,
 			managarm::posix::FdSetFlagsRequest,
+			managarm::posix::SpliceRequest,
+			managarm::posix::SendfileRequest,
+			managarm::posix::CopyFileRangeRequest,
+			managarm::posix::TeeRequest,
+			managarm::posix::GetPipeSizeRequest,
+			managarm::posix::SetPipeSizeRequest,
 			// From filesystem.cpp
 			managarm::posix::ChrootRequest,
 			managarm::posix::ChdirRequest,
@@ -92,6 +100,10 @@ async::result<void> serveRequests(std::shared_ptr<Process> self,
 			managarm::posix::WaitRequest,
 			managarm::posix::SetAffinityRequest,
 			managarm::posix::GetAffinityRequest,
+			managarm::posix::SetSchedulerRequest,
+			managarm::posix::GetSchedulerRequest,
+			managarm::posix::SetTimerSlackRequest,
+			managarm::posix::GetTimerSlackRequest,
 			managarm::posix::GetPgidRequest,
 			managarm::posix::SetPgidRequest,
 			managarm::posix::GetSidRequest,
@@ -106,6 +118,7 @@ async::result<void> serveRequests(std::shared_ptr<Process> self,
 			managarm::posix::SocketRequest,
 			managarm::posix::SockpairRequest,
 			managarm::posix::AcceptRequest,
+			managarm::posix::SocketRingRequest,
 			// From system.cpp
 			managarm::posix::RebootRequest,
 			managarm::posix::MountRequest,
@@ -1,8 +1,12 @@
 #include <fcntl.h>
+#include <limits.h>
+#include <linux/close_range.h>
 #include <sys/poll.h>
 
 #include "common.hpp"
 #include "../epoll.hpp"
+#include "../fifo.hpp"
+#include "../splice.hpp"
 
 namespace requests {
 
@@ -228,6 +232,42 @@ HandleRequest::operator()(managarm::posix::CloseRequest &&req,
 	co_return {};
 }
 
+async::result<std::expected<void, DispatchError>>
+HandleRequest::operator()(managarm::posix::CloseRangeRequest &&req,
+		helix::BorrowedDescriptor conversation, bragi::preamble preamble,
+		std::shared_ptr<Process> self, std::shared_ptr<Generation>) {
+	id = preamble.id();
+	logBragiRequest(req);
+
+	logRequest(logRequests, self, "CLOSE_RANGE", "first={} last={} flags={:#x}",
+			req.first(), req.last(), req.flags());
+
+	// TODO: support CLOSE_RANGE_UNSHARE. This requires switching the universe
+	//       and the file table mapping of all threads that share the FileContext.
+	if(req.first() > req.last() || (req.flags() & ~CLOSE_RANGE_CLOEXEC)) {
+		co_await sendErrorResponse<managarm::posix::CloseRangeResponse>(conversation,
+				managarm::posix::Errors::ILLEGAL_ARGUMENTS);
+		co_return {};
+	}
+
+	// Descriptors are ints; larger values cannot be open.
+	if(req.first() <= INT_MAX) {
+		auto last = std::min(req.last(), static_cast<uint32_t>(INT_MAX));
+		self->fileContext()->closeRange(req.first(), last, req.flags() & CLOSE_RANGE_CLOEXEC);
+	}
+
+	managarm::posix::CloseRangeResponse resp;
+	resp.set_error(managarm::posix::Errors::SUCCESS);
+
+	auto [sendResp] = co_await helix_ng::exchangeMsgs(
+		conversation,
+		helix_ng::sendBragiHeadOnly(resp, frg::stl_allocator{})
+	);
+	HEL_CHECK(sendResp.error());
+	logBragiReply(resp);
+	co_return {};
+}
+
 async::result<std::expected<void, DispatchError>>
 HandleRequest::operator()(managarm::posix::EpollCallRequest &&req,
 		helix::BorrowedDescriptor conversation, bragi::preamble preamble,
@@ -357,7 +397,7 @@ HandleRequest::operator()(managarm::posix::EpollCallRequest &&req,
 				// if the timeout runs to completion, i.e. the sleep does not return
 				// false to signal cancellation, we DO NOT consider the call to have
 				// been interrupted.
-				co_await helix::sleepFor(static_cast<uint64_t>(timeout), c);
+				co_await helix::sleepFor(static_cast<uint64_t>(timeout), c, self->timerSlack());
 			}),
 			async::lambda([&](auto c) -> async::result<void> {
 				co_await async::suspend_indefinitely(c, cancelEvent);
@@ -508,7 +548,8 @@ HandleRequest::operator()(managarm::posix::EpollWaitRequest &&req,
 	}else{
 		assert(req.timeout() > 0);
 		async::cancellation_event cancel_wait;
-		helix::TimeoutCancellation timer{static_cast<uint64_t>(req.timeout()), cancel_wait};
+		helix::TimeoutCancellation timer{static_cast<uint64_t>(req.timeout()), cancel_wait,
+				self->timerSlack()};
 		k = co_await epoll::wait(epfile.get(), events, 16, cancel_wait);
 		co_await timer.retire();
 	}
@@ -529,6 +570,49 @@ HandleRequest::operator()(managarm::posix::EpollWaitRequest &&req,
 	co_return {};
 }
 
+async::result<std::expected<void, DispatchError>>
+HandleRequest::operator()(managarm::posix::EpollRingRequest &&req,
+		helix::BorrowedDescriptor conversation, bragi::preamble preamble,
+		std::shared_ptr<Process> self, std::shared_ptr<Generation>) {
+	id = preamble.id();
+	logBragiRequest(req);
+	logRequest(logRequests, self, "EPOLL_RING", "epollfd={}", req.fd());
+
+	auto epfile = self->fileContext()->getFile(req.fd());
+	if(!epfile) {
+		co_await sendErrorResponse<managarm::posix::EpollRingResponse>(conversation, managarm::posix::Errors::NO_SUCH_FD);
+		co_return {};
+	}
+	if(!epoll::isEpoll(epfile.get())) {
+		co_await sendErrorResponse<managarm::posix::EpollRingResponse>(conversation, managarm::posix::Errors::ILLEGAL_ARGUMENTS);
+		co_return {};
+	}
+
+	// The C library maps the memory and closes the handle afterwards.
+	auto memory = epoll::setupRing(epfile.get());
+	HelHandle handle;
+	HEL_CHECK(helTransferDescriptor(
+		memory.getHandle(),
+		self->fileContext()->getUniverse().getHandle(),
+		kHelTransferDescriptorOut,
+		kHelRightInvoke,
+		kHelRightInvoke,
+		&handle
+	));
+	managarm::posix::EpollRingResponse resp;
+	resp.set_error(managarm::posix::Errors::SUCCESS);
+	resp.set_memory_handle(handle);
+	resp.set_size(epoll::ringMemorySize);
+
+	auto [send_resp] = co_await helix_ng::exchangeMsgs(conversation,
+		helix_ng::sendBragiHeadOnly(resp, frg::stl_allocator{})
+	);
+	HEL_CHECK(send_resp.error());
+	logBragiReply(resp);
+
+	co_return {};
+}
+
 async::result<std::expected<void, DispatchError>>
 HandleRequest::operator()(managarm::posix::FdGetFlagsRequest &&req,
 		helix::BorrowedDescriptor conversation, bragi::preamble preamble,
@@ -592,4 +676,333 @@ HandleRequest::operator()(managarm::posix::FdSetFlagsRequest &&req,
 	co_return {};
 }
 
+namespace {
+
+constexpr uint32_t allSpliceFlags = SPLICE_F_MOVE | SPLICE_F_NONBLOCK | SPLICE_F_MORE | SPLICE_F_GIFT;
+
+std::optional<VfsType> fileType(File *file) {
+	auto link = file->associatedLink();
+	if(!link)
+		return std::nullopt;
+	return link->getTarget()->getType();
+}
+
+// SPLICE_F_NONBLOCK only applies to the pipe side(s) of the operation.
+async::result<bool> spliceWouldBlock(Process *process, File *in, File *out) {
+	if(fifo::isPipe(in)) {
+		auto status = co_await in->pollStatus(process);
+		if(status && !(std::get<1>(status.value()) & (EPOLLIN | EPOLLHUP)))
+			co_return true;
+	}
+	if(fifo::isPipe(out)) {
+		auto status = co_await out->pollStatus(process);
+		if(status && !(std::get<1>(status.value()) & (EPOLLOUT | EPOLLERR)))
+			co_return true;
+	}
+	co_return false;
+}
+
+} // anonymous namespace
+
+async::result<std::expected<void, DispatchError>>
+HandleRequest::operator()(managarm::posix::SpliceRequest &&req,
+		helix::BorrowedDescriptor conversation, bragi::preamble preamble,
+		std::shared_ptr<Process> self, std::shared_ptr<Generation>) {
+	id = preamble.id();
+	logBragiRequest(req);
+
+	logRequest(logRequests, self, "SPLICE", "in_fd={} out_fd={} size={}",
+			req.in_fd(), req.out_fd(), req.size());
+
+	auto in = self->fileContext()->getFile(req.in_fd());
+	auto out = self->fileContext()->getFile(req.out_fd());
+	if(!in || !out) {
+		co_await sendErrorResponse<managarm::posix::SpliceResponse>(conversation,
+				managarm::posix::Errors::NO_SUCH_FD);
+		co_return {};
+	}
+
+	bool inIsPipe = fifo::isPipe(in.get());
+	bool outIsPipe = fifo::isPipe(out.get());
+	if((!inIsPipe && !outIsPipe) || (req.flags() & ~allSpliceFlags)
+			|| (req.has_in_offset() && req.in_offset() < 0)
+			|| (req.has_out_offset() && req.out_offset() < 0)) {
+		co_await sendErrorResponse<managarm::posix::SpliceResponse>(conversation,
+				managarm::posix::Errors::ILLEGAL_ARGUMENTS);
+		co_return {};
+	}
+	if((inIsPipe && req.has_in_offset()) || (outIsPipe && req.has_out_offset())) {
+		co_await sendErrorResponse<managarm::posix::SpliceResponse>(conversation,
+				managarm::posix::Errors::SEEK_ON_PIPE);
+		co_return {};
+	}
+	if((req.flags() & SPLICE_F_NONBLOCK) && co_await spliceWouldBlock(self.get(), in.get(), out.get())) {
+		co_await sendErrorResponse<managarm::posix::SpliceResponse>(conversation,
+				managarm::posix::Errors::WOULD_BLOCK);
+		co_return {};
+	}
+
+	std::optional<int64_t> inOffset;
+	std::optional<int64_t> outOffset;
+	if(req.has_in_offset())
+		inOffset = req.in_offset();
+	if(req.has_out_offset())
+		outOffset = req.out_offset();
+
+	auto result = co_await splice::transfer(self.get(), in.get(), inOffset,
+			out.get(), outOffset, req.size());
+	if(!result) {
+		co_await sendErrorResponse<managarm::posix::SpliceResponse>(conversation,
+				result.error() | toPosixProtoError);
+		co_return {};
+	}
+
+	managarm::posix::SpliceResponse resp;
+	resp.set_error(managarm::posix::Errors::SUCCESS);
+	resp.set_size(result.value());
+	resp.set_in_offset(inOffset.value_or(0));
+	resp.set_out_offset(outOffset.value_or(0));
+
+	auto [send_resp] = co_await helix_ng::exchangeMsgs(
+		conversation,
+		helix_ng::sendBragiHeadOnly(resp, frg::stl_allocator{})
+	);
+	HEL_CHECK(send_resp.error());
+	logBragiReply(resp);
+	co_return {};
+}
+
+async::result<std::expected<void, DispatchError>>
+HandleRequest::operator()(managarm::posix::SendfileRequest &&req,
+		helix::BorrowedDescriptor conversation, bragi::preamble preamble,
+		std::shared_ptr<Process> self, std::shared_ptr<Generation>) {
+	id = preamble.id();
+	logBragiRequest(req);
+
+	logRequest(logRequests, self, "SENDFILE", "out_fd={} in_fd={} size={}",
+			req.out_fd(), req.in_fd(), req.size());
+
+	auto in = self->fileContext()->getFile(req.in_fd());
+	auto out = self->fileContext()->getFile(req.out_fd());
+	if(!in || !out) {
+		co_await sendErrorResponse<managarm::posix::SendfileResponse>(conversation,
+				managarm::posix::Errors::NO_SUCH_FD);
+		co_return {};
+	}
+	if(req.has_offset() && req.offset() < 0) {
+		co_await sendErrorResponse<managarm::posix::SendfileResponse>(conversation,
+				managarm::posix::Errors::ILLEGAL_ARGUMENTS);
+		co_return {};
+	}
+
+	std::optional<int64_t> inOffset;
+	std::optional<int64_t> outOffset;
+	if(req.has_offset())
+		inOffset = req.offset();
+
+	auto result = co_await splice::transfer(self.get(), in.get(), inOffset,
+			out.get(), outOffset, req.size());
+	if(!result) {
+		co_await sendErrorResponse<managarm::posix::SendfileResponse>(conversation,
+				result.error() | toPosixProtoError);
+		co_return {};
+	}
+
+	managarm::posix::SendfileResponse resp;
+	resp.set_error(managarm::posix::Errors::SUCCESS);
+	resp.set_size(result.value());
+	resp.set_offset(inOffset.value_or(0));
+
+	auto [send_resp] = co_await helix_ng::exchangeMsgs(
+		conversation,
+		helix_ng::sendBragiHeadOnly(resp, frg::stl_allocator{})
+	);
+	HEL_CHECK(send_resp.error());
+	logBragiReply(resp);
+	co_return {};
+}
+
+async::result<std::expected<void, DispatchError>>
+HandleRequest::operator()(managarm::posix::CopyFileRangeRequest &&req,
+		helix::BorrowedDescriptor conversation, bragi::preamble preamble,
+		std::shared_ptr<Process> self, std::shared_ptr<Generation>) {
+	id = preamble.id();
+	logBragiRequest(req);
+
+	logRequest(logRequests, self, "COPY_FILE_RANGE", "in_fd={} out_fd={} size={}",
+			req.in_fd(), req.out_fd(), req.size());
+
+	auto in = self->fileContext()->getFile(req.in_fd());
+	auto out = self->fileContext()->getFile(req.out_fd());
+	if(!in || !out) {
+		co_await sendErrorResponse<managarm::posix::CopyFileRangeResponse>(conversation,
+				managarm::posix::Errors::NO_SUCH_FD);
+		co_return {};
+	}
+
+	auto inType = fileType(in.get());
+	auto outType = fileType(out.get());
+	if(inType == VfsType::directory || outType == VfsType::directory) {
+		co_await sendErrorResponse<managarm::posix::CopyFileRangeResponse>(conversation,
+				managarm::posix::Errors::IS_DIRECTORY);
+		co_return {};
+	}
+	// Like Linux, fail with EBADF unless in is readable and out is writable (but not O_APPEND).
+	if(!in->isReadable() || !out->isWritable() || out->isAppend()) {
+		co_await sendErrorResponse<managarm::posix::CopyFileRangeResponse>(conversation,
+				managarm::posix::Errors::BAD_FD);
+		co_return {};
+	}
+	if(inType != VfsType::regular || outType != VfsType::regular || req.flags()
+			|| (req.has_in_offset() && req.in_offset() < 0)
+			|| (req.has_out_offset() && req.out_offset() < 0)) {
+		co_await sendErrorResponse<managarm::posix::CopyFileRangeResponse>(conversation,
+				managarm::posix::Errors::ILLEGAL_ARGUMENTS);
+		co_return {};
+	}
+
+	std::optional<int64_t> inOffset;
+	std::optional<int64_t> outOffset;
+	if(req.has_in_offset())
+		inOffset = req.in_offset();
+	if(req.has_out_offset())
+		outOffset = req.out_offset();
+
+	auto result = co_await splice::copyFileRange(self.get(), in.get(), inOffset,
+			out.get(), outOffset, req.size());
+	if(!result) {
+		co_await sendErrorResponse<managarm::posix::CopyFileRangeResponse>(conversation,
+				result.error() | toPosixProtoError);
+		co_return {};
+	}
+
+	managarm::posix::CopyFileRangeResponse resp;
+	resp.set_error(managarm::posix::Errors::SUCCESS);
+	resp.set_size(result.value());
+	resp.set_in_offset(inOffset.value_or(0));
+	resp.set_out_offset(outOffset.value_or(0));
+
+	auto [send_resp] = co_await helix_ng::exchangeMsgs(
+		conversation,
+		helix_ng::sendBragiHeadOnly(resp, frg::stl_allocator{})
+	);
+	HEL_CHECK(send_resp.error());
+	logBragiReply(resp);
+	co_return {};
+}
+
+async::result<std::expected<void, DispatchError>>
+HandleRequest::operator()(managarm::posix::TeeRequest &&req,
+		helix::BorrowedDescriptor conversation, bragi::preamble preamble,
+		std::shared_ptr<Process> self, std::shared_ptr<Generation>) {
+	id = preamble.id();
+	logBragiRequest(req);
+
+	logRequest(logRequests, self, "TEE", "in_fd={} out_fd={} size={}",
+			req.in_fd(), req.out_fd(), req.size());
+
+	auto in = self->fileContext()->getFile(req.in_fd());
+	auto out = self->fileContext()->getFile(req.out_fd());
+	if(!in || !out) {
+		co_await sendErrorResponse<managarm::posix::TeeResponse>(conversation,
+				managarm::posix::Errors::NO_SUCH_FD);
+		co_return {};
+	}
+	if(!fifo::isPipe(in.get()) || !fifo::isPipe(out.get()) || (req.flags() & ~allSpliceFlags)) {
+		co_await sendErrorResponse<managarm::posix::TeeResponse>(conversation,
+				managarm::posix::Errors::ILLEGAL_ARGUMENTS);
+		co_return {};
+	}
+
+	auto result = co_await fifo::tee(in.get(), out.get(), req.size(),
+			req.flags() & SPLICE_F_NONBLOCK);
+	if(!result) {
+		co_await sendErrorResponse<managarm::posix::TeeResponse>(conversation,
+				result.error() | toPosixProtoError);
+		co_return {};
+	}
+
+	managarm::posix::TeeResponse resp;
+	resp.set_error(managarm::posix::Errors::SUCCESS);
+	resp.set_size(result.value());
+
+	auto [send_resp] = co_await helix_ng::exchangeMsgs(
+		conversation,
+		helix_ng::sendBragiHeadOnly(resp, frg::stl_allocator{})
+	);
+	HEL_CHECK(send_resp.error());
+	logBragiReply(resp);
+	co_return {};
+}
+
+async::result<std::expected<void, DispatchError>>
+HandleRequest::operator()(managarm::posix::GetPipeSizeRequest &&req,
+		helix::BorrowedDescriptor conversation, bragi::preamble preamble,
+		std::shared_ptr<Process> self, std::shared_ptr<Generation>) {
+	id = preamble.id();
+	logBragiRequest(req);
+	logRequest(logRequests, self, "GET_PIPE_SZ", "fd={}", req.fd());
+
+	auto file = self->fileContext()->getFile(req.fd());
+	if(!file) {
+		co_await sendErrorResponse<managarm::posix::GetPipeSizeResponse>(conversation,
+				managarm::posix::Errors::NO_SUCH_FD);
+		co_return {};
+	}
+
+	auto result = fifo::getPipeSize(file.get());
+	if(!result) {
+		co_await sendErrorResponse<managarm::posix::GetPipeSizeResponse>(conversation,
+				result.error() | toPosixProtoError);
+		co_return {};
+	}
+
+	managarm::posix::GetPipeSizeResponse resp;
+	resp.set_error(managarm::posix::Errors::SUCCESS);
+	resp.set_size(result.value());
+
+	auto [send_resp] = co_await helix_ng::exchangeMsgs(
+		conversation,
+		helix_ng::sendBragiHeadOnly(resp, frg::stl_allocator{})
+	);
+	HEL_CHECK(send_resp.error());
+	logBragiReply(resp);
+	co_return {};
+}
+
+async::result<std::expected<void, DispatchError>>
+HandleRequest::operator()(managarm::posix::SetPipeSizeRequest &&req,
+		helix::BorrowedDescriptor conversation, bragi::preamble preamble,
+		std::shared_ptr<Process> self, std::shared_ptr<Generation>) {
+	id = preamble.id();
+	logBragiRequest(req);
+	logRequest(logRequests, self, "SET_PIPE_SZ", "fd={} size={}", req.fd(), req.size());
+
+	auto file = self->fileContext()->getFile(req.fd());
+	if(!file) {
+		co_await sendErrorResponse<managarm::posix::SetPipeSizeResponse>(conversation,
+				managarm::posix::Errors::NO_SUCH_FD);
+		co_return {};
+	}
+
+	auto result = fifo::setPipeSize(file.get(), req.size(), self->threadGroup()->isRoot());
+	if(!result) {
+		co_await sendErrorResponse<managarm::posix::SetPipeSizeResponse>(conversation,
+				result.error() | toPosixProtoError);
+		co_return {};
+	}
+
+	managarm::posix::SetPipeSizeResponse resp;
+	resp.set_error(managarm::posix::Errors::SUCCESS);
+	resp.set_size(result.value());
+
+	auto [send_resp] = co_await helix_ng::exchangeMsgs(
+		conversation,
+		helix_ng::sendBragiHeadOnly(resp, frg::stl_allocator{})
+	);
+	HEL_CHECK(send_resp.error());
+	logBragiReply(resp);
+	co_return {};
+}
+
 } // namespace requests
@@ -1522,6 +1522,13 @@ HandleRequest::operator()(managarm::posix::OpenAtRequest &&req,
 			co_return {};
 		}
 	}
+	if(req.flags() & managarm::posix::OpenFlags::OF_PATH) {
+		file->setAccessMode(false, false, false);
+	}else{
+		file->setAccessMode(semantic_flags & semanticRead, semantic_flags & semanticWrite,
+				semantic_flags & semanticAppend);
+	}
+
 	auto fd = self->fileContext()->attachFile(file,
 			req.flags() & managarm::posix::OpenFlags::OF_CLOEXEC);
 
@@ -1,5 +1,6 @@
 #include "common.hpp"
 #include "../memfd.hpp"
+#include "../swap.hpp"
 #include <sys/mman.h>
 #include <linux/memfd.h>
 
@@ -86,11 +87,8 @@ HandleRequest::operator()(managarm::posix::VmMapRequest &&req,
 					{}, nullptr,
 					0, size, true, nativeFlags);
 		}else{
-			HelHandle handle;
-			HEL_CHECK(helAllocateMemory(size, 0, nullptr, &handle));
-
 			result = co_await self->vmContext()->mapFile(hint,
-					helix::UniqueDescriptor{handle}, nullptr,
+					swap::allocateAnonymousMemory(size), nullptr,
 					0, size, false, nativeFlags);
 		}
 	}else{
@@ -1,5 +1,6 @@
 #include "common.hpp"
 #include "../requests.hpp"
+#include <sched.h>
 #include <sys/wait.h>
 #include <sys/resource.h>
 #include <iostream>
@@ -279,6 +280,189 @@ HandleRequest::operator()(managarm::posix::GetAffinityRequest &&req,
 	co_return {};
 }
 
+namespace {
+
+#ifndef SCHED_DEADLINE
+#define SCHED_DEADLINE 6
+#endif
+
+// Returns the thread of the process that is identified by pid (zero refers to self).
+helix::BorrowedDescriptor findSchedulingTarget(std::shared_ptr<Process> self, int64_t pid) {
+	if(!pid || pid == self->pid())
+		return self->threadDescriptor();
+	auto target = Process::findProcess(pid);
+	if(!target)
+		return {};
+	return target->threadDescriptor();
+}
+
+} // anonymous namespace
+
+async::result<std::expected<void, DispatchError>>
+HandleRequest::operator()(managarm::posix::SetSchedulerRequest &&req,
+		helix::BorrowedDescriptor conversation, bragi::preamble preamble,
+		std::shared_ptr<Process> self, std::shared_ptr<Generation>) {
+	id = preamble.id();
+	logBragiRequest(req);
+
+	logRequest(logRequests, self, "SET_SCHEDULER", "pid={} policy={} priority={}",
+			req.pid(), req.policy(), req.priority());
+
+	HelSchedulingParameters params{};
+	switch(req.policy()) {
+	case SCHED_OTHER:
+	case SCHED_BATCH:
+	case SCHED_IDLE:
+		if(req.priority()) {
+			co_await sendErrorResponse<managarm::posix::SetSchedulerResponse>(conversation, managarm::posix::Errors::ILLEGAL_ARGUMENTS);
+			co_return {};
+		}
+		params.policy = kHelSchedulingFair;
+		break;
+	case SCHED_FIFO:
+		params.policy = kHelSchedulingFifo;
+		params.priority = req.priority();
+		break;
+	case SCHED_RR:
+		params.policy = kHelSchedulingRoundRobin;
+		params.priority = req.priority();
+		break;
+	case SCHED_DEADLINE:
+		params.policy = kHelSchedulingDeadline;
+		params.runtime = req.runtime();
+		params.deadline = req.deadline();
+		params.period = req.period();
+		break;
+	default:
+		co_await sendErrorResponse<managarm::posix::SetSchedulerResponse>(conversation, managarm::posix::Errors::ILLEGAL_ARGUMENTS);
+		co_return {};
+	}
+
+	// Like Linux without CAP_SYS_NICE, only root may use real-time policies.
+	if(params.policy != kHelSchedulingFair && !self->isRoot()) {
+		co_await sendErrorResponse<managarm::posix::SetSchedulerResponse>(conversation, managarm::posix::Errors::INSUFFICIENT_PERMISSION);
+		co_return {};
+	}
+
+	// TODO: permission checking for other processes.
+	auto thread = findSchedulingTarget(self, req.pid());
+	if(thread.getHandle() == kHelNullHandle) {
+		co_await sendErrorResponse<managarm::posix::SetSchedulerResponse>(conversation, managarm::posix::Errors::NO_SUCH_RESOURCE);
+		co_return {};
+	}
+
+	HelError e = helSetSchedulingParameters(thread.getHandle(), &params);
+	if(e == kHelErrIllegalArgs) {
+		co_await sendErrorResponse<managarm::posix::SetSchedulerResponse>(conversation, managarm::posix::Errors::ILLEGAL_ARGUMENTS);
+		co_return {};
+	}else if(e == kHelErrIllegalState) {
+		// Admission control for SCHED_DEADLINE failed (EBUSY on Linux).
+		co_await sendErrorResponse<managarm::posix::SetSchedulerResponse>(conversation, managarm::posix::Errors::RESOURCE_IN_USE);
+		co_return {};
+	}else if(e != kHelErrNone) {
+		std::cout << "posix: SET_SCHEDULER hel call returned unexpected error: " << e << std::endl;
+		co_await sendErrorResponse<managarm::posix::SetSchedulerResponse>(conversation, managarm::posix::Errors::INTERNAL_ERROR);
+		co_return {};
+	}
+
+	managarm::posix::SetSchedulerResponse resp;
+	resp.set_error(managarm::posix::Errors::SUCCESS);
+
+	auto [sendResp] = co_await helix_ng::exchangeMsgs(
+		conversation,
+		helix_ng::sendBragiHeadOnly(resp, frg::stl_allocator{})
+	);
+	HEL_CHECK(sendResp.error());
+	logBragiReply(resp);
+	co_return {};
+}
+
+async::result<std::expected<void, DispatchError>>
+HandleRequest::operator()(managarm::posix::GetSchedulerRequest &&req,
+		helix::BorrowedDescriptor conversation, bragi::preamble preamble,
+		std::shared_ptr<Process> self, std::shared_ptr<Generation>) {
+	id = preamble.id();
+	logBragiRequest(req);
+
+	logRequest(logRequests, self, "GET_SCHEDULER", "pid={}", req.pid());
+
+	auto thread = findSchedulingTarget(self, req.pid());
+	if(thread.getHandle() == kHelNullHandle) {
+		co_await sendErrorResponse<managarm::posix::GetSchedulerResponse>(conversation, managarm::posix::Errors::NO_SUCH_RESOURCE);
+		co_return {};
+	}
+
+	HelSchedulingParameters params;
+	HEL_CHECK(helGetSchedulingParameters(thread.getHandle(), &params));
+
+	managarm::posix::GetSchedulerResponse resp;
+	resp.set_error(managarm::posix::Errors::SUCCESS);
+	switch(params.policy) {
+	case kHelSchedulingFifo: resp.set_policy(SCHED_FIFO); break;
+	case kHelSchedulingRoundRobin: resp.set_policy(SCHED_RR); break;
+	case kHelSchedulingDeadline: resp.set_policy(SCHED_DEADLINE); break;
+	default: resp.set_policy(SCHED_OTHER); break;
+	}
+	if(params.policy == kHelSchedulingFifo || params.policy == kHelSchedulingRoundRobin)
+		resp.set_priority(params.priority);
+	resp.set_runtime(params.runtime);
+	resp.set_deadline(params.deadline);
+	resp.set_period(params.period);
+
+	auto [sendResp] = co_await helix_ng::exchangeMsgs(
+		conversation,
+		helix_ng::sendBragiHeadOnly(resp, frg::stl_allocator{})
+	);
+	HEL_CHECK(sendResp.error());
+	logBragiReply(resp);
+	co_return {};
+}
+
+async::result<std::expected<void, DispatchError>>
+HandleRequest::operator()(managarm::posix::SetTimerSlackRequest &&req,
+		helix::BorrowedDescriptor conversation, bragi::preamble preamble,
+		std::shared_ptr<Process> self, std::shared_ptr<Generation>) {
+	id = preamble.id();
+	logBragiRequest(req);
+
+	logRequest(logRequests, self, "SET_TIMER_SLACK", "slack={}", req.slack());
+
+	self->setTimerSlack(req.slack() ? req.slack() : kHelDefaultTimerSlack);
+
+	managarm::posix::SetTimerSlackResponse resp;
+	resp.set_error(managarm::posix::Errors::SUCCESS);
+
+	auto [sendResp] = co_await helix_ng::exchangeMsgs(
+		conversation,
+		helix_ng::sendBragiHeadOnly(resp, frg::stl_allocator{})
+	);
+	HEL_CHECK(sendResp.error());
+	logBragiReply(resp);
+	co_return {};
+}
+
+async::result<std::expected<void, DispatchError>>
+HandleRequest::operator()(managarm::posix::GetTimerSlackRequest &&req,
+		helix::BorrowedDescriptor conversation, bragi::preamble preamble,
+		std::shared_ptr<Process> self, std::shared_ptr<Generation>) {
+	id = preamble.id();
+	logBragiRequest(req);
+
+	logRequest(logRequests, self, "GET_TIMER_SLACK");
+
+	managarm::posix::GetTimerSlackResponse resp;
+	resp.set_error(managarm::posix::Errors::SUCCESS);
+	resp.set_slack(self->timerSlack());
+
+	auto [sendResp] = co_await helix_ng::exchangeMsgs(
+		conversation,
+		helix_ng::sendBragiHeadOnly(resp, frg::stl_allocator{})
+	);
+	HEL_CHECK(sendResp.error());
+	logBragiReply(resp);
+	co_return {};
+}
+
 async::result<std::expected<void, DispatchError>>
 HandleRequest::operator()(managarm::posix::GetPgidRequest &&req,
 		helix::BorrowedDescriptor conversation, bragi::preamble preamble,
@@ -5,6 +5,7 @@
 #include "../netlink/nl-socket.hpp"
 #include <sys/socket.h>
 #include <linux/netlink.h>
+#include <protocols/posix/data.hpp>
 
 namespace requests {
 
@@ -279,4 +280,51 @@ HandleRequest::operator()(managarm::posix::AcceptRequest &&req,
 	co_return {};
 }
 
+async::result<std::expected<void, DispatchError>>
+HandleRequest::operator()(managarm::posix::SocketRingRequest &&req,
+		helix::BorrowedDescriptor conversation, bragi::preamble preamble,
+		std::shared_ptr<Process> self, std::shared_ptr<Generation>) {
+	id = preamble.id();
+	logBragiRequest(req);
+	logRequest(logRequests, self, "SOCKET_RING", "fd={}", req.fd());
+
+	auto sockfile = self->fileContext()->getFile(req.fd());
+	if(!sockfile) {
+		co_await sendErrorResponse<managarm::posix::SocketRingResponse>(conversation, managarm::posix::Errors::NO_SUCH_FD);
+		co_return {};
+	}
+
+	auto ring = un_socket::setupRing(sockfile.get(), self.get());
+	if(!ring) {
+		co_await sendErrorResponse<managarm::posix::SocketRingResponse>(conversation, ring.error() | toPosixProtoError);
+		co_return {};
+	}
+
+	// The C library maps the memory and closes the handle afterwards.
+	auto [memory, index] = ring.value();
+	HelHandle handle;
+	HEL_CHECK(helTransferDescriptor(
+		memory.getHandle(),
+		self->fileContext()->getUniverse().getHandle(),
+		kHelTransferDescriptorOut,
+		kHelRightInvoke,
+		kHelRightInvoke,
+		&handle
+	));
+	managarm::posix::SocketRingResponse resp;
+	resp.set_error(managarm::posix::Errors::SUCCESS);
+	resp.set_memory_handle(handle);
+	resp.set_size(2 * posix::socketRingSize);
+	resp.set_index(index);
+
+	auto [send_resp] = co_await helix_ng::exchangeMsgs(
+			conversation,
+			helix_ng::sendBragiHeadOnly(resp, frg::stl_allocator{})
+		);
+
+	HEL_CHECK(send_resp.error());
+	logBragiReply(resp);
+	co_return {};
+}
+
 } // namespace requests
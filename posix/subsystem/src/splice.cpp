@@ -0,0 +1,209 @@
+#include <algorithm>
+#include <vector>
+
+#include <helix/ipc.hpp>
+
+#include "extern_fs.hpp"
+#include "fifo.hpp"
+#include "splice.hpp"
+
+namespace splice {
+
+namespace {
+
+// Size of the intermediate buffer.
+// Large enough to amortize the per-chunk requests to file system servers.
+constexpr size_t chunkSize = 0x10000;
+
+// Writes the entire buffer unless an error occurs. Returns the number of bytes written.
+async::result<std::expected<size_t, Error>>
+writeChunk(Process *process, File *file, std::optional<int64_t> offset,
+		const uint8_t *data, size_t length) {
+	size_t progress = 0;
+	while(progress < length) {
+		auto result = offset
+				? co_await file->pwrite(process, *offset + progress, data + progress, length - progress)
+				: co_await file->writeAll(process, data + progress, length - progress);
+		if(!result) {
+			if(progress)
+				break;
+			co_return std::unexpected{result.error()};
+		}
+		if(!result.value())
+			break;
+		progress += result.value();
+	}
+	co_return progress;
+}
+
+// Reads up to length bytes from in at the given position (or at the file offset).
+// If useMemory is set, memory holds the file's contents. Returns zero at the end of the file.
+async::result<std::expected<size_t, Error>>
+readChunk(Process *process, File *in, bool useMemory, helix::BorrowedDescriptor memory,
+		std::optional<int64_t> position, uint8_t *data, size_t length) {
+	if(useMemory) {
+		auto readMemory = co_await helix_ng::readMemory(memory, *position, length, data);
+		// posix does not lock the file, so it may have been truncated since we sampled its size.
+		if(readMemory.error())
+			co_return std::unexpected{Error::ioError};
+		co_return length;
+	}
+
+	auto result = position
+			? co_await in->pread(process, *position, data, length)
+			: co_await in->readSome(process, data, length, {});
+	if(!result) {
+		if(result.error() == Error::eof)
+			co_return size_t{0};
+		co_return std::unexpected{result.error()};
+	}
+	co_return result.value();
+}
+
+async::result<std::expected<int64_t, Error>> currentOffset(File *file) {
+	auto result = co_await file->seek(0, VfsSeek::relative);
+	if(!result)
+		co_return std::unexpected{result.error()};
+	co_return result.value();
+}
+
+} // anonymous namespace
+
+async::result<std::expected<size_t, Error>>
+transfer(Process *process, File *in, std::optional<int64_t> &inOffset,
+		File *out, std::optional<int64_t> &outOffset, size_t length) {
+	// The file's own server enforces the access mode for reads and writes through its lane,
+	// but accessMemory() and pwrite() from within posix bypass those checks.
+	if(!in->isReadable() || !out->isWritable())
+		co_return std::unexpected{Error::badFileDescriptor};
+	if(!length)
+		co_return size_t{0};
+
+	// Hand over the pages instead of copying them.
+	if(fifo::isPipe(in) && fifo::isPipe(out))
+		co_return co_await fifo::splice(in, out, length, false);
+
+	bool useMemory = in->hasContentMemory();
+
+	// Reading from the memory object requires an explicit position.
+	std::optional<int64_t> position = inOffset;
+	if(!position && useMemory) {
+		auto result = co_await currentOffset(in);
+		if(!result)
+			co_return std::unexpected{result.error()};
+		position = result.value();
+	}
+
+	helix::UniqueDescriptor memory;
+	if(useMemory) {
+		auto stats = co_await in->associatedLink()->getTarget()->getStats();
+		if(!stats)
+			co_return std::unexpected{stats.error()};
+		auto fileSize = stats.value().fileSize;
+		if(static_cast<uint64_t>(*position) >= fileSize)
+			co_return size_t{0};
+		length = std::min(length, fileSize - *position);
+		memory = co_await in->accessMemory();
+	}
+
+	size_t progress = 0;
+	std::optional<Error> error;
+	if(fifo::isPipe(out)) {
+		// Read directly into the pages of the pipe.
+		auto result = co_await fifo::fill(out, length, [&] (uint8_t *data, size_t size) {
+			return readChunk(process, in, useMemory, memory, position, data, size);
+		});
+		if(result)
+			progress = result.value();
+		else
+			error = result.error();
+	}else{
+		std::vector<uint8_t> buffer(std::min(length, chunkSize));
+		while(progress < length) {
+			auto chunk = std::min(length - progress, chunkSize);
+
+			std::optional<int64_t> inPosition;
+			if(position)
+				inPosition = *position + progress;
+			auto readLength = co_await readChunk(process, in, useMemory, memory,
+					inPosition, buffer.data(), chunk);
+			if(!readLength) {
+				error = readLength.error();
+				break;
+			}
+			if(!readLength.value())
+				break;
+
+			std::optional<int64_t> outPosition;
+			if(outOffset)
+				outPosition = *outOffset + progress;
+			auto written = co_await writeChunk(process, out, outPosition,
+					buffer.data(), readLength.value());
+			if(!written) {
+				error = written.error();
+				break;
+			}
+			progress += written.value();
+
+			// Do not block on stream inputs once we transferred some data.
+			if(written.value() < readLength.value() || !position)
+				break;
+		}
+	}
+
+	if(inOffset) {
+		*inOffset += progress;
+	}else if(position) {
+		co_await in->seek(*position + progress, VfsSeek::absolute);
+	}
+	if(outOffset)
+		*outOffset += progress;
+
+	if(!progress && error)
+		co_return std::unexpected{*error};
+	co_return progress;
+}
+
+async::result<std::expected<size_t, Error>>
+copyFileRange(Process *process, File *in, std::optional<int64_t> &inOffset,
+		File *out, std::optional<int64_t> &outOffset, size_t length) {
+	auto inPosition = inOffset;
+	if(!inPosition) {
+		auto result = co_await currentOffset(in);
+		if(!result)
+			co_return std::unexpected{result.error()};
+		inPosition = result.value();
+	}
+	auto outPosition = outOffset;
+	if(!outPosition) {
+		auto result = co_await currentOffset(out);
+		if(!result)
+			co_return std::unexpected{result.error()};
+		outPosition = result.value();
+	}
+
+	// Like Linux, reject overlapping ranges within the same file.
+	if(in->associatedLink()->getTarget() == out->associatedLink()->getTarget()
+			&& *inPosition < *outPosition + static_cast<int64_t>(length)
+			&& *outPosition < *inPosition + static_cast<int64_t>(length))
+		co_return std::unexpected{Error::illegalArguments};
+
+	auto result = co_await extern_fs::copyFileRange(in, *inPosition, out, *outPosition, length);
+	if(!result) {
+		if(result.error() != Error::notSupported)
+			co_return std::unexpected{result.error()};
+		co_return co_await transfer(process, in, inOffset, out, outOffset, length);
+	}
+
+	if(inOffset)
+		*inOffset += result.value();
+	else
+		co_await in->seek(*inPosition + result.value(), VfsSeek::absolute);
+	if(outOffset)
+		*outOffset += result.value();
+	else
+		co_await out->seek(*outPosition + result.value(), VfsSeek::absolute);
+	co_return result.value();
+}
+
+} // namespace splice
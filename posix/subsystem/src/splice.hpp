@@ -0,0 +1,31 @@
+#pragma once
+
+#include <optional>
+
+#include "file.hpp"
+
+// Backends of splice(), sendfile() and copy_file_range().
+// Data is copied inside the posix subsystem (or the file system server)
+// instead of bouncing through a buffer of the calling process.
+
+namespace splice {
+
+// Copies up to length bytes from in to out.
+// If an offset is given, the file is accessed at that offset and the offset is advanced;
+// otherwise, the file offset is used and updated.
+// Files whose accessMemory() holds their contents are read from that memory object directly.
+// Stream inputs (e.g., pipes and sockets) transfer at most one chunk of data per call.
+// Pipe outputs are filled in place (at most one pipe buffer per call); between two pipes,
+// the pages are moved without copying the data.
+async::result<std::expected<size_t, Error>>
+transfer(Process *process, File *in, std::optional<int64_t> &inOffset,
+		File *out, std::optional<int64_t> &outOffset, size_t length);
+
+// Like transfer() but for regular files only.
+// Lets the file system server copy the data if both files are on the same server.
+// Fails with Error::illegalArguments if the ranges overlap within the same file.
+async::result<std::expected<size_t, Error>>
+copyFileRange(Process *process, File *in, std::optional<int64_t> &inOffset,
+		File *out, std::optional<int64_t> &outOffset, size_t length);
+
+} // namespace splice
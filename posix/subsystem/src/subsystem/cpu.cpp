@@ -0,0 +1,219 @@
+#include <format>
+#include <bragi/helpers-std.hpp>
+#include <kerncfg.bragi.hpp>
+
+#include "../drvcore.hpp"
+#include "../requests.hpp"
+#include "cpu.hpp"
+
+namespace cpu_subsystem {
+
+namespace {
+
+drvcore::BusSubsystem *sysfsSubsystem;
+
+struct CpuTopology {
+	uint64_t packageId;
+	uint64_t coreId;
+	uint64_t threadId;
+	uint64_t llcId;
+	uint64_t numaNode;
+};
+
+std::vector<CpuTopology> cpuTopologies;
+
+// Formats a set of CPUs in Linux' list format (e.g., "0-3,8-11").
+template<typename Pred>
+std::string formatCpuList(Pred pred) {
+	std::string list;
+	size_t cpu = 0;
+	while(cpu < cpuTopologies.size()) {
+		if(!pred(cpuTopologies[cpu])) {
+			cpu++;
+			continue;
+		}
+
+		auto first = cpu;
+		while(cpu + 1 < cpuTopologies.size() && pred(cpuTopologies[cpu + 1]))
+			cpu++;
+
+		if(!list.empty())
+			list += ',';
+		if(first == cpu)
+			list += std::format("{}", first);
+		else
+			list += std::format("{}-{}", first, cpu);
+		cpu++;
+	}
+	return list;
+}
+
+// Represents /sys/devices/system and /sys/devices/system/cpu.
+struct SystemDevice final : drvcore::Device {
+	SystemDevice(std::shared_ptr<drvcore::Device> parent, std::string name)
+	: drvcore::Device{parent, parent, std::move(name), nullptr} { }
+
+	void composeUevent(drvcore::UeventProperties &) override { }
+};
+
+struct Device final : drvcore::BusDevice {
+	Device(std::shared_ptr<drvcore::Device> parent, size_t index)
+	: drvcore::BusDevice{sysfsSubsystem, std::format("cpu{}", index), nullptr, std::move(parent)},
+			index{index} { }
+
+	void composeUevent(drvcore::UeventProperties &ue) override {
+		ue.set("SUBSYSTEM", "cpu");
+	}
+
+	size_t index;
+	// The topology/ directory.
+	std::shared_ptr<sysfs::Object> topology;
+};
+
+struct TopologyObject final : sysfs::Object {
+	TopologyObject(std::shared_ptr<Device> device)
+	: sysfs::Object{device, "topology"}, index{device->index} { }
+
+	size_t index;
+};
+
+// Attributes of /sys/devices/system/cpu.
+
+struct CpuRangeAttribute : sysfs::Attribute {
+	CpuRangeAttribute(std::string name)
+	: sysfs::Attribute{std::move(name), false} { }
+
+	async::result<frg::expected<Error, std::string>> show(sysfs::Object *) override {
+		co_return formatCpuList([] (const CpuTopology &) { return true; }) + "\n";
+	}
+};
+
+CpuRangeAttribute onlineAttr{"online"};
+CpuRangeAttribute possibleAttr{"possible"};
+CpuRangeAttribute presentAttr{"present"};
+
+// Attributes of /sys/devices/system/cpu/cpuN/topology.
+
+struct IdAttribute : sysfs::Attribute {
+	IdAttribute(std::string name, uint64_t CpuTopology::*member)
+	: sysfs::Attribute{std::move(name), false}, member_{member} { }
+
+	async::result<frg::expected<Error, std::string>> show(sysfs::Object *object) override {
+		auto topology = static_cast<TopologyObject *>(object);
+		co_return std::format("{}\n", cpuTopologies[topology->index].*member_);
+	}
+
+private:
+	uint64_t CpuTopology::*member_;
+};
+
+struct SiblingsAttribute : sysfs::Attribute {
+	using Relation = bool (*)(const CpuTopology &, const CpuTopology &);
+
+	SiblingsAttribute(std::string name, Relation relation)
+	: sysfs::Attribute{std::move(name), false}, relation_{relation} { }
+
+	async::result<frg::expected<Error, std::string>> show(sysfs::Object *object) override {
+		auto &self = cpuTopologies[static_cast<TopologyObject *>(object)->index];
+		co_return formatCpuList([&] (const CpuTopology &other) {
+			return relation_(self, other);
+		}) + "\n";
+	}
+
+private:
+	Relation relation_;
+};
+
+bool samePackage(const CpuTopology &a, const CpuTopology &b) {
+	return a.packageId == b.packageId;
+}
+
+bool sameCore(const CpuTopology &a, const CpuTopology &b) {
+	return a.packageId == b.packageId && a.coreId == b.coreId;
+}
+
+bool sameLlc(const CpuTopology &a, const CpuTopology &b) {
+	return a.packageId == b.packageId && a.llcId == b.llcId;
+}
+
+IdAttribute packageIdAttr{"physical_package_id", &CpuTopology::packageId};
+IdAttribute coreIdAttr{"core_id", &CpuTopology::coreId};
+SiblingsAttribute threadSiblingsAttr{"thread_siblings_list", &sameCore};
+SiblingsAttribute coreCpusAttr{"core_cpus_list", &sameCore};
+SiblingsAttribute coreSiblingsAttr{"core_siblings_list", &samePackage};
+SiblingsAttribute packageCpusAttr{"package_cpus_list", &samePackage};
+// Linux reports the CPUs that share the LLC as a cluster on some architectures.
+SiblingsAttribute clusterCpusAttr{"cluster_cpus_list", &sameLlc};
+
+async::result<void> fetchTopology() {
+	managarm::kerncfg::GetCpuTopologyRequest req;
+
+	auto [offer, sendReq, recvResp] = co_await helix_ng::exchangeMsgs(
+		getKerncfgLane(),
+		helix_ng::offer(
+			helix_ng::want_lane,
+			helix_ng::sendBragiHeadOnly(req, frg::stl_allocator{}),
+			helix_ng::recvInline()
+		)
+	);
+	HEL_CHECK(offer.error());
+	HEL_CHECK(sendReq.error());
+	HEL_CHECK(recvResp.error());
+
+	auto preamble = bragi::read_preamble(recvResp);
+	assert(!preamble.error());
+	std::vector<uint8_t> tail(preamble.tail_size());
+	auto [recvTail] = co_await helix_ng::exchangeMsgs(
+		offer.descriptor(),
+		helix_ng::recvBuffer(tail.data(), tail.size())
+	);
+	HEL_CHECK(recvTail.error());
+
+	auto resp = *bragi::parse_head_tail<managarm::kerncfg::GetCpuTopologyResponse>(
+			recvResp, tail);
+	assert(resp.error() == managarm::kerncfg::Error::SUCCESS);
+
+	for(auto &entry : resp.cpus())
+		cpuTopologies.push_back({
+			.packageId = entry.package_id(),
+			.coreId = entry.core_id(),
+			.threadId = entry.thread_id(),
+			.llcId = entry.llc_id(),
+			.numaNode = entry.numa_node(),
+		});
+}
+
+} // anonymous namespace
+
+async::detached run() {
+	co_await fetchTopology();
+
+	sysfsSubsystem = new drvcore::BusSubsystem{"cpu"};
+
+	auto systemDevice = std::make_shared<SystemDevice>(nullptr, "system");
+	drvcore::installDevice(systemDevice);
+	auto cpuRoot = std::make_shared<SystemDevice>(systemDevice, "cpu");
+	drvcore::installDevice(cpuRoot);
+	cpuRoot->realizeAttribute(&onlineAttr);
+	cpuRoot->realizeAttribute(&possibleAttr);
+	cpuRoot->realizeAttribute(&presentAttr);
+
+	for(size_t i = 0; i < cpuTopologies.size(); i++) {
+		auto device = std::make_shared<Device>(cpuRoot, i);
+		drvcore::installDevice(device);
+
+		auto topology = std::make_shared<TopologyObject>(device);
+		topology->addObject();
+		topology->realizeAttribute(&packageIdAttr);
+		topology->realizeAttribute(&coreIdAttr);
+		topology->realizeAttribute(&threadSiblingsAttr);
+		topology->realizeAttribute(&coreCpusAttr);
+		topology->realizeAttribute(&coreSiblingsAttr);
+		topology->realizeAttribute(&packageCpusAttr);
+		topology->realizeAttribute(&clusterCpusAttr);
+
+		device->topology = std::move(topology);
+	}
+}
+
+} // namespace cpu_subsystem
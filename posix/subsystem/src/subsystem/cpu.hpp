@@ -0,0 +1,10 @@
+#pragma once
+
+#include <async/result.hpp>
+
+namespace cpu_subsystem {
+
+// Populates /sys/devices/system/cpu. Must be called after the kerncfg lane is available.
+async::detached run();
+
+} // namespace cpu_subsystem
@@ -0,0 +1,431 @@
+#include <assert.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <core/cmdline.hpp>
+#include <frg/cmdline.hpp>
+
+#include "swap.hpp"
+
+namespace swap {
+
+namespace {
+
+constexpr size_t pageSize = 0x1000;
+
+// ----------------------------------------------------------------------------
+// LZ4 block format compression.
+// ----------------------------------------------------------------------------
+
+constexpr size_t minMatch = 4;
+// The LZ4 block format requires that the last 5 bytes are literals
+// and that the last match starts at least 12 bytes before the end of the block.
+constexpr size_t lastLiterals = 5;
+constexpr size_t matchLimit = 12;
+constexpr int hashBits = 12;
+
+uint32_t read32(const uint8_t *p) {
+	uint32_t v;
+	memcpy(&v, p, sizeof(uint32_t));
+	return v;
+}
+
+uint32_t hashSequence(uint32_t v) {
+	return (v * 2654435761u) >> (32 - hashBits);
+}
+
+// Returns the compressed size or zero if the output does not fit into dstCapacity.
+size_t compressBlock(const uint8_t *src, size_t srcSize, uint8_t *dst, size_t dstCapacity) {
+	uint16_t table[1 << hashBits]{};
+	uint8_t *op = dst;
+	uint8_t *oend = dst + dstCapacity;
+
+	auto emitLength = [&] (size_t length) {
+		while(length >= 255) {
+			*op++ = 255;
+			length -= 255;
+		}
+		*op++ = static_cast<uint8_t>(length);
+	};
+
+	// Upper bound on the size of a sequence (excluding the match length extension).
+	auto sequenceSize = [] (size_t litLength) {
+		return 1 + (litLength / 255 + 1) + litLength + 2;
+	};
+
+	size_t anchor = 0;
+	size_t ip = 0;
+	if(srcSize >= matchLimit) {
+		while(ip + matchLimit <= srcSize) {
+			auto sequence = read32(src + ip);
+			auto h = hashSequence(sequence);
+			// Positions are stored off by one such that zero denotes an empty entry.
+			size_t candidate = table[h];
+			table[h] = static_cast<uint16_t>(ip + 1);
+			if(!candidate || read32(src + candidate - 1) != sequence) {
+				ip++;
+				continue;
+			}
+			size_t ref = candidate - 1;
+
+			size_t matchLength = minMatch;
+			size_t maxLength = srcSize - lastLiterals - ip;
+			while(matchLength < maxLength && src[ip + matchLength] == src[ref + matchLength])
+				matchLength++;
+
+			size_t litLength = ip - anchor;
+			if(static_cast<size_t>(oend - op) < sequenceSize(litLength)
+					+ (matchLength - minMatch) / 255 + 1)
+				return 0;
+
+			auto token = op++;
+			*token = static_cast<uint8_t>(std::min(litLength, size_t{15}) << 4);
+			if(litLength >= 15)
+				emitLength(litLength - 15);
+			memcpy(op, src + anchor, litLength);
+			op += litLength;
+
+			size_t offset = ip - ref;
+			*op++ = static_cast<uint8_t>(offset);
+			*op++ = static_cast<uint8_t>(offset >> 8);
+
+			*token |= static_cast<uint8_t>(std::min(matchLength - minMatch, size_t{15}));
+			if(matchLength - minMatch >= 15)
+				emitLength(matchLength - minMatch - 15);
+
+			ip += matchLength;
+			anchor = ip;
+		}
+	}
+
+	size_t litLength = srcSize - anchor;
+	if(static_cast<size_t>(oend - op) < sequenceSize(litLength))
+		return 0;
+	auto token = op++;
+	*token = static_cast<uint8_t>(std::min(litLength, size_t{15}) << 4);
+	if(litLength >= 15)
+		emitLength(litLength - 15);
+	memcpy(op, src + anchor, litLength);
+	op += litLength;
+	return op - dst;
+}
+
+bool decompressBlock(const uint8_t *src, size_t srcSize, uint8_t *dst, size_t dstSize) {
+	size_t ip = 0;
+	size_t op = 0;
+
+	auto readLength = [&] (size_t &length) -> bool {
+		while(true) {
+			if(ip == srcSize)
+				return false;
+			auto b = src[ip++];
+			length += b;
+			if(b != 255)
+				return true;
+		}
+	};
+
+	while(true) {
+		if(ip == srcSize)
+			return false;
+		auto token = src[ip++];
+
+		size_t litLength = token >> 4;
+		if(litLength == 15 && !readLength(litLength))
+			return false;
+		if(litLength > srcSize - ip || litLength > dstSize - op)
+			return false;
+		memcpy(dst + op, src + ip, litLength);
+		ip += litLength;
+		op += litLength;
+
+		// The last sequence only consists of literals.
+		if(ip == srcSize)
+			return op == dstSize;
+
+		if(srcSize - ip < 2)
+			return false;
+		size_t offset = src[ip] | (size_t{src[ip + 1]} << 8);
+		ip += 2;
+		if(!offset || offset > op)
+			return false;
+
+		size_t matchLength = token & 15;
+		if(matchLength == 15 && !readLength(matchLength))
+			return false;
+		matchLength += minMatch;
+		if(matchLength > dstSize - op)
+			return false;
+		// Matches may overlap the output, hence we copy bytewise.
+		for(size_t i = 0; i < matchLength; i++)
+			dst[op + i] = dst[op - offset + i];
+		op += matchLength;
+	}
+}
+
+// ----------------------------------------------------------------------------
+// Page store.
+// ----------------------------------------------------------------------------
+
+enum class SlotState {
+	empty,
+	// The page consists of a single repeated word (e.g., zero pages).
+	sameFilled,
+	compressed,
+	// The page is incompressible and stored as-is.
+	raw
+};
+
+struct Slot {
+	SlotState state = SlotState::empty;
+	uint64_t fill = 0;
+	size_t size = 0;
+	std::unique_ptr<uint8_t[]> data;
+};
+
+struct Daemon {
+	helix::UniqueDescriptor backing;
+	helix::UniqueDescriptor swapSpace;
+
+	// Size of the swap budget in pages.
+	size_t budgetPages = 0;
+
+	// Maps swap offsets (in pages) to stored pages. Only accessed by the daemon thread.
+	// The kernel allocates an offset for each swappable page on first touch, hence
+	// offsets are not bounded by the budget and we only keep entries for pages
+	// that were actually written back. Entries are erased on discard requests.
+	std::unordered_map<size_t, Slot> slots;
+
+	std::atomic<size_t> usedPages{0};
+	std::atomic<size_t> sameFilledPages{0};
+	std::atomic<size_t> compressedBytes{0};
+	std::atomic<uint64_t> swapIns{0};
+	std::atomic<uint64_t> swapInNanos{0};
+	std::atomic<uint64_t> swapOuts{0};
+
+	void release(Slot &slot) {
+		if(slot.state == SlotState::empty)
+			return;
+		usedPages.fetch_sub(1, std::memory_order_relaxed);
+		if(slot.state == SlotState::sameFilled)
+			sameFilledPages.fetch_sub(1, std::memory_order_relaxed);
+		compressedBytes.fetch_sub(slot.size, std::memory_order_relaxed);
+		slot = Slot{};
+	}
+
+	void store(size_t index, const uint8_t *page) {
+		auto &slot = slots[index];
+		release(slot);
+
+		uint64_t fill;
+		memcpy(&fill, page, sizeof(uint64_t));
+		bool sameFilled = true;
+		for(size_t off = sizeof(uint64_t); off < pageSize; off += sizeof(uint64_t)) {
+			uint64_t word;
+			memcpy(&word, page + off, sizeof(uint64_t));
+			if(word != fill) {
+				sameFilled = false;
+				break;
+			}
+		}
+
+		if(sameFilled) {
+			slot.state = SlotState::sameFilled;
+			slot.fill = fill;
+			sameFilledPages.fetch_add(1, std::memory_order_relaxed);
+		}else{
+			uint8_t buffer[pageSize];
+			// Only keep the compressed page if it saves at least 1/8 of the page.
+			auto size = compressBlock(page, pageSize, buffer, pageSize - pageSize / 8);
+			if(size) {
+				slot.state = SlotState::compressed;
+				slot.size = size;
+				slot.data = std::make_unique<uint8_t[]>(size);
+				memcpy(slot.data.get(), buffer, size);
+			}else{
+				slot.state = SlotState::raw;
+				slot.size = pageSize;
+				slot.data = std::make_unique<uint8_t[]>(pageSize);
+				memcpy(slot.data.get(), page, pageSize);
+			}
+		}
+		usedPages.fetch_add(1, std::memory_order_relaxed);
+		compressedBytes.fetch_add(slot.size, std::memory_order_relaxed);
+	}
+
+	void discard(size_t index) {
+		auto it = slots.find(index);
+		if(it == slots.end())
+			return;
+		release(it->second);
+		slots.erase(it);
+	}
+
+	void load(size_t index, uint8_t *page) {
+		auto it = slots.find(index);
+		if(it == slots.end()) {
+			memset(page, 0, pageSize);
+			return;
+		}
+		auto &slot = it->second;
+		switch(slot.state) {
+		case SlotState::empty:
+			memset(page, 0, pageSize);
+			break;
+		case SlotState::sameFilled:
+			for(size_t off = 0; off < pageSize; off += sizeof(uint64_t))
+				memcpy(page + off, &slot.fill, sizeof(uint64_t));
+			break;
+		case SlotState::compressed: {
+			bool success = decompressBlock(slot.data.get(), slot.size, page, pageSize);
+			assert(success);
+			(void)success;
+			break;
+		}
+		case SlotState::raw:
+			memcpy(page, slot.data.get(), pageSize);
+			break;
+		}
+	}
+
+	async::result<void> serve() {
+		std::vector<uint8_t> buffer;
+		while(true) {
+			helix::ManageMemory manage;
+			auto &&submit = helix::submitManageMemory(backing, &manage,
+					helix::Dispatcher::global());
+			co_await submit.async_wait();
+			HEL_CHECK(manage.error());
+
+			assert(!(manage.offset() & (pageSize - 1)));
+			assert(!(manage.length() & (pageSize - 1)));
+			auto first = manage.offset() / pageSize;
+			auto numPages = manage.length() / pageSize;
+
+			if(manage.type() == kHelManageDiscard) {
+				for(size_t i = 0; i < numPages; i++)
+					discard(first + i);
+				HEL_CHECK(helUpdateMemory(backing.getHandle(), kHelManageDiscard,
+						manage.offset(), manage.length()));
+				continue;
+			}
+
+			buffer.resize(manage.length());
+			if(manage.type() == kHelManageInitialize) {
+				auto start = std::chrono::steady_clock::now();
+				for(size_t i = 0; i < numPages; i++)
+					load(first + i, buffer.data() + i * pageSize);
+
+				auto result = co_await helix_ng::writeMemory(backing, manage.offset(),
+						manage.length(), buffer.data());
+				HEL_CHECK(result.error());
+				HEL_CHECK(helUpdateMemory(backing.getHandle(), kHelManageInitialize,
+						manage.offset(), manage.length()));
+
+				auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+						std::chrono::steady_clock::now() - start);
+				swapIns.fetch_add(numPages, std::memory_order_relaxed);
+				swapInNanos.fetch_add(elapsed.count(), std::memory_order_relaxed);
+			}else{
+				assert(manage.type() == kHelManageWriteback);
+				auto result = co_await helix_ng::readMemory(backing, manage.offset(),
+						manage.length(), buffer.data());
+				HEL_CHECK(result.error());
+
+				for(size_t i = 0; i < numPages; i++)
+					store(first + i, buffer.data() + i * pageSize);
+
+				HEL_CHECK(helUpdateMemory(backing.getHandle(), kHelManageWriteback,
+						manage.offset(), manage.length()));
+				swapOuts.fetch_add(numPages, std::memory_order_relaxed);
+			}
+		}
+	}
+};
+
+Daemon *swapDaemon = nullptr;
+
+} // anonymous namespace
+
+async::result<void> initialize() {
+	Cmdline cmdHelper;
+	auto cmdline = co_await cmdHelper.get();
+	frg::string_view sizeString = "";
+	frg::array args = {
+		frg::option{"posix.swap", frg::as_string_view(sizeString)},
+	};
+	frg::parse_arguments(cmdline.c_str(), args);
+
+	if(sizeString.empty())
+		co_return;
+	size_t numMiB = 0;
+	auto end = sizeString.data() + sizeString.size();
+	auto [ptr, ec] = std::from_chars(sizeString.data(), end, numMiB);
+	if(ec != std::errc{} || ptr != end
+			|| numMiB > std::numeric_limits<size_t>::max() / (1024 * 1024)) {
+		std::cout << "posix: Ignoring invalid posix.swap="
+				<< std::string_view{sizeString.data(), sizeString.size()} << std::endl;
+		co_return;
+	}
+	if(!numMiB)
+		co_return;
+	size_t numPages = numMiB * (1024 * 1024 / pageSize);
+
+	HelHandle backingHandle, swapHandle;
+	HEL_CHECK(helCreateSwapSpace(0, &backingHandle, &swapHandle));
+
+	swapDaemon = new Daemon;
+	swapDaemon->backing = helix::UniqueDescriptor{backingHandle};
+	swapDaemon->swapSpace = helix::UniqueDescriptor{swapHandle};
+	swapDaemon->budgetPages = numPages;
+
+	// Even incompressible pages take at most one page of memory, hence the
+	// size of the memory pool is bounded by the budget.
+	HEL_CHECK(helSetSwapBudget(swapDaemon->swapSpace.getHandle(), numPages));
+
+	std::thread{[] {
+		async::run(swapDaemon->serve(), helix::currentDispatcher);
+	}}.detach();
+
+	std::cout << "posix: Using " << numMiB << " MiB of compressed swap" << std::endl;
+}
+
+bool isEnabled() {
+	return swapDaemon;
+}
+
+helix::UniqueDescriptor allocateAnonymousMemory(size_t size) {
+	HelHandle handle;
+	if(swapDaemon) {
+		HEL_CHECK(helAllocateSwappableMemory(swapDaemon->swapSpace.getHandle(),
+				size, 0, &handle));
+	}else{
+		HEL_CHECK(helAllocateMemory(size, 0, nullptr, &handle));
+	}
+	return helix::UniqueDescriptor{handle};
+}
+
+Statistics getStatistics() {
+	Statistics stats;
+	if(!swapDaemon)
+		return stats;
+	stats.totalPages = swapDaemon->budgetPages;
+	stats.usedPages = swapDaemon->usedPages.load(std::memory_order_relaxed);
+	stats.sameFilledPages = swapDaemon->sameFilledPages.load(std::memory_order_relaxed);
+	stats.compressedBytes = swapDaemon->compressedBytes.load(std::memory_order_relaxed);
+	stats.swapIns = swapDaemon->swapIns.load(std::memory_order_relaxed);
+	stats.swapInNanos = swapDaemon->swapInNanos.load(std::memory_order_relaxed);
+	stats.swapOuts = swapDaemon->swapOuts.load(std::memory_order_relaxed);
+	return stats;
+}
+
+} // namespace swap
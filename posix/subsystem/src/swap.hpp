@@ -0,0 +1,39 @@
+#pragma once
+
+#include <async/result.hpp>
+#include <helix/ipc.hpp>
+
+// Compressed in-memory swap (similar to Linux' zram).
+// Swapped-out pages are compressed and kept in a memory pool of the posix subsystem.
+// The manage requests of the swap space are serviced by a dedicated thread,
+// such that page faults on swapped-out pages (e.g., through tmpfs mappings
+// in the posix subsystem itself) do not deadlock.
+
+namespace swap {
+
+struct Statistics {
+	// Number of page slots (i.e., the swap budget).
+	size_t totalPages = 0;
+	// Number of slots that hold a swapped-out page.
+	size_t usedPages = 0;
+	// Number of stored pages that consist of a single repeated word.
+	size_t sameFilledPages = 0;
+	// Bytes used to store the compressed pages.
+	size_t compressedBytes = 0;
+	// Number of pages and total time spent servicing swap-in requests.
+	uint64_t swapIns = 0;
+	uint64_t swapInNanos = 0;
+	uint64_t swapOuts = 0;
+};
+
+// Sets up compressed swap if posix.swap=<size in MiB> is passed on the kernel command line.
+async::result<void> initialize();
+
+bool isEnabled();
+
+// Allocates anonymous memory. The memory is swappable if swap is enabled.
+helix::UniqueDescriptor allocateAnonymousMemory(size_t size);
+
+Statistics getStatistics();
+
+} // namespace swap
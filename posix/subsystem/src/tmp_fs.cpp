@@ -16,6 +16,7 @@
 #include "tmp_fs.hpp"
 #include "fifo.hpp"
 #include "process.hpp"
+#include "swap.hpp"
 #include <sys/stat.h>
 
 #include <bitset>
@@ -453,11 +454,12 @@ public:
 		helix::UniqueLane lane;
 		std::tie(lane, file->_passthrough) = helix::createStream();
 		async::detach(protocols::fs::servePassthrough(std::move(lane),
-				file, &fileOperations, file->_cancelServe));
+				file, &memoryFileOperations, file->_cancelServe));
 	}
 
 	MemoryFile(std::shared_ptr<MountView> mount, std::shared_ptr<FsLink> link, SemanticFlags flags)
-	: FileWithDefaults{FileKind::unknown,  StructName::get("tmpfs.regular"), std::move(mount), std::move(link)},
+	: FileWithDefaults{FileKind::unknown,  StructName::get("tmpfs.regular"), std::move(mount), std::move(link),
+			File::defaultHasContentMemory},
 	flags_{flags}, _offset{0} { }
 
 	void handleClose() override;
@@ -489,6 +491,21 @@ public:
 	}
 
 private:
+	// Reads are answered directly from the file's memory object.
+	static async::result<protocols::fs::ReadMemoryResult>
+	ptReadMemory(void *object, helix_ng::CredentialsView credentials, size_t length);
+
+	static async::result<protocols::fs::ReadMemoryResult>
+	ptPreadMemory(void *object, int64_t offset, helix_ng::CredentialsView credentials,
+			size_t length);
+
+	static constexpr auto memoryFileOperations = [] {
+		auto ops = fileOperations;
+		ops.readMemory = &ptReadMemory;
+		ops.preadMemory = &ptPreadMemory;
+		return ops;
+	}();
+
 	helix::UniqueLane _passthrough;
 	async::cancellation_event _cancelServe;
 	SemanticFlags flags_;
@@ -540,6 +557,12 @@ struct MemoryNode final : Node {
 	}
 
 private:
+	// The memory object is never shrunk (truncation only changes _fileSize),
+	// hence a range that is valid now stays valid while the node is alive.
+	bool _validMemoryRange(size_t offset, size_t length) {
+		return offset <= _areaSize && length <= _areaSize - offset;
+	}
+
 	async::result<void> _resizeFile(size_t new_size) {
 		_fileSize = new_size;
 
@@ -551,9 +574,7 @@ private:
 			auto result = co_await helix_ng::resizeMemory(_memory, aligned_size);
 			HEL_CHECK(result.error());
 		}else{
-			HelHandle handle;
-			HEL_CHECK(helAllocateMemory(aligned_size, 0, nullptr, &handle));
-			_memory = helix::UniqueDescriptor{handle};
+			_memory = swap::allocateAnonymousMemory(aligned_size);
 		}
 
 		_mapping = helix::Mapping{_memory, 0, aligned_size};
@@ -705,6 +726,44 @@ MemoryFile::readSome(Process *, void *buffer, size_t max_length, async::cancella
 	co_return chunk;
 }
 
+async::result<protocols::fs::ReadMemoryResult>
+MemoryFile::ptReadMemory(void *object, helix_ng::CredentialsView, size_t length) {
+	auto self = static_cast<MemoryFile *>(static_cast<File *>(object));
+	auto target = self->associatedLink()->getTarget();
+	auto node = static_cast<MemoryNode *>(target.get());
+
+	if(!(self->_offset <= node->_fileSize))
+		co_return std::unexpected{protocols::fs::Error::endOfFile};
+	auto chunk = std::min(node->_fileSize - self->_offset, length);
+	if(!node->_validMemoryRange(self->_offset, chunk))
+		co_return std::unexpected{protocols::fs::Error::internalError};
+
+	auto chunkOffset = self->_offset;
+	self->_offset += chunk;
+	node->notifyObservers(FsObserver::accessEvent, self->associatedLink()->getName(), 0);
+	co_return protocols::fs::ReadMemoryRange{node->_memory, chunkOffset, chunk,
+			std::move(target)};
+}
+
+async::result<protocols::fs::ReadMemoryResult>
+MemoryFile::ptPreadMemory(void *object, int64_t offset, helix_ng::CredentialsView,
+		size_t length) {
+	auto self = static_cast<MemoryFile *>(static_cast<File *>(object));
+	auto target = self->associatedLink()->getTarget();
+	auto node = static_cast<MemoryNode *>(target.get());
+
+	if(offset < 0)
+		co_return std::unexpected{protocols::fs::Error::illegalArguments};
+	if(static_cast<size_t>(offset) >= node->_fileSize)
+		co_return std::unexpected{protocols::fs::Error::endOfFile};
+	auto chunk = std::min(node->_fileSize - offset, length);
+	if(!node->_validMemoryRange(offset, chunk))
+		co_return std::unexpected{protocols::fs::Error::internalError};
+
+	co_return protocols::fs::ReadMemoryRange{node->_memory, static_cast<uintptr_t>(offset),
+			chunk, std::move(target)};
+}
+
 async::result<frg::expected<Error, size_t>>
 MemoryFile::writeAll(Process *, const void *buffer, size_t length) {
 	auto node = static_cast<MemoryNode *>(associatedLink()->getTarget().get());
@@ -8,16 +8,20 @@
 #include <sys/socket.h>
 #include <sys/un.h>
 #include <iostream>
+#include <limits.h>
 #include <print>
 
 #include <asm-generic/socket.h>
+#include <async/oneshot-event.hpp>
 #include <async/recurring-event.hpp>
 #include <core/clock.hpp>
 #include <core/dispatch.hpp>
 #include <bragi/helpers-std.hpp>
 #include <protocols/fs/common.hpp>
 #include <helix/ipc.hpp>
+#include <helix/memory.hpp>
 #include <helix/timer.hpp>
+#include <protocols/posix/data.hpp>
 #include "fs.bragi.hpp"
 #include "un-socket.hpp"
 #include "pidfd.hpp"
@@ -49,6 +53,10 @@ std::array<int, 3> supportedSocketTypes = {
 	SOCK_SEQPACKET,
 };
 
+// Writes to stream sockets are appended to the last packet of the receive queue
+// up to this size. This avoids an allocation per write.
+constexpr size_t maxCoalescedPacketSize = 65536;
+
 struct Packet {
 	// Sender process information.
 	int senderPid;
@@ -58,6 +66,7 @@ struct Packet {
 	struct timeval recvTimestamp;
 
 	// The actual octet data that the packet consists of.
+	// For stream sockets, this may contain the data of multiple writes.
 	std::vector<char> buffer;
 
 	std::vector<smarter::shared_ptr<File, FileHandle>> files;
@@ -65,6 +74,129 @@ struct Packet {
 	size_t offset = 0;
 };
 
+// Shared memory of a stream connection in ring mode (see posix::SocketRing).
+// Both sockets of the connection reference the same object.
+struct StreamRings {
+	// Ancillary data that was sent through the posix server.
+	struct Control {
+		// Position of the byte that the data is attached to.
+		unsigned int position;
+		std::vector<smarter::shared_ptr<File, FileHandle>> files;
+	};
+
+	static constexpr size_t memorySize = 2 * posix::socketRingSize;
+
+	StreamRings() {
+		HelHandle handle;
+		HEL_CHECK(helAllocateMemory(memorySize, 0, nullptr, &handle));
+		memory = helix::UniqueDescriptor{handle};
+		mapping = helix::Mapping{memory, 0, memorySize};
+		for(int i = 0; i < 2; i++)
+			new (ring(i)) posix::SocketRing{};
+	}
+
+	posix::SocketRing *ring(int index) {
+		return posix::socketRing(mapping.get(), index);
+	}
+
+	// Publishes the position up to which readers of a ring can consume data by themselves.
+	// If queued is set, data from before ring mode needs to be received first.
+	void publishControl(int index, bool queued) {
+		auto r = ring(index);
+		if(queued || !controls[index].empty()) {
+			auto position = queued ? __atomic_load_n(&r->tail, __ATOMIC_RELAXED)
+					: controls[index].front().position;
+			__atomic_store_n(&r->controlPosition, position, __ATOMIC_RELAXED);
+			__atomic_store_n(&r->hasControl, 1, __ATOMIC_RELEASE);
+		}else{
+			__atomic_store_n(&r->hasControl, 0, __ATOMIC_RELEASE);
+		}
+	}
+
+	// Sets one of the flags of a ring (e.g., a shutdown flag) and wakes all readers and writers.
+	void raiseFlag(int index, unsigned int posix::SocketRing::*flag) {
+		auto r = ring(index);
+		__atomic_store_n(&(r->*flag), 1, __ATOMIC_SEQ_CST);
+		__atomic_fetch_add(&r->dataSeq, 1, __ATOMIC_SEQ_CST);
+		__atomic_fetch_add(&r->spaceSeq, 1, __ATOMIC_SEQ_CST);
+		HEL_CHECK(helFutexWake(reinterpret_cast<int *>(&r->dataSeq), UINT_MAX));
+		HEL_CHECK(helFutexWake(reinterpret_cast<int *>(&r->spaceSeq), UINT_MAX));
+	}
+
+	helix::UniqueDescriptor memory;
+	helix::Mapping mapping;
+	std::deque<Control> controls[2];
+	// Credentials that are attached to the data of each ring once the connection leaves
+	// ring mode. Since peers write to the ring directly, these are the credentials of the
+	// process that most recently set up the ring or sent data through the posix server.
+	struct ucred creds[2] = {};
+	// Set once the connection starts to leave ring mode (see OpenFile::_leaveRings()).
+	// Peers can change the abandoned flags in the rings; the server only trusts this one.
+	bool leaving = false;
+	// Raised once the remaining data of the rings was moved to the receive queues.
+	async::oneshot_event left;
+};
+
+// Acquires one of the futex-based mutexes of a posix::SocketRing. Fails with Error::interrupted
+// if the cancellation token is triggered and with Error::ioError if a peer corrupted the mutex.
+static async::result<std::expected<void, Error>>
+lockRing(unsigned int *word, async::cancellation_token ct) {
+	unsigned int expected = 0;
+	if(__atomic_compare_exchange_n(word, &expected, 1, false,
+			__ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+		co_return {};
+	while(true) {
+		auto previous = __atomic_exchange_n(word, 2, __ATOMIC_ACQUIRE);
+		if(!previous)
+			co_return {};
+		if(previous > 2)
+			co_return std::unexpected{Error::ioError};
+		auto result = co_await helix_ng::futexWait(reinterpret_cast<int *>(word), 2, -1, ct);
+		if(result.error() == kHelErrCancelled)
+			co_return std::unexpected{Error::interrupted};
+		HEL_CHECK(result.error());
+	}
+}
+
+static void unlockRing(unsigned int *word) {
+	if(__atomic_exchange_n(word, 0, __ATOMIC_RELEASE) == 2)
+		HEL_CHECK(helFutexWake(reinterpret_cast<int *>(word), 1));
+}
+
+// Increments seq and wakes waiters that announced themselves in waiting.
+static void signalRing(unsigned int *seq, unsigned int *waiting) {
+	__atomic_fetch_add(seq, 1, __ATOMIC_SEQ_CST);
+	if(__atomic_exchange_n(waiting, 0, __ATOMIC_SEQ_CST))
+		HEL_CHECK(helFutexWake(reinterpret_cast<int *>(seq), UINT_MAX));
+}
+
+// Waits until seq differs from current, which must be read before checking the ring.
+// Returns false if the cancellation token was triggered.
+static async::result<bool> waitRing(unsigned int *seq, unsigned int *waiting, unsigned int current,
+		async::cancellation_token ct) {
+	__atomic_store_n(waiting, 1, __ATOMIC_SEQ_CST);
+	auto result = co_await helix_ng::futexWait(reinterpret_cast<int *>(seq),
+			static_cast<int>(current), -1, ct);
+	if(result.error() == kHelErrCancelled)
+		co_return false;
+	HEL_CHECK(result.error());
+	co_return true;
+}
+
+static void copyToRing(unsigned char *ring, unsigned int position, const void *data, size_t length) {
+	auto offset = position % posix::socketRingCapacity;
+	auto chunk = std::min(length, posix::socketRingCapacity - offset);
+	memcpy(ring + offset, data, chunk);
+	memcpy(ring, static_cast<const char *>(data) + chunk, length - chunk);
+}
+
+static void copyFromRing(void *data, unsigned char *ring, unsigned int position, size_t length) {
+	auto offset = position % posix::socketRingCapacity;
+	auto chunk = std::min(length, posix::socketRingCapacity - offset);
+	memcpy(data, ring + offset, chunk);
+	memcpy(static_cast<char *>(data) + chunk, ring, length - chunk);
+}
+
 struct OpenFile : FileWithDefaults {
 	enum class State {
 		null,
@@ -140,6 +272,14 @@ public:
 			abstractSocketsBindMap.erase(_sockpath);
 		}
 
+		if(_rings) {
+			// The remote reads EOF once it drained the ring and fails to write with EPIPE.
+			_rings->raiseFlag(_ringIndex, &posix::SocketRing::writerShutdown);
+			_rings->raiseFlag(1 - _ringIndex, &posix::SocketRing::readerShutdown);
+			_rings->controls[1 - _ringIndex].clear();
+		}
+		_cancelRingOps.cancel();
+
 		if(_currentState == State::connected) {
 			auto rf = _remote;
 			if(logSockets)
@@ -160,6 +300,16 @@ public:
 public:
 	async::result<std::expected<size_t, Error>>
 	readSome(Process *, void *data, size_t max_length, async::cancellation_token ct) override {
+		if(_rings && _recvQueue.empty()) {
+			auto result = co_await _recvRing(data, max_length, false, nonBlock_, nullptr, ct);
+			if(result) {
+				if(*result && !result->value())
+					co_return std::unexpected{Error::eof};
+				co_return *result;
+			}
+			// The connection left ring mode; the data is in the receive queue now.
+		}
+
 		if(socktype_ == SOCK_STREAM && _recvQueue.empty() && (_currentState == State::remoteShutDown || _remote->shutdownFlags_ & shutdownWrite))
 			co_return std::unexpected{Error::eof};
 		if(socktype_ == SOCK_STREAM && _currentState != State::connected && _currentState != State::remoteShutDown)
@@ -208,12 +358,10 @@ public:
 
 		auto packet = &_recvQueue.front();
 		if(socktype_ == SOCK_STREAM) {
-			auto chunk = std::min(packet->buffer.size() - packet->offset, max_length);
-			memcpy(data, packet->buffer.data() + packet->offset, chunk);
-			packet->offset += chunk;
-			if(packet->offset == packet->buffer.size())
-				_recvQueue.pop_front();
-			co_return chunk;
+			auto length = _readStream(data, max_length, false);
+			if(_rings)
+				_rings->publishControl(1 - _ringIndex, !_recvQueue.empty());
+			co_return length;
 		} else {
 			assert(!packet->offset);
 			auto size = packet->buffer.size();
@@ -238,17 +386,34 @@ public:
 		if(logSockets)
 			std::cout << "posix: Write to socket \e[1;34m" << structName() << "\e[0m" << std::endl;
 
-		Packet packet;
-		packet.senderPid = process->pid();
-		packet.buffer.resize(length);
-		memcpy(packet.buffer.data(), data, length);
-		packet.offset = 0;
-		auto now = clk::getRealtime();
-		TIMESPEC_TO_TIMEVAL(&packet.recvTimestamp, &now);
+		size_t progress = 0;
+		if(_rings) {
+			// WriteRequest has no cancellation ID; only closing the socket interrupts the write.
+			std::vector<smarter::shared_ptr<File, FileHandle>> files;
+			auto result = co_await _sendRing(process, data, length, files, nonBlock_,
+					progress, _cancelRingOps);
+			if(result) {
+				if(!*result) {
+					if(result->error() == Error::brokenPipe)
+						process->issueThreadSignal(SIGPIPE, {});
+					co_return result->error();
+				}
+				co_return result->value();
+			}
 
-		_remote->_recvQueue.push_back(std::move(packet));
-		_remote->_inSeq = ++_remote->_currentSeq;
-		_remote->_statusBell.raise();
+			// The connection left ring mode; queue the remaining data.
+			if(_currentState != State::connected) {
+				if(progress)
+					co_return progress;
+				co_return Error::notConnected;
+			}
+		}
+
+		struct ucred creds{};
+		creds.pid = process->pid();
+		creds.uid = process->threadGroup()->uid();
+		creds.gid = process->threadGroup()->gid();
+		_remote->_receive(static_cast<const char *>(data) + progress, length - progress, creds, {});
 		co_return length;
 	}
 
@@ -262,6 +427,15 @@ public:
 		if(socktype_ == SOCK_STREAM && _currentState != State::connected && _currentState != State::remoteShutDown)
 			co_return protocols::fs::Error::notConnected;
 
+		if(_rings && _recvQueue.empty()) {
+			// RecvMsgRequest has no cancellation ID; only closing the socket interrupts the read.
+			auto result = co_await _recvMsgRing(process, flags, data, max_length, max_ctrl_length,
+					_cancelRingOps);
+			if(result)
+				co_return std::move(*result);
+			// The connection left ring mode; the data is in the receive queue now.
+		}
+
 		if(socktype_ == SOCK_STREAM && _recvQueue.empty() && _currentState == State::remoteShutDown)
 			co_return protocols::fs::RecvData{{}, 0, 0, 0};
 
@@ -339,17 +513,14 @@ public:
 		// datagram packets are always read from their beginning, so offsets are illegal
 		assert(!packet->offset || socktype_ == SOCK_STREAM);
 		auto data_length = packet->buffer.size() - packet->offset;
-		auto chunk = std::min(packet->buffer.size() - packet->offset, max_length);
-		memcpy(data, packet->buffer.data() + packet->offset, chunk);
 
 		if(socktype_ == SOCK_STREAM) {
-			returned_length = chunk;
-			if(!(flags & MSG_PEEK)) {
-				packet->offset += chunk;
-				if(packet->offset == packet->buffer.size())
-					_recvQueue.pop_front();
-			}
+			returned_length = _readStream(data, max_length, flags & MSG_PEEK);
+			if(_rings)
+				_rings->publishControl(1 - _ringIndex, !_recvQueue.empty());
 		} else {
+			auto chunk = std::min(data_length, max_length);
+			memcpy(data, packet->buffer.data(), chunk);
 			returned_length = (flags & MSG_TRUNC) ? data_length : chunk;
 			if(!(flags & MSG_PEEK))
 				_recvQueue.pop_front();
@@ -434,26 +605,36 @@ public:
 		if(logSockets)
 			std::cout << "posix: Send to socket \e[1;34m" << structName() << "\e[0m" << std::endl;
 
+		size_t progress = 0;
+		if(_rings) {
+			// SendMsgRequest has no cancellation ID; only closing the socket interrupts the send.
+			auto result = co_await _sendRing(process, data, max_length, files,
+					(flags & MSG_DONTWAIT) || nonBlock_, progress, _cancelRingOps);
+			if(result) {
+				if(!*result) {
+					if(result->error() == Error::brokenPipe && !(flags & MSG_NOSIGNAL))
+						process->issueThreadSignal(SIGPIPE, {});
+					co_return result->error() | protocols::fs::toFsProtoError;
+				}
+				co_return result->value();
+			}
+
+			// The connection left ring mode; queue the remaining data.
+			if(_currentState != State::connected) {
+				if(progress)
+					co_return progress;
+				co_return protocols::fs::Error::brokenPipe;
+			}
+			remote = _remote;
+		}
+
 		protocols::fs::utils::handleSoPasscred(remote->_passCreds, ucreds, process->pid(), process->threadGroup()->uid(), process->threadGroup()->gid());
 
 		// We ignore MSG_DONTWAIT here as we never block anyway.
 
 		// TODO: Add permission checking for ucred related items
-		Packet packet;
-		packet.senderPid = ucreds.pid;
-		packet.senderUid = ucreds.uid;
-		packet.senderGid = ucreds.gid;
-		packet.buffer.resize(max_length);
-		memcpy(packet.buffer.data(), data, max_length);
-		packet.files = std::move(files);
-		packet.offset = 0;
-		auto now = clk::getRealtime();
-		TIMESPEC_TO_TIMEVAL(&packet.recvTimestamp, &now);
-
-		remote->_recvQueue.push_back(std::move(packet));
-		remote->_inSeq = ++remote->_currentSeq;
-		remote->_statusBell.raise();
-
+		remote->_receive(static_cast<const char *>(data) + progress, max_length - progress,
+				ucreds, std::move(files));
 		co_return max_length;
 	}
 
@@ -504,8 +685,22 @@ public:
 			if (_currentState == State::closed)
 				co_return Error::fileClosed;
 
-			// For now making sockets always writable is sufficient.
-			edges = EPOLLOUT;
+			// In ring mode, peers change the rings without notifying _statusBell.
+			// Sample the sequences before checking the rings (see posix::SocketRing).
+			// Keep the rings alive while waiting, even if the connection leaves ring mode.
+			auto rings = _rings;
+			unsigned int dataSeq = 0;
+			unsigned int spaceSeq = 0;
+			if(rings) {
+				dataSeq = __atomic_load_n(&rings->ring(1 - _ringIndex)->dataSeq, __ATOMIC_SEQ_CST);
+				spaceSeq = __atomic_load_n(&rings->ring(_ringIndex)->spaceSeq, __ATOMIC_SEQ_CST);
+				_observeRing();
+			}
+
+			// Outside of ring mode, making sockets always writable is sufficient.
+			edges = 0;
+			if(!_rings || _ringWritable())
+				edges |= EPOLLOUT;
 			if (socktype_ == SOCK_STREAM || socktype_ == SOCK_SEQPACKET) {
 				if (_hupSeq > past_seq)
 					edges |= EPOLLHUP | EPOLLIN;
@@ -520,6 +715,34 @@ public:
 			if (edges & mask)
 				break;
 
+			if(rings) {
+				auto incoming = rings->ring(1 - _ringIndex);
+				auto outgoing = rings->ring(_ringIndex);
+				co_await async::race_and_cancel(
+					async::lambda([&](async::cancellation_token c) -> async::result<void> {
+						co_await _statusBell.async_wait(c);
+					}),
+					async::lambda([&](async::cancellation_token c) -> async::result<void> {
+						if(mask & EPOLLIN)
+							co_await waitRing(&incoming->dataSeq, &incoming->dataWaiting, dataSeq, c);
+						else
+							co_await async::suspend_indefinitely(c);
+					}),
+					async::lambda([&](async::cancellation_token c) -> async::result<void> {
+						if(mask & EPOLLOUT)
+							co_await waitRing(&outgoing->spaceSeq, &outgoing->spaceWaiting, spaceSeq, c);
+						else
+							co_await async::suspend_indefinitely(c);
+					}),
+					async::lambda([&](async::cancellation_token c) -> async::result<void> {
+						co_await async::suspend_indefinitely(c, cancellation);
+					})
+				);
+				if(cancellation.is_cancellation_requested())
+					break;
+				continue;
+			}
+
 			if (!co_await _statusBell.async_wait(cancellation))
 				break;
 		}
@@ -532,12 +755,17 @@ public:
 
 	async::result<frg::expected<Error, PollStatusResult>>
 	pollStatus(Process *) override {
-		int events = EPOLLOUT;
+		if(_rings)
+			_observeRing();
+
+		int events = 0;
+		if(!_rings || _ringWritable())
+			events |= EPOLLOUT;
 		if(socktype_ == SOCK_STREAM || socktype_ == SOCK_SEQPACKET) {
 			if(_currentState == State::remoteShutDown)
 				events |= EPOLLHUP | EPOLLIN;
 		}
-		if(!_acceptQueue.empty() || !_recvQueue.empty())
+		if(!_acceptQueue.empty() || !_recvQueue.empty() || (_rings && _ringReadable()))
 			events |= EPOLLIN;
 		if(shutdownFlags_ & shutdownRead)
 			events |= EPOLLRDHUP;
@@ -727,6 +955,8 @@ public:
 			co_return protocols::fs::Error::illegalArguments;
 		}
 
+		if(_rings)
+			_shutdownRings();
 		_statusBell.raise();
 
 		co_return protocols::fs::Error::none;
@@ -736,6 +966,37 @@ public:
 		return _passthrough;
 	}
 
+	// Switches the connection to ring mode (if not done already). Returns the memory object
+	// that holds the rings and the index of the ring that this socket sends on.
+	std::expected<std::pair<helix::BorrowedDescriptor, int>, Error> setupRing(Process *process) {
+		if(socktype_ != SOCK_STREAM || _currentState != State::connected)
+			return std::unexpected{Error::illegalArguments};
+		// SCM_CREDENTIALS needs the sender of each byte, which peers do not report
+		// when they write to the ring directly.
+		if(_passCreds || _remote->_passCreds)
+			return std::unexpected{Error::illegalArguments};
+		if(_rings && _rings->leaving)
+			return std::unexpected{Error::illegalArguments};
+
+		if(!_rings) {
+			auto rings = std::make_shared<StreamRings>();
+			_rings = rings;
+			_ringIndex = 0;
+			_remote->_rings = rings;
+			_remote->_ringIndex = 1;
+
+			// Data that was sent before stays in the receive queues.
+			// Readers need to receive it through the posix server first.
+			_rings->publishControl(1, !_recvQueue.empty());
+			_rings->publishControl(0, !_remote->_recvQueue.empty());
+			_shutdownRings();
+			_remote->_shutdownRings();
+		}
+
+		_rings->creds[_ringIndex] = _credsOf(process);
+		return std::pair{helix::BorrowedDescriptor{_rings->memory}, _ringIndex};
+	}
+
 	async::result<void> setFileFlags(int flags) override {
 		if(flags & ~(O_NONBLOCK | O_RDONLY | O_WRONLY | O_RDWR)) {
 			std::cout << std::format("posix: setFileFlags on socket \e[1;34m{}\e[0m called with unknown flags {:x}\n",
@@ -818,6 +1079,10 @@ public:
 		if(layer == SOL_SOCKET && number == SO_PASSCRED) {
 			if(optbuf.size() >= sizeof(int))
 				_passCreds = *reinterpret_cast<int *>(optbuf.data());
+			// See setupRing(); the remaining data of the rings is queued with the
+			// credentials of the process that most recently wrote to them.
+			if(_passCreds && _rings)
+				co_await _leaveRings();
 		} else if(layer == SOL_SOCKET && number == SO_TIMESTAMP) {
 			if(optbuf.size() != sizeof(int))
 				co_return protocols::fs::Error::illegalArguments;
@@ -861,8 +1126,15 @@ public:
 
 					if(self->_currentState != State::connected) {
 						resp.set_error(managarm::fs::Errors::NOT_CONNECTED);
-					} else if(self->_recvQueue.empty()) {
+					} else if(self->_recvQueue.empty() && !self->_rings) {
 						resp.set_fionread_count(0);
+					} else if(self->socktype_ == SOCK_STREAM) {
+						size_t count = 0;
+						for(auto &packet : self->_recvQueue)
+							count += packet.buffer.size() - packet.offset;
+						if(self->_rings)
+							count += self->_ringAvailable();
+						resp.set_fionread_count(count);
 					} else {
 						auto packet = &self->_recvQueue.front();
 						resp.set_fionread_count(packet->buffer.size() - packet->offset);
@@ -951,6 +1223,457 @@ public:
 private:
 	helix::UniqueLane _passthrough;
 	async::cancellation_event _cancelServe;
+	// Cancels operations on the rings whose requests cannot be cancelled otherwise.
+	async::cancellation_event _cancelRingOps;
+
+	// Appends data to the receive queue of this socket and wakes up readers.
+	void _receive(const void *data, size_t length, const struct ucred &creds,
+			std::vector<smarter::shared_ptr<File, FileHandle>> files) {
+		auto sameSender = [&] (const Packet &packet) {
+			return packet.senderPid == creds.pid
+				&& packet.senderUid == creds.uid
+				&& packet.senderGid == creds.gid;
+		};
+
+		// Stream sockets do not preserve message boundaries, hence we can append to the
+		// last packet unless file descriptors or credentials need to be attached to the data.
+		if(socktype_ == SOCK_STREAM && files.empty() && !_recvQueue.empty()) {
+			auto &last = _recvQueue.back();
+			if(last.files.empty() && sameSender(last)
+					&& last.buffer.size() + length <= maxCoalescedPacketSize) {
+				auto p = static_cast<const char *>(data);
+				last.buffer.insert(last.buffer.end(), p, p + length);
+				_inSeq = ++_currentSeq;
+				_statusBell.raise();
+				return;
+			}
+		}
+
+		Packet packet;
+		packet.senderPid = creds.pid;
+		packet.senderUid = creds.uid;
+		packet.senderGid = creds.gid;
+		packet.buffer.resize(length);
+		memcpy(packet.buffer.data(), data, length);
+		packet.files = std::move(files);
+		packet.offset = 0;
+		auto now = clk::getRealtime();
+		TIMESPEC_TO_TIMEVAL(&packet.recvTimestamp, &now);
+
+		_recvQueue.push_back(std::move(packet));
+		_inSeq = ++_currentSeq;
+		_statusBell.raise();
+	}
+
+	static struct ucred _credsOf(Process *process) {
+		struct ucred creds{};
+		creds.pid = process->pid();
+		creds.uid = process->threadGroup()->uid();
+		creds.gid = process->threadGroup()->gid();
+		return creds;
+	}
+
+	// Propagates shutdownFlags_ to the rings.
+	void _shutdownRings() {
+		if(shutdownFlags_ & shutdownWrite)
+			_rings->raiseFlag(_ringIndex, &posix::SocketRing::writerShutdown);
+		if(shutdownFlags_ & shutdownRead)
+			_rings->raiseFlag(1 - _ringIndex, &posix::SocketRing::readerShutdown);
+	}
+
+	// Reflects data that peers wrote to the receiving ring in _inSeq.
+	void _observeRing() {
+		auto head = __atomic_load_n(&_rings->ring(1 - _ringIndex)->head, __ATOMIC_ACQUIRE);
+		if(head != _seenRingHead) {
+			_seenRingHead = head;
+			_inSeq = ++_currentSeq;
+		}
+	}
+
+	// Returns the number of bytes in the receiving ring.
+	size_t _ringAvailable() {
+		auto ring = _rings->ring(1 - _ringIndex);
+		size_t available = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE)
+				- __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+		// Peers can write to the whole ring; ignore its contents if they are inconsistent.
+		if(available > posix::socketRingCapacity)
+			return 0;
+		return available;
+	}
+
+	bool _ringReadable() {
+		auto ring = _rings->ring(1 - _ringIndex);
+		return _ringAvailable() || __atomic_load_n(&ring->writerShutdown, __ATOMIC_ACQUIRE);
+	}
+
+	bool _ringWritable() {
+		auto ring = _rings->ring(_ringIndex);
+		size_t used = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE)
+				- __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+		return used < posix::socketRingCapacity
+				|| __atomic_load_n(&ring->readerShutdown, __ATOMIC_ACQUIRE);
+	}
+
+	// Result of the ring operations below; std::nullopt if the connection left ring mode
+	// in the meantime (see _leaveRings()). Callers then continue with the receive queues.
+	using RingResult = std::optional<std::expected<size_t, Error>>;
+
+	// Writes data to the sending ring. Files are attached to the first byte.
+	// Unless nonBlock is set, this waits until all data is written, the remote shuts down reading
+	// or the send timeout expires. progress counts the bytes that were written; if the connection
+	// leaves ring mode, the caller sends the rest (and files, unless they were attached).
+	async::result<RingResult>
+	_sendRing(Process *process, const void *data, size_t length,
+			std::vector<smarter::shared_ptr<File, FileHandle>> &files, bool nonBlock,
+			size_t &progress, async::cancellation_token ct) {
+		auto rings = _rings;
+		auto ring = rings->ring(_ringIndex);
+		auto buffer = posix::socketRingData(ring);
+		rings->creds[_ringIndex] = _credsOf(process);
+
+		// Like Linux, do not pass ancillary data without payload on stream sockets.
+		if(!length)
+			co_return size_t{0};
+
+		if(auto locked = co_await lockRing(&ring->writeLock, ct); !locked)
+			co_return std::unexpected{locked.error()};
+
+		std::expected<size_t, Error> result{size_t{0}};
+		bool left = false;
+		while(progress < length) {
+			if(rings->leaving) {
+				left = true;
+				break;
+			}
+
+			auto seq = __atomic_load_n(&ring->spaceSeq, __ATOMIC_SEQ_CST);
+			if(__atomic_load_n(&ring->readerShutdown, __ATOMIC_ACQUIRE)
+					|| __atomic_load_n(&ring->writerShutdown, __ATOMIC_ACQUIRE)) {
+				result = std::unexpected{Error::brokenPipe};
+				break;
+			}
+
+			auto head = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+			auto tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+			size_t used = head - tail;
+			if(used > posix::socketRingCapacity) {
+				result = std::unexpected{Error::ioError};
+				break;
+			}
+			if(used == posix::socketRingCapacity) {
+				if(nonBlock) {
+					result = std::unexpected{Error::wouldBlock};
+					break;
+				}
+
+				bool woken = false;
+				co_await async::race_and_cancel(
+					[&](async::cancellation_token c) { return raceSendTimeout(c); },
+					async::lambda([&](async::cancellation_token c) -> async::result<void> {
+						woken = co_await waitRing(&ring->spaceSeq, &ring->spaceWaiting, seq, c);
+					}),
+					async::lambda([&](async::cancellation_token c) -> async::result<void> {
+						co_await async::suspend_indefinitely(c, ct);
+					})
+				);
+				if(!woken) {
+					result = std::unexpected{ct.is_cancellation_requested()
+							? Error::interrupted : Error::wouldBlock};
+					break;
+				}
+				continue;
+			}
+
+			if(!files.empty()) {
+				rings->controls[_ringIndex].push_back({head, std::move(files)});
+				files.clear();
+				rings->publishControl(_ringIndex, _remote && !_remote->_recvQueue.empty());
+			}
+
+			auto chunk = std::min(posix::socketRingCapacity - used, length - progress);
+			copyToRing(buffer, head, static_cast<const char *>(data) + progress, chunk);
+			__atomic_store_n(&ring->head, head + chunk, __ATOMIC_RELEASE);
+			signalRing(&ring->dataSeq, &ring->dataWaiting);
+			progress += chunk;
+		}
+
+		unlockRing(&ring->writeLock);
+		if(left) {
+			co_await rings->left.wait();
+			co_return std::nullopt;
+		}
+		if(progress)
+			co_return progress;
+		co_return result;
+	}
+
+	// Reads data from the receiving ring. Reads stop before bytes that carry ancillary data;
+	// if the first byte carries ancillary data, its files are returned in files (if given).
+	async::result<RingResult>
+	_recvRing(void *data, size_t maxLength, bool peek, bool nonBlock,
+			std::vector<smarter::shared_ptr<File, FileHandle>> *files,
+			async::cancellation_token ct) {
+		auto rings = _rings;
+		auto index = 1 - _ringIndex;
+		auto ring = rings->ring(index);
+		auto &controls = rings->controls[index];
+
+		if(auto locked = co_await lockRing(&ring->readLock, ct); !locked)
+			co_return std::unexpected{locked.error()};
+
+		std::expected<size_t, Error> result{size_t{0}};
+		size_t length = 0;
+		unsigned int tail;
+		bool attached = false;
+		bool left = false;
+		while(true) {
+			if(rings->leaving) {
+				left = true;
+				break;
+			}
+
+			auto seq = __atomic_load_n(&ring->dataSeq, __ATOMIC_SEQ_CST);
+			auto head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+			tail = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+			size_t available = head - tail;
+			if(available > posix::socketRingCapacity) {
+				result = std::unexpected{Error::ioError};
+				break;
+			}
+
+			// Drop ancillary data of bytes that peers consumed without the posix server.
+			while(!controls.empty() && controls.front().position - tail > available) {
+				controls.pop_front();
+				rings->publishControl(index, false);
+			}
+			if(!controls.empty()) {
+				size_t distance = controls.front().position - tail;
+				if(!distance) {
+					attached = true;
+					distance = controls.size() > 1 ? controls[1].position - tail : available;
+				}
+				available = std::min(available, distance);
+			}
+
+			if(available) {
+				length = std::min(available, maxLength);
+				break;
+			}
+			if(__atomic_load_n(&ring->writerShutdown, __ATOMIC_ACQUIRE)
+					|| __atomic_load_n(&ring->readerShutdown, __ATOMIC_ACQUIRE))
+				break;
+			if(nonBlock) {
+				result = std::unexpected{Error::wouldBlock};
+				break;
+			}
+
+			bool woken = false;
+			co_await async::race_and_cancel(
+				[&](async::cancellation_token c) { return raceReceiveTimeout(c); },
+				async::lambda([&](async::cancellation_token c) -> async::result<void> {
+					woken = co_await waitRing(&ring->dataSeq, &ring->dataWaiting, seq, c);
+				}),
+				async::lambda([&](async::cancellation_token c) -> async::result<void> {
+					co_await async::suspend_indefinitely(c, ct);
+				})
+			);
+			if(!woken) {
+				result = std::unexpected{ct.is_cancellation_requested()
+						? Error::interrupted : Error::wouldBlock};
+				break;
+			}
+		}
+
+		if(length) {
+			copyFromRing(data, posix::socketRingData(ring), tail, length);
+			if(attached && files) {
+				if(peek)
+					*files = controls.front().files;
+				else
+					*files = std::move(controls.front().files);
+			}
+			if(!peek) {
+				if(attached) {
+					controls.pop_front();
+					rings->publishControl(index, false);
+				}
+				__atomic_store_n(&ring->tail, tail + static_cast<unsigned int>(length),
+						__ATOMIC_RELEASE);
+				signalRing(&ring->spaceSeq, &ring->spaceWaiting);
+			}
+			result = length;
+		}
+
+		unlockRing(&ring->readLock);
+		if(left) {
+			co_await rings->left.wait();
+			co_return std::nullopt;
+		}
+		co_return result;
+	}
+
+	async::result<std::optional<protocols::fs::RecvResult>>
+	_recvMsgRing(Process *process, uint32_t flags, void *data, size_t maxLength,
+			size_t maxCtrlLength, async::cancellation_token ct) {
+		std::vector<smarter::shared_ptr<File, FileHandle>> files;
+		auto result = co_await _recvRing(data, maxLength, flags & MSG_PEEK,
+				(flags & MSG_DONTWAIT) || nonBlock_, &files, ct);
+		if(!result)
+			co_return std::nullopt;
+		if(!*result)
+			co_return result->error() | protocols::fs::toFsProtoError;
+
+		// SO_PASSCRED makes the connection leave ring mode, hence there are no credentials here.
+		uint32_t replyFlags = 0;
+		protocols::fs::CtrlBuilder ctrl{maxCtrlLength};
+
+		// Data in the ring carries no timestamp; report the time of the receive instead.
+		if(timestamp_) {
+			struct timeval timestamp;
+			auto now = clk::getRealtime();
+			TIMESPEC_TO_TIMEVAL(&timestamp, &now);
+			auto truncated = ctrl.message(SOL_SOCKET, SCM_TIMESTAMP, sizeof(struct timeval));
+			if(!truncated)
+				ctrl.write(timestamp);
+		}
+
+		if(!files.empty()) {
+			auto [truncated, payload_len] = ctrl.message_truncated(SOL_SOCKET, SCM_RIGHTS,
+					sizeof(int) * files.size(), sizeof(int));
+			for(auto &file : files) {
+				if(truncated && payload_len < sizeof(int))
+					break;
+
+				ctrl.write<int>(
+					process->fileContext()->attachFile(std::move(file), flags & MSG_CMSG_CLOEXEC)
+					.value_or(-1));
+
+				if(truncated)
+					payload_len -= sizeof(int);
+			}
+
+			if(truncated)
+				replyFlags |= MSG_CTRUNC;
+		}
+
+		co_return protocols::fs::RecvData{ctrl.buffer(), result->value(), 0, replyFlags};
+	}
+
+	// Makes the connection leave ring mode. Peers see the abandoned flags of the rings and
+	// stop using them; the data that is left in the rings is moved to the receive queues.
+	async::result<void> _leaveRings() {
+		auto rings = _rings;
+		if(rings->leaving) {
+			co_await rings->left.wait();
+			co_return;
+		}
+
+		rings->leaving = true;
+		for(int i = 0; i < 2; i++)
+			rings->raiseFlag(i, &posix::SocketRing::abandoned);
+
+		for(int i = 0; i < 2; i++) {
+			auto ring = rings->ring(i);
+			auto &controls = rings->controls[i];
+
+			// Readers and writers (including our own ring operations) drop the locks once
+			// they see the abandoned flag. Peers that keep holding them lose the data
+			// in the ring once the socket is closed.
+			if(co_await lockRing(&ring->writeLock, _cancelRingOps)) {
+				if(co_await lockRing(&ring->readLock, _cancelRingOps)) {
+					// Ring i carries the data that the socket with index i sends.
+					auto receiver = (i == _ringIndex) ? _remote : this;
+					_drainRing(rings.get(), i, receiver);
+					unlockRing(&ring->readLock);
+				}
+				unlockRing(&ring->writeLock);
+			}
+			controls.clear();
+		}
+
+		_rings = nullptr;
+		_statusBell.raise();
+		if(_remote) {
+			_remote->_rings = nullptr;
+			_remote->_statusBell.raise();
+		}
+		rings->left.raise();
+	}
+
+	// Moves the data of one of the rings to the receive queue of the receiver (if any).
+	// The caller holds both locks of the ring.
+	static void _drainRing(StreamRings *rings, int index, OpenFile *receiver) {
+		auto ring = rings->ring(index);
+		auto &controls = rings->controls[index];
+		auto head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+		auto tail = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+		size_t available = head - tail;
+		if(!receiver || available > posix::socketRingCapacity)
+			return;
+
+		std::vector<char> data(available);
+		copyFromRing(data.data(), posix::socketRingData(ring), tail, available);
+
+		// Split the data at the bytes that carry files.
+		size_t offset = 0;
+		while(offset < available) {
+			std::vector<smarter::shared_ptr<File, FileHandle>> files;
+			size_t end = available;
+			while(!controls.empty()) {
+				size_t distance = controls.front().position - tail;
+				if(distance == offset && files.empty()) {
+					files = std::move(controls.front().files);
+					controls.pop_front();
+				}else if(distance <= offset || distance > available) {
+					// Peers consumed the byte (or moved head and tail arbitrarily).
+					controls.pop_front();
+				}else{
+					end = distance;
+					break;
+				}
+			}
+
+			receiver->_receive(data.data() + offset, end - offset,
+					rings->creds[index], std::move(files));
+			offset = end;
+		}
+		__atomic_store_n(&ring->tail, head, __ATOMIC_RELEASE);
+	}
+
+	// Copies data from the receive queue of a stream socket.
+	// Like on Linux, a single read returns data from multiple packets but it stops
+	// before packets that carry file descriptors or credentials of a different sender.
+	size_t _readStream(void *data, size_t maxLength, bool peek) {
+		assert(socktype_ == SOCK_STREAM);
+		assert(!_recvQueue.empty());
+		int pid = _recvQueue.front().senderPid;
+		unsigned int uid = _recvQueue.front().senderUid;
+		unsigned int gid = _recvQueue.front().senderGid;
+
+		size_t progress = 0;
+		for(auto it = _recvQueue.begin(); it != _recvQueue.end() && progress < maxLength; ) {
+			if(it != _recvQueue.begin()) {
+				if(!it->files.empty())
+					break;
+				if(_passCreds && (it->senderPid != pid
+						|| it->senderUid != uid || it->senderGid != gid))
+					break;
+			}
+
+			auto chunk = std::min(it->buffer.size() - it->offset, maxLength - progress);
+			memcpy(static_cast<char *>(data) + progress, it->buffer.data() + it->offset, chunk);
+			progress += chunk;
+
+			if(peek || it->offset + chunk < it->buffer.size()) {
+				if(!peek)
+					it->offset += chunk;
+				++it;
+			}else{
+				it = _recvQueue.erase(it);
+			}
+		}
+		return progress;
+	}
 
 	State _currentState;
 
@@ -966,6 +1689,12 @@ private:
 	// The actual receive queue of the socket.
 	std::deque<Packet> _recvQueue;
 
+	// Only used in ring mode (see setupRing()).
+	std::shared_ptr<StreamRings> _rings;
+	// Index of the ring that this socket sends on; it receives on the other ring.
+	int _ringIndex = 0;
+	unsigned int _seenRingHead = 0;
+
 	int _ownerPid;
 	int _ownerUid;
 	int _ownerGid;
@@ -1007,6 +1736,14 @@ createSocketFile(bool nonBlock, int32_t socktype) {
 	return File::constructHandle(std::move(file));
 }
 
+std::expected<std::pair<helix::BorrowedDescriptor, int>, Error>
+setupRing(File *file, Process *process) {
+	auto socket = dynamic_cast<OpenFile *>(file);
+	if(!socket)
+		return std::unexpected{Error::illegalArguments};
+	return socket->setupRing(process);
+}
+
 std::array<smarter::shared_ptr<File, FileHandle>, 2> createSocketPair(Process *process, bool nonBlock, int32_t socktype) {
 	auto file0 = smarter::make_shared<OpenFile>(process, nonBlock, socktype, true);
 	auto file1 = smarter::make_shared<OpenFile>(process, nonBlock, socktype, true);
@@ -7,5 +7,10 @@ namespace un_socket {
 std::expected<smarter::shared_ptr<File, FileHandle>, Error> createSocketFile(bool nonBlock, int32_t socktype);
 std::array<smarter::shared_ptr<File, FileHandle>, 2> createSocketPair(Process *process, bool nonBlock, int32_t socktype);
 
+// Switches a connected stream socket to ring mode (see posix::SocketRing).
+// Returns the memory object that holds the rings and the index of the ring that the socket sends on.
+std::expected<std::pair<helix::BorrowedDescriptor, int>, Error>
+setupRing(File *file, Process *process);
+
 } // namespace un_socket
 
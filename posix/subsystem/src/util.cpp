@@ -37,6 +37,7 @@ std::ostream& operator<<(std::ostream& os, const Error& err) {
 		case Error::notSupported: err_string = "notSupported"; break;
 		case Error::badFileDescriptor: err_string = "badFileDescriptor"; break;
 		case Error::badProcessCredentials: err_string = "badProcessCredentials"; break;
+		case Error::resourceBusy: err_string = "resourceBusy"; break;
 	}
 
 	return os << err_string;
@@ -29,6 +29,9 @@ struct File {
 	async::result<ReadResult> readSome(void *data, size_t max_length, async::cancellation_token);
 	async::result<size_t> writeSome(const void *data, size_t max_length);
 
+	async::result<ReadResult> pread(int64_t offset, void *data, size_t max_length);
+	async::result<frg::expected<Error, size_t>> pwrite(int64_t offset, const void *data, size_t length);
+
 	async::result<frg::expected<Error, PollWaitResult>>
 	pollWait(uint64_t sequence, int mask, async::cancellation_token cancellation = {});
 
@@ -37,6 +40,10 @@ struct File {
 
 	async::result<helix::UniqueDescriptor> accessMemory();
 
+	// Reads directory entries in the layout of struct linux_dirent64.
+	// Returns the number of bytes written to the buffer (zero at the end of the directory).
+	async::result<std::expected<size_t, Error>> readEntriesBatch(void *buffer, size_t size);
+
 	static async::result<frg::expected<Error, File>> createSocket(helix::BorrowedLane lane,
 		int domain, int type, int proto, int flags);
 
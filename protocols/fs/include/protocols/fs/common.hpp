@@ -1,5 +1,6 @@
 #pragma once
 
+#include <dirent.h>
 #include <expected>
 #include <optional>
 #include <string.h>
@@ -157,6 +158,67 @@ struct ReadEntriesResult {
 	int64_t fileType;
 };
 
+// Packs directory entries into a buffer using the layout of Linux' struct linux_dirent64.
+struct DirentBuffer {
+	explicit DirentBuffer(size_t capacity)
+	: _data(capacity) { }
+
+	// Returns false (and leaves the buffer unchanged) if the entry does not fit.
+	bool append(const ReadEntriesResult &entry) {
+		constexpr size_t nameOffset = 19;
+		size_t recordLength = (nameOffset + entry.name.size() + 1 + 7) & ~size_t{7};
+		if(recordLength > _data.size() - _size) {
+			_overflow = true;
+			return false;
+		}
+
+		auto record = _data.data() + _size;
+		uint64_t inode = entry.inode;
+		int64_t offset = entry.offset;
+		uint16_t length = recordLength;
+		uint8_t type = direntType(entry.fileType);
+		memset(record, 0, recordLength);
+		memcpy(record, &inode, sizeof(uint64_t));
+		memcpy(record + 8, &offset, sizeof(int64_t));
+		memcpy(record + 16, &length, sizeof(uint16_t));
+		memcpy(record + 18, &type, sizeof(uint8_t));
+		memcpy(record + nameOffset, entry.name.data(), entry.name.size());
+		_size += recordLength;
+		return true;
+	}
+
+	const char *data() const {
+		return _data.data();
+	}
+
+	size_t size() const {
+		return _size;
+	}
+
+	// True if an entry was rejected because the buffer was full.
+	bool overflowed() const {
+		return _overflow;
+	}
+
+private:
+	static uint8_t direntType(int64_t fileType) {
+		switch(fileType) {
+		case managarm::fs::FileType::REGULAR: return DT_REG;
+		case managarm::fs::FileType::DIRECTORY: return DT_DIR;
+		case managarm::fs::FileType::SYMLINK: return DT_LNK;
+		case managarm::fs::FileType::SOCKET: return DT_SOCK;
+		case managarm::fs::FileType::CHAR_DEVICE: return DT_CHR;
+		case managarm::fs::FileType::BLOCK_DEVICE: return DT_BLK;
+		case managarm::fs::FileType::FIFO: return DT_FIFO;
+		default: return DT_UNKNOWN;
+		}
+	}
+
+	std::vector<char> _data;
+	size_t _size = 0;
+	bool _overflow = false;
+};
+
 using PollResult = std::tuple<uint64_t, int, int>;
 using PollWaitResult = std::tuple<uint64_t, int>;
 using PollStatusResult = std::tuple<uint64_t, int>;
@@ -18,6 +18,7 @@
 
 #include <deque>
 #include <memory>
+#include <optional>
 
 namespace managarm::fs {
 	struct CntRequest;
@@ -76,6 +77,19 @@ using AcceptResult = std::pair<helix::UniqueLane, helix::UniqueLane>;
 using MkdirResult = std::pair<std::shared_ptr<void>, int64_t>;
 using SymlinkResult = std::pair<std::shared_ptr<void>, int64_t>;
 
+// Range of a memory object (e.g., the page cache) that contains the result of a read.
+// The range must remain within the memory object until the guard is released since
+// the server replies with success before the data is transferred.
+struct ReadMemoryRange {
+	helix::BorrowedDescriptor memory;
+	uintptr_t offset;
+	size_t length;
+	// Released after the data has been sent (e.g., a lock that prevents truncation).
+	std::shared_ptr<void> guard;
+};
+
+using ReadMemoryResult = std::expected<ReadMemoryRange, Error>;
+
 using TraverseLinksResult = frg::expected<Error, std::tuple<std::vector<std::pair<std::shared_ptr<void>, int64_t>>, FileType, size_t>>;
 
 struct FileOperations {
@@ -99,6 +113,16 @@ struct FileOperations {
 		read = f;
 		return *this;
 	}
+	constexpr FileOperations &withReadMemory(async::result<ReadMemoryResult> (*f)(void *object,
+			helix_ng::CredentialsView, size_t length)) {
+		readMemory = f;
+		return *this;
+	}
+	constexpr FileOperations &withPreadMemory(async::result<ReadMemoryResult> (*f)(void *object,
+			int64_t offset, helix_ng::CredentialsView, size_t length)) {
+		preadMemory = f;
+		return *this;
+	}
 	constexpr FileOperations &withWrite(async::result<frg::expected<protocols::fs::Error, size_t>> (*f)(void *object,
 			helix_ng::CredentialsView, const void *buffer, size_t length)) {
 		write = f;
@@ -113,6 +137,11 @@ struct FileOperations {
 		readEntries = f;
 		return *this;
 	}
+	constexpr FileOperations &withReadEntriesBatch(async::result<std::expected<void, managarm::fs::Errors>> (*f)(void *object,
+			DirentBuffer &buffer)) {
+		readEntriesBatch = f;
+		return *this;
+	}
 	constexpr FileOperations &withAccessMemory(async::result<helix::BorrowedDescriptor>(*f)(void *object)) {
 		accessMemory = f;
 		return *this;
@@ -174,11 +203,20 @@ struct FileOperations {
 			void *buffer, size_t length, async::cancellation_token cancellation) = nullptr;
 	async::result<ReadResult> (*pread)(void *object, int64_t offset, helix_ng::CredentialsView credentials,
 			void *buffer, size_t length) = nullptr;
+	// If present, these are preferred over read and pread. Instead of copying the data into
+	// a buffer, they return a range of a memory object that the data is sent from directly.
+	async::result<ReadMemoryResult> (*readMemory)(void *object, helix_ng::CredentialsView credentials,
+			size_t length) = nullptr;
+	async::result<ReadMemoryResult> (*preadMemory)(void *object, int64_t offset,
+			helix_ng::CredentialsView credentials, size_t length) = nullptr;
 	async::result<frg::expected<protocols::fs::Error, size_t>> (*write)(void *object, helix_ng::CredentialsView credentials,
 			const void *buffer, size_t length) = nullptr;
 	async::result<frg::expected<protocols::fs::Error, size_t>> (*pwrite)(void *object, int64_t offset, helix_ng::CredentialsView credentials,
 			const void *buffer, size_t length) = nullptr;
 	async::result<std::expected<protocols::fs::ReadEntriesResult, managarm::fs::Errors>> (*readEntries)(void *object) = nullptr;
+	// Appends entries until the buffer is full or the end of the directory is reached.
+	async::result<std::expected<void, managarm::fs::Errors>> (*readEntriesBatch)(void *object,
+			DirentBuffer &buffer) = nullptr;
 	async::result<helix::BorrowedDescriptor>(*accessMemory)(void *object) = nullptr;
 	async::result<frg::expected<protocols::fs::Error>> (*truncate)(void *object, size_t size) = nullptr;
 	async::result<frg::expected<protocols::fs::Error>> (*fallocate)(void *object, int64_t offset, size_t size) = nullptr;
@@ -268,6 +306,37 @@ struct NodeOperations {
 		std::string name, mode_t mode, bool exclusive, uid_t uid, gid_t gid);
 };
 
+// Helper to implement readEntriesBatch on top of a function that returns one entry at a time.
+// An entry that does not fit into the buffer is stored in pending and is
+// returned first by the next call. Errors (including END_OF_FILE) are only
+// reported if the buffer is still empty; otherwise, the next call retries readEntry().
+template<typename F>
+async::result<std::expected<void, managarm::fs::Errors>>
+fillDirentBuffer(DirentBuffer &buffer, std::optional<ReadEntriesResult> &pending, F readEntry) {
+	bool empty = true;
+	while(true) {
+		std::expected<ReadEntriesResult, managarm::fs::Errors> entry;
+		if(pending) {
+			entry = std::move(*pending);
+			pending.reset();
+		}else{
+			entry = co_await readEntry();
+		}
+
+		if(!entry) {
+			if(entry.error() == managarm::fs::Errors::END_OF_FILE || !empty)
+				co_return {};
+			co_return std::unexpected{entry.error()};
+		}
+
+		if(!buffer.append(*entry)) {
+			pending = std::move(*entry);
+			co_return {};
+		}
+		empty = false;
+	}
+}
+
 async::result<void>
 serveFile(helix::UniqueLane lane, void *file, const FileOperations *file_ops);
 
@@ -186,6 +186,72 @@ async::result<size_t> File::writeSome(const void *data, size_t maxLength) {
 	co_return resp.size();
 }
 
+async::result<ReadResult> File::pread(int64_t offset, void *data, size_t max_length) {
+	managarm::fs::PreadRequest req;
+	req.set_offset(offset);
+	req.set_size(max_length);
+
+	auto [offer, sendReq, imbueCreds, recvResp, recvData] =
+		co_await helix_ng::exchangeMsgs(
+			_lane,
+			helix_ng::offer(
+				helix_ng::sendBragiHeadOnly(req, frg::stl_allocator{}),
+				helix_ng::imbueCredentials(credsToken_),
+				helix_ng::recvInline(),
+				helix_ng::recvBuffer(data, max_length)
+			)
+		);
+
+	HEL_CHECK(offer.error());
+	HEL_CHECK(sendReq.error());
+	HEL_CHECK(imbueCreds.error());
+	HEL_CHECK(recvResp.error());
+
+	managarm::fs::SvrResponse resp;
+	resp.ParseFromArray(recvResp.data(), recvResp.length());
+	recvResp.reset();
+	// The server does not send any data on error.
+	if(resp.error() == managarm::fs::Errors::END_OF_FILE)
+		co_return std::unexpected{Error::endOfFile};
+	if(resp.error() != managarm::fs::Errors::SUCCESS)
+		co_return std::unexpected{resp.error() | toFsProtoError};
+
+	HEL_CHECK(recvData.error());
+	if(max_length && !recvData.actualLength())
+		co_return std::unexpected{Error::endOfFile};
+	co_return recvData.actualLength();
+}
+
+async::result<frg::expected<Error, size_t>>
+File::pwrite(int64_t offset, const void *data, size_t length) {
+	managarm::fs::PwriteRequest req;
+	req.set_offset(offset);
+	req.set_size(length);
+
+	auto [offer, sendReq, imbueCreds, sendData, recvResp] =
+		co_await helix_ng::exchangeMsgs(
+			_lane,
+			helix_ng::offer(
+				helix_ng::sendBragiHeadOnly(req, frg::stl_allocator{}),
+				helix_ng::imbueCredentials(credsToken_),
+				helix_ng::sendBuffer(data, length),
+				helix_ng::recvInline()
+			)
+		);
+
+	HEL_CHECK(offer.error());
+	HEL_CHECK(sendReq.error());
+	HEL_CHECK(imbueCreds.error());
+	HEL_CHECK(sendData.error());
+	HEL_CHECK(recvResp.error());
+
+	managarm::fs::SvrResponse resp;
+	resp.ParseFromArray(recvResp.data(), recvResp.length());
+	if(resp.error() != managarm::fs::Errors::SUCCESS)
+		co_return resp.error() | toFsProtoError;
+	co_return resp.size();
+}
+
 async::result<frg::expected<Error, PollWaitResult>> File::pollWait(uint64_t sequence, int mask,
 		async::cancellation_token ct) {
 	auto cancelId = cancellationId_++;
@@ -301,6 +367,32 @@ async::result<helix::UniqueDescriptor> File::accessMemory() {
 	co_return recv_memory.descriptor();
 }
 
+async::result<std::expected<size_t, Error>> File::readEntriesBatch(void *buffer, size_t size) {
+	managarm::fs::ReadEntriesBatchRequest req;
+	req.set_size(size);
+
+	auto [offer, send_req, recv_resp, recv_data] =
+		co_await helix_ng::exchangeMsgs(
+			_lane,
+			helix_ng::offer(
+				helix_ng::sendBragiHeadOnly(req, frg::stl_allocator{}),
+				helix_ng::recvInline(),
+				helix_ng::recvBuffer(buffer, size)
+			)
+		);
+
+	HEL_CHECK(offer.error());
+	HEL_CHECK(send_req.error());
+	HEL_CHECK(recv_resp.error());
+	HEL_CHECK(recv_data.error());
+
+	auto resp = *bragi::parse_head_only<managarm::fs::ReadEntriesBatchResponse>(recv_resp);
+	if(resp.error() != managarm::fs::Errors::SUCCESS)
+		co_return std::unexpected{resp.error() | toFsProtoError};
+	assert(resp.size() == recv_data.actualLength());
+	co_return resp.size();
+}
+
 async::result<frg::expected<Error, File>> File::createSocket(helix::BorrowedLane lane,
 		int domain, int type, int proto, int flags) {
 	managarm::fs::CntRequest req;
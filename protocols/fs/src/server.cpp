@@ -121,6 +121,59 @@ struct HandleFileRequest {
 		);
 	}
 
+	// Sends the response to a read or pread that was handled by readMemory or preadMemory.
+	// The data is sent directly from the memory object.
+	// For pread, errors are sent without a (zero-sized) data message.
+	async::result<void> sendReadMemoryResponse(helix::BorrowedDescriptor conversation,
+			ReadMemoryResult res, bool sendDataOnError) {
+		managarm::fs::SvrResponse resp;
+		if(!res.has_value() && !sendDataOnError) {
+			resp.set_error(res.error() | toFsError);
+
+			auto ser = resp.SerializeAsString();
+			auto [send_resp] = co_await helix_ng::exchangeMsgs(
+				conversation,
+				helix_ng::sendBuffer(ser.data(), ser.size())
+			);
+			HEL_CHECK(send_resp.error());
+			logBragiSerializedReply(ser);
+			co_return;
+		}
+
+		if(!res.has_value() || !res->length) {
+			if(!res.has_value()) {
+				resp.set_error(res.error() | toFsError);
+			}else{
+				resp.set_error(managarm::fs::Errors::SUCCESS);
+			}
+
+			auto ser = resp.SerializeAsString();
+			auto [send_resp, send_data] = co_await helix_ng::exchangeMsgs(
+				conversation,
+				helix_ng::sendBuffer(ser.data(), ser.size()),
+				helix_ng::sendBuffer(nullptr, 0)
+			);
+			HEL_CHECK(send_resp.error());
+			HEL_CHECK(send_data.error());
+			logBragiSerializedReply(ser);
+			co_return;
+		}
+
+		resp.set_error(managarm::fs::Errors::SUCCESS);
+
+		auto ser = resp.SerializeAsString();
+		auto [send_resp, send_data] = co_await helix_ng::exchangeMsgs(
+			conversation,
+			helix_ng::sendBuffer(ser.data(), ser.size()),
+			helix_ng::sendFromMemory(res->memory, res->offset, res->length)
+		);
+		HEL_CHECK(send_resp.error());
+		// readMemory and preadMemory guarantee that the range stays valid until the guard
+		// is released, hence this can only fail if the client went away.
+		HEL_CHECK(send_data.error());
+		logBragiSerializedReply(ser);
+	}
+
 	async::result<std::expected<void, DispatchError>>
 	operator()(managarm::fs::CntRequest &&req, helix::BorrowedDescriptor conversation,
 			bragi::preamble preamble, smarter::shared_ptr<void> file,
@@ -741,7 +794,8 @@ struct HandleFileRequest {
 			conversation,
 			helix_ng::sendBuffer(ser.data(), ser.size()),
 			helix_ng::sendBuffer(addr.data(), std::min(addr.size(), data.addressLength)),
-			helix_ng::sendBuffer(buffer.data(), buffer.size()),
+			// With MSG_TRUNC, dataLength can exceed the size of the buffer.
+			helix_ng::sendBuffer(buffer.data(), std::min(buffer.size(), data.dataLength)),
 			helix_ng::sendBuffer(data.ctrl.data(), data.ctrl.size())
 		);
 		HEL_CHECK(send_resp.error());
@@ -1051,6 +1105,47 @@ struct HandleFileRequest {
 		co_return {};
 	}
 
+	async::result<std::expected<void, DispatchError>>
+	operator()(managarm::fs::ReadEntriesBatchRequest &&req, helix::BorrowedDescriptor conversation,
+			bragi::preamble preamble, smarter::shared_ptr<void> file,
+			const FileOperations *file_ops) {
+		id = preamble.id();
+		logBragiRequest(req);
+
+		// Bound the size of the temporary buffer; clients simply issue more requests.
+		constexpr size_t maxBatchSize = 64 * 1024;
+
+		managarm::fs::ReadEntriesBatchResponse resp;
+		DirentBuffer buffer{std::min(static_cast<size_t>(req.size()), maxBatchSize)};
+		if(!file_ops->readEntriesBatch) {
+			resp.set_error(managarm::fs::Errors::ILLEGAL_OPERATION_TARGET);
+		}else{
+			auto result = co_await file_ops->readEntriesBatch(file.get(), buffer);
+			if(!result) {
+				resp.set_error(result.error());
+			}else if(!buffer.size() && buffer.overflowed()) {
+				// Not even a single entry fits into the buffer.
+				resp.set_error(managarm::fs::Errors::ILLEGAL_ARGUMENT);
+			}else{
+				resp.set_error(managarm::fs::Errors::SUCCESS);
+			}
+		}
+
+		size_t size = resp.error() == managarm::fs::Errors::SUCCESS ? buffer.size() : 0;
+		resp.set_size(size);
+
+		auto ser = resp.SerializeAsString();
+		auto [send_resp, send_data] = co_await helix_ng::exchangeMsgs(
+			conversation,
+			helix_ng::sendBuffer(ser.data(), ser.size()),
+			helix_ng::sendBuffer(buffer.data(), size)
+		);
+		HEL_CHECK(send_resp.error());
+		HEL_CHECK(send_data.error());
+		logBragiSerializedReply(ser);
+		co_return {};
+	}
+
 	async::result<std::expected<void, DispatchError>>
 	operator()(managarm::fs::CancelOperation &&req, helix::BorrowedDescriptor conversation,
 			bragi::preamble preamble, smarter::shared_ptr<void>,
@@ -1218,6 +1313,13 @@ struct HandleFileRequest {
 		);
 		HEL_CHECK(extract_creds.error());
 
+		if(file_ops->readMemory) {
+			auto res = co_await file_ops->readMemory(file.get(),
+					extract_creds.credentials(), req.size());
+			co_await sendReadMemoryResponse(conversation, std::move(res), true);
+			co_return {};
+		}
+
 		if(!file_ops->read) {
 			managarm::fs::SvrResponse resp;
 			resp.set_error(managarm::fs::Errors::ILLEGAL_OPERATION_TARGET);
@@ -1296,6 +1398,13 @@ struct HandleFileRequest {
 		);
 		HEL_CHECK(extract_creds.error());
 
+		if(file_ops->preadMemory) {
+			auto res = co_await file_ops->preadMemory(file.get(), req.offset(),
+					extract_creds.credentials(), req.size());
+			co_await sendReadMemoryResponse(conversation, std::move(res), false);
+			co_return {};
+		}
+
 		if(!file_ops->pread) {
 			managarm::fs::SvrResponse resp;
 			resp.set_error(managarm::fs::Errors::ILLEGAL_OPERATION_TARGET);
@@ -2276,6 +2385,7 @@ async::result<void> servePassthrough(helix::UniqueLane lane,
 			managarm::fs::GetSockOpt,
 			managarm::fs::ShutdownSocket,
 			managarm::fs::ReadEntriesRequest,
+			managarm::fs::ReadEntriesBatchRequest,
 			managarm::fs::CancelOperation,
 			managarm::fs::FilePollRequest,
 			managarm::fs::AcceptRequest,
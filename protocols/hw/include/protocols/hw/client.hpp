@@ -190,4 +190,9 @@ private:
 	helix::UniqueLane _lane;
 };
 
+// Routes an IRQ to the n-th CPU (modulo the number of CPUs) that the calling thread may run on.
+// Drivers with multiple IRQs (e.g., one per queue) use this to spread them across CPUs.
+// IRQs that cannot be re-routed (for any reason) are left alone.
+void spreadIrq(helix::BorrowedDescriptor irq, unsigned int n);
+
 } } // namespace protocols::hw
@@ -1146,5 +1146,33 @@ async::result<std::pair<bool, helix::UniqueDescriptor>> Device::getDmaSpace() {
 	co_return {resp.iommu_active(), recv_desc.descriptor()};
 }
 
+void spreadIrq(helix::BorrowedDescriptor irq, unsigned int n) {
+	std::vector<uint8_t> mask(8);
+	size_t actualSize;
+	while(true) {
+		auto e = helGetAffinity(kHelThisThread, mask.data(), mask.size(), &actualSize);
+		if(e == kHelErrBufferTooSmall) {
+			mask.resize(mask.size() * 2);
+			continue;
+		}
+		if(e != kHelErrNone)
+			return;
+		break;
+	}
+
+	std::vector<uint32_t> cpus;
+	for(size_t i = 0; i < actualSize * 8; i++) {
+		if(mask[i / 8] & (1 << (i % 8)))
+			cpus.push_back(i);
+	}
+	if(cpus.empty())
+		return;
+
+	// Spreading IRQs is only an optimization. If the IRQ cannot be re-routed
+	// (e.g., the CPU is offline or the IRQ does not support affinity), leave it alone.
+	auto e = helSetIrqAffinity(irq.getHandle(), cpus[n % cpus.size()]);
+	(void)e;
+}
+
 } // namespace protocols::hw
 
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <stddef.h>
+#include <stdint.h>
 #include <hel.h>
 
 namespace posix {
@@ -28,4 +30,107 @@ struct ManagarmProcessData {
 	void *clockTrackerPage;
 };
 
+struct EpollRingEntry {
+	uint32_t events;
+	uint32_t reserved;
+	uint64_t data;
+};
+
+// Shared memory of an epoll instance in ring mode (see EpollRingRequest).
+// The posix server publishes ready events at head; the C library consumes them at tail.
+// Both are free-running counters; event i is stored at entries[i % numEntries].
+//
+// Consumers read entries and then take them by advancing tail with a compare-and-swap.
+// Afterwards, if producerWaiting was set (exchange it with zero), they futex-wake tail.
+// If the ring is empty, consumers read wakeSeq, set consumerWaiting, re-check head and closed
+// and futex-wait on wakeSeq. Level-triggered events are published again once consumers
+// drained the ring. Consumers must skip entries whose events are zero: EPOLL_CTL_DEL and
+// EPOLL_CTL_MOD clear the events of entries that were published for the item but not consumed.
+// Once the ring is set up, EpollWaitRequest takes events from the ring in the same way.
+// The posix server never reads numEntries back; it only serves as information for consumers.
+struct alignas(64) EpollRing {
+	// Written by the posix server.
+	unsigned int head;
+	// Written by consumers. Futex word for the posix server.
+	unsigned int tail;
+	// Incremented by the posix server after it advances head or sets closed.
+	// Futex word for consumers.
+	unsigned int wakeSeq;
+	unsigned int consumerWaiting;
+	unsigned int producerWaiting;
+	// Set by the posix server once the epoll instance is closed.
+	unsigned int closed;
+	unsigned int numEntries;
+};
+
+inline EpollRingEntry *epollRingEntries(EpollRing *ring) {
+	return reinterpret_cast<EpollRingEntry *>(ring + 1);
+}
+
+// Layout of the shared memory of a connected AF_UNIX stream socket in ring mode
+// (see SocketRingRequest). The memory object holds two rings of socketRingSize bytes each.
+// Ring i carries the data that is sent by the socket that SocketRingResponse reports as index i;
+// the other ring carries the data that it receives. Each ring consists of a SocketRing header
+// followed by socketRingCapacity bytes of data at offset socketRingDataOffset.
+constexpr size_t socketRingDataOffset = 0x1000;
+constexpr size_t socketRingCapacity = 0x10000;
+constexpr size_t socketRingSize = socketRingDataOffset + socketRingCapacity;
+
+// head and tail are free-running byte counters; byte n is stored at data[n % socketRingCapacity].
+//
+// Writers (including the posix server) hold writeLock and readers hold readLock while they
+// access the ring. Both are futex-based mutexes (0: unlocked, 1: locked, 2: locked with waiters);
+// unlocking exchanges the word with zero and futex-wakes it if it was 2.
+//
+// Writers fail with EPIPE (and raise SIGPIPE unless MSG_NOSIGNAL is given) if readerShutdown is set.
+// Otherwise, they copy data to head, advance head (release), increment dataSeq and, if dataWaiting
+// was set (exchange it with zero), futex-wake dataSeq. Readers consume data at tail and advance tail
+// in the same way, using spaceSeq and spaceWaiting. If there is no data (or no space), they read
+// dataSeq (or spaceSeq), set dataWaiting (or spaceWaiting), re-check the ring and futex-wait.
+// Once the ring is drained and writerShutdown is set, reads return EOF.
+//
+// If hasControl is set, readers must not consume the byte at controlPosition (or beyond it)
+// by themselves. Instead, they use RecvMsgRequest, since the posix server has attached ancillary
+// data (e.g., SCM_RIGHTS) to that byte or still holds data from before ring mode was set up.
+//
+// The posix server sets the shutdown flags on shutdown() and close(). Afterwards, it increments
+// both sequences and wakes all waiters. The server never reads layout information from the ring;
+// both peers can write to the whole memory object.
+//
+// If abandoned is set, the connection has left ring mode (e.g., because SO_PASSCRED was enabled,
+// which requires the posix server to see all data). The posix server sets it, increments both
+// sequences and wakes all waiters; it then takes both locks and moves the remaining data to its
+// receive queues. Readers and writers must check abandoned after acquiring a lock and after each
+// wakeup; if it is set, they release the lock without touching the ring and use the regular
+// requests from then on.
+struct alignas(64) SocketRing {
+	// Written by writers.
+	unsigned int head;
+	// Written by readers.
+	unsigned int tail;
+	unsigned int writeLock;
+	unsigned int readLock;
+	// Futex words for readers and writers, respectively.
+	unsigned int dataSeq;
+	unsigned int spaceSeq;
+	unsigned int dataWaiting;
+	unsigned int spaceWaiting;
+	// Written by the posix server.
+	unsigned int hasControl;
+	unsigned int controlPosition;
+	unsigned int writerShutdown;
+	unsigned int readerShutdown;
+	unsigned int abandoned;
+};
+
+static_assert(sizeof(SocketRing) <= socketRingDataOffset);
+
+inline SocketRing *socketRing(void *memory, int index) {
+	return reinterpret_cast<SocketRing *>(static_cast<char *>(memory) + index * socketRingSize);
+}
+
+inline unsigned char *socketRingData(SocketRing *ring) {
+	return reinterpret_cast<unsigned char *>(ring) + socketRingDataOffset;
+}
+
 } // namespace posix
@@ -0,0 +1,250 @@
+#include <iostream>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+#include <bragi/helpers-std.hpp>
+#include <core/dispatch.hpp>
+#include <helix/timer.hpp>
+#include <kerncfg.bragi.hpp>
+#include <protocols/mbus/client.hpp>
+
+// Periodically rebalances IRQs among CPUs.
+// The cost of each CPU is estimated from the time that it spent in IRQ handlers during the
+// last interval plus its share of the thread load as reported by the kernel's load balancer.
+// In each interval, at most one IRQ is moved from the most expensive to the cheapest CPU.
+
+namespace {
+
+constexpr bool logBalancing = false;
+
+// Length of one balancing interval.
+constexpr uint64_t balanceInterval = 2'000'000'000;
+
+// Do not move IRQs if the imbalance between CPUs is less than this fraction of an interval.
+constexpr uint64_t minImbalance = balanceInterval / 100;
+
+// Number of intervals that an IRQ stays on its CPU after it was moved.
+constexpr int moveCooldown = 5;
+
+// Number of intervals that we wait before retrying to move an IRQ after a failure.
+constexpr int retryCooldown = 10;
+
+helix::UniqueLane kerncfgLane;
+
+struct IrqState {
+	// Counters at the end of the last interval (summed over all CPUs).
+	uint64_t lastRaiseNanos = 0;
+	// Time spent in the IRQ's handlers during the last interval.
+	uint64_t intervalNanos = 0;
+	uint64_t affinity = 0;
+	int cooldown = 0;
+	// Set if the kernel cannot change the IRQ's affinity.
+	bool pinned = false;
+	bool seen = false;
+};
+
+async::result<void> enumerateKerncfg() {
+	auto filter = mbus_ng::Conjunction{{
+		mbus_ng::EqualsFilter{"class", "kerncfg"}
+	}};
+
+	auto enumerator = mbus_ng::Instance::global().enumerate(filter);
+	auto [_, events] = (co_await enumerator.nextEvents()).unwrap();
+	assert(events.size() == 1);
+
+	auto entity = co_await mbus_ng::Instance::global().getEntity(events[0].id);
+	kerncfgLane = (co_await entity.getRemoteLane()).unwrap();
+}
+
+async::result<std::optional<managarm::kerncfg::GetIrqStatisticsResponse>> getStatistics() {
+	managarm::kerncfg::GetIrqStatisticsRequest req;
+
+	auto [offer, sendReq, recvResp] = co_await helix_ng::exchangeMsgs(
+		kerncfgLane,
+		helix_ng::offer(
+			helix_ng::want_lane,
+			helix_ng::sendBragiHeadOnly(req, frg::stl_allocator{}),
+			helix_ng::recvInline()
+		)
+	);
+	HEL_CHECK(offer.error());
+	HEL_CHECK(sendReq.error());
+	HEL_CHECK(recvResp.error());
+
+	auto preamble = bragi::read_preamble(recvResp);
+	if(preamble.error()) {
+		std::cout << "irqbalance: Malformed statistics response" << std::endl;
+		co_return std::nullopt;
+	}
+	std::vector<uint8_t> tail(preamble.tail_size());
+	auto [recvTail] = co_await helix_ng::exchangeMsgs(
+		offer.descriptor(),
+		helix_ng::recvBuffer(tail.data(), tail.size())
+	);
+	HEL_CHECK(recvTail.error());
+
+	auto resp = bragi::parse_head_tail<managarm::kerncfg::GetIrqStatisticsResponse>(
+			recvResp, tail);
+	if(!resp) {
+		std::cout << "irqbalance: Malformed statistics response" << std::endl;
+		co_return std::nullopt;
+	}
+	if(resp->error() != managarm::kerncfg::Error::SUCCESS) {
+		std::cout << "irqbalance: Failed to retrieve IRQ statistics" << std::endl;
+		co_return std::nullopt;
+	}
+	co_return std::move(*resp);
+}
+
+async::result<managarm::kerncfg::Error> setAffinity(uint64_t id, uint64_t cpu) {
+	managarm::kerncfg::SetIrqAffinityRequest req;
+	req.set_id(id);
+	req.set_cpu(cpu);
+
+	auto [offer, sendReq, recvResp] = co_await helix_ng::exchangeMsgs(
+		kerncfgLane,
+		helix_ng::offer(
+			helix_ng::sendBragiHeadOnly(req, frg::stl_allocator{}),
+			helix_ng::recvInline()
+		)
+	);
+	HEL_CHECK(offer.error());
+	HEL_CHECK(sendReq.error());
+	HEL_CHECK(recvResp.error());
+
+	auto resp = bragi::parse_head_only<managarm::kerncfg::SvrResponse>(recvResp);
+	if(!resp)
+		co_return managarm::kerncfg::Error::ILLEGAL_REQUEST;
+	co_return resp->error();
+}
+
+struct Balancer {
+	async::result<void> balanceOnce();
+
+private:
+	std::unordered_map<uint64_t, IrqState> irqs_;
+	// Per-CPU IRQ time at the end of the last interval.
+	std::vector<uint64_t> lastIrqNanos_;
+};
+
+async::result<void> Balancer::balanceOnce() {
+	auto maybeStats = co_await getStatistics();
+	if(!maybeStats)
+		co_return;
+	auto &stats = *maybeStats;
+	auto numCpus = stats.cpu_loads().size();
+	if(numCpus < 2)
+		co_return;
+
+	// Update the per-IRQ state and attribute the IRQ time to the CPUs that handled the IRQs.
+	std::vector<uint64_t> irqNanos(numCpus, 0);
+	for(auto &entry : stats.irqs()) {
+		auto &state = irqs_[entry.id()];
+
+		uint64_t raiseNanos = 0;
+		for(size_t cpu = 0; cpu < entry.cpus().size() && cpu < numCpus; cpu++) {
+			auto &cpuStats = entry.cpus()[cpu];
+			raiseNanos += cpuStats.raise_nanos();
+			irqNanos[cpu] += cpuStats.raise_nanos();
+		}
+
+		// The first sample only establishes the baseline.
+		state.intervalNanos = state.seen ? raiseNanos - state.lastRaiseNanos : 0;
+		state.lastRaiseNanos = raiseNanos;
+		state.affinity = entry.affinity();
+		state.seen = true;
+		if(state.cooldown)
+			state.cooldown--;
+	}
+
+	// irqNanos holds absolute counters so far; turn them into per-interval values.
+	lastIrqNanos_.resize(numCpus, 0);
+	for(size_t cpu = 0; cpu < numCpus; cpu++) {
+		auto delta = irqNanos[cpu] - lastIrqNanos_[cpu];
+		lastIrqNanos_[cpu] = irqNanos[cpu];
+		irqNanos[cpu] = delta;
+	}
+
+	uint64_t totalLoad = 0;
+	for(auto load : stats.cpu_loads())
+		totalLoad += load;
+
+	std::vector<uint64_t> cost(numCpus);
+	for(size_t cpu = 0; cpu < numCpus; cpu++) {
+		cost[cpu] = irqNanos[cpu];
+		// The load balancer's load values are relative, hence we weigh the thread load
+		// by the CPU's share of the total system load.
+		if(totalLoad)
+			cost[cpu] += static_cast<unsigned __int128>(stats.cpu_loads()[cpu])
+					* balanceInterval / totalLoad;
+	}
+
+	size_t src = 0;
+	size_t dst = 0;
+	for(size_t cpu = 1; cpu < numCpus; cpu++) {
+		if(cost[cpu] > cost[src])
+			src = cpu;
+		if(cost[cpu] < cost[dst])
+			dst = cpu;
+	}
+
+	auto imbalance = cost[src] - cost[dst];
+	if(imbalance < minImbalance)
+		co_return;
+
+	// Pick the most expensive IRQ on src whose move does not invert the imbalance.
+	uint64_t bestId = 0;
+	IrqState *best = nullptr;
+	for(auto &[id, state] : irqs_) {
+		if(state.pinned || state.cooldown || state.affinity != src)
+			continue;
+		if(!state.intervalNanos || state.intervalNanos >= imbalance)
+			continue;
+		if(!best || state.intervalNanos > best->intervalNanos) {
+			bestId = id;
+			best = &state;
+		}
+	}
+	if(!best)
+		co_return;
+
+	auto error = co_await setAffinity(bestId, dst);
+	if(error == managarm::kerncfg::Error::NO_HARDWARE_SUPPORT) {
+		best->pinned = true;
+		co_return;
+	}else if(error != managarm::kerncfg::Error::SUCCESS) {
+		// Other errors can be transient (e.g., if the target CPU is not online yet).
+		std::cout << "irqbalance: Failed to move IRQ " << bestId
+				<< " to CPU " << dst << ", retrying later" << std::endl;
+		best->cooldown = retryCooldown;
+		co_return;
+	}
+
+	if(logBalancing)
+		std::cout << "irqbalance: Moving IRQ " << bestId << " from CPU " << src
+				<< " to CPU " << dst << " (" << best->intervalNanos << " ns/interval)" << std::endl;
+	best->affinity = dst;
+	best->cooldown = moveCooldown;
+}
+
+async::detached runBalancer() {
+	co_await enumerateKerncfg();
+
+	Balancer balancer;
+	while(true) {
+		co_await balancer.balanceOnce();
+		co_await helix::sleepFor(balanceInterval);
+	}
+}
+
+} // anonymous namespace
+
+int main() {
+	std::cout << "irqbalance: Starting IRQ balancer" << std::endl;
+
+	runBalancer();
+	async::run_forever(helix::currentDispatcher);
+
+	return 0;
+}
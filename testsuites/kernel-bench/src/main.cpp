@@ -1,4 +1,5 @@
 #include <math.h>
+#include <string.h>
 
 #include <async/result.hpp>
 #include <async/algorithm.hpp>
@@ -15,6 +16,12 @@ namespace {
 struct IterationsPerSecondBenchmark {
 	using clock = std::chrono::high_resolution_clock;
 
+	IterationsPerSecondBenchmark() = default;
+
+	// If bytesPerIteration is non-zero, the benchmark also reports bandwidth.
+	explicit IterationsPerSecondBenchmark(size_t bytesPerIteration)
+	: bytesPerIteration_{bytesPerIteration} { }
+
 	void launchRepetition() {
 		ref_ = clock::now();
 	}
@@ -26,7 +33,10 @@ struct IterationsPerSecondBenchmark {
 	}
 
 	void announceIterations(uint64_t iters) {
-		std::cout << "    " << iters << " iterations per second" << std::endl;
+		std::cout << "    " << iters << " iterations per second";
+		if(bytesPerIteration_)
+			std::cout << " (" << (iters * bytesPerIteration_ / (1024 * 1024)) << " MiB/s)";
+		std::cout << std::endl;
 		results_.push_back(iters);
 	}
 
@@ -42,14 +52,78 @@ struct IterationsPerSecondBenchmark {
 		var /= results_.size();
 
 		std::cout << "    avg: " << static_cast<uint64_t>(avg)
-				<< ", std: " << static_cast<uint64_t>(sqrt(var)) << std::endl;
+				<< ", std: " << static_cast<uint64_t>(sqrt(var));
+		if(bytesPerIteration_)
+			std::cout << ", avg bandwidth: "
+					<< static_cast<uint64_t>(avg * bytesPerIteration_ / (1024 * 1024)) << " MiB/s";
+		std::cout << std::endl;
 	}
 
 private:
+	size_t bytesPerIteration_ = 0;
 	std::vector<double> results_;
 	std::chrono::time_point<clock> ref_;
 };
 
+// Histogram of latencies with power-of-two buckets (in microseconds).
+struct LatencyHistogram {
+	static constexpr int numBuckets = 16;
+
+	void record(uint64_t nanos) {
+		auto micros = nanos / 1000;
+		int b = 0;
+		while(b < numBuckets - 1 && micros >= (uint64_t{1} << b))
+			++b;
+		++buckets_[b];
+		++count_;
+		if(nanos > max_)
+			max_ = nanos;
+	}
+
+	// Returns the upper bound (in microseconds) of the bucket that contains the given quantile.
+	uint64_t quantile(double q) {
+		uint64_t n = 0;
+		for(int b = 0; b < numBuckets; ++b) {
+			n += buckets_[b];
+			if(n >= q * count_)
+				return uint64_t{1} << b;
+		}
+		return uint64_t{1} << (numBuckets - 1);
+	}
+
+	void print() {
+		for(int b = 0; b < numBuckets; ++b) {
+			if(!buckets_[b])
+				continue;
+			std::cout << "    < " << (uint64_t{1} << b) << " us: " << buckets_[b] << std::endl;
+		}
+		std::cout << "    p50: < " << quantile(0.5) << " us, p99: < " << quantile(0.99)
+				<< " us, max: " << (max_ / 1000) << " us" << std::endl;
+	}
+
+private:
+	uint64_t buckets_[numBuckets] = {};
+	uint64_t count_ = 0;
+	uint64_t max_ = 0;
+};
+
+uint64_t getClock() {
+	uint64_t now;
+	HEL_CHECK(helGetClock(&now));
+	return now;
+}
+
+void sleepUntil(uint64_t deadline) {
+	int futex = 0;
+	auto error = helFutexWait(&futex, 0, deadline);
+	if(error != kHelErrTimeout)
+		HEL_CHECK(error);
+}
+
+void sleepFor(uint64_t nanos) {
+	sleepUntil(getClock() + nanos);
+}
+
 void doNopBenchmark() {
 	std::cout << "syscall ops" << std::endl;
 
@@ -196,6 +270,53 @@ void doFutexBenchmark() {
 	bench.finalizeStatistics();
 }
 
+// Ping-pong between this coroutine and a second thread. Each iteration blocks on the
+// current value of the futex through the submission queue until the other thread wakes us.
+async::result<void> doSqFutexBenchmark() {
+	std::cout << "futex wait + wake, submission queue" << std::endl;
+
+	// 1: the other thread's turn, 0: our turn.
+	std::atomic<int> turn{0};
+	std::atomic<bool> stop{false};
+	std::thread waker([&] {
+		while(true) {
+			while(!turn.load(std::memory_order_acquire)) {
+				auto error = helFutexWait(reinterpret_cast<int *>(&turn), 0, -1);
+				if(error != kHelErrCancelled)
+					HEL_CHECK(error);
+			}
+			if(stop.load(std::memory_order_relaxed))
+				return;
+			turn.store(0, std::memory_order_release);
+			HEL_CHECK(helFutexWake(reinterpret_cast<int *>(&turn), 1));
+		}
+	});
+
+	IterationsPerSecondBenchmark bench;
+	for(int k = 0; k < 5; ++k) {
+		uint64_t n = 0;
+		bench.launchRepetition();
+		while(!bench.isRepetitionDone()) {
+			for(int i = 0; i < 100; ++i) {
+				turn.store(1, std::memory_order_release);
+				HEL_CHECK(helFutexWake(reinterpret_cast<int *>(&turn), 1));
+				while(turn.load(std::memory_order_acquire)) {
+					auto result = co_await helix_ng::futexWait(reinterpret_cast<int *>(&turn), 1);
+					HEL_CHECK(result.error());
+				}
+				++n;
+			}
+		}
+		bench.announceIterations(n);
+	}
+	bench.finalizeStatistics();
+
+	stop.store(true, std::memory_order_relaxed);
+	turn.store(1, std::memory_order_release);
+	HEL_CHECK(helFutexWake(reinterpret_cast<int *>(&turn), 1));
+	waker.join();
+}
+
 void doAllocateBenchmark(size_t size) {
 	std::cout << "allocate memory, size = " << (size / (1024 * 1024)) << " MiB" << std::endl;
 
@@ -236,6 +357,44 @@ void doMapBenchmark(size_t size) {
 	bench.finalizeStatistics();
 }
 
+// Same as doMapBenchmark() but maps, unmaps and closes through the submission queue.
+// With batch > 1, the operations of multiple iterations are pipelined.
+async::result<void> doSqMapBenchmark(size_t size, int batch) {
+	std::cout << "memory mapping, submission queue, size = " << (size / (1024 * 1024))
+			<< " MiB, batch = " << batch << std::endl;
+
+	IterationsPerSecondBenchmark bench;
+	for(int k = 0; k < 5; ++k) {
+		uint64_t n = 0;
+		bench.launchRepetition();
+		while(!bench.isRepetitionDone()) {
+			async::wait_group wg{batch};
+			for(int i = 0; i < batch; ++i) {
+				async::detach([] (size_t size, async::wait_group &wg) -> async::result<void> {
+					HelHandle handle;
+					HEL_CHECK(helAllocateMemory(size, 0, nullptr, &handle));
+					helix::UniqueDescriptor memory{handle};
+
+					auto mapResult = co_await helix_ng::mapMemory(memory,
+							helix::BorrowedDescriptor{kHelNullHandle}, nullptr, 0, size,
+							kHelMapProtRead | kHelMapProtWrite);
+					HEL_CHECK(mapResult.error());
+					auto unmapResult = co_await helix_ng::unmapMemory(
+							helix::BorrowedDescriptor{kHelNullHandle}, mapResult.pointer(), size);
+					HEL_CHECK(unmapResult.error());
+					auto closeResult = co_await helix_ng::closeDescriptor(std::move(memory));
+					HEL_CHECK(closeResult.error());
+					wg.done();
+				}(size, wg));
+			}
+			co_await wg.wait();
+			n += batch;
+		}
+		bench.announceIterations(n);
+	}
+	bench.finalizeStatistics();
+}
+
 void doMapPopulatedBenchmark(size_t size) {
 	std::cout << "populated mapping, size = " << (size / (1024 * 1024)) << " MiB" << std::endl;
 
@@ -299,20 +458,87 @@ void doPageFaultBenchmark(size_t size) {
 	bench.finalizeStatistics();
 }
 
-async::result<void> doSendRecvBufferBenchmark(size_t size) {
+// Buffers are page-aligned plus misalign bytes. Page-aligned sends allow the kernel
+// to transfer full pages without bouncing them through a kernel buffer.
+async::result<void> doSendRecvBufferBenchmark(size_t size, size_t misalign = 0) {
 	auto [lane1, lane2] = helix::createStream();
-	std::vector<std::byte> sBuf(size);
-	std::vector<std::byte> rBuf(size);
+	std::vector<std::byte> sStorage(size + misalign + 0x1000);
+	std::vector<std::byte> rStorage(size + misalign + 0x1000);
+	auto alignUp = [] (std::byte *p) {
+		return reinterpret_cast<std::byte *>(
+				(reinterpret_cast<uintptr_t>(p) + 0xFFF) & ~uintptr_t{0xFFF});
+	};
+	auto sBuf = alignUp(sStorage.data()) + misalign;
+	auto rBuf = alignUp(rStorage.data()) + misalign;
 
 	if(size < 1024) {
-		std::cout << "size = " << size << std::endl;
+		std::cout << "size = " << size;
 	}else if(size < 1024 * 1024) {
-		std::cout << "size = " << (size / 1024) << " KiB" << std::endl;
+		std::cout << "size = " << (size / 1024) << " KiB";
 	}else{
-		std::cout << "size = " << (size / (1024 * 1024)) << " MiB" << std::endl;
+		std::cout << "size = " << (size / (1024 * 1024)) << " MiB";
 	}
+	if(misalign)
+		std::cout << ", misaligned by " << misalign;
+	std::cout << std::endl;
 
-	IterationsPerSecondBenchmark bench;
+	IterationsPerSecondBenchmark bench{size};
+	for(int k = 0; k < 5; ++k) {
+		uint64_t n = 0;
+		bench.launchRepetition();
+		while(!bench.isRepetitionDone()) {
+			for(int i = 0; i < 100; ++i) {
+				co_await async::when_all(
+					async::transform(
+						helix_ng::exchangeMsgs(lane1, helix_ng::sendBuffer(sBuf, size)
+					), [&] (auto result) {
+						auto [send] = std::move(result);
+						HEL_CHECK(send.error());
+					}),
+					async::transform(
+						helix_ng::exchangeMsgs(lane2, helix_ng::recvBuffer(rBuf, size)
+					), [&] (auto result) {
+						auto [recv] = std::move(result);
+						HEL_CHECK(recv.error());
+						assert(recv.actualLength() == size);
+					})
+				);
+				++n;
+			}
+		}
+		bench.announceIterations(n);
+	}
+	bench.finalizeStatistics();
+}
+
+// Sends size bytes as numSegments scatter-gather segments. Page-aligned segments
+// are pinned and copied directly from user memory by the kernel, misaligned
+// segments are bounced through kernel buffers, which gives the copy baseline.
+async::result<void> doSendBufferSgBenchmark(size_t size, size_t numSegments,
+		size_t misalign = 0) {
+	auto [lane1, lane2] = helix::createStream();
+	size_t segmentSize = size / numSegments;
+	size_t stride = (segmentSize + misalign + 0xFFF) & ~size_t{0xFFF};
+	std::vector<std::byte> sStorage(numSegments * stride + 0x1000);
+	std::vector<std::byte> rStorage(size + 0x1000);
+	auto alignUp = [] (std::byte *p) {
+		return reinterpret_cast<std::byte *>(
+				(reinterpret_cast<uintptr_t>(p) + 0xFFF) & ~uintptr_t{0xFFF});
+	};
+	auto sBase = alignUp(sStorage.data());
+	auto rBuf = alignUp(rStorage.data());
+
+	std::vector<HelSgItem> sgItems(numSegments);
+	for(size_t i = 0; i < numSegments; ++i)
+		sgItems[i] = HelSgItem{sBase + i * stride + misalign, segmentSize};
+
+	std::cout << "sendBufferSg, size = " << (size / 1024) << " KiB in "
+			<< numSegments << " segments";
+	if(misalign)
+		std::cout << ", misaligned by " << misalign;
+	std::cout << std::endl;
+
+	IterationsPerSecondBenchmark bench{size};
 	for(int k = 0; k < 5; ++k) {
 		uint64_t n = 0;
 		bench.launchRepetition();
@@ -320,11 +546,70 @@ async::result<void> doSendRecvBufferBenchmark(size_t size) {
 			for(int i = 0; i < 100; ++i) {
 				co_await async::when_all(
 					async::transform(
-						helix_ng::exchangeMsgs(lane1, helix_ng::sendBuffer(sBuf.data(), size)
+						helix_ng::exchangeMsgs(lane1,
+								helix_ng::sendBufferSg(sgItems.data(), numSegments)
 					), [&] (auto result) {
 						auto [send] = std::move(result);
 						HEL_CHECK(send.error());
 					}),
+					async::transform(
+						helix_ng::exchangeMsgs(lane2, helix_ng::recvBuffer(rBuf, size)
+					), [&] (auto result) {
+						auto [recv] = std::move(result);
+						HEL_CHECK(recv.error());
+						assert(recv.actualLength() == size);
+					})
+				);
+				++n;
+			}
+		}
+		bench.announceIterations(n);
+	}
+	bench.finalizeStatistics();
+}
+
+// Models a file server that answers reads from its page cache: the data is either
+// copied out of the memory object and sent via sendBuffer, or sent via sendFromMemory.
+async::result<void> doSendFromMemoryBenchmark(size_t size, bool fromMemory) {
+	std::cout << (fromMemory ? "sendFromMemory" : "readMemory + sendBuffer")
+			<< ", size = " << (size / 1024) << " KiB" << std::endl;
+
+	auto [lane1, lane2] = helix::createStream();
+
+	HelHandle handle;
+	HEL_CHECK(helAllocateMemory(size, 0, nullptr, &handle));
+	helix::UniqueDescriptor memory{handle};
+	void *window;
+	HEL_CHECK(helMapMemory(handle, kHelNullHandle, nullptr, 0, size,
+			kHelMapProtRead | kHelMapProtWrite, &window));
+	memset(window, 0x5A, size);
+	HEL_CHECK(helUnmapMemory(kHelNullHandle, window, size));
+
+	std::vector<std::byte> sBuf(size);
+	std::vector<std::byte> rBuf(size);
+
+	IterationsPerSecondBenchmark bench{size};
+	for(int k = 0; k < 5; ++k) {
+		uint64_t n = 0;
+		bench.launchRepetition();
+		while(!bench.isRepetitionDone()) {
+			for(int i = 0; i < 100; ++i) {
+				auto send = [&] () -> async::result<void> {
+					if(fromMemory) {
+						auto [send] = co_await helix_ng::exchangeMsgs(lane1,
+								helix_ng::sendFromMemory(memory, 0, size));
+						HEL_CHECK(send.error());
+					}else{
+						auto readMemory = co_await helix_ng::readMemory(memory,
+								0, size, sBuf.data());
+						HEL_CHECK(readMemory.error());
+						auto [send] = co_await helix_ng::exchangeMsgs(lane1,
+								helix_ng::sendBuffer(sBuf.data(), size));
+						HEL_CHECK(send.error());
+					}
+				};
+				co_await async::when_all(
+					send(),
 					async::transform(
 						helix_ng::exchangeMsgs(lane2, helix_ng::recvBuffer(rBuf.data(), size)
 					), [&] (auto result) {
@@ -341,6 +626,88 @@ async::result<void> doSendRecvBufferBenchmark(size_t size) {
 	bench.finalizeStatistics();
 }
 
+// Keeps many small exchangeMsgs in flight on every CPU. This mostly stresses
+// the kernel heap since each exchange allocates (and frees) a handful of small objects.
+void doParallelSendRecvBufferBenchmark(int inflight) {
+	unsigned int numCpus = std::thread::hardware_concurrency();
+	std::cout << "parallel send/recv (" << numCpus << " threads, "
+			<< inflight << " in flight)" << std::endl;
+
+	IterationsPerSecondBenchmark bench;
+	std::atomic<unsigned int> barrier{0};
+	std::atomic<int> iter{-1};
+	std::atomic<bool> stop{false};
+	std::atomic<uint64_t> totalIterations{0};
+
+	auto exchange = [] (helix::BorrowedDescriptor lane1, helix::BorrowedDescriptor lane2,
+			async::wait_group &wg) -> async::result<void> {
+		char sBuf[64]{};
+		char rBuf[64];
+		co_await async::when_all(
+			async::transform(
+				helix_ng::exchangeMsgs(lane1, helix_ng::sendBuffer(sBuf, sizeof(sBuf))
+			), [&] (auto result) {
+				auto [send] = std::move(result);
+				HEL_CHECK(send.error());
+			}),
+			async::transform(
+				helix_ng::exchangeMsgs(lane2, helix_ng::recvBuffer(rBuf, sizeof(rBuf))
+			), [&] (auto result) {
+				auto [recv] = std::move(result);
+				HEL_CHECK(recv.error());
+			})
+		);
+		wg.done();
+	};
+
+	auto worker = [&](unsigned int c) -> async::result<void> {
+		auto [lane1, lane2] = helix::createStream();
+		for(int k = 0; k < 5; ++k) {
+			if (barrier.fetch_add(1, std::memory_order_acquire) + 1 == numCpus) {
+				barrier.store(0, std::memory_order_relaxed);
+				stop.store(false, std::memory_order_relaxed);
+				totalIterations.store(0, std::memory_order_relaxed);
+				iter.store(k, std::memory_order_release);
+			}
+			while(iter.load(std::memory_order_acquire) < k)
+				;
+
+			if (!c) {
+				bench.launchRepetition();
+			}
+
+			while (true) {
+				if (!c) {
+					if (bench.isRepetitionDone()) {
+						stop.store(true, std::memory_order_relaxed);
+						bench.announceIterations(totalIterations.load(std::memory_order_acquire));
+						break;
+					}
+				} else {
+					if (stop.load(std::memory_order_relaxed))
+						break;
+				}
+				async::wait_group wg{inflight};
+				for(int i = 0; i < inflight; ++i)
+					async::detach(exchange(lane1, lane2, wg));
+				co_await wg.wait();
+				totalIterations.fetch_add(inflight, std::memory_order_release);
+			}
+		}
+	};
+
+	std::vector<std::thread> threads;
+	threads.reserve(numCpus);
+	for(unsigned int c = 0; c < numCpus; ++c) {
+		threads.emplace_back([worker](unsigned int c) {
+			async::run(worker(c), helix::currentDispatcher);
+		}, c);
+	}
+	for(auto &t : threads)
+		t.join();
+	bench.finalizeStatistics();
+}
+
 void doCrossThreadSendRecvBufferBenchmark(size_t size) {
 	auto [lane1, lane2] = helix::createStream();
 
@@ -415,16 +782,269 @@ void doCrossThreadSendRecvBufferBenchmark(size_t size) {
 	bench.finalizeStatistics();
 }
 
+enum class SimdUsage {
+	none,
+	sse,
+	avx
+};
+
+const char *simdUsageName(SimdUsage usage) {
+	switch(usage) {
+		case SimdUsage::none: return "no SIMD";
+		case SimdUsage::sse: return "SSE";
+		case SimdUsage::avx: return "AVX";
+	}
+	return "?";
+}
+
+// Puts the SIMD registers out of their initial configuration,
+// such that the kernel has to save and restore them on context switches.
+void dirtySimdState(SimdUsage usage) {
+#if defined(__x86_64__)
+	if(usage == SimdUsage::sse)
+		asm volatile ("pcmpeqd %%xmm15, %%xmm15" : : : "xmm15");
+	if(usage == SimdUsage::avx)
+		asm volatile ("vpcmpeqd %%ymm15, %%ymm15, %%ymm15" : : : "xmm15");
+#else
+	(void)usage;
+#endif
+}
+
+void pinToFirstCpu() {
+	uint8_t mask = 1;
+	HEL_CHECK(helSetAffinity(kHelThisThread, &mask, 1));
+}
+
+// Ping-pong between two threads on the same CPU, i.e., every iteration
+// involves two context switches. If ipc is false, the threads use futexes.
+void doContextSwitchBenchmark(bool ipc, SimdUsage usage) {
+#if defined(__x86_64__)
+	if(usage == SimdUsage::avx && !__builtin_cpu_supports("avx"))
+		return;
+#endif
+	std::cout << "context switches (" << (ipc ? "IPC" : "futex")
+			<< ", " << simdUsageName(usage) << ")" << std::endl;
+
+	IterationsPerSecondBenchmark bench;
+
+	if(!ipc) {
+		// 0: ping's turn, 1: pong's turn, 2: stop.
+		std::atomic<int> turn{0};
+		auto futex = reinterpret_cast<int *>(&turn);
+
+		std::thread pong([&] {
+			pinToFirstCpu();
+			while(true) {
+				int t;
+				while(!(t = turn.load(std::memory_order_acquire))) {
+					auto error = helFutexWait(futex, 0, -1);
+					if(error != kHelErrCancelled)
+						HEL_CHECK(error);
+				}
+				if(t == 2)
+					break;
+				dirtySimdState(usage);
+				turn.store(0, std::memory_order_release);
+				HEL_CHECK(helFutexWake(futex, 1));
+			}
+		});
+
+		std::thread ping([&] {
+			pinToFirstCpu();
+			for(int k = 0; k < 5; ++k) {
+				uint64_t n = 0;
+				bench.launchRepetition();
+				while(!bench.isRepetitionDone()) {
+					for(int i = 0; i < 100; ++i) {
+						dirtySimdState(usage);
+						turn.store(1, std::memory_order_release);
+						HEL_CHECK(helFutexWake(futex, 1));
+						while(turn.load(std::memory_order_acquire) == 1) {
+							auto error = helFutexWait(futex, 1, -1);
+							if(error != kHelErrCancelled)
+								HEL_CHECK(error);
+						}
+						++n;
+					}
+				}
+				bench.announceIterations(n);
+			}
+			turn.store(2, std::memory_order_release);
+			HEL_CHECK(helFutexWake(futex, 1));
+		});
+
+		ping.join();
+		pong.join();
+	}else{
+		auto [lane1, lane2] = helix::createStream();
+
+		// The first byte of each message tells pong whether to continue.
+		std::thread pong([&, lane = std::move(lane2)] () mutable {
+			pinToFirstCpu();
+			async::run([&] () -> async::result<void> {
+				while(true) {
+					char buf;
+					auto [recv] = co_await helix_ng::exchangeMsgs(lane,
+							helix_ng::recvBuffer(&buf, 1));
+					HEL_CHECK(recv.error());
+					if(!buf)
+						break;
+					dirtySimdState(usage);
+					auto [send] = co_await helix_ng::exchangeMsgs(lane,
+							helix_ng::sendBuffer(&buf, 1));
+					HEL_CHECK(send.error());
+				}
+			}(), helix::currentDispatcher);
+		});
+
+		std::thread ping([&, lane = std::move(lane1)] () mutable {
+			pinToFirstCpu();
+			async::run([&] () -> async::result<void> {
+				char buf = 1;
+				for(int k = 0; k < 5; ++k) {
+					uint64_t n = 0;
+					bench.launchRepetition();
+					while(!bench.isRepetitionDone()) {
+						for(int i = 0; i < 100; ++i) {
+							dirtySimdState(usage);
+							auto [send] = co_await helix_ng::exchangeMsgs(lane,
+									helix_ng::sendBuffer(&buf, 1));
+							HEL_CHECK(send.error());
+							auto [recv] = co_await helix_ng::exchangeMsgs(lane,
+									helix_ng::recvBuffer(&buf, 1));
+							HEL_CHECK(recv.error());
+							++n;
+						}
+					}
+					bench.announceIterations(n);
+				}
+
+				char stop = 0;
+				auto [send] = co_await helix_ng::exchangeMsgs(lane,
+						helix_ng::sendBuffer(&stop, 1));
+				HEL_CHECK(send.error());
+			}(), helix::currentDispatcher);
+		});
+
+		ping.join();
+		pong.join();
+	}
+	bench.finalizeStatistics();
+}
+
+// Measures the time from a futex wake until the woken thread runs.
+// The system is loaded by CPU hogs on half of the CPUs and by threads that alternate
+// between computing and sleeping on the other half.
+void doWakeupLatencyBenchmark() {
+	unsigned int numCpus = std::thread::hardware_concurrency();
+	std::cout << "wakeup latency (mixed load, " << numCpus << " CPUs)" << std::endl;
+
+	std::atomic<bool> stop{false};
+	std::vector<std::thread> background;
+	for(unsigned int c = 0; c < numCpus; ++c) {
+		background.emplace_back([&, c] {
+			while(!stop.load(std::memory_order_relaxed)) {
+				if(c % 2) {
+					// Compute for 1 ms, then sleep for 1 ms.
+					auto ref = getClock();
+					while(getClock() - ref < 1'000'000)
+						;
+					sleepFor(1'000'000);
+				}
+			}
+		});
+	}
+
+	constexpr int numWakeups = 10'000;
+	LatencyHistogram histogram;
+	std::atomic<int> seq{0};
+	std::atomic<int> ack{0};
+	std::atomic<uint64_t> wakeTime{0};
+
+	std::thread waiter([&] {
+		for(int i = 1; i <= numWakeups; ++i) {
+			ack.store(i - 1, std::memory_order_release);
+			while(seq.load(std::memory_order_acquire) < i) {
+				auto error = helFutexWait(reinterpret_cast<int *>(&seq), i - 1, -1);
+				if(error != kHelErrCancelled)
+					HEL_CHECK(error);
+			}
+			histogram.record(getClock() - wakeTime.load(std::memory_order_relaxed));
+		}
+	});
+
+	for(int i = 1; i <= numWakeups; ++i) {
+		// Wait until the waiter is (likely) blocked.
+		while(ack.load(std::memory_order_acquire) < i - 1)
+			sleepFor(10'000);
+		sleepFor(100'000);
+
+		wakeTime.store(getClock(), std::memory_order_relaxed);
+		seq.store(i, std::memory_order_release);
+		HEL_CHECK(helFutexWake(reinterpret_cast<int *>(&seq), 1));
+	}
+
+	waiter.join();
+	stop.store(true, std::memory_order_relaxed);
+	for(auto &t : background)
+		t.join();
+	histogram.print();
+}
+
+// Similar to cyclictest: measures how late a periodic thread wakes up
+// while all CPUs are busy with CPU hogs. This is done for each scheduling policy.
+void doCyclicLatencyBenchmark(const char *name, HelSchedulingParameters params) {
+	unsigned int numCpus = std::thread::hardware_concurrency();
+	std::cout << "cyclic latency (" << name << ", " << numCpus << " CPU hogs)" << std::endl;
+
+	std::atomic<bool> stop{false};
+	std::vector<std::thread> hogs;
+	for(unsigned int c = 0; c < numCpus; ++c) {
+		hogs.emplace_back([&] {
+			while(!stop.load(std::memory_order_relaxed))
+				;
+		});
+	}
+
+	constexpr int numCycles = 5'000;
+	constexpr uint64_t interval = 1'000'000;
+	LatencyHistogram histogram;
+
+	std::thread measure([&] {
+		HEL_CHECK(helSetSchedulingParameters(kHelThisThread, &params));
+
+		auto next = getClock() + interval;
+		for(int i = 0; i < numCycles; ++i) {
+			sleepUntil(next);
+			histogram.record(getClock() - next);
+			next += interval;
+		}
+
+		HelSchedulingParameters fairParams{};
+		fairParams.policy = kHelSchedulingFair;
+		HEL_CHECK(helSetSchedulingParameters(kHelThisThread, &fairParams));
+	});
+
+	measure.join();
+	stop.store(true, std::memory_order_relaxed);
+	for(auto &t : hogs)
+		t.join();
+	histogram.print();
+}
+
 } // anonymous namespace
 
 int main() {
 	doNopBenchmark();
 	doFutexBenchmark();
+	async::run(doSqFutexBenchmark(), helix::currentDispatcher);
 	async::run(doAsyncNopBenchmark(), helix::currentDispatcher);
 	async::run(doMultiSubmitAsyncNopBenchmark(), helix::currentDispatcher);
 	doParallelAsyncNopBenchmark();
 	doAllocateBenchmark(1 << 20);
 	doMapBenchmark(1 << 20);
+	async::run(doSqMapBenchmark(1 << 20, 1), helix::currentDispatcher);
+	async::run(doSqMapBenchmark(1 << 20, 8), helix::currentDispatcher);
 	doMapPopulatedBenchmark(1 << 20);
 	doPageFaultBenchmark(1 << 20);
 	async::run(doSendRecvBufferBenchmark(1), helix::currentDispatcher);
@@ -432,9 +1052,35 @@ int main() {
 	async::run(doSendRecvBufferBenchmark(16 * 1024), helix::currentDispatcher);
 	async::run(doSendRecvBufferBenchmark(64 * 1024), helix::currentDispatcher);
 	async::run(doSendRecvBufferBenchmark(1024 * 1024), helix::currentDispatcher);
+	async::run(doSendRecvBufferBenchmark(4 * 1024 * 1024), helix::currentDispatcher);
+	async::run(doSendRecvBufferBenchmark(64 * 1024, 1), helix::currentDispatcher);
+	async::run(doSendRecvBufferBenchmark(1024 * 1024, 1), helix::currentDispatcher);
+	async::run(doSendBufferSgBenchmark(1024 * 1024, 4), helix::currentDispatcher);
+	async::run(doSendBufferSgBenchmark(1024 * 1024, 4, 1), helix::currentDispatcher);
+	async::run(doSendRecvBufferBenchmark(4 * 1024 * 1024, 1), helix::currentDispatcher);
+	for(size_t size : {4096, 64 * 1024, 1024 * 1024}) {
+		async::run(doSendFromMemoryBenchmark(size, false), helix::currentDispatcher);
+		async::run(doSendFromMemoryBenchmark(size, true), helix::currentDispatcher);
+	}
+	doParallelSendRecvBufferBenchmark(1);
+	doParallelSendRecvBufferBenchmark(32);
 	doCrossThreadSendRecvBufferBenchmark(1);
 	doCrossThreadSendRecvBufferBenchmark(4096);
 	doCrossThreadSendRecvBufferBenchmark(16 * 1024);
 	doCrossThreadSendRecvBufferBenchmark(64 * 1024);
 	doCrossThreadSendRecvBufferBenchmark(1024 * 1024);
+	for(auto usage : {SimdUsage::none, SimdUsage::sse, SimdUsage::avx}) {
+		doContextSwitchBenchmark(false, usage);
+		doContextSwitchBenchmark(true, usage);
+	}
+	doWakeupLatencyBenchmark();
+
+	doCyclicLatencyBenchmark("fair", {.policy = kHelSchedulingFair});
+	doCyclicLatencyBenchmark("fifo", {.policy = kHelSchedulingFifo, .priority = 90});
+	doCyclicLatencyBenchmark("deadline", {
+		.policy = kHelSchedulingDeadline,
+		.runtime = 100'000,
+		.deadline = 500'000,
+		.period = 1'000'000
+	});
 }
@@ -3,6 +3,7 @@
 #include <cstddef>
 #include <cstdint>
 #include <cstdio>
+#include <cstring>
 #include <chrono>
 #include <thread>
 #include <vector>
@@ -23,13 +24,14 @@ struct SwapDaemonState {
 	std::vector<uint8_t> disk;
 	std::atomic<size_t> pagesWrittenBack{0};
 	std::atomic<size_t> pagesInitialized{0};
+	std::atomic<size_t> pagesDiscarded{0};
 	std::atomic<bool> stop{false};
 	std::atomic<bool> finished{false};
 };
 
 // Emulates the swap daemon, serves a single manage request. Services
 // initialize requests by reading from the disk buffer and writeback
-// requests by writing to it.
+// requests by writing to it. Discard requests clear the disk buffer.
 async::result<void> serveOnce(helix::BorrowedDescriptor backing, SwapDaemonState *state) {
 	helix::ManageMemory manage;
 	auto submit = helix::submitManageMemory(backing, &manage,
@@ -49,6 +51,12 @@ async::result<void> serveOnce(helix::BorrowedDescriptor backing, SwapDaemonState
 				manage.offset(), manage.length()));
 		state->pagesInitialized.fetch_add(manage.length() / pageSize,
 				std::memory_order_relaxed);
+	}else if(manage.type() == kHelManageDiscard) {
+		memset(state->disk.data() + manage.offset(), 0, manage.length());
+		HEL_CHECK(helUpdateMemory(backing.getHandle(), kHelManageDiscard,
+				manage.offset(), manage.length()));
+		state->pagesDiscarded.fetch_add(manage.length() / pageSize,
+				std::memory_order_relaxed);
 	}else{
 		assert(manage.type() == kHelManageWriteback);
 		auto result = co_await helix_ng::readMemory(backing, manage.offset(),
@@ -212,6 +220,55 @@ HelHandle backingHandle, swapHandle;
 	}
 }
 
+// Checks that freeing swappable memory discards its swapped-out pages
+// and that the swap budget is released once the discards are acknowledged.
+async::result<void> testSwapDiscard() {
+	HelHandle backingHandle, swapHandle;
+	HEL_CHECK(helCreateSwapSpace(0, &backingHandle, &swapHandle));
+	helix::UniqueDescriptor backing{backingHandle};
+	helix::UniqueDescriptor swapSpace{swapHandle};
+
+	// The budget only covers a single view.
+	HEL_CHECK(helSetSwapBudget(swapSpace.getHandle(), viewPages));
+
+	SwapDaemonState state;
+	state.disk.resize(swapPages * pageSize);
+
+	auto writeOut = [&] (uint32_t salt) -> async::result<helix::UniqueDescriptor> {
+		HelHandle memoryHandle;
+		HEL_CHECK(helAllocateSwappableMemory(swapSpace.getHandle(),
+				viewPages * pageSize, 0, &memoryHandle));
+		helix::UniqueDescriptor memory{memoryHandle};
+
+		void *window;
+		HEL_CHECK(helMapMemory(memory.getHandle(), kHelNullHandle, nullptr,
+				0, viewPages * pageSize, kHelMapProtRead | kHelMapProtWrite, &window));
+		for(size_t pg = 0; pg < viewPages; pg++)
+			fillPattern(reinterpret_cast<uint8_t *>(window) + pg * pageSize, pg, salt);
+		HEL_CHECK(helUnmapMemory(kHelNullHandle, window, viewPages * pageSize));
+
+		auto target = state.pagesWrittenBack.load(std::memory_order_relaxed) + viewPages;
+		while(state.pagesWrittenBack.load(std::memory_order_relaxed) < target)
+			co_await serveOnce(backing, &state);
+		co_return memory;
+	};
+
+	auto memory = co_await writeOut(0);
+
+	// Dropping the memory discards all of its pages.
+	memory = helix::UniqueDescriptor{};
+	while(state.pagesDiscarded.load(std::memory_order_relaxed) < viewPages)
+		co_await serveOnce(backing, &state);
+	assert(state.pagesDiscarded.load(std::memory_order_relaxed) == viewPages);
+
+	// This only completes if the acknowledged discards released the budget.
+	memory = co_await writeOut(1);
+
+	printf("kernel-tests: swapDiscard: %zu pages swapped out, %zu pages discarded\n",
+			state.pagesWrittenBack.load(std::memory_order_relaxed),
+			state.pagesDiscarded.load(std::memory_order_relaxed));
+}
+
 } // anonymous namespace
 
 DEFINE_TEST(swapRoundtrip, ([] {
@@ -221,3 +278,7 @@ DEFINE_TEST(swapRoundtrip, ([] {
 DEFINE_TEST(swapFaultIn, ([] {
 	testSwapFaultIn();
 }))
+
+DEFINE_TEST(swapDiscard, ([] {
+	async::run(testSwapDiscard(), helix::currentDispatcher);
+}))
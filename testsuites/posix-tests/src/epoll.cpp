@@ -1,11 +1,21 @@
 #include <cassert>
+#include <climits>
 #include <cstring>
 #include <errno.h>
+#include <iostream>
 #include <time.h>
 #include <unistd.h>
 #include <sys/epoll.h>
 #include <sys/eventfd.h>
+#include <sys/resource.h>
 #include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <vector>
+
+#if defined(__managarm__)
+#include "posix-lane.hpp"
+#endif
 
 #include "testsuite.hpp"
 
@@ -166,3 +176,340 @@ DEFINE_TEST(pselect_no_fd_wait, ([] {
 
 	return 0;
 }))
+
+#if defined(__managarm__)
+// The C library does not consume the shared event ring of epoll instances yet.
+// Map it by hand and consume it as described next to posix::EpollRing.
+
+namespace {
+
+struct MappedEpollRing {
+	posix::EpollRing *ring;
+	posix::EpollRingEntry *entries;
+};
+
+MappedEpollRing map_epoll_ring(int epfd) {
+	managarm::posix::EpollRingRequest req;
+	req.set_fd(epfd);
+	auto resp = posix_request<managarm::posix::EpollRingResponse>(req);
+	assert(resp.error() == managarm::posix::Errors::SUCCESS);
+
+	auto ring = static_cast<posix::EpollRing *>(map_posix_memory(resp.memory_handle(), resp.size()));
+	assert(ring->numEntries);
+	assert(sizeof(posix::EpollRing) + ring->numEntries * sizeof(posix::EpollRingEntry) <= resp.size());
+	return {ring, posix::epollRingEntries(ring)};
+}
+
+bool ring_has_events(const MappedEpollRing &m) {
+	return __atomic_load_n(&m.ring->head, __ATOMIC_ACQUIRE)
+			!= __atomic_load_n(&m.ring->tail, __ATOMIC_ACQUIRE);
+}
+
+// Waits until the ring holds events that were not consumed yet.
+bool wait_for_ring(const MappedEpollRing &m, int timeout_ms = 1000) {
+	auto deadline = deadline_in_ms(timeout_ms);
+	while(true) {
+		auto seq = __atomic_load_n(&m.ring->wakeSeq, __ATOMIC_ACQUIRE);
+		if(ring_has_events(m))
+			return true;
+		if(__atomic_load_n(&m.ring->closed, __ATOMIC_ACQUIRE))
+			return false;
+
+		__atomic_store_n(&m.ring->consumerWaiting, 1, __ATOMIC_SEQ_CST);
+		if(ring_has_events(m))
+			continue;
+		auto e = helFutexWait(reinterpret_cast<int *>(&m.ring->wakeSeq), seq, deadline);
+		if(e == kHelErrTimeout)
+			return false;
+		HEL_CHECK(e);
+	}
+}
+
+// Returns the entries that are published but not consumed yet, including scrubbed ones.
+std::vector<posix::EpollRingEntry> peek_ring(const MappedEpollRing &m) {
+	std::vector<posix::EpollRingEntry> out;
+	auto head = __atomic_load_n(&m.ring->head, __ATOMIC_ACQUIRE);
+	for(auto i = __atomic_load_n(&m.ring->tail, __ATOMIC_ACQUIRE); i != head; i++)
+		out.push_back(m.entries[i % m.ring->numEntries]);
+	return out;
+}
+
+// Consumes all published entries and returns those that were not scrubbed.
+std::vector<posix::EpollRingEntry> consume_ring(const MappedEpollRing &m) {
+	while(true) {
+		auto tail = __atomic_load_n(&m.ring->tail, __ATOMIC_ACQUIRE);
+		auto head = __atomic_load_n(&m.ring->head, __ATOMIC_ACQUIRE);
+		std::vector<posix::EpollRingEntry> out;
+		for(auto i = tail; i != head; i++) {
+			auto entry = m.entries[i % m.ring->numEntries];
+			if(entry.events)
+				out.push_back(entry);
+		}
+		if(!__atomic_compare_exchange_n(&m.ring->tail, &tail, head,
+				false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST))
+			continue;
+		if(__atomic_exchange_n(&m.ring->producerWaiting, 0, __ATOMIC_SEQ_CST))
+			HEL_CHECK(helFutexWake(reinterpret_cast<int *>(&m.ring->tail), UINT_MAX));
+		return out;
+	}
+}
+
+bool contains_data(const std::vector<posix::EpollRingEntry> &entries, uint64_t data) {
+	for(auto &entry : entries) {
+		if(entry.data == data)
+			return true;
+	}
+	return false;
+}
+
+} // namespace
+
+DEFINE_TEST(epoll_ring, ([] {
+	int level = eventfd(0, 0);
+	int edge = eventfd(0, 0);
+	assert(level >= 0 && edge >= 0);
+	int epfd = epoll_create1(0);
+	assert(epfd >= 0);
+
+	auto add = [&] (int op, int fd, uint32_t events, uint64_t data) {
+		epoll_event evt;
+		memset(&evt, 0, sizeof(epoll_event));
+		evt.events = events;
+		evt.data.u64 = data;
+		assert(!epoll_ctl(epfd, op, fd, &evt));
+	};
+	add(EPOLL_CTL_ADD, level, EPOLLIN, 1);
+	add(EPOLL_CTL_ADD, edge, EPOLLIN | EPOLLET, 2);
+
+	auto m = map_epoll_ring(epfd);
+	assert(!__atomic_load_n(&m.ring->closed, __ATOMIC_ACQUIRE));
+
+	// Nothing is readable yet.
+	assert(!wait_for_ring(m, 100));
+
+	uint64_t value = 1;
+	assert(write(level, &value, sizeof(value)) == sizeof(value));
+	assert(write(edge, &value, sizeof(value)) == sizeof(value));
+
+	// Both events arrive, but possibly in separate batches.
+	std::vector<posix::EpollRingEntry> seen;
+	while(!contains_data(seen, 1) || !contains_data(seen, 2)) {
+		assert(wait_for_ring(m));
+		for(auto &entry : consume_ring(m)) {
+			assert(entry.events == EPOLLIN);
+			assert(entry.data == 1 || entry.data == 2);
+			seen.push_back(entry);
+		}
+	}
+
+	// The level-triggered item is published again once the ring is drained;
+	// the edge-triggered one is not (there is no new edge).
+	for(int i = 0; i < 3; i++) {
+		assert(wait_for_ring(m));
+		auto batch = consume_ring(m);
+		assert(contains_data(batch, 1));
+		assert(!contains_data(batch, 2));
+	}
+
+	// Wait until the level-triggered item is published (but not consumed) again.
+	// EPOLL_CTL_MOD must scrub the entry that still carries the old data.
+	assert(wait_for_ring(m));
+	assert(contains_data(peek_ring(m), 1));
+	add(EPOLL_CTL_MOD, level, EPOLLIN, 3);
+	for(auto &entry : peek_ring(m))
+		assert(entry.data != 1 || !entry.events);
+	auto batch = consume_ring(m);
+	assert(!contains_data(batch, 1));
+	assert(wait_for_ring(m));
+	batch = consume_ring(m);
+	assert(contains_data(batch, 3));
+	assert(!contains_data(batch, 1));
+
+	// Likewise, EPOLL_CTL_DEL scrubs published entries and stops further events.
+	assert(wait_for_ring(m));
+	assert(contains_data(peek_ring(m), 3));
+	assert(!epoll_ctl(epfd, EPOLL_CTL_DEL, level, nullptr));
+	assert(consume_ring(m).empty());
+	assert(!wait_for_ring(m, 100));
+
+	// epoll_wait() takes events from the ring as well.
+	assert(write(edge, &value, sizeof(value)) == sizeof(value));
+	assert(wait_for_ring(m));
+	epoll_event events[4];
+	int n = epoll_wait(epfd, events, 4, 1000);
+	assert(n == 1);
+	assert(events[0].events == EPOLLIN);
+	assert(events[0].data.u64 == 2);
+	assert(!ring_has_events(m));
+	assert(epoll_wait(epfd, events, 4, 0) == 0);
+
+	// Events that are published while epoll_wait() blocks wake it up.
+	int pid = fork();
+	assert(pid >= 0);
+	if(!pid) {
+		usleep(100'000);
+		assert(write(edge, &value, sizeof(value)) == sizeof(value));
+		_exit(0);
+	}
+	n = epoll_wait(epfd, events, 4, 5000);
+	assert(n == 1);
+	assert(events[0].data.u64 == 2);
+	int status;
+	assert(waitpid(pid, &status, 0) == pid);
+	assert(WIFEXITED(status) && !WEXITSTATUS(status));
+
+	// Closing the epoll instance marks the ring as closed; the mapping stays valid.
+	close(epfd);
+	assert(!wait_for_ring(m, 5000));
+	assert(__atomic_load_n(&m.ring->closed, __ATOMIC_ACQUIRE));
+
+	close(level);
+	close(edge);
+}))
+#endif
+
+// Reports the rate at which epoll_wait() delivers events from thousands of sockets,
+// both for level-triggered sockets that stay readable and for a rotating set of
+// sockets that become readable between calls.
+DEFINE_BENCHMARK(bench_epoll_event_rate, ([] {
+	constexpr size_t maxPairs = 2048;
+	constexpr int rounds = 2000;
+	constexpr int maxEvents = 64;
+
+	// Each pair needs two file descriptors; raise the soft limit as far as we can.
+	struct rlimit limit;
+	if(!getrlimit(RLIMIT_NOFILE, &limit) && limit.rlim_cur < limit.rlim_max) {
+		limit.rlim_cur = limit.rlim_max;
+		setrlimit(RLIMIT_NOFILE, &limit);
+	}
+
+	// Stop early if we run out of file descriptors.
+	std::vector<std::pair<int, int>> pairs;
+	bool outOfFds = false;
+	while(pairs.size() < maxPairs) {
+		int sp[2];
+		if(socketpair(AF_UNIX, SOCK_STREAM, 0, sp)) {
+			assert(errno == EMFILE || errno == ENFILE);
+			outOfFds = true;
+			break;
+		}
+		pairs.push_back({sp[0], sp[1]});
+	}
+	// Leave room for the epoll instances.
+	if(outOfFds) {
+		for(int i = 0; i < 2; i++) {
+			assert(pairs.size() >= 2);
+			close(pairs.back().first);
+			close(pairs.back().second);
+			pairs.pop_back();
+		}
+	}
+
+	// The rates below depend on the number of watched sockets, so say how many we got.
+	std::cout << "posix-tests: bench_epoll_event_rate watches " << pairs.size()
+			<< " sockets (" << maxPairs << " requested";
+	if(outOfFds)
+		std::cout << ", limited by the number of file descriptors";
+	std::cout << ")" << std::endl;
+
+	int epfd = epoll_create1(0);
+	assert(epfd >= 0);
+	for(size_t i = 0; i < pairs.size(); i++) {
+		epoll_event evt;
+		memset(&evt, 0, sizeof(epoll_event));
+		evt.events = EPOLLIN;
+		evt.data.u64 = i;
+		assert(!epoll_ctl(epfd, EPOLL_CTL_ADD, pairs[i].first, &evt));
+	}
+
+	auto report = [&] (const char *what, size_t events, uint64_t elapsed) {
+		std::cout << "posix-tests: " << what << " with " << pairs.size()
+				<< " sockets: " << (events * 1'000'000'000ULL / (elapsed ? elapsed : 1))
+				<< " events/s" << std::endl;
+	};
+
+	// Level-triggered sockets that stay readable.
+	for(size_t i = 0; i < maxEvents && i < pairs.size(); i++)
+		assert(write(pairs[i].second, "x", 1) == 1);
+	size_t total = 0;
+	auto start = nanos_now();
+	for(int r = 0; r < rounds; r++) {
+		epoll_event events[maxEvents];
+		int n = epoll_wait(epfd, events, maxEvents, 0);
+		assert(n > 0);
+		total += n;
+	}
+	report("epoll_wait() level-triggered", total, nanos_now() - start);
+
+	char c;
+	for(size_t i = 0; i < maxEvents && i < pairs.size(); i++)
+		assert(read(pairs[i].first, &c, 1) == 1);
+
+	// Each round, a different batch of sockets becomes readable.
+	total = 0;
+	size_t next = 0;
+	start = nanos_now();
+	for(int r = 0; r < rounds; r++) {
+		size_t batch = std::min(static_cast<size_t>(maxEvents), pairs.size());
+		for(size_t i = 0; i < batch; i++)
+			assert(write(pairs[(next + i) % pairs.size()].second, "x", 1) == 1);
+
+		size_t seen = 0;
+		while(seen < batch) {
+			epoll_event events[maxEvents];
+			int n = epoll_wait(epfd, events, maxEvents, -1);
+			assert(n > 0);
+			for(int i = 0; i < n; i++)
+				assert(read(pairs[events[i].data.u64].first, &c, 1) == 1);
+			seen += n;
+		}
+		assert(seen == batch);
+		total += seen;
+		next += batch;
+	}
+	report("epoll_wait() rotating", total, nanos_now() - start);
+
+#if defined(__managarm__)
+	// The same rotating pattern, but consuming the shared event ring without requests.
+	int ringfd = epoll_create1(0);
+	assert(ringfd >= 0);
+	for(size_t i = 0; i < pairs.size(); i++) {
+		epoll_event evt;
+		memset(&evt, 0, sizeof(epoll_event));
+		evt.events = EPOLLIN;
+		evt.data.u64 = i;
+		assert(!epoll_ctl(ringfd, EPOLL_CTL_ADD, pairs[i].first, &evt));
+	}
+	auto m = map_epoll_ring(ringfd);
+
+	total = 0;
+	next = 0;
+	start = nanos_now();
+	for(int r = 0; r < rounds; r++) {
+		size_t batch = std::min(static_cast<size_t>(maxEvents), pairs.size());
+		for(size_t i = 0; i < batch; i++)
+			assert(write(pairs[(next + i) % pairs.size()].second, "x", 1) == 1);
+
+		size_t seen = 0;
+		while(seen < batch) {
+			assert(wait_for_ring(m));
+			for(auto &entry : consume_ring(m)) {
+				assert(read(pairs[entry.data].first, &c, 1) == 1);
+				seen++;
+			}
+		}
+		assert(seen == batch);
+		total += seen;
+		next += batch;
+	}
+	report("event ring rotating", total, nanos_now() - start);
+
+	close(ringfd);
+#endif
+
+	close(epfd);
+	for(auto [a, b] : pairs) {
+		close(a);
+		close(b);
+	}
+}))
@@ -0,0 +1,82 @@
+#include <cassert>
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/close_range.h>
+#include <unistd.h>
+#include <vector>
+
+#include "testsuite.hpp"
+
+namespace {
+
+constexpr int numFds = 300;
+
+// Returns numFds consecutive descriptors (assuming that no other thread opens files).
+std::vector<int> openMany() {
+	std::vector<int> fds;
+	int fd = open("/dev/null", O_RDONLY);
+	assert(fd >= 0);
+	fds.push_back(fd);
+	for(int i = 1; i < numFds; i++) {
+		int dupFd = dup(fd);
+		assert(dupFd >= 0);
+		fds.push_back(dupFd);
+	}
+	return fds;
+}
+
+bool isOpen(int fd) {
+	if(fcntl(fd, F_GETFD) >= 0)
+		return true;
+	assert(errno == EBADF);
+	return false;
+}
+
+} // anonymous namespace
+
+DEFINE_TEST(fd_lowest_free, ([] {
+	auto fds = openMany();
+	int a = fds[10];
+	int b = fds[200];
+	close(b);
+	close(a);
+
+	// dup() and F_DUPFD return the lowest free descriptor.
+	int fd = dup(fds[0]);
+	assert(fd == a);
+	fd = fcntl(fds[0], F_DUPFD, a + 1);
+	assert(fd == b);
+
+	// dup2() replaces an open descriptor.
+	assert(dup2(fds[1], fds[2]) == fds[2]);
+	assert(isOpen(fds[2]));
+
+	for(auto fd : fds)
+		close(fd);
+}))
+
+DEFINE_TEST(close_range, ([] {
+	auto fds = openMany();
+
+	// The C library may not implement close_range() yet.
+	if(close_range(fds[100], fds[199], 0) == -1) {
+		assert(errno == ENOSYS || errno == EINVAL);
+		for(auto fd : fds)
+			close(fd);
+		skip_test("close_range() unsupported");
+	}
+	for(int i = 0; i < numFds; i++)
+		assert(isOpen(fds[i]) == (i < 100 || i >= 200));
+
+	assert(close_range(fds[0], fds[9], CLOSE_RANGE_CLOEXEC) == 0);
+	for(int i = 0; i < 20; i++)
+		assert(fcntl(fds[i], F_GETFD) == (i < 10 ? FD_CLOEXEC : 0));
+
+	assert(close_range(fds[1], fds[0], 0) == -1);
+	assert(errno == EINVAL);
+
+	// The range may extend beyond the largest open descriptor.
+	assert(close_range(fds[0], ~0U, 0) == 0);
+	for(auto fd : fds)
+		assert(!isOpen(fd));
+}))
@@ -0,0 +1,289 @@
+#include <cassert>
+#include <dirent.h>
+#include <fcntl.h>
+#include <optional>
+#include <set>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+#include <frg/scope_exit.hpp>
+
+#if defined(__managarm__)
+#include <async/result.hpp>
+#include <helix/ipc.hpp>
+#include <helix/passthrough-fd.hpp>
+#include <protocols/fs/client.hpp>
+#include <protocols/fs/server.hpp>
+#include "fs.bragi.hpp"
+#endif
+
+#include "testsuite.hpp"
+
+namespace {
+
+// Enough entries such that a directory listing needs several batches.
+constexpr int numEntries = 1000;
+
+// Use names of different lengths to vary the record sizes.
+std::string entryName(int i) {
+	return "entry-" + std::string(i % 37, 'x') + std::to_string(i);
+}
+
+void check_listing(std::string tmpl) {
+	std::string dir(tmpl);
+	if(!mkdtemp(dir.data()))
+		assert(!"mkdtemp() failed");
+
+	std::set<std::string> expected;
+	for(int i = 0; i < numEntries; i++) {
+		auto name = entryName(i);
+		int fd = creat((dir + "/" + name).c_str(), 0644);
+		assert(fd >= 0);
+		close(fd);
+		expected.insert(name);
+	}
+	frg::scope_exit cleanup{[&] {
+		for(auto &name : expected)
+			unlink((dir + "/" + name).c_str());
+		rmdir(dir.c_str());
+	}};
+
+	DIR *d = opendir(dir.c_str());
+	assert(d);
+
+	std::set<std::string> seen;
+	bool seenDot = false;
+	bool seenDotDot = false;
+	struct dirent *ent;
+	while((ent = readdir(d))) {
+		std::string name{ent->d_name};
+		if(name == ".") {
+			assert(!seenDot);
+			seenDot = true;
+			continue;
+		}
+		if(name == "..") {
+			assert(!seenDotDot);
+			seenDotDot = true;
+			continue;
+		}
+		// Every entry must be returned exactly once.
+		assert(expected.contains(name));
+		assert(!seen.contains(name));
+		seen.insert(name);
+	}
+	closedir(d);
+
+	assert(seenDot && seenDotDot);
+	assert(seen == expected);
+}
+
+} // namespace
+
+DEFINE_TEST(getdents_tmpfs, ([] {
+	check_listing("/tmp/posix-tests-getdents-XXXXXX");
+}))
+
+#if defined(__managarm__)
+// The root file system is ext2 on Managarm.
+DEFINE_TEST(getdents_ext2, ([] {
+	check_listing("/posix-tests-getdents-XXXXXX");
+}))
+#endif
+
+#if defined(__managarm__)
+// The C library still lists directories with the single-entry ReadEntriesRequest.
+// Exercise ReadEntriesBatchRequest directly against a directory served by protocols/fs.
+
+namespace {
+
+// A record of a ReadEntriesBatchResponse (laid out like struct linux_dirent64).
+struct BatchRecord {
+	uint64_t inode;
+	int64_t offset;
+	uint8_t type;
+	std::string name;
+};
+
+std::vector<BatchRecord> parseBatch(const char *data, size_t size) {
+	std::vector<BatchRecord> records;
+	size_t position = 0;
+	while(position < size) {
+		auto record = data + position;
+		BatchRecord parsed;
+		uint16_t length;
+		memcpy(&parsed.inode, record, sizeof(uint64_t));
+		memcpy(&parsed.offset, record + 8, sizeof(int64_t));
+		memcpy(&length, record + 16, sizeof(uint16_t));
+		memcpy(&parsed.type, record + 18, sizeof(uint8_t));
+		assert(length && !(length % 8) && position + length <= size);
+		parsed.name = std::string{record + 19};
+		records.push_back(std::move(parsed));
+		position += length;
+	}
+	return records;
+}
+
+struct FakeDirectory {
+	int next = 0;
+	std::optional<protocols::fs::ReadEntriesResult> pending;
+};
+
+async::result<std::expected<protocols::fs::ReadEntriesResult, managarm::fs::Errors>>
+fakeReadEntry(FakeDirectory *dir) {
+	if(dir->next == numEntries)
+		co_return std::unexpected{managarm::fs::Errors::END_OF_FILE};
+	auto i = dir->next++;
+	co_return protocols::fs::ReadEntriesResult{entryName(i), static_cast<ino_t>(1000 + i),
+			i + 1, managarm::fs::FileType::REGULAR};
+}
+
+async::result<std::expected<void, managarm::fs::Errors>>
+fakeReadEntriesBatch(void *object, protocols::fs::DirentBuffer &buffer) {
+	auto dir = static_cast<FakeDirectory *>(object);
+	return protocols::fs::fillDirentBuffer(buffer, dir->pending, [dir] {
+		return fakeReadEntry(dir);
+	});
+}
+
+constexpr protocols::fs::FileOperations fakeDirectoryOperations{
+	.readEntriesBatch = &fakeReadEntriesBatch,
+};
+
+async::result<void> checkBatchProtocol() {
+	HelHandle serverHandle, clientHandle;
+	HEL_CHECK(helCreateStream(&serverHandle, &clientHandle, 1));
+
+	async::cancellation_event cancelServe;
+	async::detach(protocols::fs::servePassthrough(helix::UniqueLane{serverHandle},
+			smarter::make_shared<FakeDirectory>(), &fakeDirectoryOperations, cancelServe));
+	protocols::fs::File file{helix::UniqueDescriptor{clientHandle}};
+
+	// Not even the first entry fits; it must be returned by the next request.
+	std::vector<char> buffer(16);
+	auto tooSmall = co_await file.readEntriesBatch(buffer.data(), buffer.size());
+	assert(!tooSmall && tooSmall.error() == protocols::fs::Error::illegalArguments);
+
+	// Small batches such that entries frequently do not fit and have to be resumed.
+	buffer.resize(512);
+	int index = 0;
+	int numBatches = 0;
+	while(true) {
+		auto size = co_await file.readEntriesBatch(buffer.data(), buffer.size());
+		assert(size);
+		if(!*size)
+			break;
+		numBatches++;
+
+		for(auto &record : parseBatch(buffer.data(), *size)) {
+			// Entries must be returned in order, exactly once.
+			assert(record.name == entryName(index));
+			assert(record.inode == static_cast<uint64_t>(1000 + index));
+			assert(record.offset == index + 1);
+			assert(record.type == DT_REG);
+			index++;
+		}
+	}
+	assert(index == numEntries);
+	assert(numBatches > 1);
+
+	// Further requests keep reporting the end of the directory.
+	auto atEnd = co_await file.readEntriesBatch(buffer.data(), buffer.size());
+	assert(atEnd && !*atEnd);
+
+	cancelServe.cancel();
+}
+
+// Sends ReadEntriesBatchRequest to a directory on ext2 (the root file system).
+// The passthrough lane of such a directory is served by the ext2 server itself.
+async::result<void> checkBatchExt2() {
+	std::string dir{"/posix-tests-getdents-XXXXXX"};
+	if(!mkdtemp(dir.data()))
+		assert(!"mkdtemp() failed");
+
+	std::set<std::string> expected;
+	for(int i = 0; i < numEntries; i++) {
+		auto name = entryName(i);
+		int fd = creat((dir + "/" + name).c_str(), 0644);
+		assert(fd >= 0);
+		close(fd);
+		expected.insert(name);
+	}
+	assert(!mkdir((dir + "/subdir").c_str(), 0755));
+	frg::scope_exit cleanup{[&] {
+		for(auto &name : expected)
+			unlink((dir + "/" + name).c_str());
+		rmdir((dir + "/subdir").c_str());
+		rmdir(dir.c_str());
+	}};
+
+	int fd = open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+	assert(fd >= 0);
+	frg::scope_exit closeFd{[&] {
+		close(fd);
+	}};
+
+	// The handle in the file table belongs to the posix subsystem; use a copy of it.
+	HelHandle laneHandle;
+	HEL_CHECK(helTransferDescriptor(helix::handleForFd(fd), kHelThisUniverse,
+			kHelTransferDescriptorOut, kHelRightsMax, kHelRightNull, &laneHandle));
+	protocols::fs::File file{helix::UniqueDescriptor{laneHandle}};
+
+	std::vector<char> buffer(512);
+	std::vector<BatchRecord> firstBatch;
+	std::set<std::string> seen;
+	int64_t lastOffset = 0;
+	while(true) {
+		auto size = co_await file.readEntriesBatch(buffer.data(), buffer.size());
+		assert(size);
+		if(!*size)
+			break;
+
+		auto records = parseBatch(buffer.data(), *size);
+		if(firstBatch.empty())
+			firstBatch = records;
+		for(auto &record : records) {
+			// Offsets are the positions of the following entries in the directory file.
+			assert(record.offset > lastOffset);
+			lastOffset = record.offset;
+			assert(record.inode);
+
+			// ext2 records the file type in its directory entries.
+			if(record.name == "." || record.name == ".." || record.name == "subdir") {
+				assert(record.type == DT_DIR);
+			}else{
+				assert(record.type == DT_REG);
+				assert(expected.contains(record.name));
+			}
+			assert(!seen.contains(record.name));
+			seen.insert(record.name);
+		}
+	}
+	assert(seen.size() == expected.size() + 3);
+
+	// After rewinding, the same entries are returned again.
+	co_await file.seekAbsolute(0);
+	auto size = co_await file.readEntriesBatch(buffer.data(), buffer.size());
+	assert(size && *size);
+	auto records = parseBatch(buffer.data(), *size);
+	assert(records.size() == firstBatch.size());
+	for(size_t i = 0; i < records.size(); i++) {
+		assert(records[i].name == firstBatch[i].name);
+		assert(records[i].inode == firstBatch[i].inode);
+		assert(records[i].offset == firstBatch[i].offset);
+		assert(records[i].type == firstBatch[i].type);
+	}
+}
+
+} // namespace
+
+DEFINE_TEST(getdents_batch_protocol, ([] {
+	async::run(checkBatchProtocol(), helix::currentDispatcher);
+}))
+
+DEFINE_TEST(getdents_batch_ext2, ([] {
+	async::run(checkBatchExt2(), helix::currentDispatcher);
+}))
+#endif
@@ -0,0 +1,129 @@
+#include <cassert>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <dirent.h>
+#include <fcntl.h>
+#include <set>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <frg/scope_exit.hpp>
+
+#include "testsuite.hpp"
+
+namespace {
+
+// On Managarm, the scratch directory lives on the ext2 root (to exercise libblockfs's
+// hashed directories, which /tmp as tmpfs would bypass).
+std::string make_scratch() {
+#if defined(__managarm__)
+	std::string tmpl = "/posix-tests-large-dir-XXXXXX";
+#else
+	std::string tmpl = "/tmp/posix-tests-large-dir-XXXXXX";
+#endif
+	std::string path(tmpl);
+	if(!mkdtemp(path.data()))
+		assert(!"mkdtemp() failed");
+	return path;
+}
+
+// With 4 KiB blocks, about 15 of these entries fit into a leaf. After splits, leaves are
+// between half full and full, so numEntries needs more leaves than the root of the index
+// can point to (507 with metadata_csum); this forces a second level of index nodes.
+constexpr int numEntries = 6000;
+
+std::string entry_name(int i) {
+	char suffix[16];
+	snprintf(suffix, sizeof(suffix), "-%05d", i);
+	return std::string(240, 'x') + suffix;
+}
+
+bool path_exists(const std::string &path) {
+	struct stat st;
+	return stat(path.c_str(), &st) == 0;
+}
+
+} // namespace
+
+// Fills a directory until ext2 has to index it, split leaves and grow the index,
+// then checks that all entries can be found, listed and removed again.
+DEFINE_TEST(large_directory, ([] {
+	auto dir = make_scratch();
+	auto target = dir + "/target";
+	int fd = creat(target.c_str(), 0644);
+	assert(fd >= 0);
+	close(fd);
+
+	int linked = 0;
+	frg::scope_exit cleanup{[&] {
+		for(int i = 0; i < linked; i++)
+			unlink((dir + "/" + entry_name(i)).c_str());
+		unlink(target.c_str());
+		rmdir(dir.c_str());
+	}};
+
+	struct stat targetStat;
+	assert(!stat(target.c_str(), &targetStat));
+
+	// Hard links keep the test from running out of inodes.
+	for(; linked < numEntries; linked++)
+		assert(!link(target.c_str(), (dir + "/" + entry_name(linked)).c_str()));
+
+	// Every name must be found in the leaf that covers its hash.
+	for(int i = 0; i < numEntries; i++) {
+		struct stat st;
+		assert(!stat((dir + "/" + entry_name(i)).c_str(), &st));
+		assert(st.st_ino == targetStat.st_ino);
+	}
+	assert(!stat(target.c_str(), &targetStat));
+	assert(targetStat.st_nlink == static_cast<nlink_t>(numEntries + 1));
+
+	errno = 0;
+	assert(!path_exists(dir + "/" + entry_name(numEntries)));
+	assert(errno == ENOENT);
+
+	// Indexed directories can still be listed in full.
+	std::set<std::string> seen;
+	auto stream = opendir(dir.c_str());
+	assert(stream);
+	while(auto ent = readdir(stream)) {
+		std::string name{ent->d_name};
+		assert(!seen.contains(name));
+		seen.insert(name);
+	}
+	closedir(stream);
+	assert(seen.size() == static_cast<size_t>(numEntries + 3));
+	for(int i = 0; i < numEntries; i++)
+		assert(seen.contains(entry_name(i)));
+
+	// Remove every other entry; the remaining ones must still be found.
+	for(int i = 0; i < numEntries; i += 2)
+		assert(!unlink((dir + "/" + entry_name(i)).c_str()));
+	for(int i = 0; i < numEntries; i++) {
+		errno = 0;
+		bool exists = path_exists(dir + "/" + entry_name(i));
+		if(i % 2) {
+			assert(exists);
+		}else{
+			assert(!exists);
+			assert(errno == ENOENT);
+		}
+	}
+
+	// New entries can reuse the space of the removed ones.
+	for(int i = 0; i < numEntries; i += 2)
+		assert(!link(target.c_str(), (dir + "/" + entry_name(i)).c_str()));
+	for(int i = 0; i < numEntries; i++)
+		assert(path_exists(dir + "/" + entry_name(i)));
+
+	for(int i = 0; i < numEntries; i++)
+		assert(!unlink((dir + "/" + entry_name(i)).c_str()));
+	linked = 0;
+	for(int i = 0; i < numEntries; i++) {
+		errno = 0;
+		assert(!path_exists(dir + "/" + entry_name(i)));
+		assert(errno == ENOENT);
+	}
+}))
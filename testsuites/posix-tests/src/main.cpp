@@ -30,15 +30,21 @@ int main(int argc, char **argv) {
 
 	std::vector<std::string> globs;
 	app.add_option("globs", globs, "tests to run");
+	bool bench = false;
+	app.add_flag("--bench", bench, "also run benchmarks");
 
 	CLI11_PARSE(app, argc, argv);
 
 	if (globs.empty()) {
 		for(abstract_test_case *tcp : test_case_ptrs()) {
+			if (tcp->is_benchmark() && !bench)
+				continue;
 			run_case(tcp);
 		}
 	} else {
 		for(abstract_test_case *tcp : test_case_ptrs()) {
+			if (tcp->is_benchmark() && !bench)
+				continue;
 			for (const auto &glob : globs) {
 				if (fnmatch(glob.c_str(), tcp->name(), 0) == 0) {
 					run_case(tcp);
@@ -1,8 +1,12 @@
 #include <assert.h>
 #include <fcntl.h>
+#include <fstream>
+#include <iostream>
 #include <limits.h>
+#include <string>
 #include <sys/stat.h>
 #include <sys/resource.h>
+#include <time.h>
 #include <unistd.h>
 #include <vector>
 
@@ -76,3 +80,133 @@ DEFINE_TEST(mkdir_trailing_dot, ([] {
 
 	rmdir("a");
 }))
+
+namespace {
+
+bool exists(const std::string &path) {
+	struct stat st;
+	if(stat(path.c_str(), &st)) {
+		assert(errno == ENOENT);
+		return false;
+	}
+	return true;
+}
+
+// Checks that cached (positive and negative) lookups observe modifications of the directory.
+void check_lookup_coherence(std::string tmpl) {
+	std::string dir(tmpl);
+	if(!mkdtemp(dir.data()))
+		assert(!"mkdtemp() failed");
+	frg::scope_exit cleanup{[&] {
+		unlink((dir + "/file").c_str());
+		unlink((dir + "/renamed").c_str());
+		unlink((dir + "/hardlink").c_str());
+		unlink((dir + "/symlink").c_str());
+		rmdir((dir + "/subdir").c_str());
+		rmdir(dir.c_str());
+	}};
+
+	// Look up each name twice, such that the second lookup is served from the cache.
+	assert(!exists(dir + "/file"));
+	assert(!exists(dir + "/file"));
+	int fd = open((dir + "/file").c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+	assert(fd >= 0);
+	close(fd);
+	assert(exists(dir + "/file"));
+	assert(exists(dir + "/file"));
+
+	assert(!exists(dir + "/hardlink"));
+	assert(!link((dir + "/file").c_str(), (dir + "/hardlink").c_str()));
+	assert(exists(dir + "/hardlink"));
+	assert(!unlink((dir + "/hardlink").c_str()));
+	assert(!exists(dir + "/hardlink"));
+
+	assert(!exists(dir + "/renamed"));
+	assert(!rename((dir + "/file").c_str(), (dir + "/renamed").c_str()));
+	assert(!exists(dir + "/file"));
+	assert(exists(dir + "/renamed"));
+
+	assert(!exists(dir + "/symlink"));
+	assert(!symlink("renamed", (dir + "/symlink").c_str()));
+	assert(exists(dir + "/symlink"));
+	assert(!unlink((dir + "/symlink").c_str()));
+	assert(!exists(dir + "/symlink"));
+
+	assert(!exists(dir + "/subdir/.."));
+	assert(!mkdir((dir + "/subdir").c_str(), 0755));
+	assert(exists(dir + "/subdir/.."));
+	assert(!rmdir((dir + "/subdir").c_str()));
+	assert(!exists(dir + "/subdir"));
+	assert(!exists(dir + "/subdir/.."));
+}
+
+// Reports the average time of repeated stat() calls on existing and nonexistent paths.
+void bench_lookups(std::string tmpl) {
+	constexpr int iterations = 10000;
+
+	std::string dir(tmpl);
+	if(!mkdtemp(dir.data()))
+		assert(!"mkdtemp() failed");
+	assert(!mkdir((dir + "/a").c_str(), 0755));
+	assert(!mkdir((dir + "/a/b").c_str(), 0755));
+	int fd = creat((dir + "/a/b/file").c_str(), 0644);
+	assert(fd >= 0);
+	close(fd);
+	frg::scope_exit cleanup{[&] {
+		unlink((dir + "/a/b/file").c_str());
+		rmdir((dir + "/a/b").c_str());
+		rmdir((dir + "/a").c_str());
+		rmdir(dir.c_str());
+	}};
+
+	auto bench = [&] (const char *what, const std::string &path, bool expected) {
+		auto start = nanos_now();
+		for(int i = 0; i < iterations; i++) {
+			bool found = exists(path);
+			assert(found == expected);
+			(void)found;
+		}
+		auto elapsed = nanos_now() - start;
+		std::cout << "posix-tests: stat() of " << what << " path in " << dir
+				<< ": " << elapsed / iterations << " ns" << std::endl;
+	};
+	bench("existing", dir + "/a/b/file", true);
+	bench("nonexistent", dir + "/a/b/missing", false);
+}
+
+} // namespace
+
+DEFINE_TEST(lookup_coherence_tmpfs, ([] {
+	check_lookup_coherence("/tmp/posix-tests-lookup-XXXXXX");
+}))
+
+DEFINE_BENCHMARK(bench_lookups_tmpfs, ([] {
+	bench_lookups("/tmp/posix-tests-lookup-XXXXXX");
+}))
+
+#if defined(__managarm__)
+// The root file system is ext2 on Managarm, i.e., lookups go through the dentry cache.
+DEFINE_TEST(lookup_coherence_ext2, ([] {
+	check_lookup_coherence("/posix-tests-lookup-XXXXXX");
+}))
+
+DEFINE_BENCHMARK(bench_lookups_ext2, ([] {
+	auto readHits = [] {
+		std::ifstream stats{"/proc/sys/fs/dentry-cache"};
+		assert(stats);
+		std::string key;
+		uint64_t value;
+		while(stats >> key >> value) {
+			if(key == "hits")
+				return value;
+		}
+		assert(!"no hits counter in /proc/sys/fs/dentry-cache");
+		return uint64_t{0};
+	};
+
+	auto hitsBefore = readHits();
+	bench_lookups("/posix-tests-lookup-XXXXXX");
+	// Apart from the first iterations, all lookups should be served from the cache.
+	assert(readHits() - hitsBefore >= 10000);
+}))
+#endif
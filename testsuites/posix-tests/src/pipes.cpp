@@ -1,10 +1,15 @@
 #include <cassert>
 #include <cstring>
+#include <initializer_list>
 #include <errno.h>
 #include <fcntl.h>
+#include <iostream>
 #include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
 #include <unistd.h>
 #include <poll.h>
+#include <vector>
 
 #include "testsuite.hpp"
 
@@ -53,3 +58,158 @@ DEFINE_TEST(fifo_rw, ([] {
 	assert(close(fd) == 0);
 	assert(unlink("/tmp/posix-testsuite-fifo") == 0);
 }))
+
+DEFINE_TEST(pipe_size, ([] {
+	int fds[2];
+	assert(!pipe(fds));
+
+	// The C library may not forward F_GETPIPE_SZ and F_SETPIPE_SZ to the kernel yet.
+	auto size = fcntl(fds[0], F_GETPIPE_SZ);
+	if(size == -1 && errno == EINVAL) {
+		close(fds[0]);
+		close(fds[1]);
+		skip_test("F_GETPIPE_SZ unsupported");
+	}
+	assert(size == 65536);
+
+	// Sizes are rounded up to a power of two; both ends share the buffer.
+	assert(fcntl(fds[1], F_SETPIPE_SZ, 100000) == 131072);
+	assert(fcntl(fds[0], F_GETPIPE_SZ) == 131072);
+	assert(fcntl(fds[1], F_SETPIPE_SZ, 1) == 4096);
+
+	// The pipe accepts exactly its capacity.
+	assert(fcntl(fds[1], F_SETPIPE_SZ, 16384) == 16384);
+	int flags = fcntl(fds[1], F_GETFL);
+	assert(fcntl(fds[1], F_SETFL, flags | O_NONBLOCK) == 0);
+	std::vector<char> buffer(65536, 'x');
+	assert(write(fds[1], buffer.data(), buffer.size()) == 16384);
+	assert(write(fds[1], buffer.data(), 1) == -1);
+	assert(errno == EAGAIN);
+
+	// The data does not fit into a smaller buffer.
+	assert(fcntl(fds[1], F_SETPIPE_SZ, 4096) == -1);
+	assert(errno == EBUSY);
+
+	// Growing the buffer makes the pipe writable again.
+	assert(fcntl(fds[1], F_SETPIPE_SZ, 32768) == 32768);
+	assert(write(fds[1], buffer.data(), buffer.size()) == 16384);
+	assert(read(fds[0], buffer.data(), buffer.size()) == 32768);
+
+	close(fds[0]);
+	close(fds[1]);
+
+	int fd = open("/dev/null", O_RDONLY);
+	assert(fd >= 0);
+	assert(fcntl(fd, F_GETPIPE_SZ) == -1);
+	assert(errno == EBADF);
+	close(fd);
+}))
+
+namespace {
+
+// Forks a child that writes size bytes to fd in chunks of chunkSize bytes.
+// The child closes the descriptors in unused such that readers observe the end of the data.
+pid_t forkWriter(int fd, size_t size, size_t chunkSize, std::initializer_list<int> unused) {
+	pid_t child = fork();
+	assert(child >= 0);
+	if(!child) {
+		for(int other : unused)
+			close(other);
+		std::vector<char> buffer(chunkSize, 'x');
+		size_t progress = 0;
+		while(progress < size) {
+			auto n = write(fd, buffer.data(), std::min(chunkSize, size - progress));
+			if(n <= 0)
+				_exit(1);
+			progress += n;
+		}
+		_exit(0);
+	}
+	return child;
+}
+
+// Forks a child that splices everything from in to out until the end of the input.
+pid_t forkSplicer(int in, int out, std::initializer_list<int> unused) {
+	pid_t child = fork();
+	assert(child >= 0);
+	if(!child) {
+		for(int other : unused)
+			close(other);
+		while(true) {
+			auto n = splice(in, nullptr, out, nullptr, 1 << 20, 0);
+			if(n < 0)
+				_exit(1);
+			if(!n)
+				_exit(0);
+		}
+	}
+	return child;
+}
+
+void waitForChild(pid_t child) {
+	int status;
+	assert(waitpid(child, &status, 0) == child);
+	assert(WIFEXITED(status) && !WEXITSTATUS(status));
+}
+
+size_t drain(int fd, size_t chunkSize) {
+	std::vector<char> buffer(chunkSize);
+	size_t total = 0;
+	while(true) {
+		auto n = read(fd, buffer.data(), buffer.size());
+		assert(n >= 0);
+		if(!n)
+			break;
+		total += n;
+	}
+	return total;
+}
+
+} // namespace
+
+// Reports the throughput of a writer -> pipe -> reader pair for different pipe sizes,
+// and of a pipeline whose middle stage splice()s from one pipe into another.
+DEFINE_BENCHMARK(bench_pipe_throughput, ([] {
+	constexpr size_t size = 64 * 1024 * 1024;
+	constexpr size_t chunkSize = 65536;
+
+	auto report = [] (const char *what, size_t pipeSize, uint64_t elapsed) {
+		std::cout << "posix-tests: " << what << " with " << (pipeSize >> 10) << " KiB pipes: "
+				<< (size * 1000 / (elapsed ? elapsed : 1)) << " MB/s" << std::endl;
+	};
+
+	for(size_t pipeSize : {size_t{4096}, size_t{65536}, size_t{1024 * 1024}}) {
+		int fds[2];
+		assert(!pipe(fds));
+		assert(fcntl(fds[1], F_SETPIPE_SZ, pipeSize) == static_cast<int>(pipeSize));
+
+		auto start = nanos_now();
+		pid_t writer = forkWriter(fds[1], size, chunkSize, {fds[0]});
+		close(fds[1]);
+		assert(drain(fds[0], chunkSize) == size);
+		auto elapsed = nanos_now() - start;
+		close(fds[0]);
+		waitForChild(writer);
+		report("pipe", pipeSize, elapsed);
+
+		int first[2];
+		int second[2];
+		assert(!pipe(first));
+		assert(!pipe(second));
+		assert(fcntl(first[1], F_SETPIPE_SZ, pipeSize) == static_cast<int>(pipeSize));
+		assert(fcntl(second[1], F_SETPIPE_SZ, pipeSize) == static_cast<int>(pipeSize));
+
+		start = nanos_now();
+		writer = forkWriter(first[1], size, chunkSize, {first[0], second[0], second[1]});
+		pid_t splicer = forkSplicer(first[0], second[1], {first[1], second[0]});
+		close(first[0]);
+		close(first[1]);
+		close(second[1]);
+		assert(drain(second[0], chunkSize) == size);
+		elapsed = nanos_now() - start;
+		close(second[0]);
+		waitForChild(writer);
+		waitForChild(splicer);
+		report("splice() pipeline", pipeSize, elapsed);
+	}
+}))
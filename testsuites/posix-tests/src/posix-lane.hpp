@@ -0,0 +1,61 @@
+#pragma once
+
+// Direct access to the posix server, for requests that the C library does not send (yet).
+
+#include <cassert>
+
+#include <async/result.hpp>
+#include <bragi/helpers-std.hpp>
+#include <hel.h>
+#include <hel-syscalls.h>
+#include <helix/ipc.hpp>
+#include <protocols/posix/data.hpp>
+#include <protocols/posix/supercalls.hpp>
+
+#include "posix.bragi.hpp"
+
+inline helix::BorrowedDescriptor posix_lane() {
+	posix::ManagarmProcessData data;
+	HEL_CHECK(helSyscall1(kHelCallSuper + posix::superGetProcessData,
+			reinterpret_cast<HelWord>(&data)));
+	return helix::BorrowedDescriptor{data.posixLane};
+}
+
+// Sends a request that the posix server answers with a head-only response.
+template<typename Response, typename Request>
+Response posix_request(Request &req) {
+	auto exchange = [&] () -> async::result<Response> {
+		auto [offer, send_req, recv_resp] = co_await helix_ng::exchangeMsgs(
+			posix_lane(),
+			helix_ng::offer(
+				helix_ng::sendBragiHeadOnly(req, frg::stl_allocator{}),
+				helix_ng::recvInline())
+		);
+		HEL_CHECK(offer.error());
+		HEL_CHECK(send_req.error());
+		HEL_CHECK(recv_resp.error());
+
+		auto resp = bragi::parse_head_only<Response>(recv_resp);
+		recv_resp.reset();
+		assert(resp);
+		co_return std::move(*resp);
+	};
+	return async::run(exchange(), helix::currentDispatcher);
+}
+
+// Maps a memory object that the posix server transferred into our universe.
+// The handle is closed afterwards; the mapping keeps the memory alive.
+inline void *map_posix_memory(HelHandle handle, size_t size) {
+	void *window;
+	HEL_CHECK(helMapMemory(handle, kHelNullHandle, nullptr, 0, size,
+			kHelMapProtRead | kHelMapProtWrite, &window));
+	HEL_CHECK(helCloseDescriptor(kHelThisUniverse, handle));
+	return window;
+}
+
+// Returns the absolute deadline (see helGetClock()) that is the given number of ms from now.
+inline int64_t deadline_in_ms(int ms) {
+	uint64_t now;
+	HEL_CHECK(helGetClock(&now));
+	return now + static_cast<uint64_t>(ms) * 1'000'000;
+}
@@ -11,9 +11,15 @@
 #include <sys/stat.h>
 #include <sys/time.h>
 #include <sys/wait.h>
+#include <time.h>
 #include <sys/poll.h>
 #include <sys/un.h>
 #include <unistd.h>
+#include <algorithm>
+
+#if defined(__managarm__)
+#include "posix-lane.hpp"
+#endif
 
 #include "testsuite.hpp"
 
@@ -462,3 +468,601 @@ DEFINE_TEST(socket_stream_eof, ([] {
 	close(fds[0]);
 	close(fds[1]);
 }));
+
+DEFINE_TEST(socket_stream_coalesce, ([] {
+	int fds[2];
+	int ret = socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+	assert(!ret);
+
+	// Stream sockets return the data of multiple writes at once.
+	for(int i = 0; i < 3; i++) {
+		ret = write(fds[0], "abc", 3);
+		assert(ret == 3);
+	}
+
+	int count;
+	ret = ioctl(fds[1], FIONREAD, &count);
+	assert(!ret);
+	assert(count == 9);
+
+	char buf[16];
+	ret = recv(fds[1], buf, sizeof(buf), MSG_PEEK);
+	assert(ret == 9);
+	ret = read(fds[1], buf, 4);
+	assert(ret == 4);
+	assert(!memcmp(buf, "abca", 4));
+	ret = read(fds[1], buf, sizeof(buf));
+	assert(ret == 5);
+	assert(!memcmp(buf, "bcabc", 5));
+
+	// File descriptors are not lost when the data is joined with other writes.
+	ret = write(fds[0], "xy", 2);
+	assert(ret == 2);
+
+	struct msghdr msg;
+	struct iovec iov;
+	char cmsgbuf[CMSG_SPACE(sizeof(int))];
+	memset(&msg, 0, sizeof(msg));
+	iov.iov_base = (char *)"z";
+	iov.iov_len = 1;
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = cmsgbuf;
+	msg.msg_controllen = sizeof(cmsgbuf);
+	struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type = SCM_RIGHTS;
+	cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+	*((int *)CMSG_DATA(cmsg)) = 0;
+	ret = sendmsg(fds[0], &msg, 0);
+	assert(ret == 1);
+
+	int progress = 0;
+	int numRights = 0;
+	while(progress < 3) {
+		iov.iov_base = buf + progress;
+		iov.iov_len = sizeof(buf) - progress;
+		msg.msg_control = cmsgbuf;
+		msg.msg_controllen = sizeof(cmsgbuf);
+		ret = recvmsg(fds[1], &msg, 0);
+		assert(ret > 0);
+		progress += ret;
+		for(cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+			assert(cmsg->cmsg_type == SCM_RIGHTS);
+			close(*((int *)CMSG_DATA(cmsg)));
+			numRights++;
+		}
+	}
+	assert(progress == 3);
+	assert(!memcmp(buf, "xyz", 3));
+	assert(numRights == 1);
+
+	close(fds[0]);
+	close(fds[1]);
+}));
+
+#if defined(__managarm__)
+// The C library does not use the shared-memory rings of stream sockets yet.
+// Map them by hand and access them as described next to posix::SocketRing.
+
+namespace {
+
+struct MappedSocketRing {
+	void *memory;
+	// The ring that the socket sends on and the one it receives on.
+	posix::SocketRing *out;
+	posix::SocketRing *in;
+};
+
+managarm::posix::SocketRingResponse request_socket_ring(int fd) {
+	managarm::posix::SocketRingRequest req;
+	req.set_fd(fd);
+	return posix_request<managarm::posix::SocketRingResponse>(req);
+}
+
+MappedSocketRing map_socket_ring(int fd) {
+	auto resp = request_socket_ring(fd);
+	assert(resp.error() == managarm::posix::Errors::SUCCESS);
+	assert(resp.size() == 2 * posix::socketRingSize);
+	assert(resp.index() == 0 || resp.index() == 1);
+	auto memory = map_posix_memory(resp.memory_handle(), resp.size());
+	return {memory, posix::socketRing(memory, resp.index()),
+			posix::socketRing(memory, 1 - resp.index())};
+}
+
+void unmap_socket_ring(const MappedSocketRing &m) {
+	HEL_CHECK(helUnmapMemory(kHelNullHandle, m.memory, 2 * posix::socketRingSize));
+}
+
+void lock_ring(unsigned int *word) {
+	unsigned int expected = 0;
+	if(__atomic_compare_exchange_n(word, &expected, 1, false,
+			__ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+		return;
+	while(__atomic_exchange_n(word, 2, __ATOMIC_ACQUIRE))
+		HEL_CHECK(helFutexWait(reinterpret_cast<int *>(word), 2, -1));
+}
+
+void unlock_ring(unsigned int *word) {
+	if(__atomic_exchange_n(word, 0, __ATOMIC_RELEASE) == 2)
+		HEL_CHECK(helFutexWake(reinterpret_cast<int *>(word), 1));
+}
+
+void signal_ring(unsigned int *seq, unsigned int *waiting) {
+	__atomic_fetch_add(seq, 1, __ATOMIC_SEQ_CST);
+	if(__atomic_exchange_n(waiting, 0, __ATOMIC_SEQ_CST))
+		HEL_CHECK(helFutexWake(reinterpret_cast<int *>(seq), UINT_MAX));
+}
+
+// Results of ring_write() and ring_read() other than byte counts.
+constexpr ssize_t ringUseServer = -1; // Ancillary data or an abandoned ring; use the socket.
+constexpr ssize_t ringTimeout = -2;
+constexpr ssize_t ringBrokenPipe = -3;
+
+// Writes all data unless the deadline (see deadline_in_ms()) expires while the ring is full.
+ssize_t ring_write(posix::SocketRing *r, const void *data, size_t length, int64_t deadline = -1) {
+	auto buffer = posix::socketRingData(r);
+	lock_ring(&r->writeLock);
+	size_t progress = 0;
+	ssize_t result = 0;
+	while(progress < length) {
+		auto seq = __atomic_load_n(&r->spaceSeq, __ATOMIC_SEQ_CST);
+		if(__atomic_load_n(&r->abandoned, __ATOMIC_ACQUIRE)) {
+			result = ringUseServer;
+			break;
+		}
+		if(__atomic_load_n(&r->readerShutdown, __ATOMIC_ACQUIRE)) {
+			result = ringBrokenPipe;
+			break;
+		}
+
+		auto head = __atomic_load_n(&r->head, __ATOMIC_RELAXED);
+		auto tail = __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE);
+		size_t space = posix::socketRingCapacity - (head - tail);
+		if(!space) {
+			__atomic_store_n(&r->spaceWaiting, 1, __ATOMIC_SEQ_CST);
+			auto e = helFutexWait(reinterpret_cast<int *>(&r->spaceSeq), seq, deadline);
+			if(e == kHelErrTimeout) {
+				result = ringTimeout;
+				break;
+			}
+			HEL_CHECK(e);
+			continue;
+		}
+
+		auto chunk = std::min(space, length - progress);
+		auto offset = head % posix::socketRingCapacity;
+		auto first = std::min(chunk, posix::socketRingCapacity - offset);
+		memcpy(buffer + offset, static_cast<const char *>(data) + progress, first);
+		memcpy(buffer, static_cast<const char *>(data) + progress + first, chunk - first);
+		__atomic_store_n(&r->head, head + static_cast<unsigned int>(chunk), __ATOMIC_RELEASE);
+		signal_ring(&r->dataSeq, &r->dataWaiting);
+		progress += chunk;
+	}
+	unlock_ring(&r->writeLock);
+	if(progress)
+		return progress;
+	return result;
+}
+
+// Returns 0 on EOF. Stops before bytes that the posix server attached ancillary data to.
+ssize_t ring_read(posix::SocketRing *r, void *data, size_t maxLength, int64_t deadline = -1) {
+	auto buffer = posix::socketRingData(r);
+	lock_ring(&r->readLock);
+	ssize_t result = 0;
+	while(true) {
+		auto seq = __atomic_load_n(&r->dataSeq, __ATOMIC_SEQ_CST);
+		if(__atomic_load_n(&r->abandoned, __ATOMIC_ACQUIRE)) {
+			result = ringUseServer;
+			break;
+		}
+
+		auto head = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+		auto tail = __atomic_load_n(&r->tail, __ATOMIC_RELAXED);
+		size_t available = head - tail;
+		if(__atomic_load_n(&r->hasControl, __ATOMIC_ACQUIRE)) {
+			size_t distance = __atomic_load_n(&r->controlPosition, __ATOMIC_RELAXED) - tail;
+			if(!distance) {
+				result = ringUseServer;
+				break;
+			}
+			available = std::min(available, distance);
+		}
+
+		if(available) {
+			auto length = std::min(available, maxLength);
+			auto offset = tail % posix::socketRingCapacity;
+			auto first = std::min(length, posix::socketRingCapacity - offset);
+			memcpy(data, buffer + offset, first);
+			memcpy(static_cast<char *>(data) + first, buffer, length - first);
+			__atomic_store_n(&r->tail, tail + static_cast<unsigned int>(length), __ATOMIC_RELEASE);
+			signal_ring(&r->spaceSeq, &r->spaceWaiting);
+			result = length;
+			break;
+		}
+		if(__atomic_load_n(&r->writerShutdown, __ATOMIC_ACQUIRE)
+				|| __atomic_load_n(&r->readerShutdown, __ATOMIC_ACQUIRE))
+			break;
+
+		__atomic_store_n(&r->dataWaiting, 1, __ATOMIC_SEQ_CST);
+		auto e = helFutexWait(reinterpret_cast<int *>(&r->dataSeq), seq, deadline);
+		if(e == kHelErrTimeout) {
+			result = ringTimeout;
+			break;
+		}
+		HEL_CHECK(e);
+	}
+	unlock_ring(&r->readLock);
+	return result;
+}
+
+// Receives a single byte with SCM_RIGHTS through the posix server and returns the fd.
+int recv_fd(int fd, char *c) {
+	struct msghdr msg;
+	struct iovec iov;
+	char cmsgbuf[CMSG_SPACE(sizeof(int))];
+	memset(&msg, 0, sizeof(msg));
+	iov.iov_base = c;
+	iov.iov_len = 1;
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = cmsgbuf;
+	msg.msg_controllen = sizeof(cmsgbuf);
+	auto ret = recvmsg(fd, &msg, 0);
+	assert(ret == 1);
+	struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+	assert(cmsg);
+	assert(cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS);
+	assert(cmsg->cmsg_len == CMSG_LEN(sizeof(int)));
+	return *reinterpret_cast<int *>(CMSG_DATA(cmsg));
+}
+
+void send_fd(int fd, char c, int passed) {
+	struct msghdr msg;
+	struct iovec iov;
+	char cmsgbuf[CMSG_SPACE(sizeof(int))];
+	memset(&msg, 0, sizeof(msg));
+	iov.iov_base = &c;
+	iov.iov_len = 1;
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = cmsgbuf;
+	msg.msg_controllen = sizeof(cmsgbuf);
+	struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type = SCM_RIGHTS;
+	cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+	*reinterpret_cast<int *>(CMSG_DATA(cmsg)) = passed;
+	auto ret = sendmsg(fd, &msg, 0);
+	assert(ret == 1);
+}
+
+} // namespace
+
+DEFINE_TEST(socket_ring, ([] {
+	int fds[2];
+	int ret = socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+	assert(!ret);
+
+	// Data from before ring mode stays with the posix server.
+	ret = write(fds[0], "queued", 6);
+	assert(ret == 6);
+
+	auto m0 = map_socket_ring(fds[0]);
+	auto m1 = map_socket_ring(fds[1]);
+	assert(m0.out == m1.in && m0.in == m1.out);
+
+	char buf[16];
+	assert(ring_read(m1.in, buf, sizeof(buf)) == ringUseServer);
+	ret = read(fds[1], buf, sizeof(buf));
+	assert(ret == 6);
+	assert(!memcmp(buf, "queued", 6));
+	assert(!__atomic_load_n(&m1.in->hasControl, __ATOMIC_ACQUIRE));
+	assert(ring_read(m1.in, buf, sizeof(buf), deadline_in_ms(10)) == ringTimeout);
+
+	// Both directions, by hand and through the posix server.
+	assert(ring_write(m0.out, "hello", 5) == 5);
+	assert(ring_read(m1.in, buf, sizeof(buf)) == 5);
+	assert(!memcmp(buf, "hello", 5));
+	assert(ring_write(m1.out, "world", 5) == 5);
+	ret = read(fds[0], buf, sizeof(buf));
+	assert(ret == 5);
+	assert(!memcmp(buf, "world", 5));
+	ret = write(fds[1], "server", 6);
+	assert(ret == 6);
+	assert(ring_read(m0.in, buf, sizeof(buf)) == 6);
+	assert(!memcmp(buf, "server", 6));
+
+	// Readers stop at bytes with SCM_RIGHTS and receive them through the posix server.
+	int pipefds[2];
+	ret = pipe(pipefds);
+	assert(!ret);
+	assert(ring_write(m0.out, "e", 1) == 1);
+	send_fd(fds[0], 'f', pipefds[1]);
+	close(pipefds[1]);
+	assert(__atomic_load_n(&m1.in->hasControl, __ATOMIC_ACQUIRE));
+	assert(__atomic_load_n(&m1.in->controlPosition, __ATOMIC_RELAXED)
+			== __atomic_load_n(&m1.in->tail, __ATOMIC_RELAXED) + 1);
+	assert(ring_read(m1.in, buf, sizeof(buf)) == 1);
+	assert(buf[0] == 'e');
+	assert(ring_read(m1.in, buf, sizeof(buf)) == ringUseServer);
+	int passed = recv_fd(fds[1], buf);
+	assert(buf[0] == 'f');
+	assert(!__atomic_load_n(&m1.in->hasControl, __ATOMIC_ACQUIRE));
+	ret = write(passed, "!", 1);
+	assert(ret == 1);
+	close(passed);
+	ret = read(pipefds[0], buf, sizeof(buf));
+	assert(ret == 1 && buf[0] == '!');
+	close(pipefds[0]);
+
+	// shutdown() and close() are reflected in the rings.
+	assert(ring_write(m0.out, "eof", 3) == 3);
+	ret = shutdown(fds[0], SHUT_WR);
+	assert(!ret);
+	assert(ring_read(m1.in, buf, sizeof(buf)) == 3);
+	assert(!memcmp(buf, "eof", 3));
+	assert(ring_read(m1.in, buf, sizeof(buf)) == 0);
+	ret = read(fds[1], buf, sizeof(buf));
+	assert(ret == 0);
+
+	close(fds[0]);
+	assert(ring_write(m1.out, "x", 1) == ringBrokenPipe);
+	ret = send(fds[1], "x", 1, MSG_NOSIGNAL);
+	assert(ret == -1 && errno == EPIPE);
+	close(fds[1]);
+	unmap_socket_ring(m0);
+	unmap_socket_ring(m1);
+}));
+
+DEFINE_TEST(socket_ring_passcred, ([] {
+	int one = 1;
+	char buf[16];
+	char cmsgbuf[CMSG_SPACE(sizeof(struct ucred))];
+
+	auto recv_creds = [&] (int fd, struct ucred *creds) -> ssize_t {
+		struct msghdr msg;
+		struct iovec iov;
+		memset(&msg, 0, sizeof(msg));
+		iov.iov_base = buf;
+		iov.iov_len = sizeof(buf);
+		msg.msg_iov = &iov;
+		msg.msg_iovlen = 1;
+		msg.msg_control = cmsgbuf;
+		msg.msg_controllen = sizeof(cmsgbuf);
+		auto ret = recvmsg(fd, &msg, 0);
+		struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+		assert(cmsg);
+		assert(cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_CREDENTIALS);
+		memcpy(creds, CMSG_DATA(cmsg), sizeof(struct ucred));
+		return ret;
+	};
+
+	// Rings are refused while either socket reports credentials.
+	int fds[2];
+	int ret = socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+	assert(!ret);
+	ret = setsockopt(fds[0], SOL_SOCKET, SO_PASSCRED, &one, sizeof(one));
+	assert(!ret);
+	assert(request_socket_ring(fds[1]).error() == managarm::posix::Errors::ILLEGAL_ARGUMENTS);
+	assert(request_socket_ring(fds[0]).error() == managarm::posix::Errors::ILLEGAL_ARGUMENTS);
+	close(fds[0]);
+	close(fds[1]);
+
+	// Enabling SO_PASSCRED later abandons the rings; their data moves to the posix server.
+	ret = socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+	assert(!ret);
+	auto m0 = map_socket_ring(fds[0]);
+	auto m1 = map_socket_ring(fds[1]);
+	assert(ring_write(m0.out, "abc", 3) == 3);
+
+	// A reader that blocks in the posix server falls back to the receive queue.
+	pid_t child = fork();
+	assert(child >= 0);
+	if(!child) {
+		ret = read(fds[0], buf, sizeof(buf));
+		if(ret != 3 || memcmp(buf, "xyz", 3))
+			_exit(1);
+		_exit(0);
+	}
+	usleep(50'000);
+
+	ret = setsockopt(fds[1], SOL_SOCKET, SO_PASSCRED, &one, sizeof(one));
+	assert(!ret);
+	assert(__atomic_load_n(&m0.out->abandoned, __ATOMIC_ACQUIRE));
+	assert(__atomic_load_n(&m0.in->abandoned, __ATOMIC_ACQUIRE));
+	assert(ring_write(m0.out, "x", 1) == ringUseServer);
+	assert(ring_read(m1.in, buf, sizeof(buf)) == ringUseServer);
+	assert(request_socket_ring(fds[0]).error() == managarm::posix::Errors::ILLEGAL_ARGUMENTS);
+
+	struct ucred creds;
+	ret = recv_creds(fds[1], &creds);
+	assert(ret == 3);
+	assert(!memcmp(buf, "abc", 3));
+	assert(creds.pid == getpid());
+
+	ret = write(fds[0], "def", 3);
+	assert(ret == 3);
+	ret = recv_creds(fds[1], &creds);
+	assert(ret == 3);
+	assert(!memcmp(buf, "def", 3));
+	assert(creds.pid == getpid());
+
+	ret = write(fds[1], "xyz", 3);
+	assert(ret == 3);
+	int status;
+	ret = waitpid(child, &status, 0);
+	assert(ret == child);
+	assert(WIFEXITED(status) && !WEXITSTATUS(status));
+
+	close(fds[0]);
+	close(fds[1]);
+	unmap_socket_ring(m0);
+	unmap_socket_ring(m1);
+}));
+#endif
+
+// Reports the throughput and the round trip latency of a stream socketpair.
+DEFINE_BENCHMARK(bench_socket_stream, ([] {
+	for(size_t chunk : {64, 4096, 65536}) {
+		// Limit the number of writes for small chunks.
+		size_t total = chunk * 16384 < 16 * 1024 * 1024 ? chunk * 16384 : 16 * 1024 * 1024;
+
+		int fds[2];
+		int ret = socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+		assert(!ret);
+
+		auto start = nanos_now();
+		pid_t child = fork();
+		assert(child >= 0);
+		if(!child) {
+			static char buf[65536];
+			size_t progress = 0;
+			while(progress < total) {
+				auto n = write(fds[0], buf, chunk);
+				assert(n == static_cast<ssize_t>(chunk));
+				progress += n;
+			}
+			_exit(0);
+		}
+
+		static char buf[65536];
+		size_t progress = 0;
+		while(progress < total) {
+			auto n = read(fds[1], buf, sizeof(buf));
+			assert(n > 0);
+			progress += n;
+		}
+		auto elapsed = nanos_now() - start;
+		int status;
+		ret = waitpid(child, &status, 0);
+		assert(ret == child);
+
+		printf("posix-tests: AF_UNIX stream, %zu byte writes: %llu MB/s\n", chunk,
+				static_cast<unsigned long long>(total * 1000 / (elapsed ? elapsed : 1)));
+		close(fds[0]);
+		close(fds[1]);
+	}
+
+	int fds[2];
+	int ret = socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+	assert(!ret);
+
+	constexpr int rounds = 10000;
+	pid_t child = fork();
+	assert(child >= 0);
+	if(!child) {
+		char c;
+		for(int i = 0; i < rounds; i++) {
+			auto n = read(fds[1], &c, 1);
+			assert(n == 1);
+			n = write(fds[1], &c, 1);
+			assert(n == 1);
+		}
+		_exit(0);
+	}
+
+	auto start = nanos_now();
+	for(int i = 0; i < rounds; i++) {
+		char c = 'x';
+		auto n = write(fds[0], &c, 1);
+		assert(n == 1);
+		n = read(fds[0], &c, 1);
+		assert(n == 1);
+	}
+	auto elapsed = nanos_now() - start;
+	int status;
+	ret = waitpid(child, &status, 0);
+	assert(ret == child);
+
+	printf("posix-tests: AF_UNIX stream round trip: %llu ns\n",
+			static_cast<unsigned long long>(elapsed / rounds));
+	close(fds[0]);
+	close(fds[1]);
+}));
+
+#if defined(__managarm__)
+// Like bench_socket_stream, but for a client that uses the shared-memory rings by hand.
+DEFINE_BENCHMARK(bench_socket_ring, ([] {
+	for(size_t chunk : {64, 4096, 65536}) {
+		size_t total = chunk * 16384 < 16 * 1024 * 1024 ? chunk * 16384 : 16 * 1024 * 1024;
+
+		int fds[2];
+		int ret = socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+		assert(!ret);
+
+		auto start = nanos_now();
+		pid_t child = fork();
+		assert(child >= 0);
+		if(!child) {
+			auto m = map_socket_ring(fds[0]);
+			static char buf[65536];
+			size_t progress = 0;
+			while(progress < total) {
+				auto n = ring_write(m.out, buf, chunk);
+				assert(n == static_cast<ssize_t>(chunk));
+				progress += n;
+			}
+			_exit(0);
+		}
+
+		auto m = map_socket_ring(fds[1]);
+		static char buf[65536];
+		size_t progress = 0;
+		while(progress < total) {
+			auto n = ring_read(m.in, buf, sizeof(buf));
+			assert(n > 0);
+			progress += n;
+		}
+		auto elapsed = nanos_now() - start;
+		int status;
+		ret = waitpid(child, &status, 0);
+		assert(ret == child);
+
+		printf("posix-tests: AF_UNIX stream ring, %zu byte writes: %llu MB/s\n", chunk,
+				static_cast<unsigned long long>(total * 1000 / (elapsed ? elapsed : 1)));
+		unmap_socket_ring(m);
+		close(fds[0]);
+		close(fds[1]);
+	}
+
+	int fds[2];
+	int ret = socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+	assert(!ret);
+
+	constexpr int rounds = 10000;
+	pid_t child = fork();
+	assert(child >= 0);
+	if(!child) {
+		auto m = map_socket_ring(fds[1]);
+		char c;
+		for(int i = 0; i < rounds; i++) {
+			auto n = ring_read(m.in, &c, 1);
+			assert(n == 1);
+			n = ring_write(m.out, &c, 1);
+			assert(n == 1);
+		}
+		_exit(0);
+	}
+
+	auto m = map_socket_ring(fds[0]);
+	auto start = nanos_now();
+	for(int i = 0; i < rounds; i++) {
+		char c = 'x';
+		auto n = ring_write(m.out, &c, 1);
+		assert(n == 1);
+		n = ring_read(m.in, &c, 1);
+		assert(n == 1);
+	}
+	auto elapsed = nanos_now() - start;
+	int status;
+	ret = waitpid(child, &status, 0);
+	assert(ret == child);
+
+	printf("posix-tests: AF_UNIX stream ring round trip: %llu ns\n",
+			static_cast<unsigned long long>(elapsed / rounds));
+	unmap_socket_ring(m);
+	close(fds[0]);
+	close(fds[1]);
+}));
+#endif
@@ -0,0 +1,385 @@
+#include <algorithm>
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <iostream>
+#include <string>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+
+#include <frg/scope_exit.hpp>
+
+#include "testsuite.hpp"
+
+namespace {
+
+std::vector<char> pattern(size_t size) {
+	std::vector<char> data(size);
+	for(size_t i = 0; i < size; i++)
+		data[i] = static_cast<char>(i * 7 + i / 4096);
+	return data;
+}
+
+void writeFile(int fd, const std::vector<char> &data) {
+	size_t progress = 0;
+	while(progress < data.size()) {
+		auto n = write(fd, data.data() + progress, data.size() - progress);
+		assert(n > 0);
+		progress += n;
+	}
+}
+
+std::vector<char> readFile(const std::string &path) {
+	int fd = open(path.c_str(), O_RDONLY);
+	assert(fd >= 0);
+	std::vector<char> data;
+	char buffer[4096];
+	while(true) {
+		auto n = read(fd, buffer, sizeof(buffer));
+		assert(n >= 0);
+		if(!n)
+			break;
+		data.insert(data.end(), buffer, buffer + n);
+	}
+	close(fd);
+	return data;
+}
+
+std::vector<char> readPipe(int fd, size_t size) {
+	std::vector<char> data(size);
+	size_t progress = 0;
+	while(progress < size) {
+		auto n = read(fd, data.data() + progress, size - progress);
+		assert(n > 0);
+		progress += n;
+	}
+	return data;
+}
+
+struct TempDir {
+	TempDir(std::string tmpl)
+	: path{std::move(tmpl)} {
+		if(!mkdtemp(path.data()))
+			assert(!"mkdtemp() failed");
+	}
+
+	~TempDir() {
+		for(auto name : {"/src", "/dst", "/copy"})
+			unlink((path + name).c_str());
+		rmdir(path.c_str());
+	}
+
+	// Creates a file with size bytes of test data.
+	std::vector<char> create(const char *name, size_t size) {
+		int fd = open((path + name).c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+		assert(fd >= 0);
+		auto data = pattern(size);
+		writeFile(fd, data);
+		close(fd);
+		return data;
+	}
+
+	std::string path;
+};
+
+void check_copy_file_range(std::string tmpl) {
+	TempDir dir{std::move(tmpl)};
+	// Not a multiple of the chunk size or the page size.
+	auto data = dir.create("/src", 300 * 1024 + 123);
+
+	int in = open((dir.path + "/src").c_str(), O_RDONLY);
+	assert(in >= 0);
+	int out = open((dir.path + "/dst").c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	assert(out >= 0);
+	frg::scope_exit closeFds{[&] {
+		close(in);
+		close(out);
+	}};
+
+	// Copy using the file offsets.
+	size_t progress = 0;
+	while(true) {
+		auto n = copy_file_range(in, nullptr, out, nullptr, 100000, 0);
+		assert(n >= 0);
+		if(!n)
+			break;
+		progress += n;
+	}
+	assert(progress == data.size());
+	assert(lseek(in, 0, SEEK_CUR) == static_cast<off_t>(data.size()));
+	assert(lseek(out, 0, SEEK_CUR) == static_cast<off_t>(data.size()));
+	assert(readFile(dir.path + "/dst") == data);
+
+	// Copy using explicit offsets; the file offsets stay untouched.
+	off_t inOffset = 1000;
+	off_t outOffset = 5;
+	auto n = copy_file_range(in, &inOffset, out, &outOffset, 4096, 0);
+	assert(n == 4096);
+	assert(inOffset == 1000 + 4096);
+	assert(outOffset == 5 + 4096);
+	assert(lseek(in, 0, SEEK_CUR) == static_cast<off_t>(data.size()));
+	auto copied = readFile(dir.path + "/dst");
+	assert(std::equal(copied.begin() + 5, copied.begin() + 5 + 4096, data.begin() + 1000));
+
+	// Copying past the end of the source file copies nothing.
+	inOffset = data.size();
+	assert(copy_file_range(in, &inOffset, out, nullptr, 4096, 0) == 0);
+
+	// Overlapping ranges within the same file are rejected.
+	int rw = open((dir.path + "/dst").c_str(), O_RDWR);
+	assert(rw >= 0);
+	inOffset = 0;
+	outOffset = 100;
+	assert(copy_file_range(rw, &inOffset, rw, &outOffset, 4096, 0) == -1);
+	assert(errno == EINVAL);
+	close(rw);
+
+	assert(copy_file_range(in, nullptr, out, nullptr, 4096, 1) == -1);
+	assert(errno == EINVAL);
+}
+
+void check_sendfile(std::string tmpl) {
+	TempDir dir{std::move(tmpl)};
+	auto data = dir.create("/src", 200 * 1024 + 17);
+
+	int in = open((dir.path + "/src").c_str(), O_RDONLY);
+	assert(in >= 0);
+	frg::scope_exit closeIn{[&] { close(in); }};
+
+	// sendfile() into a socket. Stay below the socket buffer size to avoid blocking.
+	int sp[2];
+	assert(!socketpair(AF_UNIX, SOCK_STREAM, 0, sp));
+	off_t offset = 4096;
+	auto n = sendfile(sp[0], in, &offset, 8192);
+	assert(n == 8192);
+	assert(offset == 4096 + 8192);
+	assert(lseek(in, 0, SEEK_CUR) == 0);
+	auto received = readPipe(sp[1], 8192);
+	assert(std::equal(received.begin(), received.end(), data.begin() + 4096));
+	close(sp[0]);
+	close(sp[1]);
+
+	// sendfile() into a regular file using the file offset of the input.
+	int out = open((dir.path + "/dst").c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	assert(out >= 0);
+	size_t progress = 0;
+	while(true) {
+		n = sendfile(out, in, nullptr, 65536);
+		assert(n >= 0);
+		if(!n)
+			break;
+		progress += n;
+	}
+	close(out);
+	assert(progress == data.size());
+	assert(lseek(in, 0, SEEK_CUR) == static_cast<off_t>(data.size()));
+	assert(readFile(dir.path + "/dst") == data);
+}
+
+void check_splice(std::string tmpl) {
+	TempDir dir{std::move(tmpl)};
+	auto data = dir.create("/src", 64 * 1024 + 5);
+
+	int in = open((dir.path + "/src").c_str(), O_RDONLY);
+	assert(in >= 0);
+	int out = open((dir.path + "/dst").c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	assert(out >= 0);
+	int fds[2];
+	assert(!pipe(fds));
+	frg::scope_exit closeFds{[&] {
+		close(in);
+		close(out);
+		close(fds[0]);
+		close(fds[1]);
+	}};
+
+	// File -> pipe -> file, in chunks that fit into the pipe.
+	size_t progress = 0;
+	while(progress < data.size()) {
+		auto n = splice(in, nullptr, fds[1], nullptr, 16384, 0);
+		assert(n > 0);
+		auto m = splice(fds[0], nullptr, out, nullptr, n, 0);
+		assert(m == n);
+		progress += n;
+	}
+	assert(splice(in, nullptr, fds[1], nullptr, 16384, 0) == 0);
+	assert(readFile(dir.path + "/dst") == data);
+
+	// Explicit offsets on the file side.
+	off_t offset = 100;
+	assert(splice(in, &offset, fds[1], nullptr, 50, 0) == 50);
+	assert(offset == 150);
+	auto chunk = readPipe(fds[0], 50);
+	assert(std::equal(chunk.begin(), chunk.end(), data.begin() + 100));
+
+	// Offsets on the pipe side are not allowed.
+	offset = 0;
+	assert(splice(in, nullptr, fds[1], &offset, 50, 0) == -1);
+	assert(errno == ESPIPE);
+
+	// At least one side must be a pipe.
+	assert(splice(in, nullptr, out, nullptr, 50, 0) == -1);
+	assert(errno == EINVAL);
+
+	// The pipe is empty.
+	assert(splice(fds[0], nullptr, out, nullptr, 50, SPLICE_F_NONBLOCK) == -1);
+	assert(errno == EAGAIN);
+}
+
+// Reports the throughput of copying a file with a read()/write() loop,
+// copy_file_range() and sendfile().
+void bench_copies(std::string tmpl) {
+	constexpr size_t size = 16 * 1024 * 1024;
+
+	TempDir dir{std::move(tmpl)};
+	auto data = dir.create("/src", size);
+
+	auto bench = [&] (const char *what, auto copy) {
+		int in = open((dir.path + "/src").c_str(), O_RDONLY);
+		assert(in >= 0);
+		int out = open((dir.path + "/copy").c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		assert(out >= 0);
+
+		auto start = nanos_now();
+		copy(in, out);
+		auto elapsed = nanos_now() - start;
+
+		close(in);
+		close(out);
+		assert(readFile(dir.path + "/copy") == data);
+		std::cout << "posix-tests: " << what << " of " << (size >> 20) << " MiB in " << dir.path
+				<< ": " << (size * 1000 / (elapsed ? elapsed : 1)) << " MB/s" << std::endl;
+	};
+
+	bench("read()/write()", [] (int in, int out) {
+		std::vector<char> buffer(65536);
+		while(true) {
+			auto n = read(in, buffer.data(), buffer.size());
+			assert(n >= 0);
+			if(!n)
+				break;
+			auto m = write(out, buffer.data(), n);
+			assert(m == n);
+		}
+	});
+
+	bench("copy_file_range()", [] (int in, int out) {
+		while(true) {
+			auto n = copy_file_range(in, nullptr, out, nullptr, size, 0);
+			assert(n >= 0);
+			if(!n)
+				break;
+		}
+	});
+
+	bench("sendfile()", [] (int in, int out) {
+		while(true) {
+			auto n = sendfile(out, in, nullptr, size);
+			assert(n >= 0);
+			if(!n)
+				break;
+		}
+	});
+}
+
+} // namespace
+
+DEFINE_TEST(copy_file_range_tmpfs, ([] {
+	check_copy_file_range("/tmp/posix-tests-splice-XXXXXX");
+}))
+
+DEFINE_TEST(sendfile_tmpfs, ([] {
+	check_sendfile("/tmp/posix-tests-splice-XXXXXX");
+}))
+
+DEFINE_TEST(splice_tmpfs, ([] {
+	check_splice("/tmp/posix-tests-splice-XXXXXX");
+}))
+
+DEFINE_TEST(tee_pipes, ([] {
+	int a[2];
+	int b[2];
+	assert(!pipe(a));
+	assert(!pipe(b));
+	frg::scope_exit closeFds{[&] {
+		close(a[0]);
+		close(a[1]);
+		close(b[0]);
+		close(b[1]);
+	}};
+
+	// Nothing to duplicate yet.
+	assert(tee(a[0], b[1], 100, SPLICE_F_NONBLOCK) == -1);
+	assert(errno == EAGAIN);
+
+	auto data = pattern(1000);
+	writeFile(a[1], data);
+	assert(tee(a[0], b[1], 600, 0) == 600);
+
+	// tee() does not consume the data of the input pipe.
+	assert(readPipe(a[0], 1000) == data);
+	auto duplicated = readPipe(b[0], 600);
+	assert(std::equal(duplicated.begin(), duplicated.end(), data.begin()));
+
+	// Both sides must be pipes.
+	int fd = open("/dev/null", O_WRONLY);
+	assert(fd >= 0);
+	assert(tee(a[0], fd, 100, 0) == -1);
+	assert(errno == EINVAL);
+	close(fd);
+}))
+
+DEFINE_TEST(splice_pipes, ([] {
+	int a[2];
+	int b[2];
+	assert(!pipe(a));
+	assert(!pipe(b));
+	frg::scope_exit closeFds{[&] {
+		close(a[0]);
+		close(a[1]);
+		close(b[0]);
+		close(b[1]);
+	}};
+
+	// Spans multiple pages and ends within a page.
+	auto data = pattern(10000);
+	writeFile(a[1], data);
+	assert(splice(a[0], nullptr, b[1], nullptr, 6000, 0) == 6000);
+
+	// splice() consumes the data of the input pipe.
+	auto rest = readPipe(a[0], 4000);
+	assert(std::equal(rest.begin(), rest.end(), data.begin() + 6000));
+
+	// Writes after spliced data must not modify the spliced pages.
+	writeFile(b[1], pattern(100));
+	auto moved = readPipe(b[0], 6000);
+	assert(std::equal(moved.begin(), moved.end(), data.begin()));
+	assert(readPipe(b[0], 100) == pattern(100));
+}))
+
+DEFINE_BENCHMARK(bench_copies_tmpfs, ([] {
+	bench_copies("/tmp/posix-tests-splice-XXXXXX");
+}))
+
+#if defined(__managarm__)
+// The root file system is ext2 on Managarm, i.e., copy_file_range() copies on the server.
+DEFINE_TEST(copy_file_range_ext2, ([] {
+	check_copy_file_range("/posix-tests-splice-XXXXXX");
+}))
+
+DEFINE_TEST(sendfile_ext2, ([] {
+	check_sendfile("/posix-tests-splice-XXXXXX");
+}))
+
+DEFINE_TEST(splice_ext2, ([] {
+	check_splice("/posix-tests-splice-XXXXXX");
+}))
+
+DEFINE_BENCHMARK(bench_copies_ext2, ([] {
+	bench_copies("/posix-tests-splice-XXXXXX");
+}))
+#endif
@@ -1,14 +1,21 @@
 #pragma once
 
+#include <cassert>
 #include <cerrno>
+#include <cstdint>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <time.h>
 #include <utility>
 
 #define DEFINE_TEST(s, f) \
 	static test_case test_ ## s{#s, f};
 
+// Benchmarks are only run if posix-tests is invoked with --bench.
+#define DEFINE_BENCHMARK(s, f) \
+	static test_case test_ ## s{#s, f, true};
+
 // Thrown by skip_test() to abort a test without failing it (e.g. a missing environment feature).
 struct test_skipped {
 	const char *reason;
@@ -23,8 +30,8 @@ private:
 	static void register_case(abstract_test_case *tcp);
 
 public:
-	abstract_test_case(const char *name)
-	: name_{name} {
+	abstract_test_case(const char *name, bool benchmark)
+	: name_{name}, benchmark_{benchmark} {
 		register_case(this);
 	}
 
@@ -38,16 +45,21 @@ public:
 		return name_;
 	}
 
+	bool is_benchmark() {
+		return benchmark_;
+	}
+
 	virtual void run() = 0;
 
 private:
 	const char *name_;
+	bool benchmark_;
 };
 
 template<typename F>
 struct test_case : abstract_test_case {
-	test_case(const char *name, F functor)
-	: abstract_test_case{name}, functor_{std::move(functor)} { }
+	test_case(const char *name, F functor, bool benchmark = false)
+	: abstract_test_case{name, benchmark}, functor_{std::move(functor)} { }
 
 	void run() override {
 		functor_();
@@ -57,6 +69,15 @@ private:
 	F functor_;
 };
 
+// Returns the current time of CLOCK_MONOTONIC in nanoseconds (for benchmarks).
+inline uint64_t nanos_now() {
+	struct timespec ts;
+	int ret = clock_gettime(CLOCK_MONOTONIC, &ts);
+	assert(!ret);
+	(void)ret;
+	return ts.tv_sec * 1'000'000'000ULL + ts.tv_nsec;
+}
+
 #define assert_errno(fail_func, expr) ((void)(((expr) ? 1 : 0) || (assert_errno_fail(fail_func, #expr, __FILE__, __PRETTY_FUNCTION__, __LINE__), 0)))
 
 inline void assert_errno_fail(const char *fail_func, const char *expr,
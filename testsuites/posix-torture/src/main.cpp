@@ -1,3 +1,4 @@
+#include <chrono>
 #include <iostream>
 #include <vector>
 
@@ -18,8 +19,13 @@ int main() {
 		for(abstract_test_case *tcp : test_case_ptrs()) {
 			std::cout << "posix-torture: Running " << tcp->name()
 					<< " for " << n << " iterations" << std::endl;
+			auto start = std::chrono::steady_clock::now();
 			for(int i = 0; i < n; i++)
 				tcp->run();
+			auto elapsed = std::chrono::steady_clock::now() - start;
+			std::cout << "posix-torture: " << tcp->name() << " took "
+					<< std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() / n
+					<< " ns/iteration" << std::endl;
 		}
 	}
 }
@@ -0,0 +1,62 @@
+#include <cassert>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+#include "testsuite.hpp"
+
+// Measures the system call throughput of multiple concurrent processes.
+// The workers are processes (and not threads) since the POSIX server
+// serves all threads of a process on the same thread.
+
+namespace {
+
+constexpr int callsPerWorker = 256;
+
+template<typename F>
+void runWorkers(F functor) {
+	static const int numWorkers = [] {
+		auto n = sysconf(_SC_NPROCESSORS_ONLN);
+		return n > 0 ? static_cast<int>(n) : 1;
+	}();
+
+	std::vector<pid_t> pids;
+	for(int i = 0; i < numWorkers; i++) {
+		pid_t pid = fork();
+		assert(pid >= 0);
+		if(!pid) {
+			for(int j = 0; j < callsPerWorker; j++)
+				functor();
+			_exit(0);
+		}
+		pids.push_back(pid);
+	}
+
+	for(auto pid : pids) {
+		int status;
+		auto res = waitpid(pid, &status, 0);
+		assert(res == pid);
+		assert(WIFEXITED(status) && !WEXITSTATUS(status));
+	}
+}
+
+} // anonymous namespace
+
+DEFINE_TEST(parallel_stat, ([] {
+	runWorkers([] {
+		struct stat st;
+		int res = stat("/usr/bin", &st);
+		assert(!res);
+	});
+}))
+
+DEFINE_TEST(parallel_open_close, ([] {
+	runWorkers([] {
+		int fd = open("/dev/null", O_RDONLY);
+		assert(fd >= 0);
+		close(fd);
+	});
+}))
@@ -2,6 +2,7 @@
 
 import argparse
 import bisect
+import os
 import struct
 import subprocess
 
@@ -15,6 +16,14 @@ parser.add_argument('--line', action='store_true')
 parser.add_argument('--isn', action='store_true')
 parser.add_argument('--flamegraph', action='store_true',
 	help="output folded stacks for flamegraph.pl")
+parser.add_argument('--include-user', action='store_true',
+	help="include user space samples in the flamegraph")
+parser.add_argument('--per-thread', action='store_true',
+	help="put the sampled thread at the bottom of each stack (timer-based samples only)")
+parser.add_argument('--sysroot', type=str,
+	help="system root that the initrd was generated from (used to symbolize servers)")
+parser.add_argument('--maps', type=str, action='append', default=[],
+	help="/proc/<pid>/maps of a process whose samples should be symbolized")
 
 args = parser.parse_args()
 
@@ -62,6 +71,119 @@ def resolve_ip(ip):
 		else:
 			return f"{func} {line.split(':')[0]}"
 
+# Flags in the header word of each sample (see thor-internal/profile.hpp).
+FLAG_NO_INTS = 1
+FLAG_THREAD = 2
+
+# Symbolization of user space.
+# We cannot know the load addresses of the servers and their libraries from the profile alone.
+# Instead, we use /proc/<pid>/maps dumps to find the ELF files (relative to the sysroot).
+
+class Mapping:
+	__slots__ = ('start', 'end', 'offset', 'path')
+
+	def __init__(self, start, end, offset, path):
+		self.start = start
+		self.end = end
+		self.offset = offset
+		self.path = path
+
+def read_maps(path):
+	mappings = []
+	with open(path) as f:
+		for line in f:
+			fields = line.split(maxsplit=5)
+			if len(fields) < 6 or 'x' not in fields[1]:
+				continue
+			start, end = fields[0].split('-')
+			mappings.append(Mapping(int(start, 16), int(end, 16),
+					int(fields[2], 16), fields[5].strip()))
+	return mappings
+
+all_maps = [read_maps(path) for path in args.maps]
+
+class ElfSymbols:
+	def __init__(self, path):
+		# Program headers are needed to translate file offsets into virtual addresses.
+		self.loads = []
+		with open(path, 'rb') as f:
+			ehdr = f.read(64)
+			assert ehdr[:4] == b'\x7fELF' and ehdr[4] == 2, f"{path} is not an ELF64 file"
+			phoff, = struct.unpack_from('<Q', ehdr, 32)
+			phentsize, phnum = struct.unpack_from('<HH', ehdr, 54)
+			for i in range(phnum):
+				f.seek(phoff + i * phentsize)
+				p_type, _, p_offset, p_vaddr, _, p_filesz = struct.unpack('<IIQQQQ', f.read(40))
+				if p_type == 1: # PT_LOAD
+					self.loads.append((p_offset, p_vaddr, p_filesz))
+
+		nm = subprocess.check_output(['llvm-nm', '-nC', '--defined-only', path],
+				encoding='ascii', stderr=subprocess.DEVNULL)
+		self.table = []
+		for line in nm.splitlines():
+			start, attr, symbol = line.split(' ', 2)
+			if attr.lower() in ('t', 'w'):
+				self.table.append((int(start, 16), symbol))
+		self.index = [e[0] for e in self.table]
+
+	def resolve(self, offset):
+		for p_offset, p_vaddr, p_filesz in self.loads:
+			if p_offset <= offset < p_offset + p_filesz:
+				vaddr = offset - p_offset + p_vaddr
+				break
+		else:
+			return None
+		idx = bisect.bisect_right(self.index, vaddr)
+		if idx == 0:
+			return None
+		return self.table[idx - 1][1]
+
+elf_cache = dict()
+
+def get_elf(path):
+	if path not in elf_cache:
+		elf_cache[path] = None
+		if args.sysroot:
+			full = os.path.join(args.sysroot, path.lstrip('/'))
+			if os.path.isfile(full):
+				elf_cache[path] = ElfSymbols(full)
+	return elf_cache[path]
+
+def find_mapping(maps, ip):
+	for m in maps:
+		if m.start <= ip < m.end:
+			return m
+	return None
+
+# Remember which maps file belongs to which thread.
+thread_maps = dict()
+
+def find_user_maps(thread, ips):
+	if thread is not None and thread in thread_maps:
+		return thread_maps[thread]
+	# Pick the process that explains most of the user IPs.
+	best = None
+	best_hits = 0
+	for maps in all_maps:
+		hits = sum(1 for ip in ips if ip < (1 << 63) and find_mapping(maps, ip))
+		if hits > best_hits:
+			best = maps
+			best_hits = hits
+	if thread is not None and best is not None:
+		thread_maps[thread] = best
+	return best
+
+def resolve_user_ip(maps, ip):
+	if maps:
+		m = find_mapping(maps, ip)
+		if m:
+			elf = get_elf(m.path)
+			symbol = elf.resolve(ip - m.start + m.offset) if elf else None
+			if symbol:
+				return symbol
+			return f"{os.path.basename(m.path)}+{hex(ip - m.start + m.offset)}"
+	return f"[user {hex(ip)}]"
+
 n_traces = 0
 n_noints = 0
 n_user = 0
@@ -77,6 +199,10 @@ with open(args.profile_path, 'rb') as f:
 		flags = cf >> 32
 		count = cf & 0xFFFFFFFF
 
+		thread = None
+		if flags & FLAG_THREAD:
+			thread = struct.unpack('Q', f.read(8))[0]
+
 		ips = []
 		for i in range(count):
 			rec = f.read(8)
@@ -84,7 +210,7 @@ with open(args.profile_path, 'rb') as f:
 				break
 			ips.append(struct.unpack('Q', rec)[0])
 
-		if flags & 1:
+		if flags & FLAG_NO_INTS:
 			n_noints += 1
 		elif args.no_ints_only:
 			continue
@@ -97,14 +223,18 @@ with open(args.profile_path, 'rb') as f:
 				any_user = True
 			else:
 				n_kernel += 1
-		if any_user:
+		if any_user and not (args.flamegraph and args.include_user):
 			continue
 
 		if args.flamegraph:
 			# Resolve all IPs in the stack trace
 			symbols = []
+			user_maps = find_user_maps(thread, ips) if any_user else None
 			for ip in ips:
-				symbol = resolve_ip(ip)
+				if ip < (1 << 63):
+					symbol = resolve_user_ip(user_maps, ip)
+				else:
+					symbol = resolve_ip(ip)
 				if symbol:
 					if ";" in symbol:
 						raise RuntimeError(f"Unexpected semicolon in symbol: {symbol}")
@@ -112,6 +242,8 @@ with open(args.profile_path, 'rb') as f:
 					n_resolved += 1
 
 			if symbols:
+				if args.per_thread and thread is not None:
+					symbols.append(f"[thread {thread:016x}]")
 				# Reverse to get bottom of stack first.
 				loc = ';'.join(reversed(symbols))
 				if loc in profile: